@@ -0,0 +1,705 @@
+//
+// Micro-benchmarks of the hot paths: the BPF emulator, the decoders, the DNS parser and
+// the output encoders.
+//
+// Frames are synthesized in memory, so no privileges or network are needed. Each result
+// is printed on its own line as space-separated key=value pairs, e.g.
+//
+//	bench=bpf name=port_53 frames=4096 packets=1234567 ns_per_packet=12.34 packets_per_second=81037277
+//
+// so that runs can be diffed or fed to a spreadsheet to catch regressions across releases.
+//
+
+#include "base64.h"
+#include "bpf/bpf_filter.h"
+#include "bpf/bpf_vm.h"
+#include "config.h"
+#include "dump.h"
+#include "macros.h"
+#include "output.h"
+#include "packet.h"
+#include "proto/dns/header.h"
+#include "proto/dns/name_filter.h"
+#include "proto/dns/pdns.h"
+#include "proto/dns/sections/question.h"
+#include "proto/dns/sections/rr.h"
+#include "proto/dns/types.h"
+#include "proto_ops.h"
+#include "types/buffer.h"
+#include "version.h"
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <net/ethernet.h>
+#include <netinet/in.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define BENCH_DEFAULT_FRAMES	4096
+#define BENCH_DEFAULT_SECONDS	0.5
+#define BENCH_FRAME_MAXSIZE		1514
+
+//
+// Types
+//
+typedef struct frame {
+	uint8_t data[BENCH_FRAME_MAXSIZE];
+	uint32_t length;
+	uint32_t dns_offset;	// where the DNS message starts, 0 if there's none
+	uint32_t dns_length;
+} frame_t;
+
+typedef struct bench_opts {
+	size_t frames;
+	double seconds;
+	uint64_t seed;
+	const char *only; // run only the benchmarks whose group matches
+} bench_opts_t;
+
+// Keeps the compiler from optimizing the measured calls away
+static volatile uint64_t g_sink;
+
+//
+// Random numbers (xorshift64*, deterministic across platforms)
+//
+static uint64_t g_rng_state;
+
+static uint32_t rng_next(void) {
+	g_rng_state ^= g_rng_state >> 12;
+	g_rng_state ^= g_rng_state << 25;
+	g_rng_state ^= g_rng_state >> 27;
+	return (uint32_t)((g_rng_state * 0x2545F4914F6CDD1DULL) >> 32);
+}
+
+static uint32_t rng_range(uint32_t min, uint32_t max) {
+	return min + rng_next() % (max - min + 1);
+}
+
+//
+// Frame synthesis
+//
+static uint8_t *put16(uint8_t *ptr, uint16_t value) {
+	ptr[0] = (uint8_t)(value >> 8);
+	ptr[1] = (uint8_t)value;
+	return ptr + 2;
+}
+
+static uint8_t *put32(uint8_t *ptr, uint32_t value) {
+	ptr = put16(ptr, (uint16_t)(value >> 16));
+	return put16(ptr, (uint16_t)value);
+}
+
+static uint8_t *put_ether(uint8_t *ptr, uint16_t type) {
+	static const uint8_t dst[6] = { 0x00, 0x11, 0x22, 0x33, 0x44, 0x55 };
+	static const uint8_t src[6] = { 0x66, 0x77, 0x88, 0x99, 0xaa, 0xbb };
+	memcpy(ptr, dst, 6);
+	memcpy(ptr + 6, src, 6);
+	return put16(ptr + 12, type);
+}
+
+static uint8_t *put_ipv4(uint8_t *ptr, uint8_t protocol, uint16_t payload_length) {
+	ptr[0] = 0x45; // version 4, 20 byte header
+	ptr[1] = 0;
+	put16(ptr + 2, (uint16_t)(20 + payload_length));
+	put16(ptr + 4, (uint16_t)rng_next()); // id
+	put16(ptr + 6, 0x4000); // don't fragment
+	ptr[8] = 64; // ttl
+	ptr[9] = protocol;
+	put16(ptr + 10, 0); // checksum, nobody verifies it
+	put32(ptr + 12, 0x0a000000 | rng_range(1, 0xffff)); // 10.0.x.x
+	put32(ptr + 16, rng_next() % 4 == 0 ? 0x0a000001 : 0xc0a80000 | rng_range(1, 0xff)); // 10.0.0.1 or 192.168.0.x
+	return ptr + 20;
+}
+
+static uint8_t *put_ipv6(uint8_t *ptr, uint8_t next_header, uint16_t payload_length) {
+	memset(ptr, 0, 40);
+	ptr[0] = 0x60;
+	put16(ptr + 4, payload_length);
+	ptr[6] = next_header;
+	ptr[7] = 64; // hop limit
+	put32(ptr + 8, 0x20010db8);
+	put32(ptr + 20, rng_next());
+	put32(ptr + 24, 0x20010db8);
+	put32(ptr + 36, rng_next());
+	return ptr + 40;
+}
+
+static uint8_t *put_udp(uint8_t *ptr, uint16_t sport, uint16_t dport, uint16_t payload_length) {
+	put16(ptr, sport);
+	put16(ptr + 2, dport);
+	put16(ptr + 4, (uint16_t)(8 + payload_length));
+	put16(ptr + 6, 0);
+	return ptr + 8;
+}
+
+static uint8_t *put_tcp(uint8_t *ptr, uint16_t sport, uint16_t dport) {
+	put16(ptr, sport);
+	put16(ptr + 2, dport);
+	put32(ptr + 4, rng_next()); // seq
+	put32(ptr + 8, rng_next()); // ack
+	ptr[12] = 5 << 4; // 20 byte header
+	ptr[13] = 0x10; // ACK
+	put16(ptr + 14, 65535); // window
+	put16(ptr + 16, 0); // checksum
+	put16(ptr + 18, 0); // urgent pointer
+	return ptr + 20;
+}
+
+static uint8_t *put_name(uint8_t *ptr) {
+	static const char *const labels[] = {
+		"www", "mail", "api", "cdn", "example", "test", "static", "login", "img", "news",
+	};
+	static const char *const tlds[] = { "com", "net", "org", "io" };
+	int count = (int)rng_range(1, 3);
+	for (int i = 0; i < count; i++) {
+		const char *label = labels[rng_next() % (sizeof(labels) / sizeof(labels[0]))];
+		size_t len = strlen(label);
+		*ptr++ = (uint8_t)len;
+		memcpy(ptr, label, len);
+		ptr += len;
+	}
+	const char *tld = tlds[rng_next() % (sizeof(tlds) / sizeof(tlds[0]))];
+	*ptr++ = (uint8_t)strlen(tld);
+	memcpy(ptr, tld, strlen(tld));
+	ptr += strlen(tld);
+	*ptr++ = 0;
+	return ptr;
+}
+
+// A query with one question, or a response with a CNAME chain and a few A records
+static uint16_t put_dns(uint8_t *ptr, bool response) {
+	static const uint16_t qtypes[] = { 1, 1, 1, 28, 28, 5, 15, 16, 12 }; // mostly A and AAAA
+	uint8_t *start = ptr;
+	uint16_t answers = response ? (uint16_t)rng_range(1, 6) : 0;
+	uint16_t qtype = qtypes[rng_next() % (sizeof(qtypes) / sizeof(qtypes[0]))];
+
+	ptr = put16(ptr, (uint16_t)rng_next()); // id
+	ptr = put16(ptr, response ? 0x8180 : 0x0100);
+	ptr = put16(ptr, 1);
+	ptr = put16(ptr, answers);
+	ptr = put16(ptr, 0);
+	ptr = put16(ptr, 0);
+	ptr = put_name(ptr);
+	ptr = put16(ptr, qtype);
+	ptr = put16(ptr, 1); // IN
+
+	for (uint16_t i = 0; i < answers; i++) {
+		ptr = put16(ptr, 0xc00c); // pointer to the question name
+		if (i == 0 && answers > 2) {
+			ptr = put16(ptr, 5); // CNAME
+			ptr = put16(ptr, 1);
+			ptr = put32(ptr, rng_range(30, 86400));
+			uint8_t *rdlen = ptr;
+			ptr = put_name(ptr + 2);
+			put16(rdlen, (uint16_t)(ptr - rdlen - 2));
+		} else {
+			ptr = put16(ptr, 1); // A
+			ptr = put16(ptr, 1);
+			ptr = put32(ptr, rng_range(30, 86400));
+			ptr = put16(ptr, 4);
+			ptr = put32(ptr, rng_next());
+		}
+	}
+	return (uint16_t)(ptr - start);
+}
+
+// TCP segment sizes are bimodal: pure ACKs and full segments, with some in between
+static uint16_t tcp_payload_length(void) {
+	uint32_t dice = rng_next() % 10;
+	if (dice < 5)
+		return 0;
+	if (dice < 7)
+		return (uint16_t)rng_range(100, 600);
+	return 1460;
+}
+
+static void make_frame(frame_t *frame) {
+	static const uint16_t tcp_ports[] = { 443, 443, 443, 80, 22, 8080 };
+	uint8_t *ptr = frame->data;
+	uint32_t dice = rng_next() % 100;
+	frame->dns_offset = 0;
+	frame->dns_length = 0;
+
+	if (dice < 45) { // IPv4 TCP
+		uint16_t payload = tcp_payload_length();
+		ptr = put_ether(ptr, ETHERTYPE_IP);
+		ptr = put_ipv4(ptr, IPPROTO_TCP, (uint16_t)(20 + payload));
+		ptr = put_tcp(ptr, (uint16_t)rng_range(1024, 65535), tcp_ports[rng_next() % 6]);
+		memset(ptr, 0xab, payload);
+		ptr += payload;
+	} else if (dice < 60) { // IPv4 UDP (QUIC, NTP, ...)
+		uint16_t payload = (uint16_t)rng_range(48, 1200);
+		ptr = put_ether(ptr, ETHERTYPE_IP);
+		ptr = put_ipv4(ptr, IPPROTO_UDP, (uint16_t)(8 + payload));
+		ptr = put_udp(ptr, (uint16_t)rng_range(1024, 65535), rng_next() % 2 ? 443 : 123, payload);
+		memset(ptr, 0xcd, payload);
+		ptr += payload;
+	} else if (dice < 80) { // IPv4 DNS, half queries and half responses
+		bool response = dice >= 70;
+		uint8_t dns[512];
+		uint16_t payload = put_dns(dns, response);
+		uint16_t port = (uint16_t)rng_range(1024, 65535);
+		ptr = put_ether(ptr, ETHERTYPE_IP);
+		ptr = put_ipv4(ptr, IPPROTO_UDP, (uint16_t)(8 + payload));
+		ptr = put_udp(ptr, response ? 53 : port, response ? port : 53, payload);
+		frame->dns_offset = (uint32_t)(ptr - frame->data);
+		frame->dns_length = payload;
+		memcpy(ptr, dns, payload);
+		ptr += payload;
+	} else if (dice < 95) { // IPv6 TCP
+		uint16_t payload = tcp_payload_length();
+		if (payload > 1440)
+			payload = 1440; // the IPv6 header is 20 bytes larger
+		ptr = put_ether(ptr, ETHERTYPE_IPV6);
+		ptr = put_ipv6(ptr, IPPROTO_TCP, (uint16_t)(20 + payload));
+		ptr = put_tcp(ptr, (uint16_t)rng_range(1024, 65535), 443);
+		memset(ptr, 0xef, payload);
+		ptr += payload;
+	} else { // IPv6 UDP
+		uint16_t payload = (uint16_t)rng_range(48, 1200);
+		ptr = put_ether(ptr, ETHERTYPE_IPV6);
+		ptr = put_ipv6(ptr, IPPROTO_UDP, (uint16_t)(8 + payload));
+		ptr = put_udp(ptr, (uint16_t)rng_range(1024, 65535), 443, payload);
+		memset(ptr, 0x12, payload);
+		ptr += payload;
+	}
+
+	frame->length = (uint32_t)(ptr - frame->data);
+	if (frame->length < 60) { // Ethernet minimum frame size, without the FCS
+		memset(ptr, 0, 60 - frame->length);
+		frame->length = 60;
+	}
+}
+
+//
+// Measurement
+//
+static double now_seconds(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+// Runs `fn` over the frames, round after round, until `seconds` have elapsed
+#define BENCH_RUN(opts, group, name, frames, count, body) \
+	do { \
+		uint64_t packets_ = 0; \
+		double start_ = now_seconds(), elapsed_; \
+		do { \
+			for (size_t i_ = 0; i_ < (count); i_++) { \
+				const frame_t *frame = &(frames)[i_]; \
+				body; \
+			} \
+			packets_ += (count); \
+			elapsed_ = now_seconds() - start_; \
+		} while (elapsed_ < (opts)->seconds); \
+		report(group, name, count, packets_, elapsed_); \
+	} while (0)
+
+static void report(const char *group, const char *name, size_t frames, uint64_t packets, double elapsed) {
+	printf("bench=%s name=%s frames=%zu packets=%llu ns_per_packet=%.2f packets_per_second=%.0f\n",
+		group, name, frames, (unsigned long long)packets,
+		elapsed * 1e9 / (double)packets, (double)packets / elapsed);
+	fflush(stdout);
+}
+
+static bool selected(const bench_opts_t *opts, const char *group) {
+	return opts->only == NULL || strcmp(opts->only, group) == 0;
+}
+
+static void bench_bpf_program(const bench_opts_t *opts, const char *name, const bpf_program_t *program,
+	const frame_t *frames, size_t count)
+{
+	uint64_t accepted = 0;
+	BENCH_RUN(opts, "bpf", name, frames, count, {
+		accepted += bpf_execute_filter(program, frame->data, frame->length) != 0;
+	});
+
+	// The same, a batch at a time through the prefilter, as the emulated filter of a channel
+	bpf_prefilter_t prefilter;
+	bpf_compile_prefilter(program, &prefilter);
+	const uint8_t *packets[BPF_BATCH_MAX];
+	uint32_t lengths[BPF_BATCH_MAX], results[BPF_BATCH_MAX];
+	uint32_t pending = 0;
+	char batch_name[64];
+	snprintf(batch_name, sizeof(batch_name), "%s_batch", name);
+	BENCH_RUN(opts, "bpf", batch_name, frames, count, {
+		packets[pending] = frame->data;
+		lengths[pending] = frame->length;
+		if (++pending == BPF_BATCH_MAX) {
+			bpf_execute_filter_batch(program, &prefilter, packets, lengths, pending, results);
+			for (uint32_t i = 0; i < pending; i++)
+				accepted += results[i] != 0;
+			pending = 0;
+		}
+	});
+	g_sink += accepted;
+}
+
+static void bench_bpf(const bench_opts_t *opts, const frame_t *frames, size_t count) {
+	static const struct {
+		const char *name;
+		const char *expression;
+	} expressions[] = {
+		{ "expr_ip",				"ip" },
+		{ "expr_tcp",				"tcp" },
+		{ "expr_udp",				"udp" },
+		{ "expr_dns",				"dns" },
+		{ "expr_host",				"host 10.0.0.1" },
+		{ "expr_port_53",			"port 53" },
+		{ "expr_port_443",			"port 443" },
+	};
+	bpf_program_t program = { 0, NULL };
+
+	// The generators, called directly
+	if (bpf_create_empty_filter(BPF_DEFAULT_SNAPLEN, &program) == 0) {
+		bench_bpf_program(opts, "empty", &program, frames, count);
+		bpf_free_program(&program);
+	}
+	if (bpf_create_host_filter("10.0.0.1", BPF_DEFAULT_SNAPLEN, &program) == 0) {
+		bench_bpf_program(opts, "host", &program, frames, count);
+		bpf_free_program(&program);
+	}
+	if (bpf_create_port_filter(53, BPF_DEFAULT_SNAPLEN, &program) == 0) {
+		bench_bpf_program(opts, "port", &program, frames, count);
+		bpf_free_program(&program);
+	}
+	static const char *const protocols[] = { "arp", "ip", "ipv6", "tcp", "udp", "icmp" };
+	for (size_t i = 0; i < sizeof(protocols) / sizeof(protocols[0]); i++) {
+		if (bpf_create_protocol_filter(protocols[i], BPF_DEFAULT_SNAPLEN, &program) != 0)
+			continue;
+		char name[32];
+		snprintf(name, sizeof(name), "protocol_%s", protocols[i]);
+		bench_bpf_program(opts, name, &program, frames, count);
+		bpf_free_program(&program);
+	}
+
+	// Whatever the expression compiler makes of them
+	for (size_t i = 0; i < sizeof(expressions) / sizeof(expressions[0]); i++) {
+		if (bpf_compile_filter(expressions[i].expression, BPF_DEFAULT_SNAPLEN, &program) != 0) {
+			fprintf(stderr, "Skipping %s: failed to compile '%s'\n", expressions[i].name, expressions[i].expression);
+			continue;
+		}
+		bench_bpf_program(opts, expressions[i].name, &program, frames, count);
+		bpf_free_program(&program);
+	}
+}
+
+// The decoders with every display filter off, i.e. what they cost without any output
+static void bench_decode(const bench_opts_t *opts, const frame_t *frames, size_t count) {
+	config_t config;
+	memset(&config, 0, sizeof(config));
+	sniff_pipeline_init(&config.pipeline, &config);
+	uint64_t errors = 0;
+
+	BENCH_RUN(opts, "decode", "all", frames, count, {
+		sniff_packet_t desc = SNIFF_PACKET_INITIALIZER;
+		desc.data = frame->data;
+		desc.caplen = frame->length;
+		desc.wirelen = frame->length;
+		errors += sniff_packet_fromwire(&desc, 0, &config) != 0;
+	});
+
+	// Same, but counted, as a channel does
+	stats_counters_t *stats = stats_counters_alloc();
+	if (stats != NULL) {
+		BENCH_RUN(opts, "decode", "count", frames, count, {
+			sniff_packet_t desc = SNIFF_PACKET_INITIALIZER;
+			desc.data = frame->data;
+			desc.caplen = frame->length;
+			desc.wirelen = frame->length;
+			desc.stats = stats;
+			errors += sniff_packet_fromwire(&desc, 0, &config) != 0;
+		});
+		stats_counters_free(stats);
+	}
+	g_sink += errors;
+}
+
+static int parse_dns_message(const uint8_t *data, uint32_t length) {
+	buffer_t buffer = BUFFER_INITIALIZER;
+	buffer_set_data(&buffer, (uint8_t *)data, length);
+
+	dns_hdr_t header;
+	if (decode_header(&header, &buffer) != 0)
+		return -1;
+	int result = 0;
+	for (uint16_t i = 0; i < header.qd_c && result == 0; i++) {
+		dns_question_t *question = parse_question(&buffer);
+		if (question == NULL)
+			result = -1;
+		free_question(question);
+	}
+	uint32_t records = (uint32_t)header.an_c + header.ns_c + header.ar_c;
+	for (uint32_t i = 0; i < records && result == 0; i++) {
+		dns_rr_t *rr = parse_rr(&buffer);
+		if (rr == NULL)
+			result = -1;
+		free_rr(rr);
+	}
+	return result;
+}
+
+// Through the decoder of the pipeline, no further than `level`
+static int decode_dns_level(stats_counters_t *stats, const frame_t *frame, dns_decode_level_e level) {
+	sniff_packet_t desc = SNIFF_PACKET_INITIALIZER;
+	desc.stats = stats;
+	return sniff_dns_decode(frame->data + frame->dns_offset, frame->dns_length, &desc, level, false);
+}
+
+// What --dns-name costs a query, see match_names() in proto_ops_dns.c
+static int match_dns_question(const dns_name_filter_t *names, const uint8_t *data, uint32_t length) {
+	buffer_t buffer = BUFFER_INITIALIZER;
+	buffer_set_data(&buffer, (uint8_t *)data, length);
+
+	dns_hdr_t header;
+	if (decode_header(&header, &buffer) != 0)
+		return -1;
+	if (header.qd_c == 0)
+		return 0;
+	int ret = dns_name_filter_match(names, &buffer);
+	if (ret < 0)
+		return -1;
+	g_sink += (uint64_t)ret;
+	return 0;
+}
+
+// A few of the zones that put_name() generates, plus `extra` random ones that it never does
+static dns_name_filter_t *make_name_filter(size_t extra) {
+	static const char *const zones[] = { "example.com", "cdn.net", "test.io", "www.login.org" };
+	dns_name_filter_t *names = dns_name_filter_alloc();
+	if (names == NULL)
+		return NULL;
+	for (size_t i = 0; i < sizeof(zones) / sizeof(zones[0]); i++)
+		dns_name_filter_add(names, zones[i]);
+	for (size_t i = 0; i < extra; i++) {
+		char suffix[64];
+		snprintf(suffix, sizeof(suffix), "z%08x.%s", rng_next(), i % 2 == 0 ? "com" : "www.example.net");
+		if (dns_name_filter_add(names, suffix) < 0) {
+			dns_name_filter_free(names);
+			return NULL;
+		}
+	}
+	return names;
+}
+
+// Adds the answers that a passive DNS store sees again, and then the new ones it has to drop once
+// it holds DNS_PDNS_MAX_TUPLES that weren't flushed yet. The store is flushed to /dev/null.
+static void bench_pdns(const bench_opts_t *opts, const frame_t *frames, size_t count) {
+	dns_pdns_t *pdns = dns_pdns_open("/dev/null");
+	if (pdns == NULL)
+		return;
+	uint32_t address = 0;
+	uint64_t added = 0;
+	for (size_t i = 0; i < count; i++) {
+		uint8_t rdata[4];
+		put32(rdata, address++);
+		dns_pdns_add(pdns, "bench.example.com", DNS_TYPE_A, rdata, sizeof(rdata), 1);
+	}
+	uint32_t seen = 0;
+	BENCH_RUN(opts, "dns", "pdns_add_seen", frames, count, {
+		UNUSED(frame);
+		uint8_t rdata[4];
+		put32(rdata, seen++ % (uint32_t)count);
+		added += dns_pdns_add(pdns, "bench.example.com", DNS_TYPE_A, rdata, sizeof(rdata), 2) == 0;
+	});
+	while (address < DNS_PDNS_MAX_TUPLES) {
+		uint8_t rdata[4];
+		put32(rdata, address++);
+		dns_pdns_add(pdns, "bench.example.com", DNS_TYPE_A, rdata, sizeof(rdata), 3);
+	}
+	BENCH_RUN(opts, "dns", "pdns_add_full", frames, count, {
+		UNUSED(frame);
+		uint8_t rdata[4];
+		put32(rdata, address++);
+		added += dns_pdns_add(pdns, "bench.example.com", DNS_TYPE_A, rdata, sizeof(rdata), 4) > 0;
+	});
+	g_sink += added;
+	dns_pdns_close(pdns);
+}
+
+static void bench_dns(const bench_opts_t *opts, const frame_t *frames, size_t count) {
+	// Only the frames that carry DNS, split by direction
+	frame_t *queries = malloc(count * sizeof(frame_t));
+	frame_t *responses = malloc(count * sizeof(frame_t));
+	stats_counters_t *stats = stats_counters_alloc();
+	size_t query_count = 0, response_count = 0;
+	if (queries == NULL || responses == NULL || stats == NULL)
+		goto out;
+	for (size_t i = 0; i < count; i++) {
+		if (frames[i].dns_offset == 0)
+			continue;
+		bool response = frames[i].data[frames[i].dns_offset + 2] & 0x80;
+		if (response)
+			responses[response_count++] = frames[i];
+		else
+			queries[query_count++] = frames[i];
+	}
+
+	uint64_t errors = 0;
+	if (query_count > 0) {
+		BENCH_RUN(opts, "dns", "parse_queries", queries, query_count, {
+			errors += parse_dns_message(frame->data + frame->dns_offset, frame->dns_length) != 0;
+		});
+		BENCH_RUN(opts, "dns", "decode_header_queries", queries, query_count, {
+			errors += decode_dns_level(stats, frame, DNS_DECODE_HEADER) != 0;
+		});
+		BENCH_RUN(opts, "dns", "decode_question_queries", queries, query_count, {
+			errors += decode_dns_level(stats, frame, DNS_DECODE_QUESTION) != 0;
+		});
+		// The cost per query should be the same however many suffixes there are
+		dns_name_filter_t *few = make_name_filter(0);
+		dns_name_filter_t *many = make_name_filter(100000);
+		if (few != NULL && many != NULL) {
+			BENCH_RUN(opts, "dns", "name_filter_4_queries", queries, query_count, {
+				errors += match_dns_question(few, frame->data + frame->dns_offset, frame->dns_length) != 0;
+			});
+			BENCH_RUN(opts, "dns", "name_filter_100k_queries", queries, query_count, {
+				errors += match_dns_question(many, frame->data + frame->dns_offset, frame->dns_length) != 0;
+			});
+		}
+		dns_name_filter_free(few);
+		dns_name_filter_free(many);
+	}
+	if (response_count > 0) {
+		BENCH_RUN(opts, "dns", "parse_responses", responses, response_count, {
+			errors += parse_dns_message(frame->data + frame->dns_offset, frame->dns_length) != 0;
+		});
+		BENCH_RUN(opts, "dns", "decode_question_responses", responses, response_count, {
+			errors += decode_dns_level(stats, frame, DNS_DECODE_QUESTION) != 0;
+		});
+	}
+	g_sink += errors;
+	bench_pdns(opts, frames, count);
+
+out:
+	stats_counters_free(stats);
+	free(queries);
+	free(responses);
+}
+
+// The encoders of the fields that aren't plain numbers or strings, over whole frames
+static void bench_encode(const bench_opts_t *opts, const frame_t *frames, size_t count) {
+	static char encoded[dump_hex_buffer_size(BENCH_FRAME_MAXSIZE)];
+	uint64_t length = 0;
+
+	BENCH_RUN(opts, "encode", "base64", frames, count, {
+		length += base64_encode_unterminated(encoded, frame->data, frame->length);
+	});
+	// What the *-data display filters cost in the text format
+	BENCH_RUN(opts, "encode", "hex_dump", frames, count, {
+		length += dump_hex_to_buffer(encoded, frame->data, frame->length, 0);
+	});
+	g_sink += length;
+
+	// What -f jsonl -d dns costs a DNS response, from the Ethernet header to the write() of
+	// each batch of 16 records, to /dev/null
+	frame_t *responses = malloc(count * sizeof(frame_t));
+	int fd = open("/dev/null", O_WRONLY | O_CLOEXEC);
+	output_t *out = fd >= 0 ? output_alloc(OUTPUT_FORMAT_JSONL, fd) : NULL;
+	size_t response_count = 0;
+	if (responses != NULL && out != NULL) {
+		for (size_t i = 0; i < count; i++) {
+			if (frames[i].dns_offset != 0 && (frames[i].data[frames[i].dns_offset + 2] & 0x80))
+				responses[response_count++] = frames[i];
+		}
+	}
+	if (response_count > 0) {
+		config_t config;
+		memset(&config, 0, sizeof(config));
+		config.display_filters_flag.dns = true;
+		sniff_pipeline_init(&config.pipeline, &config);
+		uint64_t errors = 0, records = 0;
+		BENCH_RUN(opts, "encode", "dns_jsonl", responses, response_count, {
+			sniff_packet_t desc = SNIFF_PACKET_INITIALIZER;
+			desc.data = frame->data;
+			desc.caplen = frame->length;
+			desc.wirelen = frame->length;
+			desc.output = out;
+			output_begin_record(out);
+			errors += sniff_packet_fromwire(&desc, 0, &config) != 0;
+			output_end_record(out);
+			if (++records % 16 == 0)
+				output_flush(out);
+		});
+		g_sink += errors;
+	}
+	output_free(out);
+	if (fd >= 0)
+		close(fd);
+	free(responses);
+}
+
+static void usage(const char *exename) {
+	fprintf(stderr,
+		"Usage: %s [OPTIONS]\n"
+		"\n"
+		"Options:\n"
+		"  -b, --bench=name      Run only one group of benchmarks: bpf, decode, dns or encode.\n"
+		"  -n, --frames=count    Number of distinct synthetic frames. Default is %d.\n"
+		"  -t, --time=seconds    Minimum duration of each benchmark. Default is %.1f.\n"
+		"  -s, --seed=number     Seed of the frame generator. Default is 1.\n"
+		"  -h, --help            Display this help and exit.\n",
+		exename, BENCH_DEFAULT_FRAMES, BENCH_DEFAULT_SECONDS);
+}
+
+int main(int argc, char **argv) {
+	static const struct option options[] = {
+		{ "bench",	required_argument,	NULL, 'b' },
+		{ "frames",	required_argument,	NULL, 'n' },
+		{ "time",	required_argument,	NULL, 't' },
+		{ "seed",	required_argument,	NULL, 's' },
+		{ "help",	no_argument,		NULL, 'h' },
+		{ NULL,		no_argument,		NULL,  0  },
+	};
+	bench_opts_t opts = { BENCH_DEFAULT_FRAMES, BENCH_DEFAULT_SECONDS, 1, NULL };
+
+	int opt;
+	while ((opt = getopt_long(argc, argv, "b:n:t:s:h", options, NULL)) != -1) {
+		switch (opt) {
+			case 'b': opts.only = optarg; break;
+			case 'n': opts.frames = strtoul(optarg, NULL, 10); break;
+			case 't': opts.seconds = strtod(optarg, NULL); break;
+			case 's': opts.seed = strtoull(optarg, NULL, 10); break;
+			case 'h': usage(argv[0]); return EXIT_SUCCESS;
+			default: usage(argv[0]); return EXIT_FAILURE;
+		}
+	}
+	if (opts.frames == 0 || opts.seconds <= 0) {
+		usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	frame_t *frames = malloc(opts.frames * sizeof(frame_t));
+	if (frames == NULL) {
+		fprintf(stderr, "Error allocating %zu frames\n", opts.frames);
+		return EXIT_FAILURE;
+	}
+	g_rng_state = opts.seed != 0 ? opts.seed : 1; // xorshift gets stuck at zero
+	uint64_t total_bytes = 0;
+	for (size_t i = 0; i < opts.frames; i++) {
+		make_frame(&frames[i]);
+		total_bytes += frames[i].length;
+	}
+
+	printf("bench=info version=%s frames=%zu avg_frame_bytes=%.1f seed=%llu\n",
+		PACKAGE_VERSION, opts.frames, (double)total_bytes / (double)opts.frames,
+		(unsigned long long)opts.seed);
+
+	if (selected(&opts, "bpf"))
+		bench_bpf(&opts, frames, opts.frames);
+	if (selected(&opts, "decode"))
+		bench_decode(&opts, frames, opts.frames);
+	if (selected(&opts, "dns"))
+		bench_dns(&opts, frames, opts.frames);
+	if (selected(&opts, "encode"))
+		bench_encode(&opts, frames, opts.frames);
+
+	free(frames);
+	return EXIT_SUCCESS;
+}
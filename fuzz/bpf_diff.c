@@ -0,0 +1,560 @@
+//
+// Differential fuzzer of the BPF emulator against the kernel.
+//
+// Random programs that the kernel's checker accepts are run against random packets by both
+// bpf_execute_filter() and the kernel, and their verdicts must match. Otherwise the same
+// filter would give different results with and without `-E`.
+//
+// On Linux the kernel side is a socket filter attached to one end of an AF_UNIX datagram
+// socketpair, which needs no privileges. Each packet is sent through the pair, and the
+// verdict is whether it arrives and how many bytes are left after the filter cuts it.
+// Where that isn't available, the emulator is compared against the reference model below,
+// which follows the same rules the kernel does.
+//
+// The packets of each program are also run through bpf_execute_filter_batch(), whose verdicts
+// must match those of bpf_execute_filter(). To give its prefilter something to lift out, some
+// programs start with checks like those of the compiled filters.
+//
+// Mismatches are printed with the program and the packet, and make the exit status fail.
+//
+
+#include "bpf/bpf_types.h"
+#include "bpf/bpf_vm.h"
+#include "version.h"
+#include <errno.h>
+#include <getopt.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+#define FUZZ_DEFAULT_PROGRAMS	2000
+#define FUZZ_DEFAULT_PACKETS	32
+#define FUZZ_DEFAULT_INSNS		48
+#define FUZZ_MAX_INSNS			1024	// well below BPF_MAXINSNS
+#define FUZZ_PACKET_MAXSIZE		128
+#define FUZZ_MEM_SLOTS			16
+#define FUZZ_VERDICT_DROP		(-1)
+#define FUZZ_MAX_CHECKS			2
+
+//
+// Types
+//
+typedef struct fuzz_opts {
+	unsigned long programs;
+	unsigned long packets;
+	unsigned long max_insns;
+	uint64_t seed;
+	bool reference; // compare against the reference model even if the kernel is available
+} fuzz_opts_t;
+
+typedef struct fuzz_kernel {
+	int fds[2]; // [0] sends, [1] has the filter and receives
+} fuzz_kernel_t;
+
+// A field compared against two values at the start of a program
+typedef struct fuzz_check {
+	uint32_t offset;
+	uint16_t size;
+	uint32_t values[2];
+} fuzz_check_t;
+
+//
+// Random numbers (xorshift64*, same as the benchmarks)
+//
+static uint64_t g_rng_state;
+static fuzz_check_t g_checks[FUZZ_MAX_CHECKS]; // of the current program
+static unsigned g_check_count;
+
+static uint32_t rng_next(void) {
+	g_rng_state ^= g_rng_state >> 12;
+	g_rng_state ^= g_rng_state << 25;
+	g_rng_state ^= g_rng_state >> 27;
+	return (uint32_t)((g_rng_state * 0x2545F4914F6CDD1DULL) >> 32);
+}
+
+static uint32_t rng_range(uint32_t min, uint32_t max) {
+	return min + rng_next() % (max - min + 1);
+}
+
+static bool rng_chance(uint32_t percent) {
+	return rng_next() % 100 < percent;
+}
+
+// Constants near the edges are far more likely to find bugs than uniform ones
+static uint32_t rng_constant(void) {
+	static const uint32_t edges[] = {
+		0, 1, 2, 3, 4, 7, 8, 14, 15, 16, 31, 32, 0x7f, 0x80, 0xff, 0x100,
+		0x7fff, 0x8000, 0xffff, 0x10000, 0x7fffffff, 0x80000000, 0xfffffffe, 0xffffffff,
+	};
+	if (rng_chance(50))
+		return edges[rng_next() % (sizeof(edges) / sizeof(edges[0]))];
+	return rng_next();
+}
+
+//
+// Program generation
+//
+// The kernel refuses programs with backward or out of range jumps, constant divisors of
+// zero, constant shifts of 32 or more, loads from memory slots that may not have been
+// stored, and programs that don't end with a return. Offsets stay away from the negative
+// range, which the kernel reserves for ancillary data.
+//
+static void emit(struct bpf_insn *insns, unsigned *count, uint16_t code, uint8_t jt, uint8_t jf, uint32_t k) {
+	insns[*count] = (struct bpf_insn){ code, jt, jf, k };
+	(*count)++;
+}
+
+static uint32_t random_offset(void) {
+	// Reaches a few bytes past the largest packet, so some loads are out of bounds
+	return rng_range(0, FUZZ_PACKET_MAXSIZE + 8);
+}
+
+static uint16_t random_size(void) {
+	static const uint16_t sizes[] = { BPF_W, BPF_H, BPF_B };
+	return sizes[rng_next() % 3];
+}
+
+static uint32_t random_slot(uint32_t valid_slots) {
+	uint32_t slot;
+	do {
+		slot = rng_next() % FUZZ_MEM_SLOTS;
+	} while ((valid_slots & (1u << slot)) == 0);
+	return slot;
+}
+
+static uint8_t random_jump(unsigned pc, unsigned last) {
+	// Lands anywhere from the next instruction up to the final return
+	unsigned max = last - pc - 1;
+	return (uint8_t)rng_range(0, max < 255 ? max : 255);
+}
+
+static void emit_alu(struct bpf_insn *insns, unsigned *count) {
+	static const uint16_t ops[] = {
+		BPF_ADD, BPF_SUB, BPF_MUL, BPF_DIV, BPF_OR, BPF_AND,
+		BPF_LSH, BPF_RSH, BPF_NEG, BPF_MOD, BPF_XOR,
+	};
+	uint16_t op = ops[rng_next() % (sizeof(ops) / sizeof(ops[0]))];
+	if (op == BPF_NEG) {
+		emit(insns, count, BPF_ALU | BPF_NEG, 0, 0, 0);
+		return;
+	}
+	if (rng_chance(30)) {
+		emit(insns, count, BPF_ALU | op | BPF_X, 0, 0, 0);
+		return;
+	}
+	uint32_t k = rng_constant();
+	if (op == BPF_LSH || op == BPF_RSH)
+		k %= 32;
+	else if ((op == BPF_DIV || op == BPF_MOD) && k == 0)
+		k = 1;
+	emit(insns, count, BPF_ALU | op | BPF_K, 0, 0, k);
+}
+
+static void emit_jump(struct bpf_insn *insns, unsigned *count, unsigned last) {
+	static const uint16_t ops[] = { BPF_JEQ, BPF_JGT, BPF_JGE, BPF_JSET };
+	unsigned pc = *count;
+	if (rng_chance(10)) {
+		emit(insns, count, BPF_JMP | BPF_JA, 0, 0, random_jump(pc, last));
+		return;
+	}
+	uint16_t op = ops[rng_next() % (sizeof(ops) / sizeof(ops[0]))];
+	uint16_t src = rng_chance(30) ? BPF_X : BPF_K;
+	emit(insns, count, BPF_JMP | op | src, random_jump(pc, last), random_jump(pc, last),
+		src == BPF_K ? rng_constant() : 0);
+}
+
+// ld [k], then jeq against two values, either of which may also reject:
+//	(0) ld [k]
+//	(1) jeq #v0, (4) or (3), (2)
+//	(2) jeq #v1, (4) or (3), (3)
+//	(3) ret #0
+//	(4) ...
+static void emit_check(struct bpf_insn *insns, unsigned *count) {
+	fuzz_check_t *check = &g_checks[g_check_count++];
+	check->offset = rng_range(0, 24);
+	check->size = random_size();
+	for (int i = 0; i < 2; i++)
+		check->values[i] = rng_chance(20) ? check->values[0] : rng_range(0, 3); // repeated now and then
+	emit(insns, count, BPF_LD | BPF_ABS | check->size, 0, 0, check->offset);
+	emit(insns, count, BPF_JMP | BPF_JEQ | BPF_K, rng_chance(80) ? 2 : 1, 0, check->values[0]);
+	emit(insns, count, BPF_JMP | BPF_JEQ | BPF_K, rng_chance(80) ? 1 : 0, 0, check->values[1]);
+	emit(insns, count, BPF_RET | BPF_K, 0, 0, 0);
+}
+
+static unsigned generate_program(struct bpf_insn *insns, unsigned max_insns) {
+	unsigned count = 0;
+
+	g_check_count = 0;
+	while (g_check_count < FUZZ_MAX_CHECKS && count + 5 < max_insns && rng_chance(40))
+		emit_check(insns, &count);
+
+	// Store a random set of slots first, so that the body may load from any of them
+	uint32_t wanted_slots = rng_next(), valid_slots = 0;
+	for (uint32_t slot = 0; slot < FUZZ_MEM_SLOTS && count + 3 < max_insns; slot++) {
+		if ((wanted_slots & (1u << slot)) == 0)
+			continue;
+		emit(insns, &count, BPF_LD | BPF_IMM, 0, 0, rng_constant());
+		emit(insns, &count, BPF_ST, 0, 0, slot);
+		valid_slots |= 1u << slot;
+	}
+
+	unsigned length = rng_range(count + 1, max_insns);
+	unsigned last = length - 1;
+	while (count < last) {
+		switch (rng_next() % 12) {
+			case 0: // ld [k]
+				emit(insns, &count, BPF_LD | BPF_ABS | random_size(), 0, 0, random_offset());
+				break;
+			case 1: // ld [x + k], with a small x so that the offset can't go negative
+				if (count + 2 > last)
+					break;
+				if (rng_chance(50))
+					emit(insns, &count, BPF_LDX | BPF_IMM, 0, 0, rng_range(0, 64));
+				else
+					emit(insns, &count, BPF_LDX | BPF_MSH | BPF_B, 0, 0, random_offset());
+				emit(insns, &count, BPF_LD | BPF_IND | random_size(), 0, 0, random_offset());
+				break;
+			case 2: // ld #k, ld #len
+				emit(insns, &count, BPF_LD | (rng_chance(80) ? BPF_IMM : BPF_LEN), 0, 0, rng_constant());
+				break;
+			case 3: // ldx #k, ldx #len, ldx 4*([k]&0xf)
+				switch (rng_next() % 3) {
+					case 0: emit(insns, &count, BPF_LDX | BPF_IMM, 0, 0, rng_constant()); break;
+					case 1: emit(insns, &count, BPF_LDX | BPF_LEN, 0, 0, 0); break;
+					case 2: emit(insns, &count, BPF_LDX | BPF_MSH | BPF_B, 0, 0, random_offset()); break;
+				}
+				break;
+			case 4: // ld M[k], ldx M[k]
+				if (valid_slots == 0)
+					break;
+				emit(insns, &count, (rng_chance(50) ? BPF_LD : BPF_LDX) | BPF_MEM, 0, 0, random_slot(valid_slots));
+				break;
+			case 5: // st M[k], stx M[k]
+				emit(insns, &count, rng_chance(50) ? BPF_ST : BPF_STX, 0, 0, rng_next() % FUZZ_MEM_SLOTS);
+				break;
+			case 6:
+			case 7:
+			case 8:
+				emit_alu(insns, &count);
+				break;
+			case 9:
+			case 10:
+				emit_jump(insns, &count, last);
+				break;
+			case 11: // tax, txa, or an early return
+				if (rng_chance(20))
+					emit(insns, &count, BPF_RET | (rng_chance(50) ? BPF_A : BPF_K), 0, 0, rng_constant());
+				else
+					emit(insns, &count, BPF_MISC | (rng_chance(50) ? BPF_TAX : BPF_TXA), 0, 0, 0);
+				break;
+		}
+	}
+	emit(insns, &count, BPF_RET | (rng_chance(50) ? BPF_A : BPF_K), 0, 0, rng_constant());
+	return count;
+}
+
+static uint32_t generate_packet(uint8_t *packet) {
+	uint32_t length = rng_chance(5) ? 0 : rng_range(1, FUZZ_PACKET_MAXSIZE);
+	for (uint32_t i = 0; i < length; i++)
+		packet[i] = (uint8_t)rng_next();
+	// Small header-like values make the indirect loads land inside the packet more often
+	if (length > 0 && rng_chance(50))
+		packet[rng_next() % length] = (uint8_t)rng_range(0x40, 0x4f);
+	// And fields that pass the checks, the next instructions run more often
+	for (unsigned c = 0; c < g_check_count; c++) {
+		const fuzz_check_t *check = &g_checks[c];
+		uint32_t size = check->size == BPF_W ? 4 : check->size == BPF_H ? 2 : 1;
+		if (check->offset + size > length || !rng_chance(70))
+			continue;
+		uint32_t value = check->values[rng_next() % 2];
+		for (uint32_t i = 0; i < size; i++)
+			packet[check->offset + i] = (uint8_t)(value >> ((size - 1 - i) * 8));
+	}
+	return length;
+}
+
+//
+// Reference model
+//
+// A straightforward reading of the kernel's semantics for classic BPF: loads outside of
+// the packet and divisions by zero end the program with a verdict of 0, and shifts by the
+// X register only use its lower 5 bits.
+//
+static int ref_load(const uint8_t *packet, uint32_t length, uint32_t offset, uint32_t size, uint32_t *value) {
+	if (offset > length || length - offset < size)
+		return -1;
+	*value = 0;
+	for (uint32_t i = 0; i < size; i++)
+		*value = (*value << 8) | packet[offset + i];
+	return 0;
+}
+
+static uint32_t ref_execute(const struct bpf_insn *insns, unsigned count, const uint8_t *packet, uint32_t length) {
+	uint32_t A = 0, X = 0, M[FUZZ_MEM_SLOTS] = {0};
+	for (unsigned pc = 0; pc < count; pc++) {
+		const struct bpf_insn *insn = &insns[pc];
+		uint32_t size = BPF_SIZE(insn->code) == BPF_W ? 4 : BPF_SIZE(insn->code) == BPF_H ? 2 : 1;
+		uint32_t operand = BPF_SRC(insn->code) == BPF_X ? X : insn->k;
+		uint32_t value;
+		switch (BPF_CLASS(insn->code)) {
+			case BPF_LD:
+				switch (BPF_MODE(insn->code)) {
+					case BPF_ABS: if (ref_load(packet, length, insn->k, size, &A) != 0) return 0; break;
+					case BPF_IND: if (ref_load(packet, length, X + insn->k, size, &A) != 0) return 0; break;
+					case BPF_IMM: A = insn->k; break;
+					case BPF_LEN: A = length; break;
+					case BPF_MEM: A = M[insn->k]; break;
+				}
+				break;
+			case BPF_LDX:
+				switch (BPF_MODE(insn->code)) {
+					case BPF_IMM: X = insn->k; break;
+					case BPF_LEN: X = length; break;
+					case BPF_MEM: X = M[insn->k]; break;
+					case BPF_MSH:
+						if (ref_load(packet, length, insn->k, 1, &value) != 0)
+							return 0;
+						X = (value & 0xf) << 2;
+						break;
+				}
+				break;
+			case BPF_ST: M[insn->k] = A; break;
+			case BPF_STX: M[insn->k] = X; break;
+			case BPF_ALU:
+				switch (BPF_OP(insn->code)) {
+					case BPF_ADD: A += operand; break;
+					case BPF_SUB: A -= operand; break;
+					case BPF_MUL: A *= operand; break;
+					case BPF_DIV: if (operand == 0) return 0; A /= operand; break;
+					case BPF_MOD: if (operand == 0) return 0; A %= operand; break;
+					case BPF_OR: A |= operand; break;
+					case BPF_AND: A &= operand; break;
+					case BPF_XOR: A ^= operand; break;
+					case BPF_LSH: A <<= operand & 31; break;
+					case BPF_RSH: A >>= operand & 31; break;
+					case BPF_NEG: A = -A; break;
+				}
+				break;
+			case BPF_JMP:
+				switch (BPF_OP(insn->code)) {
+					case BPF_JA: pc += insn->k; break;
+					case BPF_JEQ: pc += A == operand ? insn->jt : insn->jf; break;
+					case BPF_JGT: pc += A > operand ? insn->jt : insn->jf; break;
+					case BPF_JGE: pc += A >= operand ? insn->jt : insn->jf; break;
+					case BPF_JSET: pc += (A & operand) ? insn->jt : insn->jf; break;
+				}
+				break;
+			case BPF_RET:
+				return BPF_RVAL(insn->code) == BPF_A ? A : insn->k;
+			case BPF_MISC:
+				if (BPF_MISCOP(insn->code) == BPF_TAX)
+					X = A;
+				else
+					A = X;
+				break;
+		}
+	}
+	return 0;
+}
+
+// What the socket receives given the value returned by a filter
+static int verdict_of(uint32_t result, uint32_t length) {
+	if (result == 0)
+		return FUZZ_VERDICT_DROP;
+	return (int)(result < length ? result : length);
+}
+
+//
+// Kernel
+//
+#ifdef __linux__
+static int kernel_open(fuzz_kernel_t *kernel) {
+	if (socketpair(AF_UNIX, SOCK_DGRAM, 0, kernel->fds) != 0)
+		return -1;
+	return 0;
+}
+
+static void kernel_close(fuzz_kernel_t *kernel) {
+	close(kernel->fds[0]);
+	close(kernel->fds[1]);
+}
+
+static int kernel_attach(fuzz_kernel_t *kernel, struct bpf_insn *insns, unsigned count) {
+	struct sock_fprog fprog = { (unsigned short)count, (struct sock_filter *)insns };
+	return setsockopt(kernel->fds[1], SOL_SOCKET, SO_ATTACH_FILTER, &fprog, sizeof(fprog));
+}
+
+static int kernel_verdict(fuzz_kernel_t *kernel, const uint8_t *packet, uint32_t length) {
+	uint8_t buffer[FUZZ_PACKET_MAXSIZE];
+	if (send(kernel->fds[0], packet, length, 0) != (ssize_t)length) {
+		perror("send");
+		exit(EXIT_FAILURE);
+	}
+	// Dropped packets never arrive. The filter ran synchronously in send(), so there's no
+	// need to wait for them.
+	ssize_t received = recv(kernel->fds[1], buffer, sizeof(buffer), MSG_DONTWAIT | MSG_TRUNC);
+	if (received < 0) {
+		if (errno == EAGAIN || errno == EWOULDBLOCK)
+			return FUZZ_VERDICT_DROP;
+		perror("recv");
+		exit(EXIT_FAILURE);
+	}
+	return (int)received;
+}
+#else
+static int kernel_open(fuzz_kernel_t *kernel) {
+	(void)kernel;
+	errno = ENOTSUP;
+	return -1;
+}
+
+static void kernel_close(fuzz_kernel_t *kernel) {
+	(void)kernel;
+}
+
+static int kernel_attach(fuzz_kernel_t *kernel, struct bpf_insn *insns, unsigned count) {
+	(void)kernel;
+	(void)insns;
+	(void)count;
+	errno = ENOTSUP;
+	return -1;
+}
+
+static int kernel_verdict(fuzz_kernel_t *kernel, const uint8_t *packet, uint32_t length) {
+	(void)kernel;
+	(void)packet;
+	(void)length;
+	return FUZZ_VERDICT_DROP;
+}
+#endif
+
+//
+// Reporting
+//
+static void dump_mismatch(const struct bpf_insn *insns, unsigned count, const uint8_t *packet,
+	uint32_t length, int expected, const char *what, int actual)
+{
+	fprintf(stderr, "Mismatch: expected=%d %s=%d (-1 means dropped)\n", expected, what, actual);
+	fprintf(stderr, "Program (%u instructions):\n", count);
+	for (unsigned i = 0; i < count; i++) {
+		fprintf(stderr, "  (%03u) code=0x%02x jt=%u jf=%u k=0x%08x\n",
+			i, insns[i].code, insns[i].jt, insns[i].jf, insns[i].k);
+	}
+	fprintf(stderr, "Packet (%u bytes):", length);
+	for (uint32_t i = 0; i < length; i++)
+		fprintf(stderr, "%s%02x", i % 16 == 0 ? "\n  " : " ", packet[i]);
+	fprintf(stderr, "\n");
+}
+
+static void usage(const char *exename) {
+	fprintf(stderr,
+		"Usage: %s [OPTIONS]\n"
+		"\n"
+		"Options:\n"
+		"  -n, --programs=count  Number of random programs. Default is %d.\n"
+		"  -p, --packets=count   Number of random packets per program. Default is %d.\n"
+		"  -l, --length=count    Maximum number of instructions per program. Default is %d.\n"
+		"  -s, --seed=number     Seed of the generator. Default is 1.\n"
+		"  -r, --reference       Compare against the reference model instead of the kernel.\n"
+		"  -h, --help            Display this help and exit.\n",
+		exename, FUZZ_DEFAULT_PROGRAMS, FUZZ_DEFAULT_PACKETS, FUZZ_DEFAULT_INSNS);
+}
+
+int main(int argc, char **argv) {
+	static const struct option options[] = {
+		{ "programs",	required_argument,	NULL, 'n' },
+		{ "packets",	required_argument,	NULL, 'p' },
+		{ "length",		required_argument,	NULL, 'l' },
+		{ "seed",		required_argument,	NULL, 's' },
+		{ "reference",	no_argument,		NULL, 'r' },
+		{ "help",		no_argument,		NULL, 'h' },
+		{ NULL,			no_argument,		NULL,  0  },
+	};
+	fuzz_opts_t opts = { FUZZ_DEFAULT_PROGRAMS, FUZZ_DEFAULT_PACKETS, FUZZ_DEFAULT_INSNS, 1, false };
+
+	int opt;
+	while ((opt = getopt_long(argc, argv, "n:p:l:s:rh", options, NULL)) != -1) {
+		switch (opt) {
+			case 'n': opts.programs = strtoul(optarg, NULL, 10); break;
+			case 'p': opts.packets = strtoul(optarg, NULL, 10); break;
+			case 'l': opts.max_insns = strtoul(optarg, NULL, 10); break;
+			case 's': opts.seed = strtoull(optarg, NULL, 10); break;
+			case 'r': opts.reference = true; break;
+			case 'h': usage(argv[0]); return EXIT_SUCCESS;
+			default: usage(argv[0]); return EXIT_FAILURE;
+		}
+	}
+	if (opts.max_insns < 2 || opts.max_insns > FUZZ_MAX_INSNS) {
+		usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	fuzz_kernel_t kernel;
+	bool use_kernel = !opts.reference;
+	if (use_kernel && kernel_open(&kernel) != 0) {
+		fprintf(stderr, "Kernel filters are unavailable (%s), using the reference model\n", strerror(errno));
+		use_kernel = false;
+	}
+
+	g_rng_state = opts.seed != 0 ? opts.seed : 1; // xorshift gets stuck at zero
+	struct bpf_insn insns[FUZZ_MAX_INSNS];
+	static uint8_t batch[BPF_BATCH_MAX][FUZZ_PACKET_MAXSIZE];
+	const uint8_t *batch_packets[BPF_BATCH_MAX];
+	uint32_t batch_lengths[BPF_BATCH_MAX], batch_results[BPF_BATCH_MAX];
+	int batch_verdicts[BPF_BATCH_MAX]; // of the emulator, one packet at a time
+	for (unsigned i = 0; i < BPF_BATCH_MAX; i++)
+		batch_packets[i] = batch[i];
+	unsigned long refused = 0, mismatches = 0, packets = 0, dropped = 0;
+
+	for (unsigned long p = 0; p < opts.programs; p++) {
+		unsigned count = generate_program(insns, (unsigned)opts.max_insns);
+		if (use_kernel && kernel_attach(&kernel, insns, count) != 0) {
+			// The generator is meant to only produce valid programs, but older kernels are stricter
+			if (refused++ == 0)
+				fprintf(stderr, "The kernel refused program %lu: %s\n", p, strerror(errno));
+			continue;
+		}
+		bpf_program_t program = { count, insns };
+		bpf_prefilter_t prefilter;
+		bpf_compile_prefilter(&program, &prefilter);
+		uint32_t pending = 0;
+		for (unsigned long i = 0; i < opts.packets; i++) {
+			uint8_t *packet = batch[pending];
+			uint32_t length = generate_packet(packet);
+			int expected = use_kernel
+				? kernel_verdict(&kernel, packet, length)
+				: verdict_of(ref_execute(insns, count, packet, length), length);
+			int actual = verdict_of(bpf_execute_filter(&program, packet, length), length);
+			packets++;
+			dropped += expected == FUZZ_VERDICT_DROP;
+			if (expected != actual) {
+				if (mismatches++ < 5)
+					dump_mismatch(insns, count, packet, length, expected, "emulator", actual);
+			}
+
+			batch_lengths[pending] = length;
+			batch_verdicts[pending++] = actual;
+			if (pending < BPF_BATCH_MAX && i + 1 < opts.packets)
+				continue;
+			bpf_execute_filter_batch(&program, &prefilter, batch_packets, batch_lengths, pending, batch_results);
+			for (uint32_t b = 0; b < pending; b++) {
+				int verdict = verdict_of(batch_results[b], batch_lengths[b]);
+				if (verdict != batch_verdicts[b] && mismatches++ < 5)
+					dump_mismatch(insns, count, batch[b], batch_lengths[b], batch_verdicts[b], "batch", verdict);
+			}
+			pending = 0;
+		}
+	}
+
+	if (use_kernel)
+		kernel_close(&kernel);
+
+	printf("fuzz=bpf version=%s against=%s seed=%llu programs=%lu refused=%lu packets=%lu dropped=%lu mismatches=%lu\n",
+		PACKAGE_VERSION, use_kernel ? "kernel" : "reference", (unsigned long long)opts.seed,
+		opts.programs, refused, packets, dropped, mismatches);
+	return mismatches == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+//
+// Entry points of the fuzz targets, as expected by libFuzzer. AFL++ and the standalone
+// driver (fuzz_driver.c) call the same functions, so every engine runs the same code.
+//
+int LLVMFuzzerInitialize(int *argc, char ***argv);
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
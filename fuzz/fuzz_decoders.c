@@ -0,0 +1,240 @@
+//
+// Fuzz targets of the protocol decoders and of the DNS RDATA parsers.
+//
+// The same source builds one executable per target, selected by FUZZ_TARGET at compile
+// time, so that each of them has its own corpus and coverage. Inputs are:
+//
+//	eth, arp, ip, icmp, tcp, udp, dns:	the bytes of that layer and of everything above it
+//	name, rdata_*:						a 2-byte offset (big endian) followed by a DNS message,
+//										which is parsed starting at that offset, so that
+//										compression pointers may point back into the message.
+//										RDATA ends where the RDLENGTH right before it says.
+//
+// Every display filter is on, and the result is encoded in all of the output formats,
+// so that the printers run on whatever the parsers accepted.
+//
+
+#include "fuzz.h"
+#include "config.h"
+#include "log.h"
+#include "output.h"
+#include "packet.h"
+#include "proto/dns/anomaly.h"
+#include "proto/dns/name.h"
+#include "proto/dns/name_filter.h"
+#include "proto/dns/pdns.h"
+#include "proto/dns/sections/rdata.h"
+#include "proto_ops.h"
+#include "stats.h"
+#include "types/buffer.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#ifndef FUZZ_TARGET
+#	error "FUZZ_TARGET must name the target to build, e.g. -DFUZZ_TARGET=\"dns\""
+#endif
+
+//
+// Types
+//
+typedef int (*fuzz_fromwire_fn)(const uint8_t *packet, size_t length, sniff_packet_t *desc, const config_t *config);
+
+typedef struct fuzz_target {
+	const char *name;
+	fuzz_fromwire_fn fromwire;		// protocol decoders
+	int (*parse)(dns_rdata_t *rdata, buffer_t *buffer); // RDATA parsers
+	void (*free)(dns_rdata_t *rdata);
+	void (*print)(dns_rdata_t *rdata, output_t *out);
+} fuzz_target_t;
+
+#define FUZZ_DECODER(name)	{ #name, sniff_##name##_fromwire, NULL, NULL, NULL }
+#define FUZZ_RDATA(name)	{ "rdata_" #name, NULL, parse_rdata_##name, free_rdata_##name, print_rdata_##name }
+
+static const fuzz_target_t g_targets[] = {
+	FUZZ_DECODER(eth),
+	FUZZ_DECODER(arp),
+	FUZZ_DECODER(ip),
+	FUZZ_DECODER(icmp),
+	FUZZ_DECODER(tcp),
+	FUZZ_DECODER(udp),
+	FUZZ_DECODER(dns),
+	{ "name", NULL, NULL, NULL, NULL },
+	FUZZ_RDATA(a),
+	FUZZ_RDATA(aaaa),
+	FUZZ_RDATA(caa),
+	FUZZ_RDATA(cname),
+	FUZZ_RDATA(dnskey),
+	FUZZ_RDATA(ds),
+	FUZZ_RDATA(mx),
+	FUZZ_RDATA(naptr),
+	FUZZ_RDATA(ns),
+	FUZZ_RDATA(nsec),
+	FUZZ_RDATA(nsec3),
+	FUZZ_RDATA(opt),
+	FUZZ_RDATA(ptr),
+	FUZZ_RDATA(rrsig),
+	FUZZ_RDATA(soa),
+	FUZZ_RDATA(srv),
+	FUZZ_RDATA(svcb),
+	FUZZ_RDATA(txt),
+};
+
+static const output_format_e g_formats[] = {
+	OUTPUT_FORMAT_TEXT, OUTPUT_FORMAT_JSONL, OUTPUT_FORMAT_BINARY,
+};
+#define FUZZ_FORMAT_COUNT (sizeof(g_formats) / sizeof(g_formats[0]))
+
+static const fuzz_target_t *g_target;
+static output_t *g_outputs[FUZZ_FORMAT_COUNT];
+static config_t g_config;
+static config_t g_quiet_config; // nothing displayed, see sniff_pipeline_count
+static dns_anomaly_t *g_anomaly;
+static dns_pdns_t *g_pdns;
+static dns_name_filter_t *g_names;
+static stats_counters_t *g_stats;
+static uint32_t g_inputs;
+
+int LLVMFuzzerInitialize(int *argc, char ***argv) {
+	(void)argc;
+	(void)argv;
+	for (size_t i = 0; i < sizeof(g_targets) / sizeof(g_targets[0]); i++) {
+		if (strcmp(g_targets[i].name, FUZZ_TARGET) == 0)
+			g_target = &g_targets[i];
+	}
+	if (g_target == NULL) {
+		fprintf(stderr, "Unknown fuzz target %s\n", FUZZ_TARGET);
+		abort();
+	}
+
+	// The records are encoded for real, but nobody needs to read them
+	int fd = open("/dev/null", O_WRONLY);
+	for (size_t i = 0; i < FUZZ_FORMAT_COUNT; i++) {
+		g_outputs[i] = output_alloc(g_formats[i], fd);
+		if (fd < 0 || g_outputs[i] == NULL) {
+			fprintf(stderr, "Error allocating the output\n");
+			abort();
+		}
+	}
+
+	// Thresholds low enough for the alerts to be emitted as soon as a second goes by
+	static const dns_anomaly_thresholds_t thresholds = { 1, 1, 1, 1, 1, 1 };
+	g_anomaly = dns_anomaly_alloc(&thresholds);
+	if (g_anomaly == NULL) {
+		fprintf(stderr, "Error allocating the DNS anomaly detector\n");
+		abort();
+	}
+	g_pdns = dns_pdns_open("/dev/null");
+	if (g_pdns == NULL) {
+		fprintf(stderr, "Error opening the passive DNS store\n");
+		abort();
+	}
+	g_names = dns_name_filter_alloc();
+	if (g_names == NULL || dns_name_filter_add(g_names, "example.com") < 0 || dns_name_filter_add(g_names, "co.uk") < 0) {
+		fprintf(stderr, "Error allocating the DNS name filter\n");
+		abort();
+	}
+	g_stats = stats_counters_alloc();
+	if (g_stats == NULL) {
+		fprintf(stderr, "Error allocating the counters\n");
+		abort();
+	}
+
+	memset(&g_config, 0, sizeof(g_config));
+	memset(&g_config.display_filters_flag, 1, sizeof(g_config.display_filters_flag));
+	sniff_pipeline_init(&g_config.pipeline, &g_config);
+	memset(&g_quiet_config, 0, sizeof(g_quiet_config));
+	sniff_pipeline_init(&g_quiet_config.pipeline, &g_quiet_config);
+	log_level_set(LOGLEVEL_FATAL); // the parsers warn about every malformed input
+	return 0;
+}
+
+static void fuzz_decoder(const uint8_t *data, size_t size) {
+	for (size_t i = 0; i < FUZZ_FORMAT_COUNT; i++) {
+		sniff_packet_t desc = SNIFF_PACKET_INITIALIZER;
+		desc.data = data;
+		desc.caplen = (uint32_t)size;
+		desc.wirelen = (uint32_t)size;
+		desc.output = g_outputs[i];
+		desc.anomaly = g_anomaly;
+		desc.pdns = g_pdns;
+		// Only for one format, as the messages filtered out aren't displayed
+		desc.names = i == 0 ? g_names : NULL;
+		output_begin_record(desc.output);
+		g_target->fromwire(data, size, &desc, &g_config);
+		output_end_record(desc.output);
+		output_flush(desc.output);
+	}
+	// And only counted, as the quiet decoders skip what isn't displayed
+	sniff_packet_t desc = SNIFF_PACKET_INITIALIZER;
+	desc.data = data;
+	desc.caplen = (uint32_t)size;
+	desc.wirelen = (uint32_t)size;
+	desc.output = g_outputs[0];
+	desc.stats = g_stats;
+	g_target->fromwire(data, size, &desc, &g_quiet_config);
+	// Every now and then, as a flush walks the whole table
+	if (++g_inputs % 4096 == 0)
+		dns_pdns_flush(g_pdns, g_inputs);
+}
+
+static void fuzz_dns_message(uint8_t *message, uint32_t size, uint32_t offset) {
+	buffer_t buffer = BUFFER_INITIALIZER;
+	buffer_set_data(&buffer, message, size);
+	buffer_seek(&buffer, offset);
+
+	if (g_target->parse == NULL) {
+		free_name(parse_name(&buffer));
+		return;
+	}
+	// Like parse_rdata(), end the buffer with the RDATA, whose length precedes it
+	if (offset >= 2 && offset <= size) {
+		uint32_t rdlen = ((uint32_t)message[offset - 2] << 8) | message[offset - 1];
+		if (rdlen <= size - offset)
+			buffer.size = offset + rdlen;
+	}
+
+	dns_rdata_t rdata;
+	memset(&rdata, 0, sizeof(rdata));
+	if (g_target->parse(&rdata, &buffer) == 0) {
+		for (size_t i = 0; i < FUZZ_FORMAT_COUNT; i++) {
+			output_t *out = g_outputs[i];
+			output_begin_record(out);
+			output_begin_object(out, "rdata");
+			g_target->print(&rdata, out);
+			output_end_object(out);
+			output_end_record(out);
+			output_flush(out);
+		}
+	}
+	// Like free_rr(), also after a failure, as the parser may have allocated some fields
+	g_target->free(&rdata);
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+	if (g_target == NULL)
+		LLVMFuzzerInitialize(NULL, NULL);
+	if (size > UINT16_MAX + 2)
+		return 0; // bigger than any packet
+
+	if (g_target->fromwire != NULL) {
+		fuzz_decoder(data, size);
+		return 0;
+	}
+
+	if (size < 2)
+		return 0;
+	// A copy of the exact size, so that the sanitizers catch reads past its end
+	uint32_t offset = ((uint32_t)data[0] << 8) | data[1];
+	uint32_t length = (uint32_t)(size - 2);
+	uint8_t *message = malloc(length > 0 ? length : 1);
+	if (message == NULL)
+		return 0;
+	memcpy(message, data + 2, length);
+	if (offset < length)
+		fuzz_dns_message(message, length, offset);
+	free(message);
+	return 0;
+}
@@ -0,0 +1,221 @@
+//
+// Standalone driver of the fuzz targets, for when libFuzzer isn't available (e.g. GCC).
+//
+// Runs the target on each file given on the command line, or on each file of the given
+// directories, or on stdin when there are none, which is what AFL++ expects:
+//
+//	afl-fuzz -i corpus/dns -o findings -- ./babysniff_fuzz_dns @@
+//
+// With --mutations, it also runs the target on that many random mutations of each input.
+// This is no replacement for a coverage-guided fuzzer, but it's enough to shake out the
+// obvious crashes with the sanitizers and without any extra tools.
+//
+
+#include "fuzz.h"
+#include <dirent.h>
+#include <errno.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#define FUZZ_MAX_INPUT_SIZE	(64 * 1024 + 2)
+
+//
+// Types
+//
+typedef struct driver_opts {
+	unsigned long mutations;
+	uint64_t seed;
+} driver_opts_t;
+
+//
+// Random numbers (xorshift64*)
+//
+static uint64_t g_rng_state = 1;
+
+static uint32_t rng_next(void) {
+	g_rng_state ^= g_rng_state >> 12;
+	g_rng_state ^= g_rng_state << 25;
+	g_rng_state ^= g_rng_state >> 27;
+	return (uint32_t)((g_rng_state * 0x2545F4914F6CDD1DULL) >> 32);
+}
+
+//
+// Mutations
+//
+static size_t mutate(uint8_t *data, size_t size, size_t max_size) {
+	unsigned count = 1 + rng_next() % 4;
+	for (unsigned i = 0; i < count; i++) {
+		switch (rng_next() % 6) {
+			case 0: // flip a bit
+				if (size > 0)
+					data[rng_next() % size] ^= (uint8_t)(1u << (rng_next() % 8));
+				break;
+			case 1: // set a byte to an interesting value
+				if (size > 0) {
+					static const uint8_t values[] = { 0x00, 0x01, 0x3f, 0x40, 0x7f, 0x80, 0xc0, 0xff };
+					data[rng_next() % size] = values[rng_next() % sizeof(values)];
+				}
+				break;
+			case 2: // set a byte to a random value
+				if (size > 0)
+					data[rng_next() % size] = (uint8_t)rng_next();
+				break;
+			case 3: // truncate
+				if (size > 0)
+					size = rng_next() % size;
+				break;
+			case 4: // insert a random byte
+				if (size < max_size) {
+					size_t at = size > 0 ? rng_next() % (size + 1) : 0;
+					memmove(data + at + 1, data + at, size - at);
+					data[at] = (uint8_t)rng_next();
+					size++;
+				}
+				break;
+			case 5: // copy a chunk over another place
+				if (size > 1) {
+					size_t from = rng_next() % size, to = rng_next() % size;
+					size_t length = 1 + rng_next() % (size - (from > to ? from : to));
+					memmove(data + to, data + from, length);
+				}
+				break;
+		}
+	}
+	return size;
+}
+
+//
+// Inputs
+//
+static int run_input(const driver_opts_t *opts, const uint8_t *input, size_t size) {
+	// Copies of the exact size, so that the sanitizers catch reads past their end
+	uint8_t *data = malloc(size > 0 ? size : 1);
+	uint8_t *mutated = malloc(FUZZ_MAX_INPUT_SIZE);
+	if (data == NULL || mutated == NULL) {
+		free(data);
+		free(mutated);
+		return -1;
+	}
+	memcpy(data, input, size);
+	LLVMFuzzerTestOneInput(data, size);
+	free(data);
+
+	for (unsigned long i = 0; i < opts->mutations; i++) {
+		size_t length = size < FUZZ_MAX_INPUT_SIZE ? size : FUZZ_MAX_INPUT_SIZE;
+		memcpy(mutated, input, length);
+		length = mutate(mutated, length, FUZZ_MAX_INPUT_SIZE);
+		data = malloc(length > 0 ? length : 1);
+		if (data == NULL)
+			break;
+		memcpy(data, mutated, length);
+		LLVMFuzzerTestOneInput(data, length);
+		free(data);
+	}
+	free(mutated);
+	return 0;
+}
+
+static int run_stream(const driver_opts_t *opts, FILE *stream, const char *name) {
+	uint8_t *input = malloc(FUZZ_MAX_INPUT_SIZE);
+	if (input == NULL)
+		return -1;
+	size_t size = fread(input, 1, FUZZ_MAX_INPUT_SIZE, stream);
+	if (ferror(stream)) {
+		fprintf(stderr, "Error reading %s: %s\n", name, strerror(errno));
+		free(input);
+		return -1;
+	}
+	int result = run_input(opts, input, size);
+	free(input);
+	return result;
+}
+
+static int run_file(const driver_opts_t *opts, const char *path) {
+	FILE *file = fopen(path, "rb");
+	if (file == NULL) {
+		fprintf(stderr, "Error opening %s: %s\n", path, strerror(errno));
+		return -1;
+	}
+	int result = run_stream(opts, file, path);
+	fclose(file);
+	return result;
+}
+
+static int run_path(const driver_opts_t *opts, const char *path, unsigned long *inputs) {
+	struct stat st;
+	if (stat(path, &st) != 0) {
+		fprintf(stderr, "Error accessing %s: %s\n", path, strerror(errno));
+		return -1;
+	}
+	if (!S_ISDIR(st.st_mode)) {
+		(*inputs)++;
+		return run_file(opts, path);
+	}
+
+	DIR *dir = opendir(path);
+	if (dir == NULL) {
+		fprintf(stderr, "Error opening %s: %s\n", path, strerror(errno));
+		return -1;
+	}
+	int result = 0;
+	struct dirent *entry;
+	while ((entry = readdir(dir)) != NULL && result == 0) {
+		if (entry->d_name[0] == '.')
+			continue;
+		char child[4096];
+		snprintf(child, sizeof(child), "%s/%s", path, entry->d_name);
+		result = run_path(opts, child, inputs);
+	}
+	closedir(dir);
+	return result;
+}
+
+static void usage(const char *exename) {
+	fprintf(stderr,
+		"Usage: %s [OPTIONS] [FILE|DIRECTORY]...\n"
+		"\n"
+		"Runs the fuzz target on each input, or on stdin if none is given.\n"
+		"\n"
+		"Options:\n"
+		"  -m, --mutations=count Also run this many random mutations of each input. Default is 0.\n"
+		"  -s, --seed=number     Seed of the mutations. Default is 1.\n"
+		"  -h, --help            Display this help and exit.\n",
+		exename);
+}
+
+int main(int argc, char **argv) {
+	static const struct option options[] = {
+		{ "mutations",	required_argument,	NULL, 'm' },
+		{ "seed",		required_argument,	NULL, 's' },
+		{ "help",		no_argument,		NULL, 'h' },
+		{ NULL,			no_argument,		NULL,  0  },
+	};
+	driver_opts_t opts = { 0, 1 };
+
+	int opt;
+	while ((opt = getopt_long(argc, argv, "m:s:h", options, NULL)) != -1) {
+		switch (opt) {
+			case 'm': opts.mutations = strtoul(optarg, NULL, 10); break;
+			case 's': opts.seed = strtoull(optarg, NULL, 10); break;
+			case 'h': usage(argv[0]); return EXIT_SUCCESS;
+			default: usage(argv[0]); return EXIT_FAILURE;
+		}
+	}
+	g_rng_state = opts.seed != 0 ? opts.seed : 1; // xorshift gets stuck at zero
+
+	LLVMFuzzerInitialize(&argc, &argv);
+
+	if (optind == argc)
+		return run_stream(&opts, stdin, "stdin") == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+
+	unsigned long inputs = 0;
+	for (int i = optind; i < argc; i++) {
+		if (run_path(&opts, argv[i], &inputs) != 0)
+			return EXIT_FAILURE;
+	}
+	fprintf(stderr, "Ran %lu inputs with %lu mutations each\n", inputs, opts.mutations);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,559 @@
+//
+// Writes the seed corpus of the fuzz targets, one directory per target:
+//
+//	./babysniff_fuzz_seeds corpus
+//	./babysniff_fuzz_dns corpus/dns
+//
+// The seeds are synthetic but well-formed captures of every layer the decoders know, and
+// DNS messages with every RDATA type they parse, so that the fuzzers start deep in the
+// code instead of having to discover each header on their own.
+//
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <net/ethernet.h>
+#include <netinet/in.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#define SEEDS_MAXSIZE 1514
+
+//
+// Types
+//
+typedef struct seed {
+	uint8_t data[SEEDS_MAXSIZE];
+	size_t length;
+} seed_t;
+
+typedef struct dns_record_pos {
+	uint16_t type;
+	uint16_t rdata;	// offset of the RDATA within the message
+} dns_record_pos_t;
+
+static const char *g_directory;
+static unsigned long g_written;
+
+//
+// Writing
+//
+static int write_seed(const char *target, const char *name, const uint8_t *data, size_t length) {
+	char path[4096];
+	snprintf(path, sizeof(path), "%s/%s", g_directory, target);
+	if (mkdir(path, 0755) != 0 && errno != EEXIST) {
+		fprintf(stderr, "Error creating %s: %s\n", path, strerror(errno));
+		return -1;
+	}
+	snprintf(path, sizeof(path), "%s/%s/%s", g_directory, target, name);
+	FILE *file = fopen(path, "wb");
+	if (file == NULL) {
+		fprintf(stderr, "Error creating %s: %s\n", path, strerror(errno));
+		return -1;
+	}
+	size_t written = fwrite(data, 1, length, file);
+	if (fclose(file) != 0 || written != length) {
+		fprintf(stderr, "Error writing %s\n", path);
+		return -1;
+	}
+	g_written++;
+	return 0;
+}
+
+// Inputs of the `name` and `rdata_*` targets: the offset to parse from, then the message
+static int write_dns_seed(const char *target, const char *name, const seed_t *message, uint16_t offset) {
+	uint8_t data[2 + SEEDS_MAXSIZE];
+	data[0] = (uint8_t)(offset >> 8);
+	data[1] = (uint8_t)offset;
+	memcpy(data + 2, message->data, message->length);
+	return write_seed(target, name, data, 2 + message->length);
+}
+
+//
+// Building
+//
+static void put8(seed_t *seed, uint8_t value) {
+	seed->data[seed->length++] = value;
+}
+
+static void put16(seed_t *seed, uint16_t value) {
+	put8(seed, (uint8_t)(value >> 8));
+	put8(seed, (uint8_t)value);
+}
+
+static void put32(seed_t *seed, uint32_t value) {
+	put16(seed, (uint16_t)(value >> 16));
+	put16(seed, (uint16_t)value);
+}
+
+static void put_bytes(seed_t *seed, const void *data, size_t length) {
+	memcpy(seed->data + seed->length, data, length);
+	seed->length += length;
+}
+
+static void put_fill(seed_t *seed, uint8_t value, size_t length) {
+	memset(seed->data + seed->length, value, length);
+	seed->length += length;
+}
+
+static void put_seed(seed_t *seed, const seed_t *payload) {
+	put_bytes(seed, payload->data, payload->length);
+}
+
+static void set16(seed_t *seed, size_t offset, uint16_t value) {
+	seed->data[offset] = (uint8_t)(value >> 8);
+	seed->data[offset + 1] = (uint8_t)value;
+}
+
+// "www.example.com" as labels
+static void put_name(seed_t *seed, const char *name) {
+	while (*name != '\0') {
+		const char *dot = strchr(name, '.');
+		size_t length = dot != NULL ? (size_t)(dot - name) : strlen(name);
+		put8(seed, (uint8_t)length);
+		put_bytes(seed, name, length);
+		name += length + (dot != NULL);
+	}
+	put8(seed, 0);
+}
+
+static void put_ether(seed_t *seed, uint16_t type) {
+	static const uint8_t dst[6] = { 0x00, 0x11, 0x22, 0x33, 0x44, 0x55 };
+	static const uint8_t src[6] = { 0x66, 0x77, 0x88, 0x99, 0xaa, 0xbb };
+	put_bytes(seed, dst, sizeof(dst));
+	put_bytes(seed, src, sizeof(src));
+	put16(seed, type);
+}
+
+static void put_ipv4(seed_t *seed, uint8_t protocol, const seed_t *payload) {
+	put8(seed, 0x45); // version 4, 20 byte header
+	put8(seed, 0);
+	put16(seed, (uint16_t)(20 + payload->length));
+	put16(seed, 0x1234); // id
+	put16(seed, 0x4000); // don't fragment
+	put8(seed, 64); // ttl
+	put8(seed, protocol);
+	put16(seed, 0); // checksum
+	put32(seed, 0x0a000002); // 10.0.0.2
+	put32(seed, 0x0a000001); // 10.0.0.1
+	put_seed(seed, payload);
+}
+
+static void put_udp(seed_t *seed, uint16_t sport, uint16_t dport, const seed_t *payload) {
+	put16(seed, sport);
+	put16(seed, dport);
+	put16(seed, (uint16_t)(8 + payload->length));
+	put16(seed, 0);
+	put_seed(seed, payload);
+}
+
+// DNS payloads are prefixed by their length, as TCP requires
+static void put_tcp(seed_t *seed, uint16_t sport, uint16_t dport, uint8_t flags, const seed_t *payload, bool dns) {
+	put16(seed, sport);
+	put16(seed, dport);
+	put32(seed, 0x01020304); // seq
+	put32(seed, 0x05060708); // ack
+	put8(seed, 8 << 4); // 32 byte header, with options
+	put8(seed, flags);
+	put16(seed, 65535); // window
+	put16(seed, 0); // checksum
+	put16(seed, 0); // urgent pointer
+	put8(seed, 1); // nop
+	put8(seed, 1); // nop
+	put8(seed, 8); // timestamps
+	put8(seed, 10);
+	put32(seed, 1);
+	put32(seed, 2);
+	if (dns)
+		put16(seed, (uint16_t)payload->length);
+	put_seed(seed, payload);
+}
+
+static void put_dns_header(seed_t *seed, uint16_t flags, uint16_t qd, uint16_t an, uint16_t ns, uint16_t ar) {
+	put16(seed, 0xbeef); // id
+	put16(seed, flags);
+	put16(seed, qd);
+	put16(seed, an);
+	put16(seed, ns);
+	put16(seed, ar);
+}
+
+static void put_dns_query(seed_t *seed, const char *name, uint16_t qtype) {
+	put_dns_header(seed, 0x0100, 1, 0, 0, 0);
+	put_name(seed, name);
+	put16(seed, qtype);
+	put16(seed, 1); // IN
+}
+
+// The owner of every record points back to the question name. `rdata` is called to
+// append the RDATA, and its offset is recorded in `pos`.
+static void put_dns_rr(seed_t *seed, uint16_t type, void (*rdata)(seed_t *seed), dns_record_pos_t *pos) {
+	put16(seed, 0xc00c);
+	put16(seed, type);
+	put16(seed, 1); // IN
+	put32(seed, 3600);
+	size_t rdlen = seed->length;
+	put16(seed, 0);
+	pos->type = type;
+	pos->rdata = (uint16_t)seed->length;
+	rdata(seed);
+	set16(seed, rdlen, (uint16_t)(seed->length - rdlen - 2));
+}
+
+static void rdata_a(seed_t *seed) {
+	put32(seed, 0x5db8d822); // 93.184.216.34
+}
+
+static void rdata_aaaa(seed_t *seed) {
+	put32(seed, 0x20010db8);
+	put32(seed, 0);
+	put32(seed, 0);
+	put32(seed, 1);
+}
+
+static void rdata_ns(seed_t *seed) {
+	put_name(seed, "ns1.example.com");
+}
+
+static void rdata_cname(seed_t *seed) {
+	put8(seed, 3);
+	put_bytes(seed, "cdn", 3);
+	put16(seed, 0xc00c + 4); // "example.com" in the question name
+}
+
+static void rdata_soa(seed_t *seed) {
+	put_name(seed, "ns1.example.com");
+	put_name(seed, "hostmaster.example.com");
+	put32(seed, 2024010101); // serial
+	put32(seed, 7200); // refresh
+	put32(seed, 3600); // retry
+	put32(seed, 1209600); // expire
+	put32(seed, 300); // minimum
+}
+
+static void rdata_ptr(seed_t *seed) {
+	put_name(seed, "host.example.com");
+}
+
+static void rdata_mx(seed_t *seed) {
+	put16(seed, 10);
+	put_name(seed, "mail.example.com");
+}
+
+static void rdata_txt(seed_t *seed) {
+	static const char text[] = "v=spf1 include:_spf.example.com ~all";
+	put8(seed, (uint8_t)(sizeof(text) - 1));
+	put_bytes(seed, text, sizeof(text) - 1);
+}
+
+static void rdata_rrsig(seed_t *seed) {
+	put16(seed, 1); // type covered
+	put8(seed, 13); // ECDSAP256SHA256
+	put8(seed, 2); // labels
+	put32(seed, 3600); // original ttl
+	put32(seed, 1735689600); // expiration
+	put32(seed, 1733011200); // inception
+	put16(seed, 12345); // key tag
+	put_name(seed, "example.com");
+	for (int i = 0; i < 64; i++)
+		put8(seed, (uint8_t)(i * 7));
+}
+
+static void rdata_dnskey(seed_t *seed) {
+	put16(seed, 257); // KSK
+	put8(seed, 3); // protocol
+	put8(seed, 13); // ECDSAP256SHA256
+	for (int i = 0; i < 64; i++)
+		put8(seed, (uint8_t)(i * 11));
+}
+
+static void rdata_srv(seed_t *seed) {
+	put16(seed, 10); // priority
+	put16(seed, 60); // weight
+	put16(seed, 5060); // port
+	put_name(seed, "sip.example.com");
+}
+
+static void rdata_naptr(seed_t *seed) {
+	put16(seed, 100); // order
+	put16(seed, 10); // preference
+	put8(seed, 1);
+	put_bytes(seed, "S", 1);
+	put8(seed, 7);
+	put_bytes(seed, "SIP+D2U", 7);
+	put8(seed, 0); // regexp
+	put_name(seed, "_sip._udp.example.com");
+}
+
+static void rdata_opt(seed_t *seed) {
+	put16(seed, 8); // Client Subnet
+	put16(seed, 11);
+	put16(seed, 2); // IPv6
+	put8(seed, 56); // source prefix
+	put8(seed, 0); // scope prefix
+	put32(seed, 0x20010db8);
+	put16(seed, 0x1234);
+	put8(seed, 0x56);
+	put16(seed, 10); // Cookie
+	put16(seed, 16);
+	put_fill(seed, 0x5a, 16);
+}
+
+static void rdata_ds(seed_t *seed) {
+	put16(seed, 12345); // key tag
+	put8(seed, 13); // ECDSAP256SHA256
+	put8(seed, 2); // SHA-256
+	for (int i = 0; i < 32; i++)
+		put8(seed, (uint8_t)(i * 13));
+}
+
+static void rdata_nsec(seed_t *seed) {
+	put_name(seed, "mail.example.com");
+	put8(seed, 0); // window 0
+	put8(seed, 6);
+	put_bytes(seed, "\x62\x01\x80\x08\x00\x03", 6); // A NS SOA MX TXT AAAA RRSIG NSEC
+	put8(seed, 1); // window 1
+	put8(seed, 1);
+	put8(seed, 0x40); // CAA
+}
+
+static void rdata_nsec3(seed_t *seed) {
+	put8(seed, 1); // SHA-1
+	put8(seed, 1); // Opt-Out
+	put16(seed, 0); // iterations
+	put8(seed, 4); // salt
+	put32(seed, 0xaabbccdd);
+	put8(seed, 20); // next hashed owner
+	for (int i = 0; i < 20; i++)
+		put8(seed, (uint8_t)(i * 17));
+	put8(seed, 0);
+	put8(seed, 1);
+	put8(seed, 0x62); // A NS SOA
+}
+
+static void rdata_caa(seed_t *seed) {
+	put8(seed, 0); // flags
+	put8(seed, 5);
+	put_bytes(seed, "issue", 5);
+	put_bytes(seed, "letsencrypt.org", 15);
+}
+
+static void rdata_svcb(seed_t *seed) {
+	put16(seed, 1); // ServiceMode
+	put8(seed, 0); // the owner name
+	put16(seed, 1); // alpn
+	put16(seed, 6);
+	put8(seed, 2);
+	put_bytes(seed, "h2", 2);
+	put8(seed, 2);
+	put_bytes(seed, "h3", 2);
+	put16(seed, 3); // port
+	put16(seed, 2);
+	put16(seed, 443);
+	put16(seed, 4); // ipv4hint
+	put16(seed, 4);
+	put32(seed, 0x5db8d822);
+	put16(seed, 6); // ipv6hint
+	put16(seed, 16);
+	put32(seed, 0x20010db8);
+	put32(seed, 0);
+	put32(seed, 0);
+	put32(seed, 1);
+}
+
+static const struct {
+	const char *target;
+	uint16_t type;
+	void (*rdata)(seed_t *seed);
+} g_rdata_types[] = {
+	{ "rdata_a",		1,	rdata_a },
+	{ "rdata_ns",		2,	rdata_ns },
+	{ "rdata_cname",	5,	rdata_cname },
+	{ "rdata_soa",		6,	rdata_soa },
+	{ "rdata_ptr",		12,	rdata_ptr },
+	{ "rdata_mx",		15,	rdata_mx },
+	{ "rdata_txt",		16,	rdata_txt },
+	{ "rdata_aaaa",		28,	rdata_aaaa },
+	{ "rdata_srv",		33,	rdata_srv },
+	{ "rdata_naptr",	35,	rdata_naptr },
+	{ "rdata_opt",		41,	rdata_opt },
+	{ "rdata_ds",		43,	rdata_ds },
+	{ "rdata_rrsig",	46,	rdata_rrsig },
+	{ "rdata_nsec",		47,	rdata_nsec },
+	{ "rdata_dnskey",	48,	rdata_dnskey },
+	{ "rdata_nsec3",	50,	rdata_nsec3 },
+	{ "rdata_svcb",		65,	rdata_svcb },
+	{ "rdata_caa",		257,	rdata_caa },
+};
+#define RDATA_TYPE_COUNT (sizeof(g_rdata_types) / sizeof(g_rdata_types[0]))
+
+// A response with one record of each type
+static void put_dns_response(seed_t *seed, dns_record_pos_t *records) {
+	put_dns_header(seed, 0x8180, 1, RDATA_TYPE_COUNT, 0, 0);
+	put_name(seed, "www.example.com");
+	put16(seed, 255); // ANY
+	put16(seed, 1);
+	for (size_t i = 0; i < RDATA_TYPE_COUNT; i++)
+		put_dns_rr(seed, g_rdata_types[i].type, g_rdata_types[i].rdata, &records[i]);
+}
+
+// A query with an OPT RR carrying a client subnet, a client cookie and padding
+static void put_dns_query_edns(seed_t *seed) {
+	put_dns_header(seed, 0x0120, 1, 0, 0, 1);
+	put_name(seed, "www.example.com");
+	put16(seed, 1); // A
+	put16(seed, 1); // IN
+	put8(seed, 0); // root
+	put16(seed, 41); // OPT
+	put16(seed, 1232); // UDP payload size
+	put32(seed, 0x00008000); // DO
+	put16(seed, 4 + 7 + 4 + 8 + 4 + 16);
+	put16(seed, 8); // Client Subnet
+	put16(seed, 7);
+	put16(seed, 1); // IPv4
+	put8(seed, 24); // source prefix
+	put8(seed, 0); // scope prefix
+	put8(seed, 192);
+	put8(seed, 0);
+	put8(seed, 2);
+	put16(seed, 10); // Cookie
+	put16(seed, 8);
+	put_fill(seed, 0x5a, 8);
+	put16(seed, 12); // Padding
+	put16(seed, 16);
+	put_fill(seed, 0, 16);
+}
+
+//
+// Corpus
+//
+static int write_corpus(void) {
+	static const struct {
+		const char *name;
+		uint16_t qtype;
+	} queries[] = {
+		{ "query_a", 1 }, { "query_aaaa", 28 }, { "query_mx", 15 }, { "query_txt", 16 },
+	};
+	int result = 0;
+
+	// DNS
+	seed_t dns[6];
+	const char *dns_names[6];
+	for (size_t i = 0; i < 4; i++) {
+		dns[i].length = 0;
+		put_dns_query(&dns[i], "www.example.com", queries[i].qtype);
+		dns_names[i] = queries[i].name;
+	}
+	dns_record_pos_t records[RDATA_TYPE_COUNT];
+	seed_t *response = &dns[4];
+	response->length = 0;
+	put_dns_response(response, records);
+	dns_names[4] = "response_all_types";
+	dns[5].length = 0;
+	put_dns_query_edns(&dns[5]);
+	dns_names[5] = "query_edns";
+	for (size_t i = 0; i < 6; i++)
+		result |= write_seed("dns", dns_names[i], dns[i].data, dns[i].length);
+
+	// Names and RDATA, parsed from within the response
+	result |= write_dns_seed("name", "question", response, 12);
+	result |= write_dns_seed("name", "pointer", response, records[0].rdata - 12);
+	for (size_t i = 0; i < RDATA_TYPE_COUNT; i++) {
+		result |= write_dns_seed(g_rdata_types[i].target, "response", response, records[i].rdata);
+		if (g_rdata_types[i].type == 2 || g_rdata_types[i].type == 5 || g_rdata_types[i].type == 12)
+			result |= write_dns_seed("name", g_rdata_types[i].target + 6, response, records[i].rdata);
+	}
+
+	// Transports
+	seed_t payload = { .length = 0 };
+	put_fill(&payload, 0xab, 200);
+	seed_t udp[3] = { { .length = 0 }, { .length = 0 }, { .length = 0 } };
+	put_udp(&udp[0], 40000, 53, &dns[0]);
+	put_udp(&udp[1], 53, 40000, response);
+	put_udp(&udp[2], 40000, 443, &payload);
+	result |= write_seed("udp", "dns_query", udp[0].data, udp[0].length);
+	result |= write_seed("udp", "dns_response", udp[1].data, udp[1].length);
+	result |= write_seed("udp", "data", udp[2].data, udp[2].length);
+
+	seed_t empty = { .length = 0 };
+	seed_t tcp[3] = { { .length = 0 }, { .length = 0 }, { .length = 0 } };
+	put_tcp(&tcp[0], 40000, 443, 0x02, &empty, false); // SYN
+	put_tcp(&tcp[1], 443, 40000, 0x18, &payload, false); // PSH+ACK
+	put_tcp(&tcp[2], 53, 40000, 0x18, response, true);
+	result |= write_seed("tcp", "syn", tcp[0].data, tcp[0].length);
+	result |= write_seed("tcp", "data", tcp[1].data, tcp[1].length);
+	result |= write_seed("tcp", "dns_response", tcp[2].data, tcp[2].length);
+
+	seed_t icmp[2] = { { .length = 0 }, { .length = 0 } };
+	put8(&icmp[0], 8); // echo request
+	put8(&icmp[0], 0);
+	put16(&icmp[0], 0);
+	put16(&icmp[0], 0x4242); // id
+	put16(&icmp[0], 1); // seq
+	put_fill(&icmp[0], 0x61, 56);
+	put8(&icmp[1], 3); // destination unreachable
+	put8(&icmp[1], 4); // fragmentation needed
+	put16(&icmp[1], 0);
+	put16(&icmp[1], 0);
+	put16(&icmp[1], 1400); // next-hop mtu
+	put_ipv4(&icmp[1], IPPROTO_UDP, &udp[0]); // the offending datagram
+	result |= write_seed("icmp", "echo", icmp[0].data, icmp[0].length);
+	result |= write_seed("icmp", "unreachable", icmp[1].data, icmp[1].length);
+
+	// Network
+	static const char *const ip_names[] = { "udp_dns", "udp_data", "tcp_syn", "tcp_dns", "icmp_echo" };
+	seed_t ip[5];
+	const seed_t *ip_payloads[5] = { &udp[0], &udp[2], &tcp[0], &tcp[2], &icmp[0] };
+	const uint8_t ip_protocols[5] = { IPPROTO_UDP, IPPROTO_UDP, IPPROTO_TCP, IPPROTO_TCP, IPPROTO_ICMP };
+	for (size_t i = 0; i < 5; i++) {
+		ip[i].length = 0;
+		put_ipv4(&ip[i], ip_protocols[i], ip_payloads[i]);
+		result |= write_seed("ip", ip_names[i], ip[i].data, ip[i].length);
+	}
+
+	seed_t arp = { .length = 0 };
+	put16(&arp, 1); // Ethernet
+	put16(&arp, ETHERTYPE_IP);
+	put8(&arp, 6);
+	put8(&arp, 4);
+	put16(&arp, 1); // request
+	put_fill(&arp, 0x66, 6);
+	put32(&arp, 0x0a000002);
+	put_fill(&arp, 0x00, 6);
+	put32(&arp, 0x0a000001);
+	result |= write_seed("arp", "request", arp.data, arp.length);
+
+	// Link
+	for (size_t i = 0; i < 5; i++) {
+		seed_t frame = { .length = 0 };
+		put_ether(&frame, ETHERTYPE_IP);
+		put_seed(&frame, &ip[i]);
+		result |= write_seed("eth", ip_names[i], frame.data, frame.length);
+	}
+	seed_t frame = { .length = 0 };
+	put_ether(&frame, ETHERTYPE_ARP);
+	put_seed(&frame, &arp);
+	put_fill(&frame, 0, 60 - frame.length); // Ethernet minimum frame size
+	result |= write_seed("eth", "arp_request", frame.data, frame.length);
+
+	return result;
+}
+
+int main(int argc, char **argv) {
+	if (argc != 2) {
+		fprintf(stderr, "Usage: %s DIRECTORY\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+	g_directory = argv[1];
+	if (mkdir(g_directory, 0755) != 0 && errno != EEXIST) {
+		fprintf(stderr, "Error creating %s: %s\n", g_directory, strerror(errno));
+		return EXIT_FAILURE;
+	}
+	if (write_corpus() != 0)
+		return EXIT_FAILURE;
+	printf("Wrote %lu seeds to %s\n", g_written, g_directory);
+	return EXIT_SUCCESS;
+}
@@ -1,5 +1,7 @@
 #include "arguments.h"
+#include "bpf/bpf_filter.h"
 #include "log_level.h"
+#include "proto/dns/pdns.h"
 #include "version.h"
 #include <getopt.h>
 #include <stdio.h>
@@ -31,14 +33,63 @@ void usage(const cli_args_t *args) {
 		"                                tcp | tcp-data\n"
 		"                                udp | udp-data\n"
 		"                              If not provided, protocols are auto-enabled based on BPF filter.\n"
-		"  -E, --bpf-emulator          Use emulated BPF instead of the native BPF.\n"
+		"  -f, --format=" UNDER("format") "         Output format of the decoded packets. Default is text.\n"
+		"                              The supported formats are:\n"
+		"                                text   - one compact line per packet\n"
+		"                                jsonl  - one JSON object per line\n"
+		"                                binary - length-prefixed binary records\n"
+		"  -Q, --output-queue=" UNDER("length") "   Write the output from a dedicated thread, queueing up to\n"
+		"                              " UNDER("length") " batches of decoded packets. Default is 0, which writes\n"
+		"                              from the capture thread.\n"
+		"  -O, --output-overflow=" UNDER("policy") " What to do when the output queue is full. Default is block.\n"
+		"                              The supported policies are:\n"
+		"                                block       - wait for the writer thread\n"
+		"                                drop-newest - discard the batch being queued\n"
+		"                                drop-oldest - discard the oldest queued batch\n"
+		"%s"
 		"  -i, --interface=" UNDER("name") "        Specify which interface to inspect.\n"
+		"  -s, --snaplen=" UNDER("length") "        Capture at most " UNDER("length") " bytes of each packet.\n"
+		"                              The truncation happens in the BPF program, before the copy.\n"
+		"                              Default is 65535.\n"
+		"  -M, --metrics-listen=" UNDER("address") " Serve the capture statistics over HTTP, in the Prometheus\n"
+		"                              text format, on " UNDER("address") " ([host:]port). The host defaults\n"
+		"                              to 127.0.0.1. Example: --metrics-listen=9100\n"
+		"  -S, --stats-interval=" UNDER("seconds") " Print capture statistics to stderr every " UNDER("seconds") ".\n"
+		"                              Send SIGUSR1 to print them at any time. They are always\n"
+		"                              printed on exit.\n"
+		"%s"
+		"  -T, --timestamps            Start the output of each packet with a ts field, the time\n"
+		"                              the kernel received it, in nanoseconds since the Epoch.\n"
+		"  -w, --write=" UNDER("file") "            Write the captured packets to " UNDER("file") " in pcap format,\n"
+		"                              with nanosecond timestamps.\n"
 		"  -t, --chrootdir=" UNDER("directory") "   Chroot to " UNDER("directory") " after processing the command line arguments.\n"
 		"  -u, --user=" UNDER("name") "             Change the user to " UNDER("name") " after completing privileged operations, \n"
 		"                              such as creating sockets that listen on privileged ports.\n"
 		"  -v, --version               Output version information and exit.\n"
 		"  -h, --help                  Display this help and exit.\n";
-	fprintf(stderr, usage_format, args->exename);
+	// Kept apart, so no literal exceeds what C99 compilers are required to support
+	const char *bpf_options =
+		"  -E, --bpf-emulator          Use emulated BPF instead of the native BPF.\n"
+		"  -B, --bpf-batch             Run the emulated BPF on batches of packets, checking the\n"
+		"                              fields the filter starts with on the whole batch at once.\n"
+		"                              Whether that is faster depends on the machine.\n"
+		"  -F, --filter-file=" UNDER("file") "      Read the BPF filter expression from " UNDER("file") ".\n"
+		"                              Send SIGHUP to re-read it and replace the filter without\n"
+		"                              interrupting the capture.\n";
+	const char *dns_options =
+		"  -A, --dns-alerts            Watch the DNS responses and queries of each zone and client\n"
+		"                              for NXDOMAIN floods, SERVFAIL spikes and random subdomains,\n"
+		"                              and emit a dns-alerts record when one crosses a threshold.\n"
+		"  -P, --pdns=" UNDER("file") "             Keep every unique (rrname, rrtype, rdata) tuple of the DNS\n"
+		"                              answers, with when it was first and last seen and how many\n"
+		"                              times, and append the changes to " UNDER("file") ".\n"
+		"  -I, --pdns-interval=" UNDER("seconds") " Flush the passive DNS tuples every " UNDER("seconds") ". Default is 60.\n"
+		"  -L, --pdns-lookup=" UNDER("name") "      Print the tuples of " UNDER("name") " in the file given by --pdns\n"
+		"                              and exit, without capturing.\n"
+		"  -N, --dns-name=" UNDER("file") "         Only output the packets with a DNS question at or below one\n"
+		"                              of the domains listed in " UNDER("file") ", one per line. Hosts files\n"
+		"                              work too, as only the last word of each line is read.\n";
+	fprintf(stderr, usage_format, args->exename, bpf_options, dns_options);
 #undef UNDER
 #undef BOLD
 }
@@ -73,8 +124,23 @@ int parse_arguments(cli_args_t *args, int argc, char **argv) {
 		{ "loglevel",			required_argument,	NULL, 'l' },
 		{ "background",			no_argument,		NULL, 'b' },
 		{ "display-filters",	required_argument,	NULL, 'd' },
+		{ "format",				required_argument,	NULL, 'f' },
+		{ "output-queue",		required_argument,	NULL, 'Q' },
+		{ "output-overflow",	required_argument,	NULL, 'O' },
 		{ "bpf-emulator", 		no_argument,		NULL, 'E' },
+		{ "bpf-batch", 			no_argument,		NULL, 'B' },
+		{ "filter-file",		required_argument,	NULL, 'F' },
 		{ "interface",  		required_argument,  NULL, 'i' },
+		{ "snaplen",			required_argument,	NULL, 's' },
+		{ "metrics-listen",		required_argument,	NULL, 'M' },
+		{ "stats-interval",		required_argument,	NULL, 'S' },
+		{ "dns-alerts",			no_argument,		NULL, 'A' },
+		{ "pdns",				required_argument,	NULL, 'P' },
+		{ "pdns-interval",		required_argument,	NULL, 'I' },
+		{ "pdns-lookup",		required_argument,	NULL, 'L' },
+		{ "dns-name",			required_argument,	NULL, 'N' },
+		{ "timestamps",			no_argument,		NULL, 'T' },
+		{ "write",				required_argument,	NULL, 'w' },
 		{ "chrootdir",			required_argument,	NULL, 't' },
 		{ "username",			required_argument,	NULL, 'u' },
 		{ "version",			no_argument,		NULL, 'v' },
@@ -88,6 +154,9 @@ int parse_arguments(cli_args_t *args, int argc, char **argv) {
 	args->exename = strrchr(argv[0], '/');
 	args->exename = (args->exename != NULL) ? args->exename+1 : argv[0];
 	args->bpf_mode = NATIVE_BPF; // Default to native BPF
+	args->output_format = OUTPUT_FORMAT_TEXT;
+	args->output_overflow = OUTPUT_OVERFLOW_BLOCK;
+	args->pdns_interval = DNS_PDNS_DEFAULT_INTERVAL;
 
 	while (1) {
 		int opt_index = 0;
@@ -101,8 +170,75 @@ int parse_arguments(cli_args_t *args, int argc, char **argv) {
 				break;
 			case 'b': args->background = true; break;
 			case 'd': args->display_filters = optarg; break;
+			case 'f':
+				if (output_format_from_name(optarg, &args->output_format) < 0) {
+					fprintf(stderr, "Error: Unknown output format '%s'.\n\n", optarg);
+					usage(args);
+					return -1;
+				}
+				break;
+			case 'Q': {
+				char *endptr;
+				unsigned long value = strtoul(optarg, &endptr, 10);
+				if (*optarg == '\0' || *endptr != '\0' || value > 65536) {
+					fprintf(stderr, "Error: Invalid output queue length '%s'.\n\n", optarg);
+					usage(args);
+					return -1;
+				}
+				args->output_queue = (size_t)value;
+				break;
+			}
+			case 'O':
+				if (output_overflow_from_name(optarg, &args->output_overflow) < 0) {
+					fprintf(stderr, "Error: Unknown output overflow policy '%s'.\n\n", optarg);
+					usage(args);
+					return -1;
+				}
+				break;
 			case 'E': args->bpf_mode = EMULATED_BPF; break;
+			case 'B': args->bpf_batch = true; break;
+			case 'F': args->bpf_filter_file = optarg; break;
 			case 'i': args->interface_name = optarg; break;
+			case 's': {
+				char *endptr;
+				unsigned long value = strtoul(optarg, &endptr, 10);
+				if (*optarg == '\0' || *endptr != '\0' || value > UINT32_MAX) {
+					fprintf(stderr, "Error: Invalid snaplen '%s'.\n\n", optarg);
+					usage(args);
+					return -1;
+				}
+				args->snaplen = (uint32_t)value;
+				break;
+			}
+			case 'M': args->metrics_listen = optarg; break;
+			case 'S': {
+				char *endptr;
+				unsigned long value = strtoul(optarg, &endptr, 10);
+				if (*optarg == '\0' || *endptr != '\0' || value > 86400) {
+					fprintf(stderr, "Error: Invalid stats interval '%s'.\n\n", optarg);
+					usage(args);
+					return -1;
+				}
+				args->stats_interval = (unsigned)value;
+				break;
+			}
+			case 'A': args->dns_alerts = true; break;
+			case 'P': args->pdns_file = optarg; break;
+			case 'I': {
+				char *endptr;
+				unsigned long value = strtoul(optarg, &endptr, 10);
+				if (*optarg == '\0' || *endptr != '\0' || value == 0 || value > 86400) {
+					fprintf(stderr, "Error: Invalid passive DNS flush interval '%s'.\n\n", optarg);
+					usage(args);
+					return -1;
+				}
+				args->pdns_interval = (unsigned)value;
+				break;
+			}
+			case 'L': args->pdns_lookup = optarg; break;
+			case 'N': args->dns_names_file = optarg; break;
+			case 'T': args->timestamps = true; break;
+			case 'w': args->write_file = optarg; break;
 			case 't': args->chrootdir = optarg; break;
 			case 'u': args->username = optarg; break;
 			case 'v': showversion(); exit(EXIT_SUCCESS);
@@ -110,9 +246,25 @@ int parse_arguments(cli_args_t *args, int argc, char **argv) {
 			case '?': usage(args); exit(EXIT_FAILURE);
 		}
 	}
+
+	if (args->pdns_lookup != NULL && args->pdns_file == NULL) {
+		fprintf(stderr, "Error: --pdns-lookup needs the file given by --pdns.\n\n");
+		usage(args);
+		return -1;
+	}
 	
-	// Check for optional positional argument (BPF expression)
-	if (optind < argc) {
+	if (args->bpf_filter_file != NULL) {
+		if (optind < argc) {
+			fprintf(stderr, "Error: A BPF filter expression cannot be combined with --filter-file.\n\n");
+			usage(args);
+			return -1;
+		}
+		args->bpf_filter_expr = bpf_read_filter_file(args->bpf_filter_file);
+		if (args->bpf_filter_expr == NULL) {
+			fprintf(stderr, "Error: Failed to read BPF filter from %s\n", args->bpf_filter_file);
+			return -1;
+		}
+	} else if (optind < argc) {
 		// The first non-option argument is the BPF filter expression
 		args->bpf_filter_expr = argv[optind];
 		
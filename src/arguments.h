@@ -3,6 +3,7 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include "bpf/bpf_types.h"
+#include "output.h"
 
 typedef struct cli_args {
 	int argc;
@@ -11,8 +12,23 @@ typedef struct cli_args {
 	int loglevel;
 	bool background;
 	char *display_filters; // Comma-separated list of protocol display filters
+	output_format_e output_format;
+	size_t output_queue; // Number of batches queued for the writer thread (0 = write from the capture thread)
+	output_overflow_e output_overflow;
 	bpf_mode_t bpf_mode;
+	bool bpf_batch; // Run the emulated filter on batches of packets, behind a prefilter
 	char *bpf_filter_expr; // BPF filter expression
+	char *bpf_filter_file; // File to read the BPF filter expression from (re-read on SIGHUP)
+	uint32_t snaplen; // Max bytes captured per packet (0 = default)
+	bool timestamps; // Emit the arrival time of each packet into the output
+	char *write_file; // Path of the pcap file to write packets to
+	char *metrics_listen; // [host:]port to serve the statistics on, in the Prometheus format
+	unsigned stats_interval; // Seconds between statistics reports (0 = only on SIGUSR1 and exit)
+	bool dns_alerts; // Detect DNS anomalies and emit alerts into the output
+	char *pdns_file; // Path of the passive DNS store to append the answers to
+	unsigned pdns_interval; // Seconds between flushes of the passive DNS store
+	char *pdns_lookup; // Name to look up in the passive DNS store, instead of capturing
+	char *dns_names_file; // Path of the list of domain suffixes the output is filtered by
 	char *interface_name;
 	char *chrootdir;
 	char *username;
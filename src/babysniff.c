@@ -18,25 +18,63 @@
 // #error sigaction is not supported
 // #endif
 
+#include <errno.h>
 #include <fcntl.h>
 #include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
 
 #include "arguments.h"
 #include "config.h"
 #include "daemon.h"
+#include "metrics.h"
+#include "proto/dns/anomaly.h"
+#include "proto/dns/name_filter.h"
+#include "proto/dns/pdns.h"
 #include "security.h"
 
 // sig_atomic_t is defined by C99
 static volatile sig_atomic_t g_done = 0;
+static volatile sig_atomic_t g_reload_filter = 0;
+static volatile sig_atomic_t g_print_stats = 0;
 
 static void cleanup(int signal) {
-	printf("Received signal %d\n", signal);
+	if (signal != SIGUSR1)
+		fprintf(stderr, "Received signal %d\n", signal);
 	if (signal == SIGINT)
 		g_done = 1;
+	else if (signal == SIGHUP)
+		g_reload_filter = 1;
+	else if (signal == SIGUSR1)
+		g_print_stats = 1;
+}
+
+// Re-read the filter file and swap the new filter in without reopening the channel.
+// If anything fails the previous filter is kept.
+static void reload_filter(channel_t *channel, cli_args_t *args) {
+	if (args->bpf_filter_file == NULL) {
+		fprintf(stderr, "No filter file to reload, keeping BPF filter: %s\n", args->bpf_filter_expr);
+		return;
+	}
+
+	char *expression = bpf_read_filter_file(args->bpf_filter_file);
+	if (expression == NULL) {
+		fprintf(stderr, "Error reading BPF filter from %s\n", args->bpf_filter_file);
+		return;
+	}
+
+	if (sniff_channel_replace_bpf_filter(channel, expression) < 0) {
+		fprintf(stderr, "Error replacing BPF filter: %s\n", sniff_channel_get_error_msg(channel));
+		free(expression);
+		return;
+	}
+
+	free(args->bpf_filter_expr);
+	args->bpf_filter_expr = expression;
+	fprintf(stderr, "Applied BPF filter: %s\n", args->bpf_filter_expr);
 }
 
 static void install_sighandlers(void) {
@@ -48,11 +86,48 @@ static void install_sighandlers(void) {
 	sigaction(SIGINT, &sa, NULL);
 	sigaction(SIGTERM, &sa, NULL);
 	sigaction(SIGQUIT, &sa, NULL);
+	sigaction(SIGUSR1, &sa, NULL);
+}
+
+static void print_stats(channel_t *channel) {
+	stats_snapshot_t snapshot;
+	sniff_channel_get_stats(channel, &snapshot);
+	stats_print(stderr, &snapshot);
+}
+
+static void print_pdns_record(const dns_pdns_record_t *record, void *arg) {
+	output_t *output = arg;
+	output_begin_record(output);
+	dns_pdns_print_record(record, output);
+	output_end_record(output);
+}
+
+// Doesn't need any privileges, so it runs before the capture is set up
+static int lookup_pdns(const cli_args_t *args) {
+	dns_pdns_map_t *map = dns_pdns_map_open(args->pdns_file);
+	if (map == NULL) {
+		fprintf(stderr, "Error opening %s: %s\n", args->pdns_file, strerror(errno));
+		return -1;
+	}
+	output_t *output = output_alloc(args->output_format, STDOUT_FILENO);
+	if (output == NULL) {
+		fprintf(stderr, "Error allocating output buffer\n");
+		dns_pdns_map_close(map);
+		return -1;
+	}
+	size_t found = dns_pdns_map_lookup(map, args->pdns_lookup, print_pdns_record, output);
+	output_flush(output);
+	output_free(output);
+	dns_pdns_map_close(map);
+	fprintf(stderr, "Found %zu tuples of %s\n", found, args->pdns_lookup);
+	return 0;
 }
 
 int main(int argc, char **argv) {
 	cli_args_t args;
 	config_t config;
+	metrics_server_t *metrics = NULL;
+	dns_pdns_t *pdns = NULL;
 
 	if (parse_arguments(&args, argc, argv) < 0) {
 		return EXIT_FAILURE;
@@ -62,6 +137,9 @@ int main(int argc, char **argv) {
 		return EXIT_FAILURE;
 	}
 
+	if (args.pdns_lookup != NULL)
+		return lookup_pdns(&args) < 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+
 	if (geteuid() != 0) {
 		fprintf(stderr, "Requires superuser privileges\n");
 		return EXIT_FAILURE;
@@ -95,6 +173,62 @@ int main(int argc, char **argv) {
 		goto error;
 	}
 
+	// Decoded packets go to stdout, so informational messages go to stderr
+	output_t *output = output_alloc(args.output_format, STDOUT_FILENO);
+	if (output == NULL) {
+		fprintf(stderr, "Error allocating output buffer\n");
+		goto error;
+	}
+	sniff_channel_set_output(channel, output);
+
+	if (args.output_queue > 0 && output_start_writer(output, args.output_queue, args.output_overflow) < 0) {
+		fprintf(stderr, "Error starting the output writer thread\n");
+		goto error;
+	}
+
+	if (args.dns_alerts) {
+		dns_anomaly_t *anomaly = dns_anomaly_alloc(&dns_anomaly_default_thresholds);
+		if (anomaly == NULL) {
+			fprintf(stderr, "Error allocating the DNS anomaly detector\n");
+			goto error;
+		}
+		sniff_channel_set_dns_anomaly(channel, anomaly);
+	}
+
+	if (args.dns_names_file != NULL) {
+		dns_name_filter_t *names = dns_name_filter_alloc();
+		if (names == NULL) {
+			fprintf(stderr, "Error allocating the DNS name filter\n");
+			goto error;
+		}
+		if (dns_name_filter_load(names, args.dns_names_file) < 0) {
+			fprintf(stderr, "Error loading DNS names from %s: %s\n", args.dns_names_file, strerror(errno));
+			dns_name_filter_free(names);
+			goto error;
+		}
+		sniff_channel_set_dns_names(channel, names);
+		fprintf(stderr, "Loaded %zu DNS name suffixes from %s\n", dns_name_filter_count(names), args.dns_names_file);
+	}
+
+	// Opened before the chroot, so the path is the one given
+	if (args.pdns_file != NULL) {
+		pdns = dns_pdns_open(args.pdns_file);
+		if (pdns == NULL) {
+			fprintf(stderr, "Error opening %s: %s\n", args.pdns_file, strerror(errno));
+			goto error;
+		}
+		sniff_channel_set_dns_pdns(channel, pdns);
+	}
+
+	// The snaplen must be known before the filter is compiled
+	sniff_channel_set_snaplen(channel, args.snaplen);
+	sniff_channel_set_batch_filter(channel, args.bpf_batch);
+
+	if (args.write_file != NULL && sniff_channel_open_dump(channel, args.write_file) < 0) {
+		fprintf(stderr, "Error opening output file: %s\n", sniff_channel_get_error_msg(channel));
+		goto error;
+	}
+
 	// Set BPF filter
 	// If not provided, a default is set in parse_arguments()
 	if (sniff_channel_set_bpf_filter(channel, args.bpf_mode, args.bpf_filter_expr) < 0) {
@@ -108,7 +242,16 @@ int main(int argc, char **argv) {
 		goto error;
 	}
 
-	printf("Applied BPF filter: %s\n", args.bpf_filter_expr);
+	fprintf(stderr, "Applied BPF filter: %s\n", args.bpf_filter_expr);
+
+	// Bind before dropping privileges, the port may be a privileged one
+	if (args.metrics_listen != NULL) {
+		metrics = metrics_server_start(args.metrics_listen, channel);
+		if (metrics == NULL) {
+			fprintf(stderr, "Error starting the metrics server on %s\n", args.metrics_listen);
+			goto error;
+		}
+	}
 
 	if (args.chrootdir != NULL) {
 		if (security_force_chroot(args.chrootdir) < 0)
@@ -119,16 +262,43 @@ int main(int argc, char **argv) {
 			goto error;
 	}
 
+	time_t stats_printed_at = time(NULL);
+	time_t pdns_flushed_at = time(NULL);
 	while (!g_done) {
+		if (g_reload_filter) {
+			g_reload_filter = 0;
+			reload_filter(channel, &args);
+		}
 		sniff_readloop(channel, 1, &config);
+
+		// Keep going if it fails, the kernel counters just won't move
+		sniff_channel_update_stats(channel);
+		if (args.stats_interval > 0 && time(NULL) - stats_printed_at >= args.stats_interval)
+			g_print_stats = 1;
+		if (g_print_stats) {
+			g_print_stats = 0;
+			stats_printed_at = time(NULL);
+			print_stats(channel);
+		}
+		// The decoders run on this thread, so the tuples can't change under the flush
+		if (pdns != NULL && time(NULL) - pdns_flushed_at >= args.pdns_interval) {
+			pdns_flushed_at = time(NULL);
+			if (dns_pdns_flush(pdns, (uint64_t)pdns_flushed_at) < 0)
+				fprintf(stderr, "Error flushing the passive DNS tuples: %s\n", strerror(errno));
+		}
 	}
+
+	metrics_server_stop(metrics);
+	output_stop_writer(output); // So that the stats count everything written
+	print_stats(channel);
 	sniff_close(channel);
 
-	printf("Terminating...\n");
+	fprintf(stderr, "Terminating...\n");
 
 	return EXIT_SUCCESS;
 
 error:
+	metrics_server_stop(metrics);
 	sniff_close(channel);
 
 	return EXIT_FAILURE;
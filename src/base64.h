@@ -2,5 +2,13 @@
 
 #include <stddef.h>
 
+// Number of characters of the encoding, padding included, without a null terminator.
+static inline size_t base64_encoded_length(size_t input_size) {
+	return (input_size + 2) / 3 * 4;
+}
+
 size_t base64_encoded_size(size_t input_size);
 int base64_encode(char *result, size_t resultSize, const void *input, size_t inputSize);
+// Writes exactly base64_encoded_length(inputSize) characters and no null terminator.
+// Vectorized when the CPU supports it, which is detected on the first call.
+size_t base64_encode_unterminated(char *result, const void *input, size_t inputSize);
@@ -57,7 +57,7 @@ int bpf_set_instructions(bpf_program_t *program, const struct bpf_insn *instns,
 }
 
 // Create a simple host filter (matches src or dst IP)
-int bpf_create_host_filter(const char *host, bpf_program_t *program) {
+int bpf_create_host_filter(const char *host, uint32_t snaplen, bpf_program_t *program) {
     struct in_addr addr;
 
     if (resolve_hostname(host, &addr) < 0) {
@@ -73,7 +73,7 @@ int bpf_create_host_filter(const char *host, bpf_program_t *program) {
         BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, host_ip, 2, 0),        // 3: If src IP matches, jump 2 to accept (6)
         BPF_STMT(BPF_LD | BPF_W | BPF_ABS, IP_DST_OFFSET),         // 4: Load dst IP
         BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, host_ip, 0, 1),        // 5: If dst IP matches, accept (next), else jump 1 to reject (7)
-        BPF_STMT(BPF_RET | BPF_K, 0xffff),                         // 6: Accept
+        BPF_STMT(BPF_RET | BPF_K, snaplen),                        // 6: Accept
         BPF_STMT(BPF_RET | BPF_K, 0),                              // 7: Reject
     };
 
@@ -81,7 +81,7 @@ int bpf_create_host_filter(const char *host, bpf_program_t *program) {
 }
 
 // Create a port filter (matches src or dst port for SCTP/TCP/UDP)
-int bpf_create_port_filter(uint16_t port, bpf_program_t *program) {
+int bpf_create_port_filter(uint16_t port, uint32_t snaplen, bpf_program_t *program) {
     // FIXME(jweyrich): This is a very naive port filter implementation which makes an assumption about the IP header size.
     // Simplified port filter - assumes standard 20-byte IP header for now
     const struct bpf_insn instns[] = {
@@ -107,7 +107,7 @@ int bpf_create_port_filter(uint16_t port, bpf_program_t *program) {
         BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, port, 2, 0),           // 0x15: if port matches, jump 2 instructions
         BPF_STMT(BPF_LD | BPF_H | BPF_IND, 16),                    // 0x48: load half-word at X+16 (dst port)
         BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, port, 0, 1),           // 0x15: if port matches, skip next instruction
-        BPF_STMT(BPF_RET | BPF_K, 0xffff),                         // 0x06: return 65535 (accept packet)
+        BPF_STMT(BPF_RET | BPF_K, snaplen),                        // 0x06: return snaplen (accept packet)
         BPF_STMT(BPF_RET | BPF_K, 0),                              // 0x06: return 0 (reject packet)
     };
 
@@ -115,13 +115,13 @@ int bpf_create_port_filter(uint16_t port, bpf_program_t *program) {
 }
 
 // Create a protocol filter (ARP, IP, TCP, UDP, ICMP, DNS, or numeric)
-int bpf_create_protocol_filter(const char *protocol, bpf_program_t *program) {
+int bpf_create_protocol_filter(const char *protocol, uint32_t snaplen, bpf_program_t *program) {
     // Check if this is an EtherType protocol (operates at layer 2)
     if (strcasecmp(protocol, "arp") == 0) {
         const struct bpf_insn instns[] = {
             BPF_STMT(BPF_LD | BPF_H | BPF_ABS, 12),                    // Load EtherType
             BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, ETHERTYPE_ARP, 0, 1),  // Jump if not ARP
-            BPF_STMT(BPF_RET | BPF_K, 0xffff),                         // Accept
+            BPF_STMT(BPF_RET | BPF_K, snaplen),                        // Accept
             BPF_STMT(BPF_RET | BPF_K, 0),                              // Reject
         };
         return bpf_set_instructions(program, instns, sizeof(instns));
@@ -129,7 +129,7 @@ int bpf_create_protocol_filter(const char *protocol, bpf_program_t *program) {
         const struct bpf_insn instns[] = {
             BPF_STMT(BPF_LD | BPF_H | BPF_ABS, 12),                   // Load EtherType
             BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, ETHERTYPE_IP, 0, 1),  // Jump if not IP
-            BPF_STMT(BPF_RET | BPF_K, 0xffff),                        // Accept
+            BPF_STMT(BPF_RET | BPF_K, snaplen),                       // Accept
             BPF_STMT(BPF_RET | BPF_K, 0),                             // Reject
         };
         return bpf_set_instructions(program, instns, sizeof(instns));
@@ -137,13 +137,13 @@ int bpf_create_protocol_filter(const char *protocol, bpf_program_t *program) {
         const struct bpf_insn instns[] = {
             BPF_STMT(BPF_LD | BPF_H | BPF_ABS, 12),                     // Load EtherType
             BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, ETHERTYPE_IPV6, 0, 1),  // Jump if not IPv6
-            BPF_STMT(BPF_RET | BPF_K, 0xffff),                          // Accept
+            BPF_STMT(BPF_RET | BPF_K, snaplen),                         // Accept
             BPF_STMT(BPF_RET | BPF_K, 0),                               // Reject
         };
         return bpf_set_instructions(program, instns, sizeof(instns));
     } else if (strcasecmp(protocol, "dns") == 0) {
 		// Assume port 53
-        return bpf_create_port_filter(53, program);
+        return bpf_create_port_filter(53, snaplen, program);
     }
 
     // Handle IP protocol types (operates at layer 3/4)
@@ -172,16 +172,16 @@ int bpf_create_protocol_filter(const char *protocol, bpf_program_t *program) {
         BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, ETHERTYPE_IP, 0, 3),  // Jump if not IPv4
         BPF_STMT(BPF_LD | BPF_B | BPF_ABS, IP_PROTO_OFFSET),      // Load IP protocol field
         BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, proto_num, 0, 1),     // Jump if protocol doesn't match
-        BPF_STMT(BPF_RET | BPF_K, 0xffff),                        // Accept
+        BPF_STMT(BPF_RET | BPF_K, snaplen),                       // Accept
         BPF_STMT(BPF_RET | BPF_K, 0),                             // Reject
     };
 
     return bpf_set_instructions(program, instns, sizeof(instns));
 }
 
-int bpf_create_empty_filter(bpf_program_t *program) {
+int bpf_create_empty_filter(uint32_t snaplen, bpf_program_t *program) {
     const struct bpf_insn instns[] = {
-        BPF_STMT(BPF_RET | BPF_K, 0xffff), // Accept all packets
+        BPF_STMT(BPF_RET | BPF_K, snaplen), // Accept all packets
     };
     return bpf_set_instructions(program, instns, sizeof(instns));
 }
@@ -192,6 +192,9 @@ void bpf_free_program(bpf_program_t *program) {
         return;
     }
     free(program->bf_insns);
+    // The program may be reused by the generators, which free what they find in it
+    program->bf_insns = NULL;
+    program->bf_len = 0;
 }
 
 // Simple tokenizer for filter expressions
@@ -225,13 +228,18 @@ static void free_tokens(token_list_t *tokens) {
 }
 
 // Simple filter expression parser (supports basic syntax like "host 192.168.1.1", "port 80", "tcp")
-int bpf_compile_filter(const char *filter_string, bpf_program_t *program) {
+// Accepted packets are truncated to `snaplen` bytes. Use 0 to select BPF_DEFAULT_SNAPLEN.
+int bpf_compile_filter(const char *filter_string, uint32_t snaplen, bpf_program_t *program) {
     if (!program) {
         return -1;
     }
-    
+
+    if (snaplen == 0) {
+        snaplen = BPF_DEFAULT_SNAPLEN;
+    }
+
     if (!filter_string || strlen(filter_string) == 0) {
-        return bpf_create_empty_filter(program);
+        return bpf_create_empty_filter(snaplen, program);
     }
 
     token_list_t tokens;
@@ -247,19 +255,61 @@ int bpf_compile_filter(const char *filter_string, bpf_program_t *program) {
     // Handle simple filter expressions
     if (tokens.count == 2) {
         if (strcasecmp(tokens.tokens[0], "host") == 0) {
-            result = bpf_create_host_filter(tokens.tokens[1], program);
+            result = bpf_create_host_filter(tokens.tokens[1], snaplen, program);
         } else if (strcasecmp(tokens.tokens[0], "port") == 0) {
             char *endptr;
             long port = strtol(tokens.tokens[1], &endptr, 10);
             if (*endptr == '\0' && port >= 0 && port <= 65535) {
-                result = bpf_create_port_filter((uint16_t)port, program);
+                result = bpf_create_port_filter((uint16_t)port, snaplen, program);
             }
         }
     } else if (tokens.count == 1) {
         // Single protocol filter
-        result = bpf_create_protocol_filter(tokens.tokens[0], program);
+        result = bpf_create_protocol_filter(tokens.tokens[0], snaplen, program);
     }
 
     free_tokens(&tokens);
     return result;
 }
+
+// Read a filter expression from a file (tcpdump's -F). Newlines are treated as spaces
+// by the tokenizer, so the expression may span multiple lines. The caller must free it.
+char *bpf_read_filter_file(const char *path) {
+    FILE *stream = fopen(path, "r");
+    if (!stream) {
+        return NULL;
+    }
+
+    size_t capacity = 256;
+    size_t length = 0;
+    char *expression = malloc(capacity);
+    while (expression) {
+        length += fread(expression + length, 1, capacity - length - 1, stream);
+        if (length < capacity - 1) {
+            break;
+        }
+        char *grown = realloc(expression, capacity * 2);
+        if (!grown) {
+            free(expression);
+            expression = NULL;
+            break;
+        }
+        expression = grown;
+        capacity *= 2;
+    }
+
+    if (expression && ferror(stream)) {
+        free(expression);
+        expression = NULL;
+    }
+    fclose(stream);
+
+    if (expression) {
+        // Trim trailing whitespace
+        while (length > 0 && isspace((unsigned char)expression[length - 1])) {
+            length--;
+        }
+        expression[length] = '\0';
+    }
+    return expression;
+}
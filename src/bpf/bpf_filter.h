@@ -16,14 +16,21 @@
 #define UDP_SPORT_OFFSET  34    // UDP source port offset
 #define UDP_DPORT_OFFSET  36    // UDP destination port offset
 
+// Number of bytes returned by the accept instruction when no snaplen is given
+#define BPF_DEFAULT_SNAPLEN 0xffff
+
 // Filter compilation and execution functions
-int bpf_compile_filter(const char *filter_string, bpf_program_t *program);
+int bpf_compile_filter(const char *filter_string, uint32_t snaplen, bpf_program_t *program);
 void bpf_free_program(bpf_program_t *program);
+char *bpf_read_filter_file(const char *path);
 
 // Utility functions for creating common filters
-int bpf_create_host_filter(const char *host, bpf_program_t *program);
-int bpf_create_port_filter(uint16_t port, bpf_program_t *program);
-int bpf_create_protocol_filter(const char *protocol, bpf_program_t *program);
+// The `snaplen` is the value returned by the accept instruction, i.e. how many bytes of
+// each accepted packet the kernel (or the emulator) should keep.
+int bpf_create_host_filter(const char *host, uint32_t snaplen, bpf_program_t *program);
+int bpf_create_port_filter(uint16_t port, uint32_t snaplen, bpf_program_t *program);
+int bpf_create_protocol_filter(const char *protocol, uint32_t snaplen, bpf_program_t *program);
+int bpf_create_empty_filter(uint32_t snaplen, bpf_program_t *program);
 int bpf_create_net_filter(const char *network, bpf_program_t *program);
 
 // Helper function to allocate and copy BPF instructions
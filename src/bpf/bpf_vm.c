@@ -3,10 +3,18 @@
 #endif
 
 #include "bpf/bpf_vm.h"
+#include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <arpa/inet.h>
+
+// Comparisons followed by a check, repeated values included
+#define BPF_PREFILTER_MAX_COMPARISONS   16
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#   define BPF_HAVE_X86_SIMD
+#   include <emmintrin.h>
+#endif
 
 //
 // Reference man-page:
@@ -28,30 +36,43 @@ typedef struct {
     uint32_t M[BPF_VM_STACK_SIZE];  // Memory store (16 slots)
 } bpf_vm_state_t;
 
-// Helper function to safely read from packet
-static uint32_t safe_load_word(const uint8_t *packet, uint32_t packet_len, uint32_t offset) {
-    if (offset + 4 > packet_len) return 0;
-    return ntohl(*(uint32_t *)(packet + offset));
+// Helper functions to safely read from packet. Like the kernel, a load that doesn't fit in
+// the packet fails, and the caller must then reject the packet. The comparison is written
+// so that an offset close to UINT32_MAX can't wrap around.
+static int safe_load_word(const uint8_t *packet, uint32_t packet_len, uint32_t offset, uint32_t *value) {
+    if (offset > packet_len || packet_len - offset < 4) return -1;
+    *value = ((uint32_t)packet[offset] << 24) | ((uint32_t)packet[offset + 1] << 16)
+        | ((uint32_t)packet[offset + 2] << 8) | packet[offset + 3];
+    return 0;
 }
 
-static uint16_t safe_load_half(const uint8_t *packet, uint32_t packet_len, uint32_t offset) {
-    if (offset + 2 > packet_len) return 0;
-    return ntohs(*(uint16_t *)(packet + offset));
+static int safe_load_half(const uint8_t *packet, uint32_t packet_len, uint32_t offset, uint32_t *value) {
+    if (offset > packet_len || packet_len - offset < 2) return -1;
+    *value = ((uint32_t)packet[offset] << 8) | packet[offset + 1];
+    return 0;
 }
 
-static uint8_t safe_load_byte(const uint8_t *packet, uint32_t packet_len, uint32_t offset) {
-    if (offset + 1 > packet_len) return 0;
-    return *(uint8_t *)(packet + offset);
+static int safe_load_byte(const uint8_t *packet, uint32_t packet_len, uint32_t offset, uint32_t *value) {
+    if (offset >= packet_len) return -1;
+    *value = packet[offset];
+    return 0;
 }
 
-// BPF virtual machine execution
-int bpf_execute_filter(const bpf_program_t *program, const uint8_t *packet, uint32_t packet_len) {
-    if (!program || !program->bf_insns || program->bf_len == 0) {
-        return 1; // Accept all packets if no program
+static int safe_load(const uint8_t *packet, uint32_t packet_len, uint16_t size, uint32_t offset, uint32_t *value) {
+    switch (size) {
+        case BPF_W: return safe_load_word(packet, packet_len, offset, value);
+        case BPF_H: return safe_load_half(packet, packet_len, offset, value);
+        case BPF_B: return safe_load_byte(packet, packet_len, offset, value);
+        default:    return -1;
     }
+}
 
+// BPF virtual machine execution, from instruction `pc` with `A` in the accumulator
+static uint32_t execute_from(const bpf_program_t *program, const uint8_t *packet, uint32_t packet_len,
+    uint32_t pc, uint32_t A)
+{
     bpf_vm_state_t vm = {0};
-    uint32_t pc = 0; // Program counter
+    vm.A = A;
 
     while (pc < program->bf_len) {
         struct bpf_insn *insn = &program->bf_insns[pc];
@@ -61,29 +82,13 @@ int bpf_execute_filter(const bpf_program_t *program, const uint8_t *packet, uint
             case BPF_LD:
                 switch (BPF_MODE(code)) {
                     case BPF_ABS:
-                        switch (BPF_SIZE(code)) {
-                            case BPF_W:
-                                vm.A = safe_load_word(packet, packet_len, insn->k);
-                                break;
-                            case BPF_H:
-                                vm.A = safe_load_half(packet, packet_len, insn->k);
-                                break;
-                            case BPF_B:
-                                vm.A = safe_load_byte(packet, packet_len, insn->k);
-                                break;
+                        if (safe_load(packet, packet_len, BPF_SIZE(code), insn->k, &vm.A) != 0) {
+                            return 0; // Out of bounds, reject packet
                         }
                         break;
                     case BPF_IND:
-                        switch (BPF_SIZE(code)) {
-                            case BPF_W:
-                                vm.A = safe_load_word(packet, packet_len, vm.X + insn->k);
-                                break;
-                            case BPF_H:
-                                vm.A = safe_load_half(packet, packet_len, vm.X + insn->k);
-                                break;
-                            case BPF_B:
-                                vm.A = safe_load_byte(packet, packet_len, vm.X + insn->k);
-                                break;
+                        if (safe_load(packet, packet_len, BPF_SIZE(code), vm.X + insn->k, &vm.A) != 0) {
+                            return 0; // Out of bounds, reject packet
                         }
                         break;
                     case BPF_IMM:
@@ -114,7 +119,13 @@ int bpf_execute_filter(const bpf_program_t *program, const uint8_t *packet, uint
                         }
                         break;
                     case BPF_MSH:
-                        vm.X = (safe_load_byte(packet, packet_len, insn->k) & 0xf) << 2;
+                        {
+                            uint32_t byte;
+                            if (safe_load_byte(packet, packet_len, insn->k, &byte) != 0) {
+                                return 0; // Out of bounds, reject packet
+                            }
+                            vm.X = (byte & 0xf) << 2;
+                        }
                         break;
                 }
                 break;
@@ -158,11 +169,13 @@ int bpf_execute_filter(const bpf_program_t *program, const uint8_t *packet, uint
                     case BPF_OR:
                         vm.A |= (BPF_SRC(code) == BPF_X) ? vm.X : insn->k;
                         break;
+                    // Shifting by 32 or more is undefined in C. The kernel refuses such a
+                    // constant and only uses the lower 5 bits of X, so do the same.
                     case BPF_LSH:
-                        vm.A <<= (BPF_SRC(code) == BPF_X) ? vm.X : insn->k;
+                        vm.A <<= ((BPF_SRC(code) == BPF_X) ? vm.X : insn->k) & 31;
                         break;
                     case BPF_RSH:
-                        vm.A >>= (BPF_SRC(code) == BPF_X) ? vm.X : insn->k;
+                        vm.A >>= ((BPF_SRC(code) == BPF_X) ? vm.X : insn->k) & 31;
                         break;
                     case BPF_NEG:
                         vm.A = -vm.A;
@@ -250,3 +263,159 @@ int bpf_execute_filter(const bpf_program_t *program, const uint8_t *packet, uint
 
     return 0; // Default reject if we fall through
 }
+
+uint32_t bpf_execute_filter(const bpf_program_t *program, const uint8_t *packet, uint32_t packet_len) {
+    if (!program || !program->bf_insns || program->bf_len == 0) {
+        return packet_len; // Accept the whole packet if no program
+    }
+    return execute_from(program, packet, packet_len, 0, 0);
+}
+
+//
+// Prefilter
+//
+static bool is_reject(const bpf_program_t *program, uint32_t pc) {
+    // Falling off the end of the program rejects the packet too
+    if (pc >= program->bf_len)
+        return true;
+    const struct bpf_insn *insn = &program->bf_insns[pc];
+    return insn->code == (BPF_RET | BPF_K) && insn->k == 0;
+}
+
+// Follows the comparisons of A against constants that start at `pc`, down to the reject that
+// ends them, and collects the values that lead elsewhere, with where they lead. Returns false
+// if some other value may lead elsewhere too.
+static bool collect_values(const bpf_program_t *program, uint32_t pc, bpf_prefilter_check_t *check) {
+    uint32_t compared[BPF_PREFILTER_MAX_COMPARISONS];
+    uint32_t comparisons = 0;
+    while (pc < program->bf_len && program->bf_insns[pc].code == (BPF_JMP | BPF_JEQ | BPF_K)) {
+        const struct bpf_insn *insn = &program->bf_insns[pc];
+        if (comparisons == BPF_PREFILTER_MAX_COMPARISONS)
+            return false;
+        // Only the first comparison against a value is ever true
+        bool repeated = false;
+        for (uint32_t i = 0; i < comparisons; i++)
+            repeated |= compared[i] == insn->k;
+        compared[comparisons++] = insn->k;
+
+        uint32_t target = pc + 1 + insn->jt;
+        if (!repeated && !is_reject(program, target)) {
+            if (check->count == BPF_PREFILTER_MAX_VALUES)
+                return false;
+            check->values[check->count] = insn->k;
+            check->nexts[check->count++] = target;
+        }
+        pc += 1 + insn->jf;
+    }
+    return is_reject(program, pc);
+}
+
+void bpf_compile_prefilter(const bpf_program_t *program, bpf_prefilter_t *prefilter) {
+    memset(prefilter, 0, sizeof(*prefilter));
+    if (!program || !program->bf_insns) {
+        return;
+    }
+
+    // A chain of checks, as long as every value that passes one leads to the next
+    uint32_t pc = 0;
+    while (pc < program->bf_len && prefilter->count < BPF_PREFILTER_MAX_CHECKS) {
+        const struct bpf_insn *insn = &program->bf_insns[pc];
+        uint16_t size = BPF_SIZE(insn->code);
+        if (BPF_CLASS(insn->code) != BPF_LD || BPF_MODE(insn->code) != BPF_ABS
+            || (size != BPF_W && size != BPF_H && size != BPF_B)) {
+            break;
+        }
+        bpf_prefilter_check_t *check = &prefilter->checks[prefilter->count];
+        memset(check, 0, sizeof(*check));
+        check->offset = insn->k;
+        check->size = size;
+        if (!collect_values(program, pc + 1, check)) {
+            break;
+        }
+        prefilter->count++;
+        pc = check->count > 0 ? check->nexts[0] : UINT32_MAX;
+        for (uint16_t i = 1; i < check->count; i++) {
+            if (check->nexts[i] != pc)
+                pc = UINT32_MAX;
+        }
+    }
+}
+
+// Returns a bit for every one of the `fields` that holds one of the values of `check`
+#ifdef BPF_HAVE_X86_SIMD
+static uint32_t match_values(const uint32_t fields[BPF_BATCH_MAX], const bpf_prefilter_check_t *check) {
+    uint32_t mask = 0;
+    for (uint32_t lane = 0; lane < BPF_BATCH_MAX; lane += 4) {
+        const __m128i field = _mm_loadu_si128((const __m128i *)&fields[lane]);
+        __m128i equal = _mm_setzero_si128();
+        for (uint16_t i = 0; i < check->count; i++) {
+            equal = _mm_or_si128(equal, _mm_cmpeq_epi32(field, _mm_set1_epi32((int)check->values[i])));
+        }
+        mask |= (uint32_t)_mm_movemask_ps(_mm_castsi128_ps(equal)) << lane;
+    }
+    return mask;
+}
+#else
+static uint32_t match_values(const uint32_t fields[BPF_BATCH_MAX], const bpf_prefilter_check_t *check) {
+    uint32_t mask = 0;
+    for (uint32_t lane = 0; lane < BPF_BATCH_MAX; lane++) {
+        for (uint16_t i = 0; i < check->count; i++) {
+            if (fields[lane] == check->values[i]) {
+                mask |= 1u << lane;
+            }
+        }
+    }
+    return mask;
+}
+#endif
+
+// Returns a bit for every packet that passes every check. `fields` receives what each of them
+// holds in the field of the last check.
+static uint32_t apply_prefilter(const bpf_prefilter_t *prefilter, const uint8_t *const packets[],
+    const uint32_t lengths[], uint32_t count, uint32_t fields[BPF_BATCH_MAX])
+{
+    uint32_t passed = (1u << count) - 1;
+    for (uint32_t c = 0; c < prefilter->count && passed != 0; c++) {
+        const bpf_prefilter_check_t *check = &prefilter->checks[c];
+        memset(fields, 0, BPF_BATCH_MAX * sizeof(uint32_t));
+        uint32_t loaded = 0;
+        for (uint32_t i = 0; i < count; i++) {
+            // Like the VM, a load that doesn't fit in the packet rejects it
+            if (safe_load(packets[i], lengths[i], check->size, check->offset, &fields[i]) == 0) {
+                loaded |= 1u << i;
+            }
+        }
+        passed &= loaded & match_values(fields, check);
+    }
+    return passed;
+}
+
+void bpf_execute_filter_batch(const bpf_program_t *program, const bpf_prefilter_t *prefilter,
+    const uint8_t *const packets[], const uint32_t lengths[], uint32_t count, uint32_t results[])
+{
+    if (!program || !program->bf_insns || program->bf_len == 0 || !prefilter || prefilter->count == 0) {
+        for (uint32_t i = 0; i < count; i++) {
+            results[i] = bpf_execute_filter(program, packets[i], lengths[i]);
+        }
+        return;
+    }
+
+    for (uint32_t start = 0; start < count; start += BPF_BATCH_MAX) {
+        uint32_t n = count - start < BPF_BATCH_MAX ? count - start : BPF_BATCH_MAX;
+        uint32_t fields[BPF_BATCH_MAX];
+        uint32_t passed = apply_prefilter(prefilter, packets + start, lengths + start, n, fields);
+        const bpf_prefilter_check_t *last = &prefilter->checks[prefilter->count - 1];
+        for (uint32_t i = 0; i < n; i++) {
+            if ((passed & (1u << i)) == 0) {
+                results[start + i] = 0;
+                continue;
+            }
+            // Right where the last check left the program, with its field in A
+            uint16_t value = 0;
+            while (last->values[value] != fields[i])
+                value++;
+            results[start + i] = execute_from(program, packets[start + i], lengths[start + i],
+                last->nexts[value], fields[i]);
+        }
+    }
+}
@@ -72,6 +72,54 @@
  * @param program The BPF program to execute
  * @param packet The packet data to filter
  * @param packet_len The length of the packet data
- * @return Non-zero if packet should be accepted, 0 if rejected
+ * @return Number of bytes of the packet to keep (the snap length), 0 if rejected.
+ *         Like the kernel, the caller must clamp this value to packet_len.
  */
-int bpf_execute_filter(const bpf_program_t *program, const uint8_t *packet, uint32_t packet_len);
+uint32_t bpf_execute_filter(const bpf_program_t *program, const uint8_t *packet, uint32_t packet_len);
+
+//
+// Batches
+//
+// Most programs start by comparing a field at a fixed offset against a few constants, e.g.
+// the EtherType and then the IP protocol, and reject the packet if none of them matches.
+// Those comparisons are lifted out of the program into a prefilter, which is evaluated on a
+// whole batch of packets at once. Only the packets that pass it are run through the VM.
+//
+#define BPF_BATCH_MAX               16  // packets evaluated at once by the prefilter
+#define BPF_PREFILTER_MAX_CHECKS    4
+#define BPF_PREFILTER_MAX_VALUES    4
+
+typedef struct bpf_prefilter_check {
+    uint32_t offset;                            // of the field, from the start of the packet
+    uint16_t size;                              // of the field, BPF_W, BPF_H or BPF_B
+    uint16_t count;                             // of values
+    uint32_t values[BPF_PREFILTER_MAX_VALUES];  // the field must hold one of them
+    uint32_t nexts[BPF_PREFILTER_MAX_VALUES];   // and the program goes on from there
+} bpf_prefilter_check_t;
+
+// The packets that pass every check resume the program after the last one
+typedef struct bpf_prefilter {
+    uint32_t count;                             // of checks, 0 if every packet passes
+    bpf_prefilter_check_t checks[BPF_PREFILTER_MAX_CHECKS];
+} bpf_prefilter_t;
+
+/**
+ * Derive the prefilter of a BPF program
+ *
+ * @param program The BPF program to derive it from
+ * @param prefilter Receives the checks that every packet accepted by the program passes
+ */
+void bpf_compile_prefilter(const bpf_program_t *program, bpf_prefilter_t *prefilter);
+
+/**
+ * Execute a BPF program against a batch of packets
+ *
+ * @param program The BPF program to execute
+ * @param prefilter Its prefilter, see bpf_compile_prefilter(), or NULL
+ * @param packets The packets to filter
+ * @param lengths Their lengths
+ * @param count The number of packets, which may exceed BPF_BATCH_MAX
+ * @param results Receives what bpf_execute_filter() returns for each packet
+ */
+void bpf_execute_filter_batch(const bpf_program_t *program, const bpf_prefilter_t *prefilter,
+    const uint8_t *const packets[], const uint32_t lengths[], uint32_t count, uint32_t results[]);
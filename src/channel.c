@@ -1,5 +1,8 @@
 #include "channel.h"
 #include "channel_ops.h"
+#include "proto/dns/anomaly.h"
+#include "proto/dns/name_filter.h"
+#include "proto/dns/pdns.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -10,6 +13,11 @@ channel_t *sniff_alloc_channel(void) {
 	if (channel == NULL)
 		return NULL;
 	CHANNEL_INIT(channel);
+	channel->stats = stats_counters_alloc();
+	if (channel->stats == NULL) {
+		free(channel);
+		return NULL;
+	}
 	return channel;
 }
 
@@ -23,6 +31,13 @@ void sniff_free_channel(channel_t *channel) {
 	// Clear BPF filter if set
 	sniff_channel_clear_bpf_filter(channel);
 
+	pcap_writer_close(channel->dumper);
+	output_free(channel->output);
+	stats_counters_free(channel->stats);
+	dns_anomaly_free(channel->anomaly);
+	dns_pdns_close(channel->pdns);
+	dns_name_filter_free(channel->names);
+
 	free(channel->ifname);
 	free(channel->buffer);
 	free(channel);
@@ -3,39 +3,53 @@
 #include "channel_ops_common.h"
 #include "bpf/bpf_filter.h"
 #include "bpf/bpf_types.h"
+#include "bpf/bpf_vm.h"
+#include "output.h"
+#include "pcap.h"
+#include "stats.h"
 #include <stdint.h>
 #include <string.h>
 
 #define SNIFF_DEFAULT_BUFSIZE 4096 // TODO(jweyrich): move it to a per-strategy basis
 #define SNIFF_ERR_BUFSIZE 255
+#define SNIFF_BATCH_SIZE BPF_BATCH_MAX // packets read and filtered at once, where the platform can
 
 //
 // Types
 //
 typedef struct sniff_channel_opts {
 	int promisc;
+	uint32_t snaplen; // max bytes kept from each packet
+	int batch_filter; // run the emulated filter on whole batches, behind its prefilter
 } sniff_channel_opts_t;
 
 typedef struct channel_bpf_filter {
 	bpf_mode_t mode;
 	bpf_program_t program;
+	bpf_prefilter_t prefilter; // of `program`, for the emulated filter
 } channel_bpf_filter_t;
 
 typedef struct sniff_channel {
 	int fd;
 	char *ifname; // interface name
 	size_t buffer_size; // read buffer size
-	uint8_t *buffer; // read buffer
+	uint8_t *buffer; // read buffer, or SNIFF_BATCH_SIZE of them in a row where packets are read in batches
 	char errmsg[SNIFF_ERR_BUFSIZE];
 	sniff_channel_opts_t opts;
 	channel_bpf_filter_t *bpf_filter;
+	pcap_writer_t *dumper; // optional pcap output
+	output_t *output; // decoded output
+	stats_counters_t *stats; // counters of the capture thread
+	dns_anomaly_t *anomaly; // optional DNS anomaly detector
+	dns_pdns_t *pdns; // optional passive DNS store
+	dns_name_filter_t *names; // optional filter of the output by DNS name
 } channel_t;
 
 //
 // Initialization
 //
 #define CHANNEL_INITIALIZER \
-	{ -1, NULL, 0, NULL, { '\0' }, { 0 }, { 0, NULL }, 0 }
+	{ -1, NULL, 0, NULL, { '\0' }, { 0, BPF_DEFAULT_SNAPLEN, 0 }, NULL, NULL, NULL, NULL, NULL, NULL, NULL }
 #define CHANNEL_INIT(var) \
 	do { \
 		channel_t *ptr = (var); \
@@ -45,7 +59,15 @@ typedef struct sniff_channel {
 		ptr->buffer = NULL; \
 		memset(ptr->errmsg, 0, sizeof(SNIFF_ERR_BUFSIZE)); \
 		ptr->opts.promisc = 0; \
+		ptr->opts.snaplen = BPF_DEFAULT_SNAPLEN; \
+		ptr->opts.batch_filter = 0; \
 		ptr->bpf_filter = NULL; \
+		ptr->dumper = NULL; \
+		ptr->output = NULL; \
+		ptr->stats = NULL; \
+		ptr->anomaly = NULL; \
+		ptr->pdns = NULL; \
+		ptr->names = NULL; \
 	} while (0)
 
 //
@@ -4,9 +4,15 @@
 #include <stdarg.h>
 #include <stdio.h>
 #include <sys/ioctl.h>
+#include <time.h>
 #include "bpf/bpf_filter.h"
 #include "bpf/bpf_vm.h"
 #include "bpf/bpf_types.h"
+#include "log.h"
+#include "proto_ops.h"
+#include "proto/dns/anomaly.h"
+#include "proto/dns/name_filter.h"
+#include "proto/dns/pdns.h"
 
 int sniff_setnonblock(channel_t *channel, int nonblock) {
 #ifdef WIN32
@@ -43,6 +49,71 @@ const char *sniff_channel_get_error_msg(channel_t *channel) {
 	return channel->errmsg;
 }
 
+// Must be called before `sniff_channel_set_bpf_filter` so the compiled program returns it.
+int sniff_channel_set_snaplen(channel_t *channel, uint32_t snaplen) {
+	if (!channel) {
+		return -1;
+	}
+	channel->opts.snaplen = snaplen == 0 ? BPF_DEFAULT_SNAPLEN : snaplen;
+	return 0;
+}
+
+// Whether the emulated filter runs on whole batches, behind its prefilter. It's off by default,
+// since it depends on the machine whether that is any faster, see bpf_execute_filter_batch().
+int sniff_channel_set_batch_filter(channel_t *channel, int batch_filter) {
+	if (!channel) {
+		return -1;
+	}
+	channel->opts.batch_filter = batch_filter;
+	return 0;
+}
+
+int sniff_channel_open_dump(channel_t *channel, const char *path) {
+	if (!channel || !path) {
+		return -1;
+	}
+	pcap_writer_close(channel->dumper);
+	channel->dumper = pcap_writer_open(path, channel->opts.snaplen);
+	if (channel->dumper == NULL) {
+		sniff_channel_set_error_msg(channel, "Failed to open %s: %s", path, sniff_strerror(errno));
+		return -1;
+	}
+	return 0;
+}
+
+// The channel takes ownership of `output`.
+void sniff_channel_set_output(channel_t *channel, output_t *output) {
+	output_free(channel->output);
+	channel->output = output;
+}
+
+// The channel takes ownership of `anomaly`. Its alerts go to the output of the channel.
+void sniff_channel_set_dns_anomaly(channel_t *channel, dns_anomaly_t *anomaly) {
+	dns_anomaly_free(channel->anomaly);
+	channel->anomaly = anomaly;
+}
+
+// The channel takes ownership of `pdns`, and flushes it when it's freed.
+void sniff_channel_set_dns_pdns(channel_t *channel, dns_pdns_t *pdns) {
+	dns_pdns_close(channel->pdns);
+	channel->pdns = pdns;
+}
+
+// The channel takes ownership of `names`. Only the packets with a DNS question below one of
+// them reach the output.
+void sniff_channel_set_dns_names(channel_t *channel, dns_name_filter_t *names) {
+	dns_name_filter_free(channel->names);
+	channel->names = names;
+}
+
+// Writes whatever the decoders produced since the last call. Read loops call this
+// once per batch of packets.
+int sniff_channel_flush(channel_t *channel) {
+	if (channel->output == NULL)
+		return 0;
+	return output_flush(channel->output);
+}
+
 // BPF filter functions
 int sniff_channel_set_bpf_filter(channel_t *channel, bpf_mode_t bpf_mode, const char *filter_expression) {
 	if (!channel) {
@@ -66,10 +137,12 @@ int sniff_channel_set_bpf_filter(channel_t *channel, bpf_mode_t bpf_mode, const
 	memset(channel->bpf_filter, 0, sizeof(channel_bpf_filter_t));
 
 	// Compile the new filter
-	if (bpf_compile_filter(filter_expression, &channel->bpf_filter->program) < 0) {
+	if (bpf_compile_filter(filter_expression, channel->opts.snaplen, &channel->bpf_filter->program) < 0) {
 		sniff_channel_set_error_msg(channel, "Failed to compile BPF filter: %s", filter_expression);
+		sniff_channel_clear_bpf_filter(channel);
 		return -1;
 	}
+	bpf_compile_prefilter(&channel->bpf_filter->program, &channel->bpf_filter->prefilter);
 
 	channel->bpf_filter->mode = bpf_mode;
 	return 0;
@@ -80,22 +153,179 @@ void sniff_channel_clear_bpf_filter(channel_t *channel) {
 		return;
 	}
 	bpf_free_program(&channel->bpf_filter->program);
+	free(channel->bpf_filter);
 	channel->bpf_filter = NULL;
 }
 
-int sniff_channel_apply_bpf_filter(channel_t *channel, const uint8_t *packet, uint32_t packet_len) {
+// Compiles `filter_expression` and swaps it in place of the current filter without
+// reopening the channel, so the receive buffer (and every packet already accepted
+// by the old filter) is preserved. The old filter stays in effect if anything fails.
+int sniff_channel_replace_bpf_filter(channel_t *channel, const char *filter_expression) {
+	if (!channel) {
+		return -1;
+	}
+
+	if (!channel->bpf_filter) {
+		sniff_channel_set_error_msg(channel, "No BPF filter set on channel");
+		return -1;
+	}
+
+	if (!filter_expression) {
+		sniff_channel_set_error_msg(channel, "Filter expression is NULL");
+		return -1;
+	}
+
+	channel_bpf_filter_t *filter = malloc(sizeof(channel_bpf_filter_t));
+	if (!filter) {
+		sniff_channel_set_error_msg(channel, "Failed to allocate memory for BPF filter");
+		return -1;
+	}
+	memset(filter, 0, sizeof(channel_bpf_filter_t));
+	filter->mode = channel->bpf_filter->mode;
+
+	if (bpf_compile_filter(filter_expression, channel->opts.snaplen, &filter->program) < 0) {
+		sniff_channel_set_error_msg(channel, "Failed to compile BPF filter: %s", filter_expression);
+		bpf_free_program(&filter->program);
+		free(filter);
+		return -1;
+	}
+	bpf_compile_prefilter(&filter->program, &filter->prefilter);
+
+	if (sniff_channel_install_filter(channel, filter) < 0) {
+		bpf_free_program(&filter->program);
+		free(filter);
+		return -1;
+	}
+
+	// From here on the new filter is live
+	channel_bpf_filter_t *old_filter = channel->bpf_filter;
+	channel->bpf_filter = filter;
+	bpf_free_program(&old_filter->program);
+	free(old_filter);
+	return 0;
+}
+
+// Returns the number of bytes to keep from the packet, or 0 if it was rejected.
+uint32_t sniff_channel_apply_bpf_filter(channel_t *channel, const uint8_t *packet, uint32_t packet_len) {
 	if (!channel || !packet) {
 		return 0; // Reject invalid input
 	}
 
-	if (!channel->bpf_filter) {
-		return 1; // Accept all packets if no filter is set
+	if (!channel->bpf_filter || channel->bpf_filter->mode == NATIVE_BPF) {
+		// Native BPF filtering (and truncation) is done in the kernel, so we accept all packets here
+		return packet_len;
+	}
+
+	uint32_t snaplen = bpf_execute_filter(&channel->bpf_filter->program, packet, packet_len);
+	return snaplen < packet_len ? snaplen : packet_len;
+}
+
+// Same as sniff_channel_apply_bpf_filter(), for `count` packets at once. With batch_filter, the
+// emulated filter only runs the whole program on the packets that pass its prefilter.
+void sniff_channel_apply_bpf_filter_batch(channel_t *channel, const uint8_t *const packets[],
+	const uint32_t lengths[], uint32_t count, uint32_t snaplens[])
+{
+	if (!channel->bpf_filter || channel->bpf_filter->mode == NATIVE_BPF) {
+		memcpy(snaplens, lengths, count * sizeof(uint32_t));
+		return;
+	}
+
+	if (!channel->opts.batch_filter) {
+		for (uint32_t i = 0; i < count; i++)
+			snaplens[i] = sniff_channel_apply_bpf_filter(channel, packets[i], lengths[i]);
+		return;
+	}
+
+	bpf_execute_filter_batch(&channel->bpf_filter->program, &channel->bpf_filter->prefilter,
+		packets, lengths, count, snaplens);
+	for (uint32_t i = 0; i < count; i++) {
+		if (snaplens[i] > lengths[i])
+			snaplens[i] = lengths[i];
+	}
+}
+
+// Counts the verdict of the filter on a packet and, if it was accepted, runs it through the
+// pcap writer and the decoders
+static int dispatch_packet(channel_t *channel, sniff_packet_t *desc, uint32_t snaplen, const config_t *config) {
+	if (snaplen == 0) {
+		stats_inc(&channel->stats->filter_rejected);
+		return 0; // Rejected
+	}
+	stats_inc(&channel->stats->filter_accepted);
+	desc->caplen = snaplen;
+	if (SNIFF_PACKET_IS_TRUNCATED(desc))
+		stats_inc(&channel->stats->truncated);
+
+	if (channel->dumper != NULL && pcap_writer_write(channel->dumper, desc) < 0) {
+		sniff_channel_set_error_msg(channel, "Failed to write packet: %s", sniff_strerror(errno));
+		LOG_WARN("%s", channel->errmsg);
+	}
+
+	if (channel->output == NULL) {
+		return 0;
 	}
 
-	if (channel->bpf_filter->mode == NATIVE_BPF) {
-		// Native BPF filtering is done in the kernel, so we accept all packets here
-		return 1;
+	desc->output = channel->output;
+	desc->stats = channel->stats;
+	desc->anomaly = channel->anomaly;
+	desc->pdns = channel->pdns;
+	desc->names = channel->names;
+	desc->name_matched = false;
+	desc->alerted = false;
+	desc->flow.family = 0;
+	output_begin_record(channel->output);
+	if (config->timestamps)
+		output_field_uint(channel->output, "ts", desc->timestamp);
+	int result = sniff_packet_fromwire(desc, 0, config);
+	// The decoders of the lower layers can't know, so their fields are taken back.
+	// Alerts are kept, with whatever the lower layers emitted around them.
+	if (desc->names != NULL && !desc->name_matched && !desc->alerted)
+		output_cancel_record(channel->output);
+	else
+		output_end_record(channel->output);
+	return result;
+}
+
+// Runs freshly read packets through the emulated filter, the pcap writer and the decoders.
+// Platform read loops must fill `data`, `caplen` and `wirelen` of each before calling this,
+// and `timestamp` if the kernel gave one, which is then counted in the latency stats.
+// The packets without one are stamped with the current time.
+// Returns -1 if any of them failed to decode.
+int sniff_channel_dispatch_batch(channel_t *channel, sniff_packet_t descs[], uint32_t count, const config_t *config) {
+	const uint8_t *packets[SNIFF_BATCH_SIZE];
+	uint32_t lengths[SNIFF_BATCH_SIZE];
+	uint32_t snaplens[SNIFF_BATCH_SIZE];
+	int result = 0;
+
+	struct timespec ts;
+	clock_gettime(CLOCK_REALTIME, &ts);
+	const uint64_t now = (uint64_t)ts.tv_sec * SNIFF_NSEC_PER_SEC + (uint64_t)ts.tv_nsec;
+
+	for (uint32_t start = 0; start < count; start += SNIFF_BATCH_SIZE) {
+		uint32_t n = count - start < SNIFF_BATCH_SIZE ? count - start : SNIFF_BATCH_SIZE;
+		for (uint32_t i = 0; i < n; i++) {
+			sniff_packet_t *desc = &descs[start + i];
+			stats_inc(&channel->stats->packets);
+			stats_add(&channel->stats->bytes, desc->wirelen);
+			if (desc->timestamp == 0)
+				desc->timestamp = now;
+			else if (now >= desc->timestamp) // unless the clock was stepped back since
+				stats_count_latency(channel->stats, now - desc->timestamp);
+			packets[i] = desc->data;
+			lengths[i] = desc->caplen;
+		}
+		sniff_channel_apply_bpf_filter_batch(channel, packets, lengths, n, snaplens);
+		for (uint32_t i = 0; i < n; i++) {
+			if (dispatch_packet(channel, &descs[start + i], snaplens[i], config) != 0)
+				result = -1;
+		}
 	}
+	return result;
+}
 
-	return bpf_execute_filter(&channel->bpf_filter->program, packet, packet_len);
+void sniff_channel_get_stats(const channel_t *channel, stats_snapshot_t *snapshot) {
+	stats_counters_snapshot(channel->stats, snapshot);
+	if (channel->output != NULL) {
+		output_get_stats(channel->output, &snapshot->output_written, &snapshot->output_dropped);
+	}
 }
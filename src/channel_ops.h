@@ -2,6 +2,7 @@
 
 #include "channel_ops_common.h"
 #include "channel.h"
+#include "packet.h"
 #include <stdint.h>
 #include <stdlib.h>
 
@@ -27,9 +28,26 @@ int sniff_setnonblock(channel_t *channel, int nonblock);
 int sniff_readloop(channel_t *channel, long timeout, const config_t *config);
 int sniff_channel_set_error_msg(channel_t *channel, const char *format, ...);
 const char *sniff_channel_get_error_msg(channel_t *channel);
+int sniff_channel_set_snaplen(channel_t *channel, uint32_t snaplen);
+int sniff_channel_set_batch_filter(channel_t *channel, int batch_filter);
+int sniff_channel_open_dump(channel_t *channel, const char *path);
+void sniff_channel_set_output(channel_t *channel, output_t *output);
+void sniff_channel_set_dns_anomaly(channel_t *channel, dns_anomaly_t *anomaly);
+void sniff_channel_set_dns_pdns(channel_t *channel, dns_pdns_t *pdns);
+void sniff_channel_set_dns_names(channel_t *channel, dns_name_filter_t *names);
+int sniff_channel_flush(channel_t *channel);
+int sniff_channel_dispatch_batch(channel_t *channel, sniff_packet_t descs[], uint32_t count, const config_t *config);
+// Refreshes the kernel counters. Must be called from the capture thread.
+int sniff_channel_update_stats(channel_t *channel);
+// Safe to call from any thread.
+void sniff_channel_get_stats(const channel_t *channel, stats_snapshot_t *snapshot);
 
 // BPF filter functions
 int sniff_channel_set_bpf_filter(channel_t *channel, bpf_mode_t bpf_mode, const char *filter_expression);
 void sniff_channel_clear_bpf_filter(channel_t *channel);
 int sniff_channel_attach_filter(channel_t *channel);
-int sniff_channel_apply_bpf_filter(channel_t *channel, const uint8_t *packet, uint32_t packet_len);
+int sniff_channel_install_filter(channel_t *channel, const channel_bpf_filter_t *filter);
+int sniff_channel_replace_bpf_filter(channel_t *channel, const char *filter_expression);
+uint32_t sniff_channel_apply_bpf_filter(channel_t *channel, const uint8_t *packet, uint32_t packet_len);
+void sniff_channel_apply_bpf_filter_batch(channel_t *channel, const uint8_t *const packets[],
+	const uint32_t lengths[], uint32_t count, uint32_t snaplens[]);
@@ -1,5 +1,6 @@
 #include "config.h"
 #include "arguments.h"
+#include "proto_ops.h"
 #include <stdio.h>
 #include <string.h>
 
@@ -112,7 +113,8 @@ static void config_auto_enable_protocol_filters(config_t *config, const cli_args
 
 /**
  * @brief Initialize the configuration structure.
- * It will parse the filter flags from the command line arguments.
+ * It will parse the filter flags from the command line arguments, and pick
+ * the decoders that they call for.
  *
  * @param config  The configuration structure
  * @param args    The command line arguments
@@ -124,8 +126,13 @@ int config_initialize(config_t *config, const cli_args_t *args) {
         return -1;
     }
 
-    // Auto-enable protocol display filters based on BPF filter
-    config_auto_enable_protocol_filters(config, args);
+    // Auto-enable protocol display filters based on BPF filter, unless the
+    // user picked them explicitly (e.g. `-d dns` for a DNS-only event stream)
+    if (args->display_filters == NULL) {
+        config_auto_enable_protocol_filters(config, args);
+    }
 
+    config->timestamps = args->timestamps;
+    sniff_pipeline_init(&config->pipeline, config);
     return 0;
 }
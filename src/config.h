@@ -2,6 +2,27 @@
 
 #include "arguments.h"
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Forward declarations
+typedef struct config config_t;
+typedef struct sniff_packet sniff_packet_t;
+
+// Decoder of one protocol, see proto_ops.h
+typedef int (*sniff_fromwire_fn)(const uint8_t *packet, size_t length, sniff_packet_t *desc, const config_t *config);
+
+// The decoder of each protocol, picked once by sniff_pipeline_init(). The decoders hand the
+// payload to the next one through this table.
+typedef struct sniff_pipeline {
+    sniff_fromwire_fn eth;
+    sniff_fromwire_fn arp;
+    sniff_fromwire_fn ip;
+    sniff_fromwire_fn icmp;
+    sniff_fromwire_fn tcp;
+    sniff_fromwire_fn udp;
+    sniff_fromwire_fn dns;
+} sniff_pipeline_t;
 
 typedef struct config {
     struct {
@@ -16,6 +37,8 @@ typedef struct config {
         bool udp;
         bool udp_data;
     } display_filters_flag;
+    bool timestamps; // emit the arrival time of each packet
+    sniff_pipeline_t pipeline;
 } config_t;
 
 int config_initialize(config_t *config, const cli_args_t *args);
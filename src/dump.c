@@ -1,5 +1,25 @@
 #include "dump.h"
-#include <ctype.h>
+#include <stdatomic.h>
+#include <string.h>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#   define DUMP_HAVE_X86_SIMD
+#   include <immintrin.h>
+#endif
+
+// "00" to "ff", two characters per byte value
+#define HEXPAIRS_ROW(h) \
+    h "0" h "1" h "2" h "3" h "4" h "5" h "6" h "7" h "8" h "9" h "a" h "b" h "c" h "d" h "e" h "f"
+static const char hexpairs[] =
+    HEXPAIRS_ROW("0") HEXPAIRS_ROW("1") HEXPAIRS_ROW("2") HEXPAIRS_ROW("3")
+    HEXPAIRS_ROW("4") HEXPAIRS_ROW("5") HEXPAIRS_ROW("6") HEXPAIRS_ROW("7")
+    HEXPAIRS_ROW("8") HEXPAIRS_ROW("9") HEXPAIRS_ROW("a") HEXPAIRS_ROW("b")
+    HEXPAIRS_ROW("c") HEXPAIRS_ROW("d") HEXPAIRS_ROW("e") HEXPAIRS_ROW("f");
+
+// Same as isprint() in the "C" locale, which is the only one babysniff runs with
+static inline char printable(uint8_t ch) {
+    return ch >= 0x20 && ch < 0x7f ? (char)ch : '.';
+}
 
 void print_bits(FILE *stream, uint64_t value, size_t size) {
     register int32_t i;
@@ -9,30 +29,141 @@ void print_bits(FILE *stream, uint64_t value, size_t size) {
 }
 
 void dump_hex(FILE *stream, const uint8_t *data, size_t size, uint32_t offset) {
-    int ch;
+    // Rendered a block of rows at a time, instead of a fprintf per byte
+    char block[64 * DUMP_HEX_ROW_MAXSIZE];
+    const size_t block_bytes = 64 * 16;
+
+    for (size_t i = 0; i < size; i += block_bytes) {
+        size_t length = size - i < block_bytes ? size - i : block_bytes;
+        fwrite(block, 1, dump_hex_to_buffer(block, data + i, length, offset + (uint32_t)i), stream);
+    }
+}
+
+static char *dump_row_offset(char *ptr, uint32_t row_offset) {
+    if (row_offset <= 0xffff) { // the common case, always 4 digits
+        memcpy(ptr, hexpairs + (row_offset >> 8) * 2, 2);
+        memcpy(ptr + 2, hexpairs + (row_offset & 0xff) * 2, 2);
+        ptr += 4;
+    } else {
+        static const char hexdigits[] = "0123456789abcdef";
+        int digits = 5;
+        while (digits < 8 && (row_offset >> (digits * 4)) != 0)
+            digits++;
+        for (int d = digits - 1; d >= 0; --d)
+            *ptr++ = hexdigits[(row_offset >> (d * 4)) & 0xf];
+    }
+    *ptr++ = ':';
+    *ptr++ = ' ';
+    return ptr;
+}
+
+// A whole row, with no padding: 8 groups of "xxxx " and the 16 characters
+static char *dump_full_row(char *ptr, const uint8_t *data) {
+    for (int j = 0; j < 16; j += 2) {
+        memcpy(ptr, hexpairs + data[j] * 2, 2);
+        memcpy(ptr + 2, hexpairs + data[j+1] * 2, 2);
+        ptr[4] = ' ';
+        ptr += 5;
+    }
+    *ptr++ = ' ';
+    for (int j = 0; j < 16; ++j)
+        ptr[j] = printable(data[j]);
+    ptr += 16;
+    *ptr++ = '\n';
+    return ptr;
+}
+
+#ifdef DUMP_HAVE_X86_SIMD
+// Same as `dump_full_row`, but the whole row is formatted in registers
+__attribute__((target("ssse3")))
+static char *dump_full_row_ssse3(char *ptr, const uint8_t *data) {
+    const __m128i in = _mm_loadu_si128((const __m128i *)data);
+    const __m128i digits = _mm_setr_epi8(
+        '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a', 'b', 'c', 'd', 'e', 'f');
+    const __m128i nibble = _mm_set1_epi8(0x0f);
+    const __m128i high = _mm_shuffle_epi8(digits, _mm_and_si128(_mm_srli_epi16(in, 4), nibble));
+    const __m128i low = _mm_shuffle_epi8(digits, _mm_and_si128(in, nibble));
+    const __m128i first = _mm_unpacklo_epi8(high, low);     // digits of bytes 0-7
+    const __m128i second = _mm_unpackhi_epi8(high, low);    // digits of bytes 8-15
+
+    // Spread the 32 digits over 40 characters, in groups of 4 followed by a space.
+    // Lanes selected with -1 are zeroed, and then the spaces are OR'ed in.
+    const __m128i out0 = _mm_or_si128(
+        _mm_shuffle_epi8(first, _mm_setr_epi8(0, 1, 2, 3, -1, 4, 5, 6, 7, -1, 8, 9, 10, 11, -1, 12)),
+        _mm_setr_epi8(0, 0, 0, 0, ' ', 0, 0, 0, 0, ' ', 0, 0, 0, 0, ' ', 0));
+    const __m128i out1 = _mm_or_si128(_mm_or_si128(
+        _mm_shuffle_epi8(first, _mm_setr_epi8(13, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1)),
+        _mm_shuffle_epi8(second, _mm_setr_epi8(-1, -1, -1, -1, 0, 1, 2, 3, -1, 4, 5, 6, 7, -1, 8, 9))),
+        _mm_setr_epi8(0, 0, 0, ' ', 0, 0, 0, 0, ' ', 0, 0, 0, 0, ' ', 0, 0));
+    // The last 8 characters, the separator, and 7 bytes of junk that the characters overwrite
+    const __m128i out2 = _mm_or_si128(
+        _mm_shuffle_epi8(second, _mm_setr_epi8(10, 11, -1, 12, 13, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1)),
+        _mm_setr_epi8(0, 0, ' ', 0, 0, 0, 0, ' ', ' ', 0, 0, 0, 0, 0, 0, 0));
+
+    // 0x20 to 0x7e as is, everything else as '.', as bytes above 0x7f are negative
+    const __m128i is_printable = _mm_and_si128(
+        _mm_cmpgt_epi8(in, _mm_set1_epi8(0x1f)), _mm_cmplt_epi8(in, _mm_set1_epi8(0x7f)));
+    const __m128i text = _mm_or_si128(
+        _mm_and_si128(is_printable, in), _mm_andnot_si128(is_printable, _mm_set1_epi8('.')));
+
+    _mm_storeu_si128((__m128i *)ptr, out0);
+    _mm_storeu_si128((__m128i *)(ptr + 16), out1);
+    _mm_storeu_si128((__m128i *)(ptr + 32), out2);
+    _mm_storeu_si128((__m128i *)(ptr + 41), text);
+    ptr[57] = '\n';
+    return ptr + 58;
+}
+#endif // DUMP_HAVE_X86_SIMD
+
+typedef char *(*dump_row_fn)(char *ptr, const uint8_t *data);
+
+static dump_row_fn dump_select_full_row(void) {
+#ifdef DUMP_HAVE_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("ssse3"))
+        return dump_full_row_ssse3;
+#endif
+    return dump_full_row;
+}
+
+// Same layout as `dump_hex`, but rendered into `output`, which must have room for
+// at least `dump_hex_buffer_size(size)` bytes. Returns the number of bytes written.
+size_t dump_hex_to_buffer(char *output, const uint8_t *data, size_t size, uint32_t offset) {
+    static _Atomic(dump_row_fn) full_row;
+    dump_row_fn row_fn = atomic_load_explicit(&full_row, memory_order_relaxed);
+    if (row_fn == NULL) {
+        row_fn = dump_select_full_row();
+        atomic_store_explicit(&full_row, row_fn, memory_order_relaxed);
+    }
+
+    char *ptr = output;
     uint32_t i, j, cols;
 
-    for (i = 0; i < size; i += 16) {
-        fprintf(stream, "%04x: ", i + offset);
-        cols = size - i;
-        cols = cols > 16 ? 16 : cols;
-
-        for (j = 0; j < cols; ++j) {
-            if ((j % 2) == 0)
-                fprintf(stream, "%02x", (uint32_t)data[i+j]);
-            else
-                fprintf(stream, "%02x ", (uint32_t)data[i+j]);
-        }
-        for (; j < 16; ++j) {
-            fprintf(stream, "%*s", (j % 2) == 0 ? 2 : 3, " ");
-        }
-        fprintf(stream, " ");
-
-        for (j = 0; j < cols; ++j) {
-            ch = data[i+j];
-            ch = isprint(ch) ? ch : '.';
-            fprintf(stream, "%c", ch);
-        }
-        fprintf(stream, "\n");
+    for (i = 0; i + 16 <= size; i += 16) {
+        ptr = dump_row_offset(ptr, i + offset);
+        ptr = row_fn(ptr, data + i);
+    }
+    if (i == size)
+        return ptr - output;
+
+    // The last row, padded so that its characters line up with the rows above
+    ptr = dump_row_offset(ptr, i + offset);
+    cols = size - i;
+    for (j = 0; j < cols; ++j) {
+        memcpy(ptr, hexpairs + data[i+j] * 2, 2);
+        ptr += 2;
+        if ((j % 2) != 0)
+            *ptr++ = ' ';
+    }
+    for (; j < 16; ++j) {
+        *ptr++ = ' ';
+        *ptr++ = ' ';
+        if ((j % 2) != 0)
+            *ptr++ = ' ';
     }
+    *ptr++ = ' ';
+    for (j = 0; j < cols; ++j)
+        *ptr++ = printable(data[i+j]);
+    *ptr++ = '\n';
+    return ptr - output;
 }
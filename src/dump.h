@@ -6,3 +6,8 @@
 
 void print_bits(FILE *stream, uint64_t value, size_t size);
 void dump_hex(FILE *stream, const uint8_t *data, size_t size, uint32_t offset);
+size_t dump_hex_to_buffer(char *output, const uint8_t *data, size_t size, uint32_t offset);
+
+// Worst case size of `dump_hex_to_buffer` output: 8 offset digits + ": " + 40 hex + " " + 16 ascii + "\n"
+#define DUMP_HEX_ROW_MAXSIZE		68
+#define dump_hex_buffer_size(size)	((((size) + 15) / 16) * DUMP_HEX_ROW_MAXSIZE)
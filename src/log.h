@@ -12,6 +12,9 @@
 //	LOG_PRINTF_INDENT(indent, format, ...)
 //	LOG_PRINTF_INDENT_TAB(indent, format, ...)
 //
+//  The LOG_PRINTF* macros are meant for debugging only.
+//  Decoded packets are emitted through the output subsystem (see output.h).
+//
 
 #pragma once
 
@@ -16,11 +16,19 @@
 #	define BASE_NOTREACHED	((void)0)
 #endif
 
+#if defined(__GNUC__) || defined(__clang__)
+#	define BASE_ALWAYS_INLINE	inline __attribute__((always_inline))
+#else
+#	define BASE_ALWAYS_INLINE	inline
+#endif
+
 //
 // Use these
 //
 #define UNUSED(x)			BASE_UNUSED(x)
 #define NOTREACHED			BASE_NOTREACHED
+// For the bodies that are specialized by their constant arguments, see sniff_pipeline_init()
+#define ALWAYS_INLINE		BASE_ALWAYS_INLINE
 #define PTR_ADD(p1, p2)		((uintptr_t)(p1) + (uintptr_t)(p2))
 #define PTR_SUB(p1, p2)		((ptrdiff_t)((uintptr_t)(p1) - (uintptr_t)(p2)))
 
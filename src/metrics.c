@@ -0,0 +1,378 @@
+#include "metrics.h"
+#include "channel_ops.h"
+#include "channel_ops_common.h"
+#include "log.h"
+#include "proto/dns/anomaly.h"
+#include "proto/dns/arrays.h"
+#include "stats.h"
+#include <errno.h>
+#include <inttypes.h>
+#include <netdb.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#define METRICS_POLL_INTERVAL_MS	250
+#define METRICS_REQUEST_MAXSIZE		4096
+#define METRICS_IO_TIMEOUT_SEC		2
+
+struct metrics_server {
+	int fd;
+	const channel_t *channel;
+	bool emulated_filter;	// otherwise the kernel filters, and nothing is ever rejected here
+	pthread_t thread;
+	atomic_bool stop;
+};
+
+//
+// Response body
+//
+typedef struct metrics_body {
+	char *data;
+	size_t size;
+	size_t used;
+	bool error;
+} metrics_body_t;
+
+static void body_printf(metrics_body_t *body, const char *format, ...) {
+	while (!body->error) {
+		va_list ap;
+		va_start(ap, format);
+		int ret = vsnprintf(body->data + body->used, body->size - body->used, format, ap);
+		va_end(ap);
+		if (ret < 0) {
+			body->error = true;
+			return;
+		}
+		if ((size_t)ret < body->size - body->used) {
+			body->used += (size_t)ret;
+			return;
+		}
+		size_t new_size = body->size * 2 + (size_t)ret;
+		char *new_data = realloc(body->data, new_size);
+		if (new_data == NULL) {
+			body->error = true;
+			return;
+		}
+		body->data = new_data;
+		body->size = new_size;
+	}
+}
+
+static void body_counter(metrics_body_t *body, const char *name, const char *help, uint64_t value) {
+	body_printf(body, "# HELP %s %s\n# TYPE %s counter\n%s %" PRIu64 "\n", name, help, name, name, value);
+}
+
+static void body_header(metrics_body_t *body, const char *name, const char *type, const char *help) {
+	body_printf(body, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+// `totext()` falls back to "UNKNOWN", which would merge unrelated values into one series
+static const char *dns_label(dns_array_e array, int key, const char *prefix, char *buffer, size_t size) {
+	const char *text = totext(array, key);
+	if (strcmp(text, "UNKNOWN") != 0)
+		return text;
+	snprintf(buffer, size, "%s%d", prefix, key);
+	return buffer;
+}
+
+static void render(metrics_body_t *body, const stats_snapshot_t *s, bool emulated_filter) {
+	body_counter(body, "babysniff_kernel_received_packets_total",
+		"Packets counted by the kernel (after the native filter on Linux).", s->kernel_received);
+	body_counter(body, "babysniff_kernel_dropped_packets_total",
+		"Packets dropped by the kernel because the capture didn't keep up.", s->kernel_dropped);
+	body_counter(body, "babysniff_packets_total", "Packets read from the channel.", s->packets);
+	body_counter(body, "babysniff_bytes_total", "Original length of the packets read.", s->bytes);
+	body_counter(body, "babysniff_filter_accepted_packets_total", "Packets accepted by the BPF filter.", s->filter_accepted);
+	body_counter(body, "babysniff_filter_rejected_packets_total", "Packets rejected by the emulated BPF filter.", s->filter_rejected);
+
+	if (emulated_filter) {
+		uint64_t filtered = s->filter_accepted + s->filter_rejected;
+		body_header(body, "babysniff_filter_accept_ratio", "gauge", "Share of the packets read that the emulated BPF filter accepted.");
+		body_printf(body, "babysniff_filter_accept_ratio %.6f\n",
+			filtered == 0 ? 1.0 : (double)s->filter_accepted / (double)filtered);
+	}
+
+	body_counter(body, "babysniff_truncated_packets_total", "Packets cut short by the snaplen.", s->truncated);
+
+	body_header(body, "babysniff_capture_latency_seconds", "histogram", "Time from the kernel timestamp of a packet to its dispatch to the filter and decoders.");
+	uint64_t timed = 0;
+	for (int i = 0; i < STATS_LATENCY_BUCKETS - 1; i++) {
+		timed += s->latency[i];
+		body_printf(body, "babysniff_capture_latency_seconds_bucket{le=\"%g\"} %" PRIu64 "\n",
+			stats_latency_bounds[i] / 1e6, timed);
+	}
+	timed += s->latency[STATS_LATENCY_BUCKETS - 1];
+	body_printf(body, "babysniff_capture_latency_seconds_bucket{le=\"+Inf\"} %" PRIu64 "\n", timed);
+	body_printf(body, "babysniff_capture_latency_seconds_sum %.9f\n", s->latency_sum / 1e9);
+	body_printf(body, "babysniff_capture_latency_seconds_count %" PRIu64 "\n", timed);
+
+	body_header(body, "babysniff_protocol_packets_total", "counter", "Packets handed to the decoder of each protocol.");
+	for (int i = 0; i < STATS_PROTO_COUNT; i++)
+		body_printf(body, "babysniff_protocol_packets_total{protocol=\"%s\"} %" PRIu64 "\n", stats_proto_name(i), s->proto_packets[i]);
+	body_header(body, "babysniff_protocol_bytes_total", "counter", "Bytes handed to the decoder of each protocol.");
+	for (int i = 0; i < STATS_PROTO_COUNT; i++)
+		body_printf(body, "babysniff_protocol_bytes_total{protocol=\"%s\"} %" PRIu64 "\n", stats_proto_name(i), s->proto_bytes[i]);
+	body_header(body, "babysniff_decode_errors_total", "counter", "Malformed packets, by the protocol that rejected them.");
+	for (int i = 0; i < STATS_PROTO_COUNT; i++)
+		body_printf(body, "babysniff_decode_errors_total{protocol=\"%s\"} %" PRIu64 "\n", stats_proto_name(i), s->decode_errors[i]);
+
+	char label[16];
+	body_header(body, "babysniff_dns_responses_total", "counter", "DNS responses by rcode.");
+	for (int i = 0; i < STATS_DNS_RCODE_OTHER; i++) {
+		if (s->dns_rcodes[i] == 0)
+			continue;
+		body_printf(body, "babysniff_dns_responses_total{rcode=\"%s\"} %" PRIu64 "\n",
+			dns_label(DNS_ARRAY_RCODE, i, "RCODE", label, sizeof(label)), s->dns_rcodes[i]);
+	}
+	if (s->dns_rcodes[STATS_DNS_RCODE_OTHER] != 0)
+		body_printf(body, "babysniff_dns_responses_total{rcode=\"OTHER\"} %" PRIu64 "\n", s->dns_rcodes[STATS_DNS_RCODE_OTHER]);
+	body_header(body, "babysniff_dns_queries_total", "counter", "DNS queries by the type of their first question.");
+	for (int i = 0; i < STATS_DNS_QTYPE_OTHER; i++) {
+		if (s->dns_qtypes[i] == 0)
+			continue;
+		body_printf(body, "babysniff_dns_queries_total{qtype=\"%s\"} %" PRIu64 "\n",
+			dns_label(DNS_ARRAY_QTYPE, i, "TYPE", label, sizeof(label)), s->dns_qtypes[i]);
+	}
+	if (s->dns_qtypes[STATS_DNS_QTYPE_OTHER] != 0)
+		body_printf(body, "babysniff_dns_queries_total{qtype=\"OTHER\"} %" PRIu64 "\n", s->dns_qtypes[STATS_DNS_QTYPE_OTHER]);
+
+	body_counter(body, "babysniff_dns_edns_messages_total", "DNS messages with an EDNS0 OPT record.", s->dns_edns);
+	body_counter(body, "babysniff_dns_edns_dnssec_ok_messages_total", "DNS messages with the EDNS0 DO bit set.", s->dns_edns_dnssec_ok);
+	body_counter(body, "babysniff_dns_edns_cookie_messages_total", "DNS messages with an EDNS0 cookie.", s->dns_edns_cookies);
+	body_counter(body, "babysniff_dns_edns_padding_bytes_total", "Bytes of EDNS0 padding.", s->dns_edns_padding_bytes);
+	body_header(body, "babysniff_dns_edns_udp_size", "histogram", "UDP payload size advertised by DNS queries.");
+	uint64_t cumulative = 0;
+	for (int i = 0; i < STATS_DNS_UDP_SIZE_BUCKETS - 1; i++) {
+		cumulative += s->dns_edns_udp_sizes[i];
+		body_printf(body, "babysniff_dns_edns_udp_size_bucket{le=\"%u\"} %" PRIu64 "\n",
+			(unsigned)stats_dns_udp_size_bounds[i], cumulative);
+	}
+	cumulative += s->dns_edns_udp_sizes[STATS_DNS_UDP_SIZE_BUCKETS - 1];
+	body_printf(body, "babysniff_dns_edns_udp_size_bucket{le=\"+Inf\"} %" PRIu64 "\n", cumulative);
+	body_printf(body, "babysniff_dns_edns_udp_size_sum %" PRIu64 "\n", s->dns_edns_udp_size_sum);
+	body_printf(body, "babysniff_dns_edns_udp_size_count %" PRIu64 "\n", cumulative);
+	body_header(body, "babysniff_dns_ecs_queries_total", "counter", "DNS queries with an EDNS0 Client Subnet, by family and source prefix.");
+	for (int i = 0; i < STATS_DNS_ECS_IPV4_PREFIXES; i++) {
+		if (s->dns_ecs_ipv4_prefixes[i] != 0)
+			body_printf(body, "babysniff_dns_ecs_queries_total{family=\"ipv4\",source_prefix=\"%d\"} %" PRIu64 "\n", i, s->dns_ecs_ipv4_prefixes[i]);
+	}
+	for (int i = 0; i < STATS_DNS_ECS_IPV6_PREFIXES; i++) {
+		if (s->dns_ecs_ipv6_prefixes[i] != 0)
+			body_printf(body, "babysniff_dns_ecs_queries_total{family=\"ipv6\",source_prefix=\"%d\"} %" PRIu64 "\n", i, s->dns_ecs_ipv6_prefixes[i]);
+	}
+	body_header(body, "babysniff_dns_alerts_total", "counter", "Alerts raised by the DNS anomaly detector.");
+	for (int i = 0; i < STATS_DNS_ALERT_COUNT; i++)
+		body_printf(body, "babysniff_dns_alerts_total{alert=\"%s\"} %" PRIu64 "\n", dns_alert_name(i), s->dns_alerts[i]);
+	body_counter(body, "babysniff_dns_pdns_answers_total", "DNS answers added to the passive DNS store.", s->dns_pdns_answers);
+	body_counter(body, "babysniff_dns_pdns_tuples_total", "Unique (rrname, rrtype, rdata) tuples in the passive DNS store.", s->dns_pdns_tuples);
+	body_counter(body, "babysniff_dns_pdns_dropped_total", "DNS answers dropped because the passive DNS store was full.", s->dns_pdns_dropped);
+
+	body_counter(body, "babysniff_output_records_written_total", "Decoded records written to the output.", s->output_written);
+	body_counter(body, "babysniff_output_records_dropped_total", "Decoded records dropped because the output queue was full.", s->output_dropped);
+}
+
+//
+// HTTP
+//
+static void send_all(int fd, const char *data, size_t length) {
+	while (length > 0) {
+		ssize_t ret = send(fd, data, length, MSG_NOSIGNAL);
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+			return; // The scraper went away
+		}
+		data += ret;
+		length -= (size_t)ret;
+	}
+}
+
+static void send_response(int fd, const char *status, const char *content_type, const char *body, size_t length) {
+	char header[256];
+	int header_len = snprintf(header, sizeof(header),
+		"HTTP/1.0 %s\r\n"
+		"Content-Type: %s\r\n"
+		"Content-Length: %zu\r\n"
+		"Connection: close\r\n"
+		"\r\n", status, content_type, length);
+	send_all(fd, header, (size_t)header_len);
+	send_all(fd, body, length);
+}
+
+static void handle_client(metrics_server_t *server, int fd) {
+	// A scraper that stops talking must not hold the thread forever
+	struct timeval timeout = { .tv_sec = METRICS_IO_TIMEOUT_SEC, .tv_usec = 0 };
+	setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+	setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+	char request[METRICS_REQUEST_MAXSIZE];
+	size_t used = 0;
+	while (used < sizeof(request) - 1) {
+		ssize_t ret = recv(fd, request + used, sizeof(request) - 1 - used, 0);
+		if (ret <= 0)
+			break;
+		used += (size_t)ret;
+		request[used] = '\0';
+		if (strstr(request, "\r\n\r\n") != NULL || strstr(request, "\n\n") != NULL)
+			break;
+	}
+	request[used] = '\0';
+
+	if (strncmp(request, "GET ", 4) != 0) {
+		static const char message[] = "Method not allowed\n";
+		send_response(fd, "405 Method Not Allowed", "text/plain", message, sizeof(message) - 1);
+		return;
+	}
+	const char *path = request + 4;
+	size_t path_len = strcspn(path, " ?\r\n");
+	if (!(path_len == 1 && path[0] == '/') && !(path_len == 8 && strncmp(path, "/metrics", 8) == 0)) {
+		static const char message[] = "Not found\n";
+		send_response(fd, "404 Not Found", "text/plain", message, sizeof(message) - 1);
+		return;
+	}
+
+	stats_snapshot_t snapshot;
+	sniff_channel_get_stats(server->channel, &snapshot);
+
+	metrics_body_t body = { NULL, 0, 0, false };
+	body.size = 8192;
+	body.data = malloc(body.size);
+	if (body.data == NULL) {
+		body.error = true;
+	} else {
+		render(&body, &snapshot, server->emulated_filter);
+	}
+	if (body.error) {
+		static const char message[] = "Out of memory\n";
+		send_response(fd, "500 Internal Server Error", "text/plain", message, sizeof(message) - 1);
+	} else {
+		send_response(fd, "200 OK", "text/plain; version=0.0.4", body.data, body.used);
+	}
+	free(body.data);
+}
+
+static void *server_main(void *arg) {
+	metrics_server_t *server = arg;
+
+	while (!atomic_load(&server->stop)) {
+		struct pollfd pfd = { .fd = server->fd, .events = POLLIN };
+		int ret = poll(&pfd, 1, METRICS_POLL_INTERVAL_MS);
+		if (ret <= 0)
+			continue;
+		int client = accept(server->fd, NULL, NULL);
+		if (client < 0)
+			continue;
+		handle_client(server, client);
+		close(client);
+	}
+
+	return NULL;
+}
+
+//
+// Operations
+//
+static int open_listener(const char *address) {
+	char host[256] = "127.0.0.1";
+	const char *port = address;
+
+	const char *colon = strrchr(address, ':');
+	if (colon != NULL) {
+		size_t host_len = (size_t)(colon - address);
+		const char *host_start = address;
+		// Strip the brackets around IPv6 addresses
+		if (host_len >= 2 && address[0] == '[' && address[host_len - 1] == ']') {
+			host_start++;
+			host_len -= 2;
+		}
+		if (host_len >= sizeof(host)) {
+			LOG_ERROR("Invalid metrics address: %s", address);
+			return -1;
+		}
+		if (host_len > 0) {
+			memcpy(host, host_start, host_len);
+			host[host_len] = '\0';
+		}
+		port = colon + 1;
+	}
+
+	struct addrinfo hints;
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	hints.ai_flags = AI_PASSIVE | AI_NUMERICSERV;
+	struct addrinfo *result;
+	int ret = getaddrinfo(host, port, &hints, &result);
+	if (ret != 0) {
+		LOG_ERROR("Invalid metrics address %s: %s", address, gai_strerror(ret));
+		return -1;
+	}
+
+	int fd = -1;
+	for (struct addrinfo *ai = result; ai != NULL; ai = ai->ai_next) {
+		fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+		if (fd < 0)
+			continue;
+		int value = 1;
+		setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &value, sizeof(value));
+		if (bind(fd, ai->ai_addr, ai->ai_addrlen) == 0 && listen(fd, 8) == 0)
+			break;
+		close(fd);
+		fd = -1;
+	}
+	if (fd < 0)
+		LOG_ERROR("Failed to listen on %s: %s", address, sniff_strerror(errno));
+	freeaddrinfo(result);
+	return fd;
+}
+
+metrics_server_t *metrics_server_start(const char *address, const channel_t *channel) {
+	metrics_server_t *server = malloc(sizeof(metrics_server_t));
+	if (server == NULL)
+		return NULL;
+	memset(server, 0, sizeof(metrics_server_t));
+	server->channel = channel;
+	// The filter may be replaced later, but never its mode
+	server->emulated_filter = channel->bpf_filter != NULL && channel->bpf_filter->mode == EMULATED_BPF;
+	atomic_init(&server->stop, false);
+
+	server->fd = open_listener(address);
+	if (server->fd < 0) {
+		free(server);
+		return NULL;
+	}
+
+	// Leave signal handling to the capture thread
+	sigset_t all, previous;
+	sigfillset(&all);
+	pthread_sigmask(SIG_SETMASK, &all, &previous);
+	int ret = pthread_create(&server->thread, NULL, server_main, server);
+	pthread_sigmask(SIG_SETMASK, &previous, NULL);
+	if (ret != 0) {
+		LOG_ERROR("Failed to start the metrics server: %s", sniff_strerror(ret));
+		close(server->fd);
+		free(server);
+		return NULL;
+	}
+
+	return server;
+}
+
+void metrics_server_stop(metrics_server_t *server) {
+	if (server == NULL)
+		return;
+	atomic_store(&server->stop, true);
+	pthread_join(server->thread, NULL);
+	close(server->fd);
+	free(server);
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+//
+// Minimal HTTP endpoint that serves the capture statistics in the Prometheus
+// text exposition format. It runs in its own thread and only reads the
+// counters, so a slow or stuck scraper never affects the capture.
+//
+
+typedef struct sniff_channel channel_t; // Forward declaration
+typedef struct metrics_server metrics_server_t; // Forward declaration
+
+//
+// Operations
+//
+// `address` is `[host:]port`, where `host` defaults to 127.0.0.1 and may be an
+// IPv6 address in brackets. Returns NULL on failure, with the reason logged.
+// The BPF filter of `channel` must be set already.
+metrics_server_t *metrics_server_start(const char *address, const channel_t *channel);
+void metrics_server_stop(metrics_server_t *server);
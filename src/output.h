@@ -0,0 +1,181 @@
+#pragma once
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "output_writer.h"
+
+//
+//  Usage:
+//
+//	output_begin_record(out);
+//	output_begin_object(out, "udp");
+//	output_field_uint(out, "sport", 53);
+//	output_field_str(out, "note", "hello");
+//	output_end_object(out);
+//	output_end_record(out);
+//	...
+//	output_flush(out); // once per batch of records
+//
+// Decoders describe what they found as a tree of named fields, and the selected
+// encoder serializes it into the output buffer. Nothing reaches the file descriptor
+// until `output_flush()` is called, so a whole batch costs a single `write()`.
+// After `output_start_writer()` the batch is handed to a writer thread instead.
+//
+
+#define OUTPUT_DEFAULT_BUFSIZE	(64 * 1024)
+#define OUTPUT_MAX_DEPTH		16
+
+typedef struct output output_t; // Forward declaration
+
+//
+// Types
+//
+typedef enum {
+	OUTPUT_FORMAT_TEXT,		// One compact human-readable line per packet
+	OUTPUT_FORMAT_JSONL,	// One JSON object per packet
+	OUTPUT_FORMAT_BINARY,	// Length-prefixed binary records (see output_binary.c)
+} output_format_e;
+
+// Serialization callbacks of a given format. `key` is NULL for list items.
+typedef struct output_encoder {
+	const char *name;
+	void (*begin_record)(output_t *out);
+	void (*end_record)(output_t *out);
+	void (*begin_object)(output_t *out, const char *key);
+	void (*end_object)(output_t *out);
+	void (*begin_list)(output_t *out, const char *key);
+	void (*end_list)(output_t *out);
+	void (*field_uint)(output_t *out, const char *key, uint64_t value);
+	void (*field_int)(output_t *out, const char *key, int64_t value);
+	void (*field_hex)(output_t *out, const char *key, uint64_t value);
+	void (*field_str)(output_t *out, const char *key, const char *value, size_t length);
+	void (*field_bytes)(output_t *out, const char *key, const uint8_t *data, size_t length);
+	void (*field_base64)(output_t *out, const char *key, const uint8_t *data, size_t length);
+	void (*field_hexstr)(output_t *out, const char *key, const uint8_t *data, size_t length);
+} output_encoder_t;
+
+struct output {
+	const output_encoder_t *encoder;
+	int fd;
+	uint8_t *data;
+	size_t size;
+	size_t used;
+	size_t record_start;	// offset of the record being built
+	uint32_t record_fields;	// number of fields in the record being built
+	uint32_t records;		// number of complete records in the buffer
+	int depth;
+	bool first[OUTPUT_MAX_DEPTH]; // whether the next item at a given depth is the first one
+	bool is_list[OUTPUT_MAX_DEPTH]; // whether a given depth is a list (items have no keys)
+	bool error;				// set when the buffer could not grow
+	output_writer_t *writer; // NULL when writing from the capture thread
+	atomic_uint_fast64_t written_records; // when writing from the capture thread
+};
+
+//
+// Allocation
+//
+output_t *output_alloc(output_format_e format, int fd);
+void output_free(output_t *out);
+
+//
+// Operations
+//
+int output_format_from_name(const char *name, output_format_e *format);
+int output_flush(output_t *out);
+// Moves the writes to a dedicated thread. Returns -1 if it could not be started.
+int output_start_writer(output_t *out, size_t queue_length, output_overflow_e policy);
+// Flushes the buffer and waits until the writer thread, if any, wrote everything.
+void output_stop_writer(output_t *out);
+// Records written and dropped so far. Safe to call from any thread.
+void output_get_stats(const output_t *out, uint64_t *written, uint64_t *dropped);
+void output_begin_record(output_t *out);
+void output_end_record(output_t *out);
+// Drops the record being built, e.g. once a later decoder finds that it's filtered out
+void output_cancel_record(output_t *out);
+
+// Ensures there is room for `length` more bytes. Encoders call this before appending.
+bool output_reserve(output_t *out, size_t length);
+void output_append(output_t *out, const void *data, size_t length);
+void output_append_char(output_t *out, char ch);
+void output_append_uint(output_t *out, uint64_t value);
+void output_append_int(output_t *out, int64_t value);
+void output_append_hex(output_t *out, uint64_t value); // 0x-prefixed
+// Writes the lowercase hex digits of `data` to `dst`, unterminated. Returns how many, i.e.
+// twice `length`.
+size_t output_encode_hexstr(char *dst, const uint8_t *data, size_t length);
+
+// Encoders call these when entering/leaving an object or list.
+void output_push(output_t *out, bool is_list);
+void output_pop(output_t *out);
+// Returns whether this is the first item at the current depth, and clears the flag.
+bool output_next_item(output_t *out);
+
+//
+// Fields
+//
+static inline void output_begin_object(output_t *out, const char *key) {
+	out->encoder->begin_object(out, key);
+}
+
+static inline void output_end_object(output_t *out) {
+	out->encoder->end_object(out);
+}
+
+static inline void output_begin_list(output_t *out, const char *key) {
+	out->encoder->begin_list(out, key);
+}
+
+static inline void output_end_list(output_t *out) {
+	out->encoder->end_list(out);
+}
+
+static inline void output_field_uint(output_t *out, const char *key, uint64_t value) {
+	out->record_fields++;
+	out->encoder->field_uint(out, key, value);
+}
+
+static inline void output_field_int(output_t *out, const char *key, int64_t value) {
+	out->record_fields++;
+	out->encoder->field_int(out, key, value);
+}
+
+// Same as `output_field_uint`, but text encoders render it in hexadecimal.
+static inline void output_field_hex(output_t *out, const char *key, uint64_t value) {
+	out->record_fields++;
+	out->encoder->field_hex(out, key, value);
+}
+
+static inline void output_field_strn(output_t *out, const char *key, const char *value, size_t length) {
+	out->record_fields++;
+	out->encoder->field_str(out, key, value, length);
+}
+
+void output_field_str(output_t *out, const char *key, const char *value);
+
+// Same as `output_field_str` with the lowercase hex digits of `data`, e.g. for digests,
+// which are written straight into the output buffer, like `output_field_base64`.
+static inline void output_field_hexstr(output_t *out, const char *key, const uint8_t *data, size_t length) {
+	out->record_fields++;
+	out->encoder->field_hexstr(out, key, data, length);
+}
+
+static inline void output_field_bytes(output_t *out, const char *key, const uint8_t *data, size_t length) {
+	out->record_fields++;
+	out->encoder->field_bytes(out, key, data, length);
+}
+
+// Same as `output_field_str` with the base64 encoding of `data`, which is written
+// straight into the output buffer, without an intermediate string.
+static inline void output_field_base64(output_t *out, const char *key, const uint8_t *data, size_t length) {
+	out->record_fields++;
+	out->encoder->field_base64(out, key, data, length);
+}
+
+//
+// Encoders
+//
+extern const output_encoder_t output_encoder_text;
+extern const output_encoder_t output_encoder_jsonl;
+extern const output_encoder_t output_encoder_binary;
@@ -0,0 +1,269 @@
+#include "output.h"
+#include "channel_ops_common.h"
+#include "log.h"
+#include "stats.h"
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+
+static const output_encoder_t *select_encoder(output_format_e format) {
+	switch (format) {
+		case OUTPUT_FORMAT_TEXT: return &output_encoder_text;
+		case OUTPUT_FORMAT_JSONL: return &output_encoder_jsonl;
+		case OUTPUT_FORMAT_BINARY: return &output_encoder_binary;
+	}
+	return NULL;
+}
+
+int output_format_from_name(const char *name, output_format_e *format) {
+	static const output_format_e formats[] = {
+		OUTPUT_FORMAT_TEXT,
+		OUTPUT_FORMAT_JSONL,
+		OUTPUT_FORMAT_BINARY,
+	};
+	for (size_t i = 0; i < sizeof(formats) / sizeof(formats[0]); i++) {
+		if (strcasecmp(name, select_encoder(formats[i])->name) == 0) {
+			*format = formats[i];
+			return 0;
+		}
+	}
+	return -1;
+}
+
+output_t *output_alloc(output_format_e format, int fd) {
+	output_t *out = malloc(sizeof(output_t));
+	if (out == NULL)
+		return NULL;
+	memset(out, 0, sizeof(output_t));
+	out->encoder = select_encoder(format);
+	out->fd = fd;
+	out->size = OUTPUT_DEFAULT_BUFSIZE;
+	out->data = malloc(out->size);
+	if (out->data == NULL) {
+		free(out);
+		return NULL;
+	}
+	return out;
+}
+
+void output_free(output_t *out) {
+	if (out == NULL)
+		return;
+	output_flush(out);
+	output_writer_free(out->writer); // Waits until everything was written
+	free(out->data);
+	free(out);
+}
+
+int output_start_writer(output_t *out, size_t queue_length, output_overflow_e policy) {
+	if (out->writer != NULL)
+		return 0;
+	out->writer = output_writer_alloc(out->fd, queue_length, policy);
+	return out->writer != NULL ? 0 : -1;
+}
+
+void output_stop_writer(output_t *out) {
+	output_flush(out);
+	if (out->writer != NULL)
+		output_writer_stop(out->writer);
+}
+
+void output_get_stats(const output_t *out, uint64_t *written, uint64_t *dropped) {
+	if (out->writer != NULL) {
+		output_writer_stats_t stats;
+		output_writer_get_stats(out->writer, &stats);
+		*written = stats.written_records;
+		*dropped = stats.dropped_records;
+		return;
+	}
+	*written = atomic_load_explicit(&out->written_records, memory_order_relaxed);
+	*dropped = 0;
+}
+
+// Hands the complete records to the writer thread and carries on with a buffer it already drained.
+static int output_submit(output_t *out) {
+	size_t pending = out->record_start;
+	if (pending == 0)
+		return 0;
+
+	size_t incomplete = out->used - pending;
+	size_t size;
+	uint8_t *data = output_writer_get_buffer(out->writer, incomplete, &size);
+	if (data == NULL)
+		return -1; // Keep buffering, maybe there's memory next time
+	memcpy(data, out->data + pending, incomplete);
+
+	output_writer_submit(out->writer, out->data, out->size, pending, out->records);
+	out->data = data;
+	out->size = size;
+	out->used = incomplete;
+	out->record_start = 0;
+	out->records = 0;
+	return 0;
+}
+
+// Writes every complete record. A record still being built stays in the buffer.
+int output_flush(output_t *out) {
+	if (out->writer != NULL)
+		return output_submit(out);
+
+	size_t pending = out->record_start;
+	size_t written = 0;
+	int result = 0;
+
+	while (written < pending) {
+		ssize_t ret = write(out->fd, out->data + written, pending - written);
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+			LOG_WARN("Failed to write output: %s", sniff_strerror(errno));
+			result = -1;
+			break; // Discard what's left, there's nothing better to do
+		}
+		written += (size_t)ret;
+	}
+	if (result == 0)
+		stats_add(&out->written_records, out->records);
+
+	memmove(out->data, out->data + pending, out->used - pending);
+	out->used -= pending;
+	out->record_start = 0;
+	out->records = 0;
+	return result;
+}
+
+void output_begin_record(output_t *out) {
+	out->record_start = out->used;
+	out->record_fields = 0;
+	out->depth = 0;
+	out->first[0] = true;
+	out->is_list[0] = false;
+	out->error = false;
+	out->encoder->begin_record(out);
+}
+
+void output_end_record(output_t *out) {
+	if (out->record_fields == 0 || out->error) {
+		// Nothing was emitted for this packet (or we ran out of memory), so drop it
+		out->used = out->record_start;
+		return;
+	}
+	out->encoder->end_record(out);
+	if (out->error) {
+		out->used = out->record_start;
+		return;
+	}
+	out->record_start = out->used;
+	out->records++;
+
+	// Don't let the buffer grow just because the batch is large
+	if (out->used >= out->size - out->size / 4)
+		output_flush(out);
+}
+
+void output_cancel_record(output_t *out) {
+	out->used = out->record_start;
+}
+
+bool output_reserve(output_t *out, size_t length) {
+	if (out->used + length <= out->size)
+		return true;
+	if (out->error)
+		return false;
+
+	size_t new_size = out->size * 2;
+	while (new_size < out->used + length)
+		new_size *= 2;
+	uint8_t *new_data = realloc(out->data, new_size);
+	if (new_data == NULL) {
+		out->error = true;
+		return false;
+	}
+	out->data = new_data;
+	out->size = new_size;
+	return true;
+}
+
+void output_append(output_t *out, const void *data, size_t length) {
+	if (!output_reserve(out, length))
+		return;
+	memcpy(out->data + out->used, data, length);
+	out->used += length;
+}
+
+void output_append_char(output_t *out, char ch) {
+	if (!output_reserve(out, 1))
+		return;
+	out->data[out->used++] = (uint8_t)ch;
+}
+
+void output_append_uint(output_t *out, uint64_t value) {
+	char digits[20]; // UINT64_MAX has 20 digits
+	size_t count = 0;
+	do {
+		digits[sizeof(digits) - ++count] = (char)('0' + value % 10);
+		value /= 10;
+	} while (value != 0);
+	output_append(out, digits + sizeof(digits) - count, count);
+}
+
+void output_append_int(output_t *out, int64_t value) {
+	if (value < 0) {
+		output_append_char(out, '-');
+		output_append_uint(out, (uint64_t)0 - (uint64_t)value);
+	} else {
+		output_append_uint(out, (uint64_t)value);
+	}
+}
+
+void output_append_hex(output_t *out, uint64_t value) {
+	static const char hexdigits[] = "0123456789abcdef";
+	char digits[18]; // "0x" + 16 digits
+	size_t count = 0;
+	do {
+		digits[sizeof(digits) - ++count] = hexdigits[value & 0xf];
+		value >>= 4;
+	} while (value != 0);
+	digits[sizeof(digits) - ++count] = 'x';
+	digits[sizeof(digits) - ++count] = '0';
+	output_append(out, digits + sizeof(digits) - count, count);
+}
+
+size_t output_encode_hexstr(char *dst, const uint8_t *data, size_t length) {
+	static const char hexdigits[] = "0123456789abcdef";
+	for (size_t i = 0; i < length; i++) {
+		*dst++ = hexdigits[data[i] >> 4];
+		*dst++ = hexdigits[data[i] & 0xf];
+	}
+	return length * 2;
+}
+
+void output_field_str(output_t *out, const char *key, const char *value) {
+	if (value == NULL)
+		value = "";
+	output_field_strn(out, key, value, strlen(value));
+}
+
+
+void output_push(output_t *out, bool is_list) {
+	if (out->depth + 1 >= OUTPUT_MAX_DEPTH) {
+		out->error = true; // Too deep, the record will be discarded
+		return;
+	}
+	out->depth++;
+	out->first[out->depth] = true;
+	out->is_list[out->depth] = is_list;
+}
+
+void output_pop(output_t *out) {
+	if (out->depth > 0)
+		out->depth--;
+}
+
+bool output_next_item(output_t *out) {
+	bool first = out->first[out->depth];
+	out->first[out->depth] = false;
+	return first;
+}
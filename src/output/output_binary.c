@@ -0,0 +1,160 @@
+#include "output.h"
+#include "base64.h"
+#include <string.h>
+
+//
+// Binary format. Each packet becomes one record:
+//
+//	uint32_t length;	// size of the items that follow, big-endian
+//	item[];
+//
+// Every item starts with a one-byte tag. All but the END tags are followed by
+// the key, as a one-byte length and the key bytes (length 0 for list items),
+// and then by the value:
+//
+//	TAG_UINT, TAG_HEX	uint64_t, big-endian
+//	TAG_INT				int64_t, big-endian, two's complement
+//	TAG_STR, TAG_BYTES	uint32_t length, big-endian, then the raw bytes
+//	TAG_BEGIN_OBJECT	(no value) followed by items until TAG_END_OBJECT
+//	TAG_BEGIN_LIST		(no value) followed by items until TAG_END_LIST
+//
+// Strings are copied as found in the packet, without any escaping.
+//
+
+typedef enum {
+	TAG_UINT			= 1,
+	TAG_INT				= 2,
+	TAG_HEX				= 3,
+	TAG_STR				= 4,
+	TAG_BYTES			= 5,
+	TAG_BEGIN_OBJECT	= 6,
+	TAG_END_OBJECT		= 7,
+	TAG_BEGIN_LIST		= 8,
+	TAG_END_LIST		= 9,
+} binary_tag_e;
+
+#define RECORD_LENGTH_SIZE 4
+
+static void put_be(uint8_t *ptr, uint64_t value, size_t size) {
+	for (size_t i = 0; i < size; i++)
+		ptr[i] = (uint8_t)(value >> ((size - 1 - i) * 8));
+}
+
+// Writes the tag and key, and makes room for `value_size` more bytes.
+static uint8_t *item(output_t *out, binary_tag_e tag, const char *key, size_t value_size) {
+	size_t key_length = key != NULL ? strlen(key) : 0;
+	if (key_length > UINT8_MAX)
+		key_length = UINT8_MAX;
+	if (!output_reserve(out, 2 + key_length + value_size))
+		return NULL;
+	uint8_t *ptr = out->data + out->used;
+	*ptr++ = (uint8_t)tag;
+	*ptr++ = (uint8_t)key_length;
+	if (key_length > 0)
+		memcpy(ptr, key, key_length);
+	ptr += key_length;
+	out->used = ptr - out->data + value_size;
+	return ptr;
+}
+
+static void binary_begin_record(output_t *out) {
+	// Placeholder for the length, patched in `binary_end_record`
+	if (!output_reserve(out, RECORD_LENGTH_SIZE))
+		return;
+	out->used += RECORD_LENGTH_SIZE;
+}
+
+static void binary_end_record(output_t *out) {
+	size_t length = out->used - out->record_start - RECORD_LENGTH_SIZE;
+	put_be(out->data + out->record_start, length, RECORD_LENGTH_SIZE);
+}
+
+static void binary_begin_object(output_t *out, const char *key) {
+	item(out, TAG_BEGIN_OBJECT, key, 0);
+	output_push(out, false);
+}
+
+static void binary_end_object(output_t *out) {
+	output_pop(out);
+	output_append_char(out, TAG_END_OBJECT);
+}
+
+static void binary_begin_list(output_t *out, const char *key) {
+	item(out, TAG_BEGIN_LIST, key, 0);
+	output_push(out, true);
+}
+
+static void binary_end_list(output_t *out) {
+	output_pop(out);
+	output_append_char(out, TAG_END_LIST);
+}
+
+static void binary_field_uint(output_t *out, const char *key, uint64_t value) {
+	uint8_t *ptr = item(out, TAG_UINT, key, sizeof(value));
+	if (ptr != NULL)
+		put_be(ptr, value, sizeof(value));
+}
+
+static void binary_field_int(output_t *out, const char *key, int64_t value) {
+	uint8_t *ptr = item(out, TAG_INT, key, sizeof(value));
+	if (ptr != NULL)
+		put_be(ptr, (uint64_t)value, sizeof(value));
+}
+
+static void binary_field_hex(output_t *out, const char *key, uint64_t value) {
+	uint8_t *ptr = item(out, TAG_HEX, key, sizeof(value));
+	if (ptr != NULL)
+		put_be(ptr, value, sizeof(value));
+}
+
+static void binary_field_str(output_t *out, const char *key, const char *value, size_t length) {
+	uint8_t *ptr = item(out, TAG_STR, key, 4 + length);
+	if (ptr != NULL) {
+		put_be(ptr, length, 4);
+		memcpy(ptr + 4, value, length);
+	}
+}
+
+static void binary_field_bytes(output_t *out, const char *key, const uint8_t *data, size_t length) {
+	uint8_t *ptr = item(out, TAG_BYTES, key, 4 + length);
+	if (ptr != NULL) {
+		put_be(ptr, length, 4);
+		memcpy(ptr + 4, data, length);
+	}
+}
+
+// A string item, like `binary_field_str`, so that readers need no new tag
+static void binary_field_base64(output_t *out, const char *key, const uint8_t *data, size_t length) {
+	size_t encoded_length = base64_encoded_length(length);
+	uint8_t *ptr = item(out, TAG_STR, key, 4 + encoded_length);
+	if (ptr != NULL) {
+		put_be(ptr, encoded_length, 4);
+		base64_encode_unterminated((char *)ptr + 4, data, length);
+	}
+}
+
+// Also a string item
+static void binary_field_hexstr(output_t *out, const char *key, const uint8_t *data, size_t length) {
+	uint8_t *ptr = item(out, TAG_STR, key, 4 + length * 2);
+	if (ptr != NULL) {
+		put_be(ptr, length * 2, 4);
+		output_encode_hexstr((char *)ptr + 4, data, length);
+	}
+}
+
+const output_encoder_t output_encoder_binary = {
+	.name = "binary",
+	.begin_record = binary_begin_record,
+	.end_record = binary_end_record,
+	.begin_object = binary_begin_object,
+	.end_object = binary_end_object,
+	.begin_list = binary_begin_list,
+	.end_list = binary_end_list,
+	.field_uint = binary_field_uint,
+	.field_int = binary_field_int,
+	.field_hex = binary_field_hex,
+	.field_str = binary_field_str,
+	.field_bytes = binary_field_bytes,
+	.field_base64 = binary_field_base64,
+	.field_hexstr = binary_field_hexstr,
+};
@@ -0,0 +1,168 @@
+#include "output.h"
+#include "base64.h"
+#include <string.h>
+
+//
+// JSON lines format. Each packet becomes a single JSON object followed by a newline:
+//
+//	{"eth":{"dhost":"0:0:0:0:0:0",...},"ip":{"v":4,...},"udp":{...}}
+//
+// Strings are escaped by hand straight into the output buffer. Bytes outside the
+// ASCII range are written as \u00XX, so the result is always valid UTF-8 even when
+// the packet carries arbitrary binary data. Byte fields become hex strings.
+//
+
+static const char hexdigits[] = "0123456789abcdef";
+
+static void key(output_t *out, const char *key) {
+	if (!output_next_item(out))
+		output_append_char(out, ',');
+	if (key != NULL) {
+		size_t length = strlen(key);
+		if (!output_reserve(out, length + 3))
+			return;
+		out->data[out->used++] = '"';
+		memcpy(out->data + out->used, key, length);
+		out->used += length;
+		out->data[out->used++] = '"';
+		out->data[out->used++] = ':';
+	}
+}
+
+static void jsonl_begin_record(output_t *out) {
+	output_append_char(out, '{');
+}
+
+static void jsonl_end_record(output_t *out) {
+	output_append(out, "}\n", 2);
+}
+
+static void jsonl_begin_object(output_t *out, const char *name) {
+	key(out, name);
+	output_append_char(out, '{');
+	output_push(out, false);
+}
+
+static void jsonl_end_object(output_t *out) {
+	output_pop(out);
+	output_append_char(out, '}');
+}
+
+static void jsonl_begin_list(output_t *out, const char *name) {
+	key(out, name);
+	output_append_char(out, '[');
+	output_push(out, true);
+}
+
+static void jsonl_end_list(output_t *out) {
+	output_pop(out);
+	output_append_char(out, ']');
+}
+
+static void jsonl_field_uint(output_t *out, const char *name, uint64_t value) {
+	key(out, name);
+	output_append_uint(out, value);
+}
+
+static void jsonl_field_int(output_t *out, const char *name, int64_t value) {
+	key(out, name);
+	output_append_int(out, value);
+}
+
+static void jsonl_field_hex(output_t *out, const char *name, uint64_t value) {
+	key(out, name);
+	output_append_uint(out, value); // JSON has no hexadecimal literals
+}
+
+static void jsonl_field_str(output_t *out, const char *name, const char *value, size_t length) {
+	key(out, name);
+
+	// Worst case every byte becomes \u00XX
+	if (!output_reserve(out, length * 6 + 2))
+		return;
+
+	uint8_t *ptr = out->data + out->used;
+	*ptr++ = '"';
+	for (size_t i = 0; i < length; i++) {
+		uint8_t ch = (uint8_t)value[i];
+		if (ch >= 0x20 && ch < 0x7f && ch != '"' && ch != '\\') {
+			*ptr++ = ch;
+			continue;
+		}
+		*ptr++ = '\\';
+		switch (ch) {
+			case '"': *ptr++ = '"'; break;
+			case '\\': *ptr++ = '\\'; break;
+			case '\b': *ptr++ = 'b'; break;
+			case '\f': *ptr++ = 'f'; break;
+			case '\n': *ptr++ = 'n'; break;
+			case '\r': *ptr++ = 'r'; break;
+			case '\t': *ptr++ = 't'; break;
+			default:
+				*ptr++ = 'u';
+				*ptr++ = '0';
+				*ptr++ = '0';
+				*ptr++ = hexdigits[ch >> 4];
+				*ptr++ = hexdigits[ch & 0xf];
+				break;
+		}
+	}
+	*ptr++ = '"';
+	out->used = ptr - out->data;
+}
+
+static void jsonl_field_bytes(output_t *out, const char *name, const uint8_t *data, size_t length) {
+	key(out, name);
+
+	if (!output_reserve(out, length * 2 + 2))
+		return;
+
+	uint8_t *ptr = out->data + out->used;
+	*ptr++ = '"';
+	for (size_t i = 0; i < length; i++) {
+		*ptr++ = hexdigits[data[i] >> 4];
+		*ptr++ = hexdigits[data[i] & 0xf];
+	}
+	*ptr++ = '"';
+	out->used = ptr - out->data;
+}
+
+static void jsonl_field_base64(output_t *out, const char *name, const uint8_t *data, size_t length) {
+	key(out, name);
+
+	// The base64 alphabet needs no escapes
+	if (!output_reserve(out, base64_encoded_length(length) + 2))
+		return;
+
+	out->data[out->used++] = '"';
+	out->used += base64_encode_unterminated((char *)out->data + out->used, data, length);
+	out->data[out->used++] = '"';
+}
+
+static void jsonl_field_hexstr(output_t *out, const char *name, const uint8_t *data, size_t length) {
+	key(out, name);
+
+	if (!output_reserve(out, length * 2 + 2))
+		return;
+
+	out->data[out->used++] = '"';
+	out->used += output_encode_hexstr((char *)out->data + out->used, data, length);
+	out->data[out->used++] = '"';
+}
+
+const output_encoder_t output_encoder_jsonl = {
+	.name = "jsonl",
+	.begin_record = jsonl_begin_record,
+	.end_record = jsonl_end_record,
+	.begin_object = jsonl_begin_object,
+	.end_object = jsonl_end_object,
+	.begin_list = jsonl_begin_list,
+	.end_list = jsonl_end_list,
+	.field_uint = jsonl_field_uint,
+	.field_int = jsonl_field_int,
+	.field_hex = jsonl_field_hex,
+	.field_str = jsonl_field_str,
+	.field_bytes = jsonl_field_bytes,
+	.field_base64 = jsonl_field_base64,
+	.field_hexstr = jsonl_field_hexstr,
+};
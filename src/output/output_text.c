@@ -0,0 +1,160 @@
+#include "output.h"
+#include "base64.h"
+#include "dump.h"
+#include <ctype.h>
+#include <string.h>
+
+//
+// Compact text format. Each packet becomes a single line where the protocol
+// layers are separated by " | " and fields are written as key=value:
+//
+//	eth: dhost=0:0:0:0:0:0 shost=0:0:0:0:0:0 type=0x800 | ip: v=4 hl=20 ...
+//
+// Nested objects and lists are rendered as key={...} and key=[..., ...].
+// Byte fields are rendered as a hex dump right below the line.
+//
+
+static void separator(output_t *out) {
+	if (output_next_item(out))
+		return;
+	if (out->depth == 0)
+		output_append(out, " | ", 3);
+	else if (out->is_list[out->depth])
+		output_append(out, ", ", 2);
+	else
+		output_append_char(out, ' ');
+}
+
+static void key(output_t *out, const char *key) {
+	separator(out);
+	if (key != NULL) {
+		output_append(out, key, strlen(key));
+		output_append_char(out, out->depth == 0 ? ':' : '=');
+	}
+}
+
+static void text_begin_record(output_t *out) {
+	(void)out;
+}
+
+static void text_end_record(output_t *out) {
+	// A trailing hex dump already ends the record with a newline
+	if (out->used > out->record_start && out->data[out->used - 1] == '\n')
+		return;
+	output_append_char(out, '\n');
+}
+
+static void text_begin_object(output_t *out, const char *name) {
+	key(out, name);
+	if (out->depth == 0) {
+		output_append_char(out, ' ');
+		// Top-level objects are the protocol layers, so no braces around them
+		output_push(out, false);
+	} else {
+		output_append_char(out, '{');
+		output_push(out, false);
+	}
+}
+
+static void text_end_object(output_t *out) {
+	output_pop(out);
+	if (out->depth > 0)
+		output_append_char(out, '}');
+}
+
+static void text_begin_list(output_t *out, const char *name) {
+	key(out, name);
+	output_append_char(out, '[');
+	output_push(out, true);
+}
+
+static void text_end_list(output_t *out) {
+	output_pop(out);
+	output_append_char(out, ']');
+}
+
+static void text_field_uint(output_t *out, const char *name, uint64_t value) {
+	key(out, name);
+	output_append_uint(out, value);
+}
+
+static void text_field_int(output_t *out, const char *name, int64_t value) {
+	key(out, name);
+	output_append_int(out, value);
+}
+
+static void text_field_hex(output_t *out, const char *name, uint64_t value) {
+	key(out, name);
+	output_append_hex(out, value);
+}
+
+static void text_field_str(output_t *out, const char *name, const char *value, size_t length) {
+	key(out, name);
+
+	bool quote = length == 0;
+	for (size_t i = 0; i < length && !quote; i++)
+		quote = value[i] == ' ' || value[i] == '"';
+
+	if (!output_reserve(out, length * 2 + 2))
+		return;
+	if (quote)
+		out->data[out->used++] = '"';
+	for (size_t i = 0; i < length; i++) {
+		uint8_t ch = (uint8_t)value[i];
+		if (quote && (ch == '"' || ch == '\\'))
+			out->data[out->used++] = '\\';
+		// Never let the packet inject control characters into the terminal
+		out->data[out->used++] = isprint(ch) ? ch : '.';
+	}
+	if (quote)
+		out->data[out->used++] = '"';
+}
+
+static void text_field_bytes(output_t *out, const char *name, const uint8_t *data, size_t length) {
+	key(out, name);
+	output_append_uint(out, length);
+	output_append(out, " bytes\n", 7);
+	if (!output_reserve(out, dump_hex_buffer_size(length)))
+		return;
+	out->used += dump_hex_to_buffer((char *)out->data + out->used, data, length, 0);
+}
+
+static void text_field_base64(output_t *out, const char *name, const uint8_t *data, size_t length) {
+	if (length == 0) {
+		text_field_str(out, name, "", 0);
+		return;
+	}
+	key(out, name);
+	// The base64 alphabet needs neither quotes nor escapes
+	if (!output_reserve(out, base64_encoded_length(length)))
+		return;
+	out->used += base64_encode_unterminated((char *)out->data + out->used, data, length);
+}
+
+static void text_field_hexstr(output_t *out, const char *name, const uint8_t *data, size_t length) {
+	if (length == 0) {
+		text_field_str(out, name, "", 0);
+		return;
+	}
+	key(out, name);
+	if (!output_reserve(out, length * 2))
+		return;
+	out->used += output_encode_hexstr((char *)out->data + out->used, data, length);
+}
+
+const output_encoder_t output_encoder_text = {
+	.name = "text",
+	.begin_record = text_begin_record,
+	.end_record = text_end_record,
+	.begin_object = text_begin_object,
+	.end_object = text_end_object,
+	.begin_list = text_begin_list,
+	.end_list = text_end_list,
+	.field_uint = text_field_uint,
+	.field_int = text_field_int,
+	.field_hex = text_field_hex,
+	.field_str = text_field_str,
+	.field_bytes = text_field_bytes,
+	.field_base64 = text_field_base64,
+	.field_hexstr = text_field_hexstr,
+};
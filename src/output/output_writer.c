@@ -0,0 +1,384 @@
+#include "output_writer.h"
+#include "channel_ops_common.h"
+#include "log.h"
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+
+#define OUTPUT_WRITER_MIN_BUFSIZE	(64 * 1024)
+#define CACHE_LINE_SIZE				64
+
+//
+// Types
+//
+typedef struct output_chunk {
+	uint8_t *data;
+	size_t size;
+	size_t length;		// bytes to be written
+	uint32_t records;	// records in `data[0..length)`
+} output_chunk_t;
+
+// Both rings are indexed by free-running counters; `head - tail` is the number of queued chunks.
+// The counters live on separate cache lines so the two threads don't keep invalidating each other.
+typedef struct output_ring {
+	_Atomic(output_chunk_t *) *slots;
+	size_t mask;
+	_Alignas(CACHE_LINE_SIZE) atomic_uint_fast64_t head;	// Written by the producer only
+	_Alignas(CACHE_LINE_SIZE) atomic_uint_fast64_t tail;	// Advanced by the consumer, and by the producer when dropping the oldest chunk
+	_Alignas(CACHE_LINE_SIZE) char pad;	// Keeps whatever follows off the line of `tail`
+} output_ring_t;
+
+struct output_writer {
+	output_ring_t queue;	// Filled chunks, capture thread -> writer thread
+	output_ring_t free;		// Drained chunks, writer thread -> capture thread
+	int fd;
+	output_overflow_e policy;
+	output_chunk_t *spare;	// Chunk whose buffer was lent by output_writer_get_buffer(), owned by the producer
+	pthread_t thread;
+	bool thread_started;
+	// Only used to sleep when a ring is empty (writer) or full (capture thread with the block policy)
+	pthread_mutex_t lock;
+	pthread_cond_t wakeup_writer;
+	pthread_cond_t wakeup_producer;
+	atomic_bool writer_waiting;
+	atomic_bool producer_waiting;
+	atomic_bool stop;
+	atomic_uint_fast64_t written_records;
+	atomic_uint_fast64_t written_bytes;
+	atomic_uint_fast64_t dropped_records;
+	atomic_uint_fast64_t dropped_bytes;
+};
+
+//
+// Chunks
+//
+static void chunk_free(output_chunk_t *chunk) {
+	if (chunk == NULL)
+		return;
+	free(chunk->data);
+	free(chunk);
+}
+
+//
+// Rings
+//
+static int ring_init(output_ring_t *ring, size_t length) {
+	ring->slots = calloc(length, sizeof(*ring->slots));
+	if (ring->slots == NULL)
+		return -1;
+	ring->mask = length - 1;
+	atomic_init(&ring->head, 0);
+	atomic_init(&ring->tail, 0);
+	for (size_t i = 0; i < length; i++)
+		atomic_init(&ring->slots[i], NULL);
+	return 0;
+}
+
+static void ring_destroy(output_ring_t *ring) {
+	if (ring->slots == NULL)
+		return;
+	for (size_t i = 0; i <= ring->mask; i++)
+		chunk_free(atomic_load(&ring->slots[i]));
+	free(ring->slots);
+	ring->slots = NULL;
+}
+
+static bool ring_is_empty(output_ring_t *ring) {
+	return atomic_load(&ring->head) == atomic_load(&ring->tail);
+}
+
+static bool ring_is_full(output_ring_t *ring) {
+	return atomic_load(&ring->head) - atomic_load(&ring->tail) > ring->mask;
+}
+
+// Producer side. The caller must have checked that the ring isn't full.
+static void ring_put(output_ring_t *ring, output_chunk_t *chunk) {
+	uint_fast64_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+	_Atomic(output_chunk_t *) *slot = &ring->slots[head & ring->mask];
+	// Whoever claimed the previous chunk of this slot may not have picked it up yet
+	while (atomic_load(slot) != NULL)
+		sched_yield();
+	atomic_store_explicit(slot, chunk, memory_order_relaxed);
+	atomic_store(&ring->head, head + 1);
+}
+
+// Takes the oldest chunk. Safe to race with another taker: only the thread
+// that moves `tail` past a slot gets its chunk.
+static output_chunk_t *ring_take(output_ring_t *ring) {
+	uint_fast64_t tail = atomic_load(&ring->tail);
+	while (tail != atomic_load(&ring->head)) {
+		if (atomic_compare_exchange_weak(&ring->tail, &tail, tail + 1)) {
+			_Atomic(output_chunk_t *) *slot = &ring->slots[tail & ring->mask];
+			output_chunk_t *chunk;
+			// The producer publishes `head` after the slot, so this only spins
+			// while a chunk from a previous lap is being picked up
+			while ((chunk = atomic_exchange(slot, NULL)) == NULL)
+				sched_yield();
+			return chunk;
+		}
+	}
+	return NULL;
+}
+
+//
+// Writer thread
+//
+static void wake(output_writer_t *writer, atomic_bool *waiting, pthread_cond_t *cond) {
+	if (!atomic_load(waiting))
+		return;
+	pthread_mutex_lock(&writer->lock);
+	pthread_cond_signal(cond);
+	pthread_mutex_unlock(&writer->lock);
+}
+
+static void write_chunk(output_writer_t *writer, const output_chunk_t *chunk) {
+	size_t written = 0;
+
+	while (written < chunk->length) {
+		ssize_t ret = write(writer->fd, chunk->data + written, chunk->length - written);
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+			LOG_WARN("Failed to write output: %s", sniff_strerror(errno));
+			return; // Discard what's left, there's nothing better to do
+		}
+		written += (size_t)ret;
+	}
+
+	atomic_fetch_add_explicit(&writer->written_records, chunk->records, memory_order_relaxed);
+	atomic_fetch_add_explicit(&writer->written_bytes, chunk->length, memory_order_relaxed);
+}
+
+static void recycle_chunk(output_writer_t *writer, output_chunk_t *chunk) {
+	if (ring_is_full(&writer->free)) {
+		chunk_free(chunk);
+		return;
+	}
+	ring_put(&writer->free, chunk);
+}
+
+static void *writer_main(void *arg) {
+	output_writer_t *writer = arg;
+
+	while (1) {
+		output_chunk_t *chunk = ring_take(&writer->queue);
+		if (chunk != NULL) {
+			wake(writer, &writer->producer_waiting, &writer->wakeup_producer);
+			write_chunk(writer, chunk);
+			recycle_chunk(writer, chunk);
+			continue;
+		}
+
+		// The producer submits everything before setting `stop`, so one more look is enough
+		if (atomic_load(&writer->stop) && ring_is_empty(&writer->queue))
+			break;
+
+		pthread_mutex_lock(&writer->lock);
+		atomic_store(&writer->writer_waiting, true);
+		while (ring_is_empty(&writer->queue) && !atomic_load(&writer->stop))
+			pthread_cond_wait(&writer->wakeup_writer, &writer->lock);
+		atomic_store(&writer->writer_waiting, false);
+		pthread_mutex_unlock(&writer->lock);
+	}
+
+	return NULL;
+}
+
+//
+// Allocation
+//
+output_writer_t *output_writer_alloc(int fd, size_t queue_length, output_overflow_e policy) {
+	size_t length = 2;
+	while (length < queue_length)
+		length *= 2;
+
+	// Rounded up to a multiple of the alignment as required by aligned_alloc()
+	size_t alloc_size = (sizeof(output_writer_t) + CACHE_LINE_SIZE - 1) & ~(size_t)(CACHE_LINE_SIZE - 1);
+	output_writer_t *writer = aligned_alloc(CACHE_LINE_SIZE, alloc_size);
+	if (writer == NULL)
+		return NULL;
+	memset(writer, 0, sizeof(output_writer_t));
+	writer->fd = fd;
+	writer->policy = policy;
+	atomic_init(&writer->writer_waiting, false);
+	atomic_init(&writer->producer_waiting, false);
+	atomic_init(&writer->stop, false);
+	atomic_init(&writer->written_records, 0);
+	atomic_init(&writer->written_bytes, 0);
+	atomic_init(&writer->dropped_records, 0);
+	atomic_init(&writer->dropped_bytes, 0);
+	pthread_mutex_init(&writer->lock, NULL);
+	pthread_cond_init(&writer->wakeup_writer, NULL);
+	pthread_cond_init(&writer->wakeup_producer, NULL);
+
+	// Every chunk is either queued, in the free ring, being written or lent to the producer
+	if (ring_init(&writer->queue, length) < 0 || ring_init(&writer->free, length * 2) < 0)
+		goto error;
+
+	// Signals must keep interrupting the capture thread, so the writer blocks all of them
+	sigset_t all, previous;
+	sigfillset(&all);
+	pthread_sigmask(SIG_SETMASK, &all, &previous);
+	int ret = pthread_create(&writer->thread, NULL, writer_main, writer);
+	pthread_sigmask(SIG_SETMASK, &previous, NULL);
+	if (ret != 0) {
+		LOG_WARN("Failed to start the output writer: %s", sniff_strerror(ret));
+		goto error;
+	}
+	writer->thread_started = true;
+
+	return writer;
+error:
+	output_writer_free(writer);
+	return NULL;
+}
+
+void output_writer_free(output_writer_t *writer) {
+	if (writer == NULL)
+		return;
+	output_writer_stop(writer);
+	ring_destroy(&writer->queue);
+	ring_destroy(&writer->free);
+	if (writer->spare != NULL) {
+		// NULL while lent out, but a dropped chunk keeps its buffer
+		free(writer->spare->data);
+		free(writer->spare);
+	}
+	pthread_cond_destroy(&writer->wakeup_producer);
+	pthread_cond_destroy(&writer->wakeup_writer);
+	pthread_mutex_destroy(&writer->lock);
+	free(writer);
+}
+
+//
+// Operations
+//
+void output_writer_stop(output_writer_t *writer) {
+	if (!writer->thread_started)
+		return;
+	pthread_mutex_lock(&writer->lock);
+	atomic_store(&writer->stop, true);
+	pthread_cond_signal(&writer->wakeup_writer);
+	pthread_mutex_unlock(&writer->lock);
+	pthread_join(writer->thread, NULL);
+	writer->thread_started = false;
+}
+
+int output_overflow_from_name(const char *name, output_overflow_e *policy) {
+	static const struct {
+		const char *name;
+		output_overflow_e policy;
+	} policies[] = {
+		{ "block",			OUTPUT_OVERFLOW_BLOCK },
+		{ "drop-newest",	OUTPUT_OVERFLOW_DROP_NEWEST },
+		{ "drop-oldest",	OUTPUT_OVERFLOW_DROP_OLDEST },
+	};
+	for (size_t i = 0; i < sizeof(policies) / sizeof(policies[0]); i++) {
+		if (strcasecmp(name, policies[i].name) == 0) {
+			*policy = policies[i].policy;
+			return 0;
+		}
+	}
+	return -1;
+}
+
+uint8_t *output_writer_get_buffer(output_writer_t *writer, size_t min_size, size_t *size) {
+	if (writer->spare == NULL) {
+		if (!ring_is_empty(&writer->free)) {
+			writer->spare = ring_take(&writer->free);
+		} else {
+			writer->spare = calloc(1, sizeof(output_chunk_t));
+			if (writer->spare == NULL)
+				return NULL;
+		}
+	}
+
+	output_chunk_t *chunk = writer->spare;
+	if (chunk->data == NULL || chunk->size < min_size) {
+		size_t new_size = min_size < OUTPUT_WRITER_MIN_BUFSIZE ? OUTPUT_WRITER_MIN_BUFSIZE : min_size;
+		uint8_t *new_data = realloc(chunk->data, new_size);
+		if (new_data == NULL)
+			return NULL;
+		chunk->data = new_data;
+		chunk->size = new_size;
+	}
+
+	// The buffer now belongs to the caller, only the chunk is kept to wrap the next submission
+	uint8_t *data = chunk->data;
+	*size = chunk->size;
+	chunk->data = NULL;
+	chunk->size = 0;
+	return data;
+}
+
+static void drop_chunk(output_writer_t *writer, output_chunk_t *chunk) {
+	atomic_fetch_add_explicit(&writer->dropped_records, chunk->records, memory_order_relaxed);
+	atomic_fetch_add_explicit(&writer->dropped_bytes, chunk->length, memory_order_relaxed);
+}
+
+void output_writer_submit(output_writer_t *writer, uint8_t *data, size_t size, size_t length, uint32_t records) {
+	output_chunk_t *chunk = writer->spare;
+	writer->spare = NULL;
+	if (chunk == NULL) {
+		chunk = calloc(1, sizeof(output_chunk_t));
+		if (chunk == NULL) {
+			output_chunk_t dropped = { data, size, length, records };
+			drop_chunk(writer, &dropped);
+			free(data);
+			return;
+		}
+	}
+	chunk->data = data;
+	chunk->size = size;
+	chunk->length = length;
+	chunk->records = records;
+
+	if (!writer->thread_started) {
+		write_chunk(writer, chunk);
+		recycle_chunk(writer, chunk);
+		return;
+	}
+
+	if (ring_is_full(&writer->queue)) {
+		switch (writer->policy) {
+			case OUTPUT_OVERFLOW_BLOCK:
+				pthread_mutex_lock(&writer->lock);
+				atomic_store(&writer->producer_waiting, true);
+				while (ring_is_full(&writer->queue))
+					pthread_cond_wait(&writer->wakeup_producer, &writer->lock);
+				atomic_store(&writer->producer_waiting, false);
+				pthread_mutex_unlock(&writer->lock);
+				break;
+			case OUTPUT_OVERFLOW_DROP_NEWEST:
+				drop_chunk(writer, chunk);
+				writer->spare = chunk; // Keep the buffer for the next batch
+				return;
+			case OUTPUT_OVERFLOW_DROP_OLDEST: {
+				// The writer may have taken it in the meantime, in which case there's room already
+				output_chunk_t *oldest = ring_take(&writer->queue);
+				if (oldest != NULL) {
+					drop_chunk(writer, oldest);
+					writer->spare = oldest; // Keep the buffer for the next batch
+				}
+				break;
+			}
+		}
+	}
+
+	ring_put(&writer->queue, chunk);
+	wake(writer, &writer->writer_waiting, &writer->wakeup_writer);
+}
+
+void output_writer_get_stats(const output_writer_t *writer, output_writer_stats_t *stats) {
+	stats->written_records = atomic_load_explicit(&writer->written_records, memory_order_relaxed);
+	stats->written_bytes = atomic_load_explicit(&writer->written_bytes, memory_order_relaxed);
+	stats->dropped_records = atomic_load_explicit(&writer->dropped_records, memory_order_relaxed);
+	stats->dropped_bytes = atomic_load_explicit(&writer->dropped_bytes, memory_order_relaxed);
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+//
+// Hands complete output buffers from the capture thread (the only producer)
+// to a dedicated writer thread (the only consumer) through a lock-free ring,
+// so that a slow terminal or pipe never stalls the capture loop.
+//
+// Buffers change owner instead of being copied: `output_flush()` submits the
+// buffer it was filling and continues with one the writer already drained.
+//
+
+typedef struct output_writer output_writer_t; // Forward declaration
+
+//
+// Types
+//
+typedef enum {
+	OUTPUT_OVERFLOW_BLOCK,			// Wait for the writer to catch up
+	OUTPUT_OVERFLOW_DROP_NEWEST,	// Discard the buffer being submitted
+	OUTPUT_OVERFLOW_DROP_OLDEST,	// Discard the oldest buffer not yet written
+} output_overflow_e;
+
+typedef struct output_writer_stats {
+	uint64_t written_records;
+	uint64_t written_bytes;
+	uint64_t dropped_records;
+	uint64_t dropped_bytes;
+} output_writer_stats_t;
+
+//
+// Allocation
+//
+// `queue_length` is rounded up to a power of two.
+output_writer_t *output_writer_alloc(int fd, size_t queue_length, output_overflow_e policy);
+// Writes everything still queued, then stops the thread.
+void output_writer_free(output_writer_t *writer);
+
+//
+// Operations
+//
+// Same as the first half of output_writer_free(), so that the final stats can be read.
+// Whatever is submitted afterwards is written by the calling thread.
+void output_writer_stop(output_writer_t *writer);
+int output_overflow_from_name(const char *name, output_overflow_e *policy);
+// Returns a buffer of at least `min_size` bytes for the producer to fill, or NULL.
+uint8_t *output_writer_get_buffer(output_writer_t *writer, size_t min_size, size_t *size);
+// Passes ownership of `data` to the writer. It holds `records` records in its first `length` bytes.
+void output_writer_submit(output_writer_t *writer, uint8_t *data, size_t size, size_t length, uint32_t records);
+// Safe to call from any thread.
+void output_writer_get_stats(const output_writer_t *writer, output_writer_stats_t *stats);
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "stats.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// Forward declarations
+typedef struct dns_anomaly dns_anomaly_t;
+typedef struct dns_name_filter dns_name_filter_t;
+typedef struct dns_pdns dns_pdns_t;
+typedef struct output output_t;
+
+//
+// Types
+//
+
+// Addresses and ports of the packet, filled in by the network and transport decoders.
+typedef struct sniff_flow {
+	uint8_t family;		// AF_INET, or 0 if no network layer was decoded
+	uint8_t protocol;	// IPPROTO_*
+	uint16_t sport;		// host byte order
+	uint16_t dport;		// host byte order
+	uint8_t src[16];	// network byte order, only the first 4 bytes are used by AF_INET
+	uint8_t dst[16];
+} sniff_flow_t;
+
+// Describes a single captured frame as it travels through the decoders.
+// When a snaplen is in effect `caplen` may be smaller than `wirelen`, in which
+// case decoders must only trust the first `caplen` bytes of `data`.
+typedef struct sniff_packet {
+	const uint8_t *data;	// captured bytes, starting at the link-layer header
+	uint32_t caplen;		// number of bytes available in `data`
+	uint32_t wirelen;		// original length of the frame on the wire
+	uint64_t timestamp;		// arrival time, in nanoseconds since the Epoch, 0 if unknown
+	output_t *output;		// where decoders emit what they found
+	stats_counters_t *stats; // where decoders count their errors
+	dns_anomaly_t *anomaly;	// fed by the DNS decoder, NULL unless --dns-alerts is given
+	dns_pdns_t *pdns;		// fed by the DNS decoder, NULL unless --pdns is given
+	const dns_name_filter_t *names; // NULL unless --dns-name is given
+	bool name_matched;		// set by the DNS decoder when a question matches `names`
+	bool alerted;			// set by the DNS decoder when `anomaly` emitted alerts
+	sniff_flow_t flow;
+} sniff_packet_t;
+
+#define SNIFF_PACKET_INITIALIZER \
+	{ NULL, 0, 0, 0, NULL, NULL, NULL, NULL, NULL, false, false, { 0, 0, 0, 0, { 0 }, { 0 } } }
+
+#define SNIFF_NSEC_PER_SEC	1000000000ULL
+
+// Whether the frame was cut short by the snaplen
+#define SNIFF_PACKET_IS_TRUNCATED(desc)	((desc)->caplen < (desc)->wirelen)
+
+// Counts a packet (well-formed or not) handed to the decoder of `proto`
+static inline void sniff_packet_count(sniff_packet_t *desc, stats_proto_e proto, size_t length) {
+	if (desc->stats == NULL)
+		return;
+	stats_inc(&desc->stats->proto_packets[proto]);
+	stats_add(&desc->stats->proto_bytes[proto], length);
+}
+
+// Counts a malformed packet against `proto`. Returns -1 so decoders can `return` it.
+static inline int sniff_packet_decode_error(sniff_packet_t *desc, stats_proto_e proto) {
+	if (desc->stats != NULL)
+		stats_inc(&desc->stats->decode_errors[proto]);
+	return -1;
+}
@@ -0,0 +1,89 @@
+#include "pcap.h"
+#include <stdlib.h>
+#include <time.h>
+
+//
+// Reference:
+// name: "PCAP Capture File Format"
+// url : https://www.ietf.org/archive/id/draft-gharris-opsawg-pcap-01.html
+//
+
+#define PCAP_MAGIC				0xa1b23c4d // nanosecond resolution
+#define PCAP_VERSION_MAJOR		2
+#define PCAP_VERSION_MINOR		4
+#define PCAP_LINKTYPE_ETHERNET	1
+
+typedef struct pcap_file_header {
+	uint32_t magic;
+	uint16_t version_major;
+	uint16_t version_minor;
+	int32_t thiszone;	// always 0
+	uint32_t sigfigs;	// always 0
+	uint32_t snaplen;
+	uint32_t linktype;
+} pcap_file_header_t;
+
+typedef struct pcap_record_header {
+	uint32_t ts_sec;
+	uint32_t ts_nsec;
+	uint32_t incl_len;	// captured length
+	uint32_t orig_len;	// wire length
+} pcap_record_header_t;
+
+pcap_writer_t *pcap_writer_open(const char *path, uint32_t snaplen) {
+	pcap_writer_t *writer = malloc(sizeof(pcap_writer_t));
+	if (writer == NULL)
+		return NULL;
+
+	writer->stream = fopen(path, "wb");
+	if (writer->stream == NULL) {
+		free(writer);
+		return NULL;
+	}
+	writer->snaplen = snaplen;
+
+	const pcap_file_header_t header = {
+		.magic = PCAP_MAGIC,
+		.version_major = PCAP_VERSION_MAJOR,
+		.version_minor = PCAP_VERSION_MINOR,
+		.thiszone = 0,
+		.sigfigs = 0,
+		.snaplen = snaplen,
+		.linktype = PCAP_LINKTYPE_ETHERNET,
+	};
+	if (fwrite(&header, sizeof(header), 1, writer->stream) != 1) {
+		pcap_writer_close(writer);
+		return NULL;
+	}
+
+	return writer;
+}
+
+int pcap_writer_write(pcap_writer_t *writer, const sniff_packet_t *desc) {
+	uint64_t timestamp = desc->timestamp;
+	if (timestamp == 0) {
+		struct timespec ts;
+		clock_gettime(CLOCK_REALTIME, &ts);
+		timestamp = (uint64_t)ts.tv_sec * SNIFF_NSEC_PER_SEC + (uint64_t)ts.tv_nsec;
+	}
+
+	const pcap_record_header_t header = {
+		.ts_sec = (uint32_t)(timestamp / SNIFF_NSEC_PER_SEC),
+		.ts_nsec = (uint32_t)(timestamp % SNIFF_NSEC_PER_SEC),
+		.incl_len = desc->caplen,
+		.orig_len = desc->wirelen,
+	};
+	if (fwrite(&header, sizeof(header), 1, writer->stream) != 1)
+		return -1;
+	if (desc->caplen > 0 && fwrite(desc->data, desc->caplen, 1, writer->stream) != 1)
+		return -1;
+	return 0;
+}
+
+void pcap_writer_close(pcap_writer_t *writer) {
+	if (writer == NULL)
+		return;
+	if (writer->stream != NULL)
+		fclose(writer->stream);
+	free(writer);
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include "packet.h"
+#include <stdint.h>
+#include <stdio.h>
+
+//
+// Types
+//
+typedef struct pcap_writer {
+	FILE *stream;
+	uint32_t snaplen;
+} pcap_writer_t;
+
+//
+// Operations
+//
+
+// Creates (or truncates) `path` and writes the pcap global header.
+pcap_writer_t *pcap_writer_open(const char *path, uint32_t snaplen);
+// Appends one record. The record keeps both captured and original lengths, and the
+// timestamp of `desc` to the nanosecond, or the current time if it has none.
+int pcap_writer_write(pcap_writer_t *writer, const sniff_packet_t *desc);
+void pcap_writer_close(pcap_writer_t *writer);
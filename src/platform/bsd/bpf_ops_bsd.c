@@ -9,8 +9,9 @@
 #include "../../channel.h"
 #include "../../channel_ops.h"
 
+// BIOCSETF discards everything in the store and hold buffers while installing the
+// filter, so packets that arrived before the filter was set never reach us.
 int bsd_bpf_attach_filter(channel_t *channel) {
-	// TODO(jweyrich): Drain packets that arrived before the filter was set! See https://natanyellin.com/posts/ebpf-filtering-done-right/
 	if (ioctl(channel->fd, BIOCSETF, &channel->bpf_filter->program) < 0) {
 		snprintf(channel->errmsg, SNIFF_ERR_BUFSIZE, "BIOCSETF: %s", sniff_strerror(errno));
 		return -1;
@@ -35,3 +36,29 @@ int sniff_channel_attach_filter(channel_t *channel) {
 			return -1;
 	}
 }
+
+// For a live replacement we want to keep the packets already accepted by the old
+// filter, so prefer BIOCSETFNR (set filter without resetting the buffers) if available.
+int sniff_channel_install_filter(channel_t *channel, const channel_bpf_filter_t *filter) {
+	switch (filter->mode) {
+		case NATIVE_BPF:
+#ifdef BIOCSETFNR
+			if (ioctl(channel->fd, BIOCSETFNR, &filter->program) < 0) {
+				snprintf(channel->errmsg, SNIFF_ERR_BUFSIZE, "BIOCSETFNR: %s", sniff_strerror(errno));
+				return -1;
+			}
+#else
+			if (ioctl(channel->fd, BIOCSETF, &filter->program) < 0) {
+				snprintf(channel->errmsg, SNIFF_ERR_BUFSIZE, "BIOCSETF: %s", sniff_strerror(errno));
+				return -1;
+			}
+#endif
+			return 0;
+		case EMULATED_BPF:
+			// Nothing to do for emulated BPF
+			return 0;
+		default:
+			sniff_channel_set_error_msg(channel, "Unknown BPF mode");
+			return -1;
+	}
+}
@@ -8,6 +8,7 @@
 #include <fcntl.h>
 #include <net/bpf.h>
 #include <net/if.h>
+#include <poll.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -166,12 +167,29 @@ void sniff_close(channel_t *channel) {
 	sniff_free_channel(channel);
 }
 
+// The BPF counters are cumulative. `bs_recv` counts the packets seen before the filter.
+int sniff_channel_update_stats(channel_t *channel) {
+	struct bpf_stat stats;
+	if (ioctl(channel->fd, BIOCGSTATS, &stats) < 0) {
+		sniff_channel_set_error_msg(channel, "ioctl(BIOCGSTATS): %s", sniff_strerror(errno));
+		return -1;
+	}
+	atomic_store_explicit(&channel->stats->kernel_received, stats.bs_recv, memory_order_relaxed);
+	atomic_store_explicit(&channel->stats->kernel_dropped, stats.bs_drop, memory_order_relaxed);
+	return 0;
+}
+
 int sniff_readloop(channel_t *channel, long timeout, const config_t *config) {
 	uint8_t *begin, *end, *current;
 	struct bpf_hdr *header;
+	sniff_packet_t descs[SNIFF_BATCH_SIZE];
+	uint32_t count;
 	ssize_t bytes_read;
 	time_t time_start, time_elapsed;
 
+	for (int i = 0; i < SNIFF_BATCH_SIZE; i++)
+		descs[i] = (sniff_packet_t)SNIFF_PACKET_INITIALIZER;
+
 	time_start = time(NULL);
 
 	while (1) {
@@ -184,20 +202,36 @@ int sniff_readloop(channel_t *channel, long timeout, const config_t *config) {
 			begin = channel->buffer;
 			end = channel->buffer + bytes_read;
 
-			// loop through each snapshot in the chunk
+			// loop through each snapshot in the chunk, a batch at a time
+			count = 0;
 			while (begin < end) {
 				header = (struct bpf_hdr *)begin;
 				current = begin + header->bh_hdrlen;
-				sniff_packet_fromwire(current, header->bh_caplen, 0, config);
+				descs[count].data = current;
+				descs[count].caplen = header->bh_caplen; // already truncated by the kernel
+				descs[count].wirelen = header->bh_datalen;
+				// Stamped by the kernel as the packet arrived, to the microsecond
+				descs[count].timestamp = (uint64_t)header->bh_tstamp.tv_sec * SNIFF_NSEC_PER_SEC
+					+ (uint64_t)header->bh_tstamp.tv_usec * 1000;
+				if (++count == SNIFF_BATCH_SIZE) {
+					sniff_channel_dispatch_batch(channel, descs, count, config);
+					count = 0;
+				}
 				begin += BPF_WORDALIGN(header->bh_caplen + header->bh_hdrlen);
 			}
+			sniff_channel_dispatch_batch(channel, descs, count, config);
+			sniff_channel_flush(channel);
 		}
 		time_elapsed = time(NULL) - time_start;
 		if (time_elapsed >= timeout) {
 			//printf("expired @ %lus\n", time_elapsed);
 			return 0;
 		}
-		usleep(50000);
+		// Only wait when there's nothing left to read, and wake up as soon as there is
+		if (bytes_read <= 0) {
+			struct pollfd pfd = { .fd = channel->fd, .events = POLLIN };
+			poll(&pfd, 1, 50);
+		}
 	}
 	//printf("error = %s\n", sniff_strerror(errno));
 	return -1;
@@ -5,21 +5,56 @@
 #include <errno.h>
 #include <linux/filter.h>
 #include <net/if.h>
+#include <sys/socket.h>
 #include "../../channel.h"
 #include "../../channel_ops.h"
 
-int linux_bpf_attach_filter(channel_t *channel) {
-	const void *program = &channel->bpf_filter->program;
-	const size_t program_size = sizeof(channel->bpf_filter->program);
-
-	// TODO(jweyrich): We should drain packets that arrived before the filter was set! See https://natanyellin.com/posts/ebpf-filtering-done-right/
-	if (setsockopt(channel->fd, SOL_SOCKET, SO_ATTACH_FILTER, program, program_size) == -1) {
+static int linux_bpf_set_program(channel_t *channel, const bpf_program_t *program) {
+	if (setsockopt(channel->fd, SOL_SOCKET, SO_ATTACH_FILTER, program, sizeof(*program)) == -1) {
 		snprintf(channel->errmsg, SNIFF_ERR_BUFSIZE, "setsockopt(SO_ATTACH_FILTER): %s", sniff_strerror(errno));
 		return -1;
 	}
 	return 0;
 }
 
+// Discard whatever is sitting in the socket receive queue.
+static int linux_bpf_drain(channel_t *channel) {
+	uint8_t byte;
+	while (1) {
+		// MSG_TRUNC lets us dequeue a whole packet with a 1-byte buffer.
+		ssize_t ret = recv(channel->fd, &byte, sizeof(byte), MSG_DONTWAIT | MSG_TRUNC);
+		if (ret >= 0)
+			continue;
+		if (errno == EINTR)
+			continue;
+		if (errno == EAGAIN || errno == EWOULDBLOCK)
+			return 0;
+		snprintf(channel->errmsg, SNIFF_ERR_BUFSIZE, "recv(): %s", sniff_strerror(errno));
+		return -1;
+	}
+}
+
+// The socket starts receiving every packet as soon as it's created, so by the time
+// the filter gets attached the receive queue may already hold packets that do not
+// match it. To close that window we attach a filter that rejects everything, drain
+// the queue, and only then attach the real filter.
+// See https://natanyellin.com/posts/ebpf-filtering-done-right/
+int linux_bpf_attach_filter(channel_t *channel) {
+	static struct bpf_insn reject_all_insns[] = {
+		BPF_STMT(BPF_RET | BPF_K, 0),
+	};
+	static const bpf_program_t reject_all = {
+		.bf_len = sizeof(reject_all_insns) / sizeof(reject_all_insns[0]),
+		.bf_insns = reject_all_insns,
+	};
+
+	if (linux_bpf_set_program(channel, &reject_all) < 0)
+		return -1;
+	if (linux_bpf_drain(channel) < 0)
+		return -1;
+	return linux_bpf_set_program(channel, &channel->bpf_filter->program);
+}
+
 int sniff_channel_attach_filter(channel_t *channel) {
 	if (!channel || !channel->bpf_filter) {
 		sniff_channel_set_error_msg(channel, "No BPF filter set on channel");
@@ -37,3 +72,18 @@ int sniff_channel_attach_filter(channel_t *channel) {
 			return -1;
 	}
 }
+
+// SO_ATTACH_FILTER replaces the socket filter in a single step, so packets already
+// queued (accepted by the old filter) are kept and nothing is lost in between.
+int sniff_channel_install_filter(channel_t *channel, const channel_bpf_filter_t *filter) {
+	switch (filter->mode) {
+		case NATIVE_BPF:
+			return linux_bpf_set_program(channel, &filter->program);
+		case EMULATED_BPF:
+			// Nothing to do for emulated BPF
+			return 0;
+		default:
+			sniff_channel_set_error_msg(channel, "Unknown BPF mode");
+			return -1;
+	}
+}
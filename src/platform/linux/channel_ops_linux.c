@@ -12,8 +12,10 @@
 #include <features.h>
 #include <linux/if_ether.h>
 #include <linux/if_packet.h>
+#include <linux/net_tstamp.h>
 #include <net/if.h>
 #include <netinet/in.h>
+#include <poll.h>
 //#include <net/ethernet.h>
 //#include <netdb.h>
 //#include <netinet/if_ether.h>
@@ -70,6 +72,38 @@ static int linux_set_immediate(channel_t *channel, int on) {
 	return 0;
 }
 
+// Ask the kernel to report the original packet length along with each packet,
+// so that we can tell the captured length apart from the wire length.
+static int linux_set_auxdata(channel_t *channel, int on) {
+	int value = on == 0 ? 0 : 1;
+	if (setsockopt(channel->fd, SOL_PACKET, PACKET_AUXDATA, &value, sizeof(value)) == -1) {
+		snprintf(channel->errmsg, SNIFF_ERR_BUFSIZE, "setsockopt(PACKET_AUXDATA): %s",
+			sniff_strerror(errno));
+		return -1;
+	}
+	return 0;
+}
+
+// Ask the kernel to stamp each packet as it arrives, in nanoseconds. The stamp of the NIC isn't
+// asked for, as it's on the clock of the NIC, which only ptp4l and the like keep in step with
+// CLOCK_REALTIME, and the latency stats, pcap and passive DNS need the latter.
+static int linux_set_timestamps(channel_t *channel, int on) {
+	int flags = on == 0 ? 0 : SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE;
+	if (setsockopt(channel->fd, SOL_SOCKET, SO_TIMESTAMPING, &flags, sizeof(flags)) == 0)
+		return 0;
+	int value = on == 0 ? 0 : 1;
+	if (setsockopt(channel->fd, SOL_SOCKET, SO_TIMESTAMPNS, &value, sizeof(value)) == -1) {
+		snprintf(channel->errmsg, SNIFF_ERR_BUFSIZE, "setsockopt(SO_TIMESTAMPNS): %s",
+			sniff_strerror(errno));
+		return -1;
+	}
+	return 0;
+}
+
+static inline uint64_t linux_timespec_to_ns(const struct timespec *ts) {
+	return (uint64_t)ts->tv_sec * SNIFF_NSEC_PER_SEC + (uint64_t)ts->tv_nsec;
+}
+
 static int linux_set_promisc(channel_t *channel, const char *ifname, int on) {
 	int value = on == 0 ? 0 : 1;
 	struct ifreq ifr;
@@ -105,7 +139,7 @@ static int linux_set_buffersize(channel_t *channel, size_t size) {
 	}
 	// TODO(jweyrich): better use realloc?
 	free(channel->buffer);
-	channel->buffer = calloc(channel->buffer_size, sizeof(uint8_t));
+	channel->buffer = calloc(SNIFF_BATCH_SIZE, channel->buffer_size); // one per packet of a batch
 	if (channel->buffer == NULL) {
 		snprintf(channel->errmsg, SNIFF_ERR_BUFSIZE, "calloc(): %s",
 			sniff_strerror(errno));
@@ -141,6 +175,13 @@ channel_t *sniff_open(const char *ifname, int promisc, size_t buffer_size) {
 	if (linux_set_immediate(channel, 1) < 0)
 		goto error;
 
+	if (linux_set_auxdata(channel, 1) < 0)
+		goto error;
+
+	// Keep going if it fails, the packets are then stamped when they're read
+	if (linux_set_timestamps(channel, 1) < 0)
+		LOG_WARN("%s", channel->errmsg);
+
 	// Keep going if it fails
 	linux_set_promisc(channel, ifname, promisc);
 
@@ -156,47 +197,96 @@ void sniff_close(channel_t *channel) {
 	sniff_free_channel(channel);
 }
 
+// The kernel resets its counters on every read, so they are accumulated here.
+// `tp_packets` includes the packets that were dropped.
+int sniff_channel_update_stats(channel_t *channel) {
+	struct tpacket_stats stats;
+	socklen_t length = sizeof(stats);
+	if (getsockopt(channel->fd, SOL_PACKET, PACKET_STATISTICS, &stats, &length) == -1) {
+		sniff_channel_set_error_msg(channel, "getsockopt(PACKET_STATISTICS): %s", sniff_strerror(errno));
+		return -1;
+	}
+	stats_add(&channel->stats->kernel_received, stats.tp_packets);
+	stats_add(&channel->stats->kernel_dropped, stats.tp_drops);
+	return 0;
+}
+
 int sniff_readloop(channel_t *channel, long timeout, const config_t *config) {
-	uint8_t *begin, *end, *current;
-	struct sockaddr packet_info;
-	size_t packet_info_size = sizeof(struct sockaddr_ll);
-	//struct eth_hdr *header;
-	ssize_t bytes_read;
+	struct sockaddr_ll packet_info[SNIFF_BATCH_SIZE];
+	// CMSG_SPACE() is a multiple of the alignment, so every row is aligned too.
+	// The timestamps are either a struct scm_timestamping or a single struct timespec.
+	_Alignas(struct cmsghdr) uint8_t control[SNIFF_BATCH_SIZE][CMSG_SPACE(sizeof(struct tpacket_auxdata))
+		+ CMSG_SPACE(3 * sizeof(struct timespec))];
+	struct iovec iov[SNIFF_BATCH_SIZE];
+	struct mmsghdr msgs[SNIFF_BATCH_SIZE];
+	struct cmsghdr *cmsg;
+	sniff_packet_t descs[SNIFF_BATCH_SIZE];
+	int count;
 	time_t time_start, time_elapsed;
 
+	for (int i = 0; i < SNIFF_BATCH_SIZE; i++)
+		descs[i] = (sniff_packet_t)SNIFF_PACKET_INITIALIZER;
+
 	time_start = time(NULL);
 
 	while (1) {
-		bytes_read = recvfrom(channel->fd, channel->buffer, channel->buffer_size, 0,
-			&packet_info, (socklen_t *)&packet_info_size);
-		//bytes_read = read(channel->fd, channel->buffer, channel->buffer_size);
-		if (bytes_read < 0) {
+		memset(msgs, 0, sizeof(msgs));
+		for (int i = 0; i < SNIFF_BATCH_SIZE; i++) {
+			iov[i].iov_base = channel->buffer + i * channel->buffer_size;
+			iov[i].iov_len = channel->buffer_size;
+			msgs[i].msg_hdr.msg_name = &packet_info[i];
+			msgs[i].msg_hdr.msg_namelen = sizeof(packet_info[i]);
+			msgs[i].msg_hdr.msg_iov = &iov[i];
+			msgs[i].msg_hdr.msg_iovlen = 1;
+			msgs[i].msg_hdr.msg_control = control[i];
+			msgs[i].msg_hdr.msg_controllen = sizeof(control[i]);
+		}
+
+		// Up to a batch of packets per call, as many as are queued.
+		// MSG_TRUNC makes each length the one of the packet as queued,
+		// which is what the filter let through, even if our buffer is smaller.
+		count = recvmmsg(channel->fd, msgs, SNIFF_BATCH_SIZE, MSG_TRUNC, NULL);
+		if (count < 0) {
 			if (errno != EAGAIN)
 				fprintf(stderr, "errno = %d\n", errno);
-		} else if (bytes_read > 0) {
-			//printf("bytes_read = %lu\n", bytes_read);
-			begin = channel->buffer;
-			end = channel->buffer + bytes_read;
-
-			// loop through each snapshot in the chunk
-			while (begin < end) {
-				//header = (struct eth_hdr *)begin;
-				current = begin; // Point to the start of the received buffer because it's not encapsulated.
-
-				// Apply BPF filter if set
-				if (sniff_channel_apply_bpf_filter(channel, current, bytes_read)) {
-					sniff_packet_fromwire(current, bytes_read, 0, config);
-				}
+			// The socket is drained, so this is the end of the batch
+			sniff_channel_flush(channel);
+		} else if (count > 0) {
+			for (int i = 0; i < count; i++) {
+				// The packet is not encapsulated, so it starts at the beginning of its buffer.
+				uint32_t bytes_read = msgs[i].msg_len;
+				descs[i].data = iov[i].iov_base;
+				descs[i].caplen = bytes_read < channel->buffer_size ? bytes_read : (uint32_t)channel->buffer_size;
+				descs[i].wirelen = bytes_read;
+				descs[i].timestamp = 0;
 
-				begin += bytes_read;
+				for (cmsg = CMSG_FIRSTHDR(&msgs[i].msg_hdr); cmsg != NULL; cmsg = CMSG_NXTHDR(&msgs[i].msg_hdr, cmsg)) {
+					if (cmsg->cmsg_level == SOL_PACKET && cmsg->cmsg_type == PACKET_AUXDATA) {
+						const struct tpacket_auxdata *aux = (struct tpacket_auxdata *)CMSG_DATA(cmsg);
+						descs[i].wirelen = aux->tp_len; // length before the kernel filter truncated it
+					} else if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SO_TIMESTAMPING) {
+						// The software stamp, a deprecated one, and the raw stamp of the NIC
+						const struct timespec *stamps = (struct timespec *)CMSG_DATA(cmsg);
+						descs[i].timestamp = linux_timespec_to_ns(&stamps[0]);
+					} else if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SO_TIMESTAMPNS) {
+						descs[i].timestamp = linux_timespec_to_ns((struct timespec *)CMSG_DATA(cmsg));
+					}
+				}
 			}
+
+			sniff_channel_dispatch_batch(channel, descs, (uint32_t)count, config);
 		}
 		time_elapsed = time(NULL) - time_start;
 		if (time_elapsed >= timeout) {
 			//printf("expired @ %lus\n", time_elapsed);
+			sniff_channel_flush(channel);
 			return 0;
 		}
-		usleep(50000);
+		// Only wait when there's nothing left to read, and wake up as soon as there is
+		if (count <= 0) {
+			struct pollfd pfd = { .fd = channel->fd, .events = POLLIN };
+			poll(&pfd, 1, 50);
+		}
 	}
 	//printf("error = %s\n", sniff_strerror(errno));
 	return -1;
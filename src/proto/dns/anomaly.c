@@ -0,0 +1,428 @@
+#include "anomaly.h"
+#include "output.h"
+#include "stats.h"
+#include "proto/dns/name.h"
+#include "proto/dns/types.h"
+#include "utils.h" // for utils_in_addr_to_str
+#include <arpa/inet.h> // for INET_ADDRSTRLEN
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h> // for strncasecmp
+#include <sys/socket.h> // for AF_INET
+#include <time.h>
+
+#define DNS_ANOMALY_MAX_ALERTS	5 // that a single message can bring about, 3 of its zone and 2 of its client
+
+// 20 NXDOMAIN or 10 SERVFAIL per second, making up a good share of the responses, and
+// 20 queries per second to names below a zone that hash almost evenly (of a maximum of 5 bits)
+const dns_anomaly_thresholds_t dns_anomaly_default_thresholds = {
+	.nxdomain = 200,
+	.nxdomain_percent = 50,
+	.servfail = 100,
+	.servfail_percent = 25,
+	.subdomain_queries = 200,
+	.subdomain_millibits = 4500,
+};
+
+static const char *const g_alert_names[DNS_ALERT_COUNT] = {
+	[DNS_ALERT_NXDOMAIN_FLOOD] = "nxdomain_flood",
+	[DNS_ALERT_SERVFAIL_SPIKE] = "servfail_spike",
+	[DNS_ALERT_RANDOM_SUBDOMAIN] = "random_subdomain",
+};
+
+//
+// Types
+//
+// Counts of one second
+typedef struct dns_anomaly_bucket {
+	uint32_t	queries;
+	uint32_t	responses;
+	uint32_t	nxdomain;
+	uint32_t	servfail;
+} dns_anomaly_bucket_t;
+
+typedef struct dns_anomaly_window {
+	uint32_t	second;		// of the newest bucket
+	uint32_t	quiet_until[DNS_ALERT_COUNT]; // second from which each alert may be raised again
+	dns_anomaly_bucket_t buckets[DNS_ANOMALY_WINDOW];
+} dns_anomaly_window_t;
+
+// What the zones and the clients start with
+typedef struct dns_anomaly_slot {
+	uint64_t	hash;		// 0 if the slot is free
+	dns_anomaly_window_t window;
+} dns_anomaly_slot_t;
+
+typedef struct dns_anomaly_zone {
+	dns_anomaly_slot_t slot;
+	uint16_t	labels[DNS_ANOMALY_WINDOW][DNS_ANOMALY_LABEL_BINS]; // leftmost labels, by hash
+	char		name[DNS_NAME_MAXLEN + 1]; // lowercase
+} dns_anomaly_zone_t;
+
+typedef struct dns_anomaly_client {
+	dns_anomaly_slot_t slot;
+	uint8_t		address[4];	// IPv4 only, as is sniff_flow_t
+} dns_anomaly_client_t;
+
+struct dns_anomaly {
+	dns_anomaly_thresholds_t thresholds;
+	dns_anomaly_zone_t zones[DNS_ANOMALY_ZONES];
+	dns_anomaly_client_t clients[DNS_ANOMALY_CLIENTS];
+};
+
+// An alert waiting for the others of the same message, so they all go in a single list
+typedef struct dns_alert_event {
+	dns_alert_e	alert;
+	const dns_anomaly_zone_t *zone;		// either one
+	const dns_anomaly_client_t *client;
+	uint32_t	count;		// NXDOMAIN, SERVFAIL, or queries below the zone
+	uint32_t	total;		// responses
+	uint32_t	millibits;	// entropy of the leftmost labels
+} dns_alert_event_t;
+
+typedef struct dns_alert_events {
+	size_t		count;
+	dns_alert_event_t events[DNS_ANOMALY_MAX_ALERTS];
+} dns_alert_events_t;
+
+//
+// Allocation
+//
+dns_anomaly_t *dns_anomaly_alloc(const dns_anomaly_thresholds_t *thresholds) {
+	dns_anomaly_t *anomaly = calloc(1, sizeof(dns_anomaly_t));
+	if (anomaly == NULL)
+		return NULL;
+	anomaly->thresholds = *thresholds;
+	return anomaly;
+}
+
+void dns_anomaly_free(dns_anomaly_t *anomaly) {
+	free(anomaly);
+}
+
+//
+// Keys
+//
+// FNV-1a, never 0 as that marks a free slot
+static uint64_t hash_update(uint64_t hash, uint8_t byte) {
+	return (hash ^ byte) * UINT64_C(0x100000001b3);
+}
+
+#define HASH_INITIALIZER	UINT64_C(0xcbf29ce484222325)
+#define HASH_FINAL(hash)	((hash) != 0 ? (hash) : 1)
+
+static inline char lowercase(char ch) {
+	return ch >= 'A' && ch <= 'Z' ? (char)(ch + ('a' - 'A')) : ch;
+}
+
+// Second-level labels under which the ccTLDs register names, as in `example.co.uk`
+static bool is_second_level_suffix(const char *label, size_t length) {
+	static const char *const suffixes[] = {
+		"ac", "co", "com", "edu", "go", "gob", "gov", "ltd", "mil", "ne", "net", "nic", "or", "org", "plc", "sch",
+	};
+	for (size_t i = 0; i < sizeof(suffixes) / sizeof(suffixes[0]); i++) {
+		if (strlen(suffixes[i]) == length && strncasecmp(suffixes[i], label, length) == 0)
+			return true;
+	}
+	return false;
+}
+
+const char *dns_anomaly_zone(const char *name) {
+	// Starts of the last 3 labels, the TLD being the last
+	const char *labels[3] = { name, name, name };
+	size_t count = 1;
+	for (const char *ptr = name; *ptr != '\0'; ptr++) {
+		if (*ptr != '.' || ptr[1] == '\0')
+			continue;
+		labels[0] = labels[1];
+		labels[1] = labels[2];
+		labels[2] = ptr + 1;
+		count++;
+	}
+	if (count <= 2)
+		return name;
+	size_t sld_length = (size_t)(labels[2] - labels[1]) - 1;
+	if (count >= 3 && strlen(labels[2]) == 2 && is_second_level_suffix(labels[1], sld_length))
+		return labels[0];
+	return labels[1];
+}
+
+//
+// Windows
+//
+// Clears the buckets that went out of the window since the last message of the key
+static dns_anomaly_bucket_t *window_advance(dns_anomaly_window_t *window,
+	uint16_t (*labels)[DNS_ANOMALY_LABEL_BINS], uint32_t now)
+{
+	uint32_t elapsed = now - window->second;
+	if (elapsed > DNS_ANOMALY_WINDOW)
+		elapsed = DNS_ANOMALY_WINDOW;
+	for (uint32_t i = 1; i <= elapsed; i++) {
+		uint32_t index = (window->second + i) % DNS_ANOMALY_WINDOW;
+		memset(&window->buckets[index], 0, sizeof(window->buckets[index]));
+		if (labels != NULL)
+			memset(labels[index], 0, sizeof(labels[index]));
+	}
+	window->second = now;
+	return &window->buckets[now % DNS_ANOMALY_WINDOW];
+}
+
+static dns_anomaly_bucket_t window_sum(const dns_anomaly_window_t *window) {
+	dns_anomaly_bucket_t sum = { 0, 0, 0, 0 };
+	for (int i = 0; i < DNS_ANOMALY_WINDOW; i++) {
+		sum.queries += window->buckets[i].queries;
+		sum.responses += window->buckets[i].responses;
+		sum.nxdomain += window->buckets[i].nxdomain;
+		sum.servfail += window->buckets[i].servfail;
+	}
+	return sum;
+}
+
+static void window_count(dns_anomaly_bucket_t *bucket, const dns_anomaly_message_t *message) {
+	if (!message->response) {
+		bucket->queries++;
+		return;
+	}
+	bucket->responses++;
+	if (message->rcode == DNS_RC_NXDOMAIN)
+		bucket->nxdomain++;
+	else if (message->rcode == DNS_RC_SERVFAIL)
+		bucket->servfail++;
+}
+
+// Shannon entropy of the histogram of leftmost labels over the window, in millibits
+static uint32_t labels_entropy(const uint16_t (*labels)[DNS_ANOMALY_LABEL_BINS], uint32_t *samples) {
+	uint32_t bins[DNS_ANOMALY_LABEL_BINS] = { 0 };
+	uint32_t total = 0;
+	for (int i = 0; i < DNS_ANOMALY_WINDOW; i++) {
+		for (int j = 0; j < DNS_ANOMALY_LABEL_BINS; j++)
+			bins[j] += labels[i][j];
+	}
+	double sum = 0;
+	for (int j = 0; j < DNS_ANOMALY_LABEL_BINS; j++) {
+		total += bins[j];
+		if (bins[j] != 0)
+			sum += bins[j] * log2(bins[j]);
+	}
+	*samples = total;
+	if (total == 0)
+		return 0;
+	return (uint32_t)((log2(total) - sum / total) * 1000);
+}
+
+//
+// Alerts
+//
+static bool alert_is_quiet(dns_anomaly_window_t *window, dns_alert_e alert, uint32_t now) {
+	if ((int32_t)(now - window->quiet_until[alert]) < 0)
+		return true;
+	window->quiet_until[alert] = now + DNS_ANOMALY_WINDOW;
+	return false;
+}
+
+static dns_alert_event_t *alert_push(dns_alert_events_t *events, dns_alert_e alert, uint32_t count, uint32_t total) {
+	dns_alert_event_t *event = &events->events[events->count++];
+	memset(event, 0, sizeof(*event));
+	event->alert = alert;
+	event->count = count;
+	event->total = total;
+	return event;
+}
+
+// NXDOMAIN and SERVFAIL, of a zone or a client
+static void check_responses(const dns_anomaly_thresholds_t *thresholds, dns_anomaly_window_t *window,
+	uint32_t now, dns_alert_events_t *events)
+{
+	dns_anomaly_bucket_t sum = window_sum(window);
+	if (sum.nxdomain >= thresholds->nxdomain
+		&& (uint64_t)sum.nxdomain * 100 >= (uint64_t)sum.responses * thresholds->nxdomain_percent
+		&& !alert_is_quiet(window, DNS_ALERT_NXDOMAIN_FLOOD, now))
+	{
+		alert_push(events, DNS_ALERT_NXDOMAIN_FLOOD, sum.nxdomain, sum.responses);
+	}
+	if (sum.servfail >= thresholds->servfail
+		&& (uint64_t)sum.servfail * 100 >= (uint64_t)sum.responses * thresholds->servfail_percent
+		&& !alert_is_quiet(window, DNS_ALERT_SERVFAIL_SPIKE, now))
+	{
+		alert_push(events, DNS_ALERT_SERVFAIL_SPIKE, sum.servfail, sum.responses);
+	}
+}
+
+static void check_zone(const dns_anomaly_thresholds_t *thresholds, dns_anomaly_zone_t *zone,
+	uint32_t now, dns_alert_events_t *events)
+{
+	size_t first = events->count;
+	check_responses(thresholds, &zone->slot.window, now, events);
+
+	uint32_t samples;
+	uint32_t millibits = labels_entropy((const uint16_t (*)[DNS_ANOMALY_LABEL_BINS])zone->labels, &samples);
+	if (samples >= thresholds->subdomain_queries && millibits >= thresholds->subdomain_millibits
+		&& !alert_is_quiet(&zone->slot.window, DNS_ALERT_RANDOM_SUBDOMAIN, now))
+	{
+		alert_push(events, DNS_ALERT_RANDOM_SUBDOMAIN, samples, 0)->millibits = millibits;
+	}
+	for (size_t i = first; i < events->count; i++)
+		events->events[i].zone = zone;
+}
+
+static void check_client(const dns_anomaly_thresholds_t *thresholds, dns_anomaly_client_t *client,
+	uint32_t now, dns_alert_events_t *events)
+{
+	size_t first = events->count;
+	check_responses(thresholds, &client->slot.window, now, events);
+	for (size_t i = first; i < events->count; i++)
+		events->events[i].client = client;
+}
+
+static void emit_alerts(const dns_alert_events_t *events, output_t *out, stats_counters_t *stats) {
+	output_begin_list(out, "dns-alerts");
+	for (size_t i = 0; i < events->count; i++) {
+		const dns_alert_event_t *event = &events->events[i];
+		if (stats != NULL)
+			stats_inc(&stats->dns_alerts[event->alert]);
+		output_begin_object(out, NULL);
+		output_field_str(out, "alert", dns_alert_name(event->alert));
+		if (event->zone != NULL) {
+			output_field_str(out, "zone", event->zone->name);
+		} else {
+			char address[INET_ADDRSTRLEN];
+			utils_in_addr_to_str(address, sizeof(address), (const struct in_addr *)event->client->address);
+			output_field_str(out, "client", address);
+		}
+		output_field_uint(out, "window", DNS_ANOMALY_WINDOW);
+		switch (event->alert) {
+			case DNS_ALERT_NXDOMAIN_FLOOD:
+				output_field_uint(out, "nxdomain", event->count);
+				output_field_uint(out, "responses", event->total);
+				break;
+			case DNS_ALERT_SERVFAIL_SPIKE:
+				output_field_uint(out, "servfail", event->count);
+				output_field_uint(out, "responses", event->total);
+				break;
+			default:
+				output_field_uint(out, "queries", event->count);
+				output_field_uint(out, "entropy_millibits", event->millibits);
+				break;
+		}
+		output_end_object(out);
+	}
+	output_end_list(out);
+}
+
+//
+// Tables
+//
+// The slot of `hash`, or the least recently seen of those it probes, which is then emptied
+static dns_anomaly_slot_t *table_slot(void *slots, size_t slot_size, size_t mask, uint64_t hash,
+	bool (*matches)(const dns_anomaly_slot_t *slot, const void *key), const void *key, uint32_t now)
+{
+	dns_anomaly_slot_t *victim = NULL;
+	uint32_t victim_age = 0;
+	for (size_t i = 0; i < DNS_ANOMALY_PROBES; i++) {
+		dns_anomaly_slot_t *slot = (dns_anomaly_slot_t *)((uint8_t *)slots + ((hash + i) & mask) * slot_size);
+		if (slot->hash == hash && matches(slot, key))
+			return slot;
+		// A free slot is as old as it gets
+		uint32_t age = slot->hash == 0 ? UINT32_MAX : now - slot->window.second;
+		if (victim == NULL || age > victim_age) {
+			victim = slot;
+			victim_age = age;
+		}
+	}
+	memset(victim, 0, slot_size);
+	victim->hash = hash;
+	victim->window.second = now;
+	return victim;
+}
+
+static bool zone_matches(const dns_anomaly_slot_t *slot, const void *key) {
+	return strcmp(((const dns_anomaly_zone_t *)slot)->name, key) == 0;
+}
+
+static bool client_matches(const dns_anomaly_slot_t *slot, const void *key) {
+	return memcmp(((const dns_anomaly_client_t *)slot)->address, key, sizeof(((const dns_anomaly_client_t *)slot)->address)) == 0;
+}
+
+static void count_zone(dns_anomaly_t *anomaly, const dns_anomaly_message_t *message, dns_alert_events_t *events) {
+	const char *zone_start = dns_anomaly_zone(message->qname);
+
+	// DNS names are case-insensitive, and some resolvers randomize the case of their queries
+	char name[DNS_NAME_MAXLEN + 1];
+	uint64_t hash = HASH_INITIALIZER;
+	size_t length = 0;
+	for (const char *ptr = zone_start; *ptr != '\0' && length < DNS_NAME_MAXLEN; ptr++) {
+		name[length++] = lowercase(*ptr);
+		hash = hash_update(hash, (uint8_t)name[length - 1]);
+	}
+	name[length] = '\0';
+	hash = HASH_FINAL(hash);
+
+	dns_anomaly_zone_t *zone = (dns_anomaly_zone_t *)table_slot(anomaly->zones, sizeof(dns_anomaly_zone_t),
+		DNS_ANOMALY_ZONES - 1, hash, zone_matches, name, message->now);
+	if (zone->name[0] == '\0')
+		memcpy(zone->name, name, length + 1);
+
+	bool new_second = zone->slot.window.second != message->now;
+	dns_anomaly_bucket_t *bucket = window_advance(&zone->slot.window, zone->labels, message->now);
+	window_count(bucket, message);
+	if (!message->response && zone_start != message->qname) {
+		uint64_t label_hash = HASH_INITIALIZER;
+		for (const char *ptr = message->qname; *ptr != '.'; ptr++)
+			label_hash = hash_update(label_hash, (uint8_t)lowercase(*ptr));
+		uint16_t *bin = &zone->labels[message->now % DNS_ANOMALY_WINDOW][(label_hash ^ (label_hash >> 32)) % DNS_ANOMALY_LABEL_BINS];
+		if (*bin != UINT16_MAX)
+			(*bin)++;
+	}
+	if (new_second)
+		check_zone(&anomaly->thresholds, zone, message->now, events);
+}
+
+static void count_client(dns_anomaly_t *anomaly, const dns_anomaly_message_t *message, dns_alert_events_t *events) {
+	uint64_t hash = HASH_INITIALIZER;
+	for (size_t i = 0; i < sizeof(((dns_anomaly_client_t *)NULL)->address); i++)
+		hash = hash_update(hash, message->client[i]);
+	hash = HASH_FINAL(hash);
+
+	dns_anomaly_client_t *client = (dns_anomaly_client_t *)table_slot(anomaly->clients, sizeof(dns_anomaly_client_t),
+		DNS_ANOMALY_CLIENTS - 1, hash, client_matches, message->client, message->now);
+	memcpy(client->address, message->client, sizeof(client->address));
+
+	bool new_second = client->slot.window.second != message->now;
+	window_count(window_advance(&client->slot.window, NULL, message->now), message);
+	if (new_second)
+		check_client(&anomaly->thresholds, client, message->now, events);
+}
+
+//
+// Operations
+//
+uint32_t dns_anomaly_now(void) {
+	struct timespec ts;
+#ifdef CLOCK_MONOTONIC_COARSE
+	clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+#else
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+#endif
+	return (uint32_t)ts.tv_sec;
+}
+
+bool dns_anomaly_count(dns_anomaly_t *anomaly, const dns_anomaly_message_t *message,
+	output_t *out, stats_counters_t *stats)
+{
+	dns_alert_events_t events;
+	events.count = 0;
+	count_zone(anomaly, message, &events);
+	if (message->family == AF_INET)
+		count_client(anomaly, message, &events);
+	if (events.count == 0)
+		return false;
+	emit_alerts(&events, out, stats);
+	return true;
+}
+
+const char *dns_alert_name(dns_alert_e alert) {
+	if ((unsigned)alert >= DNS_ALERT_COUNT)
+		return "unknown";
+	return g_alert_names[alert];
+}
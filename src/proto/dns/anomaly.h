@@ -0,0 +1,81 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Forward declarations
+typedef struct output output_t;
+typedef struct stats_counters stats_counters_t;
+
+//
+// Anomaly detector
+//
+// Counts the queries and responses of each zone and of each client over a sliding window of
+// DNS_ANOMALY_WINDOW seconds, kept as a ring of one-second buckets. The zone is the registrable
+// suffix of the first question, e.g. `example.co.uk` for `a.b.example.co.uk`. Both tables have
+// a fixed number of slots, allocated up front. A key that finds every slot it probes taken
+// evicts the least recently seen of them, so nothing is allocated per message.
+//
+// The thresholds of a key are checked once per second, on its first message of the second.
+// The alerts are emitted into the record of that message as a `dns-alerts` list, and a key
+// raises the same alert at most once per window.
+//
+#define DNS_ANOMALY_WINDOW			10		// seconds, one bucket each
+#define DNS_ANOMALY_ZONES			2048	// slots, a power of 2
+#define DNS_ANOMALY_CLIENTS			4096	// slots, a power of 2
+#define DNS_ANOMALY_PROBES			8		// slots probed before evicting one
+#define DNS_ANOMALY_LABEL_BINS		32		// of the histogram of leftmost labels, see dns_anomaly_thresholds_t
+
+typedef enum {
+	DNS_ALERT_NXDOMAIN_FLOOD,		// of a zone or a client
+	DNS_ALERT_SERVFAIL_SPIKE,		// of a zone or a client
+	DNS_ALERT_RANDOM_SUBDOMAIN,		// of a zone
+	DNS_ALERT_COUNT
+} dns_alert_e;
+
+// Every count is over the whole window
+typedef struct dns_anomaly_thresholds {
+	uint32_t	nxdomain;			// NXDOMAIN responses
+	uint32_t	nxdomain_percent;	// of the responses
+	uint32_t	servfail;			// SERVFAIL responses
+	uint32_t	servfail_percent;	// of the responses
+	// The leftmost labels below a zone are hashed into DNS_ANOMALY_LABEL_BINS bins. A zone
+	// queried for a handful of names has most of them in a few bins, whereas random labels
+	// spread evenly, towards the maximum entropy of log2(DNS_ANOMALY_LABEL_BINS) bits.
+	uint32_t	subdomain_queries;	// queries with a label below the zone
+	uint32_t	subdomain_millibits; // entropy of their leftmost labels
+} dns_anomaly_thresholds_t;
+
+extern const dns_anomaly_thresholds_t dns_anomaly_default_thresholds;
+
+typedef struct dns_anomaly dns_anomaly_t;
+
+// What the detector needs of a message, none of which is copied
+typedef struct dns_anomaly_message {
+	uint32_t		now;		// seconds, see dns_anomaly_now()
+	const char *	qname;		// of the first question
+	bool			response;
+	uint16_t		rcode;		// of responses, extended by their OPT RR
+	uint8_t			family;		// of the client, AF_INET or 0 if unknown
+	const uint8_t *	client;		// source of queries, destination of responses
+} dns_anomaly_message_t;
+
+//
+// Allocation
+//
+dns_anomaly_t *dns_anomaly_alloc(const dns_anomaly_thresholds_t *thresholds);
+void dns_anomaly_free(dns_anomaly_t *anomaly);
+
+//
+// Operations
+//
+// Monotonic, and coarse enough to be cheap to read for every message
+uint32_t dns_anomaly_now(void);
+// Counts the message, and emits the alerts it brings about into `out`, counting them in `stats`.
+// Returns whether it emitted any.
+bool dns_anomaly_count(dns_anomaly_t *anomaly, const dns_anomaly_message_t *message,
+	output_t *out, stats_counters_t *stats);
+const char *dns_alert_name(dns_alert_e alert);
+// Where the registrable suffix of `name` starts. There's no copy of the Public Suffix List,
+// so it's the last 2 labels, or 3 when they look like `example.co.uk`.
+const char *dns_anomaly_zone(const char *name);
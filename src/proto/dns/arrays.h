@@ -1,7 +1,7 @@
 #pragma once
 
 typedef struct dns_hdr_flags dns_hdr_flags_t; // Forward declaration
-typedef struct pair_array pair_array_t; // Forward declaration
+typedef struct pair_table pair_table_t; // Forward declaration
 
 typedef enum dns_array {
 	DNS_ARRAY_OPCODE,
@@ -11,7 +11,9 @@ typedef enum dns_array {
 	DNSSEC_ARRAY_ALGORITHM
 } dns_array_e;
 
-const pair_array_t *select_array(dns_array_e type);
+const pair_table_t *select_table(dns_array_e type);
+// Returns "UNKNOWN" if `key` has no name.
 const char *totext(dns_array_e type, int key);
+// Case insensitive. Returns -1 if no code has that name.
 int fromtext(dns_array_e type, const char *value);
 const char *flags_totext(const dns_hdr_flags_t *value);
@@ -3,3 +3,16 @@
 #include "proto/dns/header.h"
 #include "proto/dns/sections.h"
 #include <stdint.h>
+
+//
+// Decode levels
+//
+// How far into a message a decoder goes, see sniff_dns_decode(). sniff_dns_fromwire() picks
+// it per message from what's going to be used of it. Each level includes the ones above it,
+// and everything past it is skipped.
+typedef enum {
+	DNS_DECODE_HEADER,		// The 12 bytes of the header, nothing is allocated
+	DNS_DECODE_QUESTION,	// Plus the type and class of the first question, and the OPT RR that the
+							// other RRs are skipped to, still without allocating
+	DNS_DECODE_FULL			// Every section, with its names and RDATA
+} dns_decode_level_e;
@@ -1,38 +1,36 @@
 #include "header.h"
 #include "log.h"
+#include "output.h"
 #include "proto/dns/arrays.h"
 #include "proto/dns/dns.h"
 #include "types/buffer.h"
-#include <arpa/inet.h>
+#include "types/buffer_span.h"
 #include <stdlib.h>
-#include <string.h>
+
+int decode_header(dns_hdr_t *header, buffer_t *buffer) {
+	const uint8_t *span = buffer_read_span(buffer, DNS_HDR_LEN);
+	if (span == NULL) {
+		LOG_WARN("Invalid header");
+		return -1;
+	}
+	header->id = buffer_span_uint16(span, 0);
+	header->flags.single = buffer_span_uint16(span, 2);
+	header->qd_c = buffer_span_uint16(span, 4);
+	header->an_c = buffer_span_uint16(span, 6);
+	header->ns_c = buffer_span_uint16(span, 8);
+	header->ar_c = buffer_span_uint16(span, 10);
+	return 0;
+}
 
 dns_hdr_t *parse_header(buffer_t *buffer) {
 	dns_hdr_t *header = malloc(sizeof(dns_hdr_t));
 	if (header == NULL)
 		return NULL;
-	memset(header, 0, sizeof(dns_hdr_t));
-	{
-		header->id = buffer_read_uint16(buffer);
-		header->flags.single = buffer_read_uint16(buffer);
-		header->qd_c = buffer_read_uint16(buffer);
-		header->an_c = buffer_read_uint16(buffer);
-		header->ns_c = buffer_read_uint16(buffer);
-		header->ar_c = buffer_read_uint16(buffer);
-		if (buffer_has_error(buffer))
-			goto error;
-		header->id = ntohs(header->id);
-		header->flags.single = ntohs(header->flags.single);
-		header->an_c = ntohs(header->an_c);
-		header->qd_c = ntohs(header->qd_c);
-		header->ns_c = ntohs(header->ns_c);
-		header->ar_c = ntohs(header->ar_c);
+	if (decode_header(header, buffer) != 0) {
+		free_header(header);
+		return NULL;
 	}
 	return header;
-error:
-	LOG_WARN("Invalid header");
-	free_header(header);
-	return NULL;
 }
 
 void free_header(dns_hdr_t *header) {
@@ -41,17 +39,15 @@ void free_header(dns_hdr_t *header) {
 	free(header);
 }
 
-void print_header(dns_hdr_t *header) {
-	LOG_PRINTF_INDENT(2, "opcode: %s, status: %s, id: %u\n",
-		totext(DNS_ARRAY_OPCODE, header->flags.expanded.opcode),
-		totext(DNS_ARRAY_RCODE, header->flags.expanded.rcode),
-		header->id);
-	LOG_PRINTF_INDENT(2, "flags: %#x [%s]\n",
-		header->flags.single,
-		flags_totext(&header->flags.expanded));
-	LOG_PRINTF_INDENT(2, "query: %u, answer: %u, authority: %u, additional: %u\n",
-		header->qd_c,
-		header->an_c,
-		header->ns_c,
-		header->ar_c);
+void print_header(dns_hdr_t *header, output_t *out) {
+	output_field_str(out, "opcode", totext(DNS_ARRAY_OPCODE, header->flags.expanded.opcode));
+	output_field_str(out, "status", totext(DNS_ARRAY_RCODE, header->flags.expanded.rcode));
+	output_field_uint(out, "rcode", header->flags.expanded.rcode);
+	output_field_uint(out, "id", header->id);
+	output_field_hex(out, "flags", header->flags.single);
+	output_field_str(out, "flags_text", flags_totext(&header->flags.expanded));
+	output_field_uint(out, "qdcount", header->qd_c);
+	output_field_uint(out, "ancount", header->an_c);
+	output_field_uint(out, "nscount", header->ns_c);
+	output_field_uint(out, "arcount", header->ar_c);
 }
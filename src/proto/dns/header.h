@@ -2,9 +2,11 @@
 
 #include "proto/dns/types.h"
 #include <stdint.h>
+#include <sys/types.h> // for BYTE_ORDER
 
-// Forward declaration
+// Forward declarations
 typedef struct buffer buffer_t;
+typedef struct output output_t;
 
 //
 // References:
@@ -62,6 +64,9 @@ typedef struct dns_hdr {
 
 #define DNS_HDR_LEN 12
 
+// Same as parse_header(), but into `header`, which is usually on the stack. Returns -1 if
+// the message is shorter than the header.
+int decode_header(dns_hdr_t *header, buffer_t *buffer);
 dns_hdr_t *parse_header(buffer_t *buffer);
 void free_header(dns_hdr_t *header);
-void print_header(dns_hdr_t *header);
+void print_header(dns_hdr_t *header, output_t *out);
@@ -1,18 +1,15 @@
 #include "name.h"
 #include "log.h"
 #include "types/buffer.h"
+#include "types/buffer_span.h"
 #include <stdlib.h>
 #include <string.h>
 
-char *parse_name(buffer_t *buffer) {
+int read_name(buffer_t *buffer, char *name) {
 	int label_count = 0;
 	int compressed = 0;
 	size_t total_len = 0, orig_pos = 0, label_len;
 
-	char *name = malloc(DNS_NAME_MAXLEN+1);
-	if (name == NULL)
-		return NULL;
-
 	for (;;) {
 		label_len = buffer_read_uint8(buffer);
 		// LOG_DEBUG("label_len is %zd", label_len);
@@ -24,7 +21,10 @@ char *parse_name(buffer_t *buffer) {
 			break;
 		}
 		if (label_len & DNS_LABEL_COMPRESS_MASK) { // compressed label?
-			compressed++;
+			if (++compressed > DNS_NAME_MAXPOINTERS) {
+				LOG_WARN("DNS name has a compression loop");
+				goto error;
+			}
 			// Get the second byte to complete the 16-bit pointer
 			uint8_t second_byte = buffer_read_uint8(buffer);
 			// LOG_DEBUG("second_byte is %#x", second_byte);
@@ -67,23 +67,71 @@ char *parse_name(buffer_t *buffer) {
 	}
 	if (label_count > 0) {
 		name[total_len - 1] = 0;
-		return name;
-	} else {
-		// LOG_WARN("DNS name has no labels");
-		return NULL;
+		return (int)total_len - 1;
 	}
+	// The root, e.g. the owner of an OPT RR
+	name[0] = '.';
+	name[1] = 0;
+	return 1;
 error:
 	LOG_WARN("DNS name is invalid");
-	free(name);
-	return NULL;
+	return -1;
+}
+
+char *parse_name(buffer_t *buffer) {
+	char *name = malloc(DNS_NAME_MAXLEN+1);
+	if (name == NULL)
+		return NULL;
+	if (read_name(buffer, name) < 0) {
+		free(name);
+		return NULL;
+	}
+	return name;
 }
 
 void free_name(char *name) {
 	free(name);
 }
 
+int read_name_wire(buffer_t *buffer, uint8_t *wire) {
+	int compressed = 0;
+	size_t length = 0, orig_pos = 0;
+
+	for (;;) {
+		const uint8_t *label = buffer_read_span(buffer, 1);
+		if (label == NULL)
+			return -1;
+		if (label[0] == 0) // null label?
+			break;
+		if (label[0] & DNS_LABEL_COMPRESS_MASK) { // compressed label?
+			const uint8_t *second_byte = buffer_read_span(buffer, 1);
+			if (second_byte == NULL || ++compressed > DNS_NAME_MAXPOINTERS)
+				return -1;
+			if (compressed == 1)
+				orig_pos = buffer_tell(buffer);
+			buffer_seek(buffer, ((label[0] & ~DNS_LABEL_COMPRESS_MASK) << 8) | second_byte[0]);
+			if (buffer_has_error(buffer))
+				return -1;
+			continue;
+		}
+		// Room for the label, its length, and the root label
+		if (label[0] > DNS_LABEL_MAXLEN || length + 1 + label[0] + 1 > DNS_NAME_MAXLEN)
+			return -1;
+		const uint8_t *data = buffer_read_span(buffer, label[0]);
+		if (data == NULL)
+			return -1;
+		wire[length] = label[0];
+		memcpy(wire + length + 1, data, label[0]);
+		length += 1 + label[0];
+	}
+	wire[length++] = 0;
+	if (compressed != 0)
+		buffer_seek(buffer, orig_pos);
+	return (int)length;
+}
+
 size_t predict_name_length(buffer_t *buffer) {
-	int label_count = 0;
+	int label_count = 0, compressed = 0;
 	size_t orig_pos, label_len, total_len = 0;
 
 	orig_pos = buffer_tell(buffer);
@@ -96,6 +144,8 @@ size_t predict_name_length(buffer_t *buffer) {
 			break;
 		}
 		if (label_len & DNS_LABEL_COMPRESS_MASK) { // compressed label?
+			if (++compressed > DNS_NAME_MAXPOINTERS)
+				goto error;
 			// Get the second byte to complete the 16-bit pointer
 			uint8_t second_byte = buffer_read_uint8(buffer);
 			if (buffer_has_error(buffer))
@@ -128,3 +178,17 @@ error:
 	return 0;
 }
 
+
+int skip_name(buffer_t *buffer) {
+	for (;;) {
+		const uint8_t *label = buffer_read_span(buffer, 1);
+		if (label == NULL)
+			return -1;
+		if (label[0] == 0) // null label?
+			return 0;
+		if (label[0] & DNS_LABEL_COMPRESS_MASK) // compressed label? Then it's the last one.
+			return buffer_read_span(buffer, 1) != NULL ? 0 : -1;
+		if (label[0] > DNS_LABEL_MAXLEN || buffer_read_span(buffer, label[0]) == NULL)
+			return -1;
+	}
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <stddef.h>
+#include <stdint.h>
 
 typedef struct buffer buffer_t; // Forward declaration
 
@@ -16,7 +17,20 @@ typedef struct buffer buffer_t; // Forward declaration
 #define DNS_LABEL_MAXLEN		63
 // If the top 2 bits are set, the label is compressed
 #define DNS_LABEL_COMPRESS_MASK	(DNS_NAME_MAXLEN - DNS_LABEL_MAXLEN) // = 0xC0 = 0b11000000
+// A name can't have more labels than this, so neither can it legitimately follow more
+// compression pointers. Anything above is a pointer loop.
+#define DNS_NAME_MAXPOINTERS	(DNS_NAME_MAXLEN / 2)
 
+// Same as parse_name(), but into `name`, which must have room for DNS_NAME_MAXLEN+1
+// characters. Returns the length of the name, or -1 if it's malformed.
+int read_name(buffer_t *buffer, char *name);
 char *parse_name(buffer_t *buffer);
+// Copies the name into `wire` in the uncompressed wire format, so it no longer depends on
+// the message. `wire` must have room for DNS_NAME_MAXLEN bytes. Returns the number of bytes
+// written, the root label included, or -1 if the name is malformed.
+int read_name_wire(buffer_t *buffer, uint8_t *wire);
 void free_name(char *name);
 size_t predict_name_length(buffer_t *buffer);
+// Moves past the name without decoding it, nor following its compression pointer.
+// Returns -1 if the name is malformed.
+int skip_name(buffer_t *buffer);
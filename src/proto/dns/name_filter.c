@@ -0,0 +1,297 @@
+#include "name_filter.h"
+#include "log.h"
+#include "proto/dns/name.h"
+#include "types/buffer.h"
+#include "types/buffer_span.h"
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DNS_NAME_FILTER_INITIAL_SLOTS	1024	// a power of 2
+#define DNS_NAME_FILTER_INITIAL_NODES	512
+#define DNS_NAME_FILTER_INITIAL_LABELS	(16 * 1024)
+
+//
+// Types
+//
+typedef struct dns_name_edge {
+	uint32_t	hash;		// 0 if the slot is free
+	uint32_t	parent;		// node
+	uint32_t	child;		// node, never the root
+	uint32_t	label;		// offset of the lowercased label in `labels`
+	uint8_t		length;		// of the label
+} dns_name_edge_t;
+
+struct dns_name_filter {
+	dns_name_edge_t *edges;
+	size_t		slot_count;		// a power of 2
+	size_t		edge_count;
+	bool *		terminal;		// whether a suffix ends at a given node, the root being 0
+	size_t		node_count;
+	size_t		node_capacity;
+	uint8_t *	labels;
+	size_t		labels_used;
+	size_t		labels_size;
+	size_t		suffixes;
+};
+
+//
+// Allocation
+//
+dns_name_filter_t *dns_name_filter_alloc(void) {
+	dns_name_filter_t *filter = calloc(1, sizeof(dns_name_filter_t));
+	if (filter == NULL)
+		return NULL;
+	filter->slot_count = DNS_NAME_FILTER_INITIAL_SLOTS;
+	filter->edges = calloc(filter->slot_count, sizeof(dns_name_edge_t));
+	filter->node_capacity = DNS_NAME_FILTER_INITIAL_NODES;
+	filter->terminal = calloc(filter->node_capacity, sizeof(bool));
+	filter->labels_size = DNS_NAME_FILTER_INITIAL_LABELS;
+	filter->labels = malloc(filter->labels_size);
+	if (filter->edges == NULL || filter->terminal == NULL || filter->labels == NULL) {
+		dns_name_filter_free(filter);
+		return NULL;
+	}
+	filter->node_count = 1; // the root
+	return filter;
+}
+
+void dns_name_filter_free(dns_name_filter_t *filter) {
+	if (filter == NULL)
+		return;
+	free(filter->edges);
+	free(filter->terminal);
+	free(filter->labels);
+	free(filter);
+}
+
+//
+// Edges
+//
+static inline uint8_t lowercase(uint8_t ch) {
+	return ch >= 'A' && ch <= 'Z' ? (uint8_t)(ch + ('a' - 'A')) : ch;
+}
+
+// FNV-1a of the parent and the lowercased label, never 0 as that marks a free slot
+static uint32_t edge_hash(uint32_t parent, const uint8_t *label, uint8_t length) {
+	uint32_t hash = 2166136261u;
+	for (int i = 0; i < 4; i++)
+		hash = (hash ^ (uint8_t)(parent >> (i * 8))) * 16777619u;
+	for (uint8_t i = 0; i < length; i++)
+		hash = (hash ^ lowercase(label[i])) * 16777619u;
+	return hash != 0 ? hash : 1;
+}
+
+static bool edge_equals(const dns_name_filter_t *filter, const dns_name_edge_t *edge,
+	uint32_t hash, uint32_t parent, const uint8_t *label, uint8_t length)
+{
+	if (edge->hash != hash || edge->parent != parent || edge->length != length)
+		return false;
+	const uint8_t *stored = filter->labels + edge->label;
+	for (uint8_t i = 0; i < length; i++) {
+		if (stored[i] != lowercase(label[i]))
+			return false;
+	}
+	return true;
+}
+
+// Returns the child of `parent` through `label`, or 0 if there's none
+static uint32_t find_child(const dns_name_filter_t *filter, uint32_t parent, const uint8_t *label, uint8_t length) {
+	uint32_t hash = edge_hash(parent, label, length);
+	size_t mask = filter->slot_count - 1;
+	for (size_t slot = hash & mask; filter->edges[slot].hash != 0; slot = (slot + 1) & mask) {
+		if (edge_equals(filter, &filter->edges[slot], hash, parent, label, length))
+			return filter->edges[slot].child;
+	}
+	return 0;
+}
+
+static int grow_edges(dns_name_filter_t *filter) {
+	size_t slot_count = filter->slot_count * 2;
+	dns_name_edge_t *edges = calloc(slot_count, sizeof(dns_name_edge_t));
+	if (edges == NULL)
+		return -1;
+	for (size_t i = 0; i < filter->slot_count; i++) {
+		const dns_name_edge_t *edge = &filter->edges[i];
+		if (edge->hash == 0)
+			continue;
+		size_t slot = edge->hash & (slot_count - 1);
+		while (edges[slot].hash != 0)
+			slot = (slot + 1) & (slot_count - 1);
+		edges[slot] = *edge;
+	}
+	free(filter->edges);
+	filter->edges = edges;
+	filter->slot_count = slot_count;
+	return 0;
+}
+
+// Returns the new child of `parent` through `label`, or 0 if memory runs out
+static uint32_t add_child(dns_name_filter_t *filter, uint32_t parent, const uint8_t *label, uint8_t length) {
+	// Keep the load factor under 3/4
+	if ((filter->edge_count + 1) * 4 > filter->slot_count * 3 && grow_edges(filter) < 0)
+		return 0;
+	if (filter->node_count == filter->node_capacity) {
+		bool *terminal = realloc(filter->terminal, filter->node_capacity * 2 * sizeof(bool));
+		if (terminal == NULL)
+			return 0;
+		memset(terminal + filter->node_capacity, 0, filter->node_capacity * sizeof(bool));
+		filter->terminal = terminal;
+		filter->node_capacity *= 2;
+	}
+	if (filter->labels_used + length > filter->labels_size) {
+		uint8_t *labels = realloc(filter->labels, filter->labels_size * 2);
+		if (labels == NULL)
+			return 0;
+		filter->labels = labels;
+		filter->labels_size *= 2;
+	}
+
+	uint32_t hash = edge_hash(parent, label, length);
+	size_t mask = filter->slot_count - 1;
+	size_t slot = hash & mask;
+	while (filter->edges[slot].hash != 0)
+		slot = (slot + 1) & mask;
+	dns_name_edge_t *edge = &filter->edges[slot];
+	edge->hash = hash;
+	edge->parent = parent;
+	edge->child = (uint32_t)filter->node_count++;
+	edge->label = (uint32_t)filter->labels_used;
+	edge->length = length;
+	for (uint8_t i = 0; i < length; i++)
+		filter->labels[filter->labels_used++] = lowercase(label[i]);
+	filter->edge_count++;
+	return edge->child;
+}
+
+//
+// Operations
+//
+int dns_name_filter_add(dns_name_filter_t *filter, const char *suffix) {
+	if (strncmp(suffix, "*.", 2) == 0)
+		suffix += 2;
+	else if (suffix[0] == '.' && suffix[1] != '\0')
+		suffix++;
+	size_t length = strlen(suffix);
+	if (length > 0 && suffix[length - 1] == '.')
+		length--;
+	if (length > DNS_NAME_MAXLEN - 2) // the first length byte and the root label
+		return -1;
+
+	// Split into labels, then walk them from the root down
+	const uint8_t *labels[DNS_NAME_FILTER_MAXLABELS];
+	uint8_t lengths[DNS_NAME_FILTER_MAXLABELS];
+	int count = 0;
+	for (size_t start = 0; start < length; ) {
+		const char *dot = memchr(suffix + start, '.', length - start);
+		size_t end = dot != NULL ? (size_t)(dot - suffix) : length;
+		if (end == start || end - start > DNS_LABEL_MAXLEN || count == DNS_NAME_FILTER_MAXLABELS)
+			return -1;
+		labels[count] = (const uint8_t *)suffix + start;
+		lengths[count++] = (uint8_t)(end - start);
+		start = end + 1;
+		if (dot != NULL && start == length) // an empty last label, e.g. `example..`
+			return -1;
+	}
+
+	uint32_t node = 0;
+	for (int i = count - 1; i >= 0; i--) {
+		uint32_t child = find_child(filter, node, labels[i], lengths[i]);
+		if (child == 0 && (child = add_child(filter, node, labels[i], lengths[i])) == 0)
+			return -1;
+		node = child;
+	}
+	if (!filter->terminal[node]) {
+		filter->terminal[node] = true;
+		filter->suffixes++;
+	}
+	return 0;
+}
+
+int dns_name_filter_load(dns_name_filter_t *filter, const char *path) {
+	FILE *file = fopen(path, "r");
+	if (file == NULL)
+		return -1;
+
+	char *line = NULL;
+	size_t capacity = 0, number = 0;
+	int added = 0;
+	while (getline(&line, &capacity, file) != -1) {
+		number++;
+		char *comment = strchr(line, '#');
+		if (comment != NULL)
+			*comment = '\0';
+		char *word = NULL;
+		for (char *token = strtok(line, " \t\r\n"); token != NULL; token = strtok(NULL, " \t\r\n"))
+			word = token;
+		if (word == NULL)
+			continue;
+		if (dns_name_filter_add(filter, word) < 0) {
+			LOG_WARN("invalid domain suffix '%s' on line %zu of %s", word, number, path);
+			free(line);
+			fclose(file);
+			errno = EINVAL;
+			return -1;
+		}
+		added++;
+	}
+	int error = ferror(file);
+	free(line);
+	fclose(file);
+	if (error) {
+		errno = EIO;
+		return -1;
+	}
+	return added;
+}
+
+size_t dns_name_filter_count(const dns_name_filter_t *filter) {
+	return filter->suffixes;
+}
+
+int dns_name_filter_match(const dns_name_filter_t *filter, buffer_t *buffer) {
+	// The labels come from the leftmost, but the trie is walked from the rightmost
+	const uint8_t *labels[DNS_NAME_FILTER_MAXLABELS];
+	int count = 0, compressed = 0;
+	size_t length = 0;
+	uint32_t orig_pos = 0;
+	for (;;) {
+		const uint8_t *label = buffer_read_span(buffer, 1);
+		if (label == NULL)
+			return -1;
+		if (label[0] == 0) // null label?
+			break;
+		if (label[0] & DNS_LABEL_COMPRESS_MASK) { // compressed label?
+			const uint8_t *second_byte = buffer_read_span(buffer, 1);
+			if (second_byte == NULL || ++compressed > DNS_NAME_MAXPOINTERS)
+				return -1;
+			if (compressed == 1)
+				orig_pos = buffer_tell(buffer);
+			buffer_seek(buffer, ((label[0] & ~DNS_LABEL_COMPRESS_MASK) << 8) | second_byte[0]);
+			if (buffer_has_error(buffer))
+				return -1;
+			continue;
+		}
+		length += 1 + label[0];
+		if (label[0] > DNS_LABEL_MAXLEN || length >= DNS_NAME_MAXLEN || buffer_read_span(buffer, label[0]) == NULL)
+			return -1;
+		labels[count++] = label;
+	}
+	if (compressed != 0)
+		buffer_seek(buffer, orig_pos);
+
+	uint32_t node = 0;
+	if (filter->terminal[node])
+		return 1;
+	for (int i = count - 1; i >= 0; i--) {
+		node = find_child(filter, node, labels[i] + 1, labels[i][0]);
+		if (node == 0)
+			return 0;
+		if (filter->terminal[node])
+			return 1;
+	}
+	return 0;
+}
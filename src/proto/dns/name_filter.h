@@ -0,0 +1,43 @@
+#pragma once
+
+#include <stddef.h>
+
+// Forward declarations
+typedef struct buffer buffer_t;
+
+//
+// Name filter
+//
+// A set of domain suffixes, kept as a trie of labels read from the root down, e.g.
+// `com` -> `example` -> `www`. A suffix matches the name itself and every name below it.
+//
+// The nodes have no child pointers. Each edge of the trie is a slot of a single hash table,
+// keyed by the parent node and the lowercased label, so a lookup costs one probe per label
+// of the name, however many suffixes there are. The names are matched as they are on the
+// wire, without converting them to text first.
+//
+#define DNS_NAME_FILTER_MAXLABELS	128	// in a name of DNS_NAME_MAXLEN bytes
+
+typedef struct dns_name_filter dns_name_filter_t;
+
+//
+// Allocation
+//
+dns_name_filter_t *dns_name_filter_alloc(void);
+void dns_name_filter_free(dns_name_filter_t *filter);
+
+//
+// Operations
+//
+// Adds a suffix in text form. A leading `*.` or `.` and a trailing `.` are ignored, and
+// `.` alone matches every name. Returns -1 if it isn't a valid name, or memory runs out.
+int dns_name_filter_add(dns_name_filter_t *filter, const char *suffix);
+// Adds the last word of every line of `path`, so both plain lists and hosts files work.
+// Blank lines and those starting with `#` are skipped. Returns the number of suffixes added,
+// or -1 and sets errno if the file can't be read or a suffix is invalid.
+int dns_name_filter_load(dns_name_filter_t *filter, const char *path);
+size_t dns_name_filter_count(const dns_name_filter_t *filter);
+// Reads the name at the position of `buffer`, following its compression pointers. Returns 1
+// if it's below one of the suffixes, 0 if it isn't, or -1 if it's malformed. Either way the
+// position is left right after the name.
+int dns_name_filter_match(const dns_name_filter_t *filter, buffer_t *buffer);
@@ -0,0 +1,722 @@
+#include "pdns.h"
+#include "log.h"
+#include "output.h"
+#include "stats.h"
+#include "utils.h" // for utils_in_addr_to_str + utils_in6_addr_to_str
+#include "proto/dns/arrays.h"
+#include "proto/dns/header.h"
+#include "proto/dns/name.h"
+#include "proto/dns/types.h"
+#include "types/buffer.h"
+#include "types/buffer_span.h"
+#include <arpa/inet.h> // for INET6_ADDRSTRLEN
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h> // for strcasecmp
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define DNS_PDNS_INITIAL_SLOTS	4096	// a power of 2
+#define DNS_PDNS_INITIAL_ARENA	(256 * 1024)
+#define DNS_PDNS_ALIGN(size)	(((size) + 7) & ~(size_t)7)
+#define DNS_PDNS_MIN_FORGOTTEN	(DNS_PDNS_MAX_TUPLES / 4) // so that rebuilding the table pays off
+
+//
+// Types
+//
+typedef struct dns_pdns_tuple {
+	uint64_t	hash;		// 0 if the slot is free
+	uint64_t	first_seen;
+	uint64_t	last_seen;
+	uint64_t	count;		// since the last flush
+	uint32_t	data;		// offset of the rrname, followed by the RDATA, in the arena
+	uint16_t	rrtype;
+	uint16_t	rdata_length;
+	uint8_t		rrname_length;
+	bool		dirty;		// changed since the last flush
+} dns_pdns_tuple_t;
+
+struct dns_pdns {
+	int			fd;
+	dns_pdns_tuple_t *slots;
+	size_t		slot_count;	// a power of 2
+	size_t		tuples;
+	size_t		dirty;
+	uint8_t *	arena;		// rrnames, null-terminated, and RDATA
+	size_t		arena_size;
+	size_t		arena_used;
+};
+
+//
+// Keys
+//
+// FNV-1a, never 0 as that marks a free slot
+static uint64_t hash_bytes(uint64_t hash, const uint8_t *data, size_t length) {
+	for (size_t i = 0; i < length; i++)
+		hash = (hash ^ data[i]) * UINT64_C(0x100000001b3);
+	return hash;
+}
+
+static uint64_t tuple_hash(const char *rrname, size_t rrname_length, uint16_t rrtype,
+	const uint8_t *rdata, uint16_t rdata_length)
+{
+	uint8_t type[2] = { (uint8_t)(rrtype >> 8), (uint8_t)rrtype };
+	uint64_t hash = UINT64_C(0xcbf29ce484222325);
+	hash = hash_bytes(hash, (const uint8_t *)rrname, rrname_length + 1);
+	hash = hash_bytes(hash, type, sizeof(type));
+	hash = hash_bytes(hash, rdata, rdata_length);
+	return hash != 0 ? hash : 1;
+}
+
+static inline uint8_t lowercase(uint8_t ch) {
+	return ch >= 'A' && ch <= 'Z' ? (uint8_t)(ch + ('a' - 'A')) : ch;
+}
+
+static int compare_tuples(const char *rrname_a, uint16_t rrtype_a, const uint8_t *rdata_a, uint16_t length_a,
+	const char *rrname_b, uint16_t rrtype_b, const uint8_t *rdata_b, uint16_t length_b)
+{
+	int ret = strcmp(rrname_a, rrname_b);
+	if (ret != 0)
+		return ret;
+	if (rrtype_a != rrtype_b)
+		return rrtype_a < rrtype_b ? -1 : 1;
+	ret = memcmp(rdata_a, rdata_b, length_a < length_b ? length_a : length_b);
+	if (ret != 0)
+		return ret;
+	return length_a == length_b ? 0 : length_a < length_b ? -1 : 1;
+}
+
+//
+// Allocation
+//
+dns_pdns_t *dns_pdns_open(const char *path) {
+	dns_pdns_t *pdns = calloc(1, sizeof(dns_pdns_t));
+	if (pdns == NULL)
+		return NULL;
+	pdns->fd = open(path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+	if (pdns->fd < 0)
+		goto error;
+	pdns->slot_count = DNS_PDNS_INITIAL_SLOTS;
+	pdns->slots = calloc(pdns->slot_count, sizeof(dns_pdns_tuple_t));
+	pdns->arena_size = DNS_PDNS_INITIAL_ARENA;
+	pdns->arena = malloc(pdns->arena_size);
+	if (pdns->slots == NULL || pdns->arena == NULL)
+		goto error;
+	return pdns;
+error:
+	if (pdns->fd >= 0)
+		close(pdns->fd);
+	free(pdns->slots);
+	free(pdns->arena);
+	free(pdns);
+	return NULL;
+}
+
+void dns_pdns_close(dns_pdns_t *pdns) {
+	if (pdns == NULL)
+		return;
+	if (dns_pdns_flush(pdns, (uint64_t)time(NULL)) < 0)
+		LOG_WARN("failed to flush the passive DNS tuples: %s", strerror(errno));
+	close(pdns->fd);
+	free(pdns->slots);
+	free(pdns->arena);
+	free(pdns);
+}
+
+//
+// Table
+//
+// Doubles the number of slots, and moves every tuple to its new slot
+static int grow_slots(dns_pdns_t *pdns) {
+	size_t slot_count = pdns->slot_count * 2;
+	dns_pdns_tuple_t *slots = calloc(slot_count, sizeof(dns_pdns_tuple_t));
+	if (slots == NULL)
+		return -1;
+	for (size_t i = 0; i < pdns->slot_count; i++) {
+		const dns_pdns_tuple_t *tuple = &pdns->slots[i];
+		if (tuple->hash == 0)
+			continue;
+		size_t slot = tuple->hash & (slot_count - 1);
+		while (slots[slot].hash != 0)
+			slot = (slot + 1) & (slot_count - 1);
+		slots[slot] = *tuple;
+	}
+	free(pdns->slots);
+	pdns->slots = slots;
+	pdns->slot_count = slot_count;
+	return 0;
+}
+
+// Returns the offset of `length` bytes of the arena, or -1 if it can't grow any more
+static int64_t arena_reserve(dns_pdns_t *pdns, size_t length) {
+	if (pdns->arena_used + length > pdns->arena_size) {
+		size_t size = pdns->arena_size;
+		while (pdns->arena_used + length > size)
+			size *= 2;
+		if (size > UINT32_MAX)
+			return -1;
+		uint8_t *arena = realloc(pdns->arena, size);
+		if (arena == NULL)
+			return -1;
+		pdns->arena = arena;
+		pdns->arena_size = size;
+	}
+	int64_t offset = (int64_t)pdns->arena_used;
+	pdns->arena_used += length;
+	return offset;
+}
+
+// Forgets the tuples that were flushed and haven't changed since, into a table of the same
+// size and a compacted arena. Returns how many were forgotten, or -1 if memory runs out.
+static int64_t forget_clean(dns_pdns_t *pdns) {
+	dns_pdns_tuple_t *slots = calloc(pdns->slot_count, sizeof(dns_pdns_tuple_t));
+	uint8_t *arena = malloc(pdns->arena_size);
+	if (slots == NULL || arena == NULL) {
+		free(slots);
+		free(arena);
+		return -1;
+	}
+	size_t mask = pdns->slot_count - 1, arena_used = 0, kept = 0;
+	for (size_t i = 0; i < pdns->slot_count; i++) {
+		const dns_pdns_tuple_t *tuple = &pdns->slots[i];
+		if (tuple->hash == 0 || !tuple->dirty)
+			continue;
+		size_t slot = tuple->hash & mask;
+		while (slots[slot].hash != 0)
+			slot = (slot + 1) & mask;
+		slots[slot] = *tuple;
+		size_t length = tuple->rrname_length + 1u + tuple->rdata_length;
+		memcpy(arena + arena_used, pdns->arena + tuple->data, length);
+		slots[slot].data = (uint32_t)arena_used;
+		arena_used += length;
+		kept++;
+	}
+	int64_t forgotten = (int64_t)(pdns->tuples - kept);
+	free(pdns->slots);
+	free(pdns->arena);
+	pdns->slots = slots;
+	pdns->arena = arena;
+	pdns->arena_used = arena_used;
+	pdns->tuples = kept;
+	return forgotten;
+}
+
+int dns_pdns_add(dns_pdns_t *pdns, const char *rrname, uint16_t rrtype,
+	const uint8_t *rdata, uint16_t rdata_length, uint64_t now)
+{
+	size_t rrname_length = strlen(rrname);
+	if (rrname_length > DNS_NAME_MAXLEN)
+		return -1;
+	uint64_t hash = tuple_hash(rrname, rrname_length, rrtype, rdata, rdata_length);
+	size_t mask = pdns->slot_count - 1;
+	size_t slot = hash & mask;
+	for (;; slot = (slot + 1) & mask) {
+		dns_pdns_tuple_t *tuple = &pdns->slots[slot];
+		if (tuple->hash == 0)
+			break;
+		if (tuple->hash != hash || tuple->rrtype != rrtype || tuple->rdata_length != rdata_length
+			|| tuple->rrname_length != rrname_length)
+			continue;
+		const uint8_t *data = pdns->arena + tuple->data;
+		if (memcmp(data, rrname, rrname_length) != 0 || memcmp(data + rrname_length + 1, rdata, rdata_length) != 0)
+			continue;
+		tuple->last_seen = now;
+		tuple->count++;
+		if (!tuple->dirty) {
+			tuple->dirty = true;
+			pdns->dirty++;
+		}
+		return 0;
+	}
+
+	if (pdns->tuples >= DNS_PDNS_MAX_TUPLES) {
+		// Their counts are in the file already, and lookups add up those of every segment.
+		// Until enough of them were flushed, new tuples are dropped, rather than rebuilding
+		// the whole table for each one.
+		if (pdns->tuples - pdns->dirty < DNS_PDNS_MIN_FORGOTTEN || forget_clean(pdns) <= 0)
+			return -1;
+		mask = pdns->slot_count - 1;
+		for (slot = hash & mask; pdns->slots[slot].hash != 0; slot = (slot + 1) & mask)
+			;
+	}
+	int64_t data = arena_reserve(pdns, rrname_length + 1 + rdata_length);
+	if (data < 0)
+		return -1;
+	memcpy(pdns->arena + data, rrname, rrname_length + 1);
+	memcpy(pdns->arena + data + rrname_length + 1, rdata, rdata_length);
+	// Keep the load factor under 3/4
+	if ((pdns->tuples + 1) * 4 > pdns->slot_count * 3) {
+		if (grow_slots(pdns) < 0) {
+			pdns->arena_used = (size_t)data;
+			return -1;
+		}
+		mask = pdns->slot_count - 1;
+		for (slot = hash & mask; pdns->slots[slot].hash != 0; slot = (slot + 1) & mask)
+			;
+	}
+	dns_pdns_tuple_t *tuple = &pdns->slots[slot];
+	tuple->hash = hash;
+	tuple->first_seen = now;
+	tuple->last_seen = now;
+	tuple->count = 1;
+	tuple->data = (uint32_t)data;
+	tuple->rrtype = rrtype;
+	tuple->rdata_length = rdata_length;
+	tuple->rrname_length = (uint8_t)rrname_length;
+	tuple->dirty = true;
+	pdns->tuples++;
+	pdns->dirty++;
+	return 1;
+}
+
+//
+// Answers
+//
+// Expands and lowercases the names of the RDATA of the types that may compress them
+// (RFC 3597, section 4), into `canonical`. Returns its length, 0 if the RDATA is kept
+// as is, or -1 if it's malformed.
+static int canonical_rdata(uint16_t rrtype, buffer_t *rdata, uint8_t *canonical) {
+	int names, fixed_before = 0, fixed_after = 0;
+	switch (rrtype) {
+		case DNS_TYPE_NS:
+		case DNS_TYPE_CNAME:
+		case DNS_TYPE_PTR:
+		case DNS_TYPE_DNAME:
+			names = 1;
+			break;
+		case DNS_TYPE_MX:
+			names = 1;
+			fixed_before = 2; // preference
+			break;
+		case DNS_TYPE_SOA:
+			names = 2;
+			fixed_after = 20; // serial, refresh, retry, expire and minimum
+			break;
+		default:
+			return 0;
+	}
+
+	size_t length = 0;
+	const uint8_t *span = buffer_read_span(rdata, fixed_before);
+	if (span == NULL)
+		return -1;
+	memcpy(canonical, span, fixed_before);
+	length += fixed_before;
+	for (int i = 0; i < names; i++) {
+		int name_length = read_name_wire(rdata, canonical + length);
+		if (name_length < 0)
+			return -1;
+		for (int j = 0; j < name_length; j++)
+			canonical[length + j] = lowercase(canonical[length + j]);
+		length += name_length;
+	}
+	span = buffer_read_span(rdata, fixed_after);
+	if (span == NULL || buffer_remaining(rdata) != 0)
+		return -1;
+	memcpy(canonical + length, span, fixed_after);
+	length += fixed_after;
+	return (int)length;
+}
+
+void dns_pdns_add_answers(dns_pdns_t *pdns, const dns_hdr_t *header, const buffer_t *buffer,
+	uint64_t now, stats_counters_t *stats)
+{
+	// Only the answers that the server stands by
+	if (!header->flags.expanded.qr || header->flags.expanded.rcode != DNS_RC_NOERROR)
+		return;
+	buffer_t peek = *buffer;
+	for (uint16_t i = 0; i < header->qd_c; i++) {
+		if (skip_name(&peek) != 0 || buffer_read_span(&peek, 4) == NULL)
+			return;
+	}
+	for (uint16_t i = 0; i < header->an_c; i++) {
+		char rrname[DNS_NAME_MAXLEN + 1];
+		if (read_name(&peek, rrname) < 0)
+			return;
+		const uint8_t *span = buffer_read_span(&peek, 10);
+		if (span == NULL)
+			return;
+		uint16_t rrtype = buffer_span_uint16(span, 0);
+		uint16_t rrclass = buffer_span_uint16(span, 2);
+		uint16_t rdlen = buffer_span_uint16(span, 8);
+		uint32_t start = buffer_tell(&peek);
+		const uint8_t *rdata = buffer_read_span(&peek, rdlen);
+		if (rdata == NULL)
+			return;
+		if (rrclass != DNS_CLASS_IN)
+			continue;
+
+		// Bounded by the RDATA, but the names may still point anywhere before it
+		buffer_t bounded = peek;
+		bounded.size = start + rdlen;
+		buffer_seek(&bounded, start);
+		uint8_t canonical[2 + DNS_NAME_MAXLEN * 2 + 20];
+		int canonical_length = canonical_rdata(rrtype, &bounded, canonical);
+		if (canonical_length < 0)
+			continue;
+		if (canonical_length > 0) {
+			rdata = canonical;
+			rdlen = (uint16_t)canonical_length;
+		}
+		for (char *ptr = rrname; *ptr != '\0'; ptr++)
+			*ptr = (char)lowercase((uint8_t)*ptr);
+
+		int ret = dns_pdns_add(pdns, rrname, rrtype, rdata, rdlen, now);
+		if (stats == NULL)
+			continue;
+		stats_inc(&stats->dns_pdns_answers);
+		if (ret > 0)
+			stats_inc(&stats->dns_pdns_tuples);
+		else if (ret < 0)
+			stats_inc(&stats->dns_pdns_dropped);
+	}
+}
+
+//
+// Flushing
+//
+static size_t record_size(const dns_pdns_tuple_t *tuple) {
+	return DNS_PDNS_ALIGN(sizeof(dns_pdns_record_t) + tuple->rrname_length + 1 + tuple->rdata_length);
+}
+
+static int compare_records(const dns_pdns_record_t *a, const dns_pdns_record_t *b) {
+	return compare_tuples(dns_pdns_record_rrname(a), a->rrtype, dns_pdns_record_rdata(a), a->rdata_length,
+		dns_pdns_record_rrname(b), b->rrtype, dns_pdns_record_rdata(b), b->rdata_length);
+}
+
+// The records of the segment being built, for sorting its index with qsort()
+static const uint8_t *flushing_segment;
+
+static int compare_index(const void *a, const void *b) {
+	return compare_records(
+		(const dns_pdns_record_t *)(flushing_segment + *(const uint64_t *)a),
+		(const dns_pdns_record_t *)(flushing_segment + *(const uint64_t *)b));
+}
+
+int dns_pdns_flush(dns_pdns_t *pdns, uint64_t now) {
+	if (pdns->dirty == 0)
+		return 0;
+
+	size_t size = sizeof(dns_pdns_segment_t);
+	for (size_t i = 0; i < pdns->slot_count; i++) {
+		if (pdns->slots[i].hash != 0 && pdns->slots[i].dirty)
+			size += record_size(&pdns->slots[i]);
+	}
+	size_t index_offset = size;
+	size += pdns->dirty * sizeof(uint64_t);
+	uint8_t *segment = calloc(1, size);
+	if (segment == NULL)
+		return -1;
+
+	dns_pdns_segment_t *header = (dns_pdns_segment_t *)segment;
+	header->magic = DNS_PDNS_MAGIC;
+	header->version = DNS_PDNS_VERSION;
+	header->size = size;
+	header->count = pdns->dirty;
+	header->index_offset = index_offset;
+	header->flushed_at = now;
+	uint64_t *index = (uint64_t *)(segment + index_offset);
+	size_t offset = sizeof(dns_pdns_segment_t), count = 0;
+	for (size_t i = 0; i < pdns->slot_count; i++) {
+		const dns_pdns_tuple_t *tuple = &pdns->slots[i];
+		if (tuple->hash == 0 || !tuple->dirty)
+			continue;
+		dns_pdns_record_t *record = (dns_pdns_record_t *)(segment + offset);
+		record->first_seen = tuple->first_seen;
+		record->last_seen = tuple->last_seen;
+		record->count = tuple->count;
+		record->rrtype = tuple->rrtype;
+		record->rdata_length = tuple->rdata_length;
+		record->rrname_length = tuple->rrname_length;
+		memcpy(record + 1, pdns->arena + tuple->data, tuple->rrname_length + 1u + tuple->rdata_length);
+		index[count++] = offset;
+		offset += record_size(tuple);
+	}
+	flushing_segment = segment;
+	qsort(index, count, sizeof(index[0]), compare_index);
+
+	// A segment cut short would hide every one appended after it, so whatever was written
+	// of it is cut off again, and the tuples stay dirty for the next flush
+	off_t end = lseek(pdns->fd, 0, SEEK_END);
+	if (end < 0) {
+		free(segment);
+		return -1;
+	}
+	int ret = 0;
+	size_t written = 0;
+	while (written < size) {
+		ssize_t n = write(pdns->fd, segment + written, size - written);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0) {
+			int error = n < 0 ? errno : ENOSPC;
+			if (written > 0 && ftruncate(pdns->fd, end) < 0)
+				LOG_WARN("failed to cut off a partial passive DNS segment: %s", strerror(errno));
+			errno = error;
+			ret = -1;
+			break;
+		}
+		written += (size_t)n;
+	}
+	if (ret == 0) {
+		for (size_t i = 0; i < pdns->slot_count; i++) {
+			pdns->slots[i].dirty = false;
+			pdns->slots[i].count = 0;
+		}
+		pdns->dirty = 0;
+	}
+	free(segment);
+	return ret;
+}
+
+//
+// Reading
+//
+struct dns_pdns_map {
+	const uint8_t *	data;
+	size_t			size;
+	const dns_pdns_segment_t **segments; // oldest first
+	size_t			segment_count;
+};
+
+static bool segment_is_valid(const uint8_t *data, size_t left) {
+	const dns_pdns_segment_t *segment = (const dns_pdns_segment_t *)data;
+	if (left < sizeof(*segment) || segment->magic != DNS_PDNS_MAGIC || segment->version != DNS_PDNS_VERSION)
+		return false;
+	if (segment->size > left || segment->size < sizeof(*segment) || (segment->size & 7) != 0)
+		return false;
+	if (segment->index_offset < sizeof(*segment) || segment->index_offset > segment->size
+		|| (segment->index_offset & 7) != 0
+		|| segment->count > (segment->size - segment->index_offset) / sizeof(uint64_t))
+		return false;
+	const uint64_t *index = (const uint64_t *)(data + segment->index_offset);
+	for (uint64_t i = 0; i < segment->count; i++) {
+		if (index[i] < sizeof(*segment) || index[i] > segment->index_offset - sizeof(dns_pdns_record_t)
+			|| (index[i] & 7) != 0)
+			return false;
+		const dns_pdns_record_t *record = (const dns_pdns_record_t *)(data + index[i]);
+		if (sizeof(*record) + record->rrname_length + 1u + record->rdata_length > segment->index_offset - index[i]
+			|| dns_pdns_record_rrname(record)[record->rrname_length] != '\0')
+			return false;
+	}
+	return true;
+}
+
+dns_pdns_map_t *dns_pdns_map_open(const char *path) {
+	int fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return NULL;
+	struct stat st;
+	if (fstat(fd, &st) < 0) {
+		close(fd);
+		return NULL;
+	}
+	dns_pdns_map_t *map = calloc(1, sizeof(dns_pdns_map_t));
+	if (map == NULL) {
+		close(fd);
+		return NULL;
+	}
+	map->size = (size_t)st.st_size;
+	if (map->size > 0) {
+		void *data = mmap(NULL, map->size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (data == MAP_FAILED) {
+			close(fd);
+			free(map);
+			return NULL;
+		}
+		map->data = data;
+	}
+	close(fd);
+
+	// Validated once, so the lookups can trust the offsets
+	size_t offset = 0, capacity = 0;
+	while (offset < map->size && segment_is_valid(map->data + offset, map->size - offset)) {
+		if (map->segment_count == capacity) {
+			capacity = capacity == 0 ? 16 : capacity * 2;
+			const dns_pdns_segment_t **segments = realloc(map->segments, capacity * sizeof(map->segments[0]));
+			if (segments == NULL) {
+				dns_pdns_map_close(map);
+				return NULL;
+			}
+			map->segments = segments;
+		}
+		const dns_pdns_segment_t *segment = (const dns_pdns_segment_t *)(map->data + offset);
+		map->segments[map->segment_count++] = segment;
+		offset += segment->size;
+	}
+	if (offset < map->size)
+		LOG_WARN("ignoring the last %zu bytes of %s, which aren't a valid segment", map->size - offset, path);
+	return map;
+}
+
+void dns_pdns_map_close(dns_pdns_map_t *map) {
+	if (map == NULL)
+		return;
+	if (map->data != NULL)
+		munmap((void *)map->data, map->size);
+	free(map->segments);
+	free(map);
+}
+
+static const dns_pdns_record_t *segment_record(const dns_pdns_segment_t *segment, uint64_t i) {
+	const uint64_t *index = (const uint64_t *)((const uint8_t *)segment + segment->index_offset);
+	return (const dns_pdns_record_t *)((const uint8_t *)segment + index[i]);
+}
+
+// The record of the same tuple as `record` in `segment`, or NULL
+static const dns_pdns_record_t *find_record(const dns_pdns_segment_t *segment, const dns_pdns_record_t *record) {
+	uint64_t lo = 0, hi = segment->count;
+	while (lo < hi) {
+		uint64_t mid = lo + (hi - lo) / 2;
+		const dns_pdns_record_t *other = segment_record(segment, mid);
+		int ret = compare_records(other, record);
+		if (ret == 0)
+			return other;
+		if (ret < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return NULL;
+}
+
+// Whether a newer segment had the same tuple, in which case it was merged from there
+static bool seen_in_newer(const dns_pdns_map_t *map, size_t newer_than, const dns_pdns_record_t *record) {
+	for (size_t s = newer_than + 1; s < map->segment_count; s++) {
+		if (find_record(map->segments[s], record) != NULL)
+			return true;
+	}
+	return false;
+}
+
+// Copies the newest record of a tuple into `merged`, with the counts of the older segments
+static void merge_records(const dns_pdns_map_t *map, size_t newest, const dns_pdns_record_t *record,
+	dns_pdns_record_t *merged)
+{
+	memcpy(merged, record, sizeof(*record) + record->rrname_length + 1u + record->rdata_length);
+	for (size_t s = 0; s < newest; s++) {
+		const dns_pdns_record_t *older = find_record(map->segments[s], record);
+		if (older == NULL)
+			continue;
+		if (older->first_seen < merged->first_seen)
+			merged->first_seen = older->first_seen;
+		if (older->last_seen > merged->last_seen)
+			merged->last_seen = older->last_seen;
+		merged->count += older->count;
+	}
+}
+
+size_t dns_pdns_map_lookup(const dns_pdns_map_t *map, const char *rrname, dns_pdns_visit_fn visit, void *arg) {
+	char key[DNS_NAME_MAXLEN + 1];
+	size_t length = strlen(rrname);
+	// The names are stored without the trailing dot
+	if (length > 1 && rrname[length - 1] == '.')
+		length--;
+	if (length > DNS_NAME_MAXLEN)
+		return 0;
+	for (size_t i = 0; i < length; i++)
+		key[i] = (char)lowercase((uint8_t)rrname[i]);
+	key[length] = '\0';
+
+	dns_pdns_record_t *merged = malloc(sizeof(dns_pdns_record_t) + DNS_NAME_MAXLEN + 1 + UINT16_MAX);
+	if (merged == NULL)
+		return 0;
+	size_t visited = 0;
+	for (size_t s = map->segment_count; s-- > 0; ) {
+		const dns_pdns_segment_t *segment = map->segments[s];
+		// The first record of `key`
+		uint64_t lo = 0, hi = segment->count;
+		while (lo < hi) {
+			uint64_t mid = lo + (hi - lo) / 2;
+			if (strcmp(dns_pdns_record_rrname(segment_record(segment, mid)), key) < 0)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+		for (; lo < segment->count; lo++) {
+			const dns_pdns_record_t *record = segment_record(segment, lo);
+			if (strcmp(dns_pdns_record_rrname(record), key) != 0)
+				break;
+			if (seen_in_newer(map, s, record))
+				continue;
+			merge_records(map, s, record, merged);
+			visit(merged, arg);
+			visited++;
+		}
+	}
+	free(merged);
+	return visited;
+}
+
+//
+// Printing
+//
+// The names in the RDATA were expanded when the tuple was added, so they're read as is
+static void print_rdata(const dns_pdns_record_t *record, output_t *out) {
+	const uint8_t *rdata = dns_pdns_record_rdata(record);
+	buffer_t buffer = BUFFER_INITIALIZER;
+	buffer_set_data(&buffer, (uint8_t *)rdata, record->rdata_length);
+	char address[INET6_ADDRSTRLEN];
+	char name[DNS_NAME_MAXLEN + 1];
+	switch (record->rrtype) {
+		case DNS_TYPE_A:
+			if (record->rdata_length != 4)
+				break;
+			utils_in_addr_to_str(address, sizeof(address), (const struct in_addr *)rdata);
+			output_field_str(out, "rdata", address);
+			return;
+		case DNS_TYPE_AAAA:
+			if (record->rdata_length != 16)
+				break;
+			utils_in6_addr_to_str(address, sizeof(address), (const struct in6_addr *)rdata);
+			output_field_str(out, "rdata", address);
+			return;
+		case DNS_TYPE_NS:
+		case DNS_TYPE_CNAME:
+		case DNS_TYPE_PTR:
+		case DNS_TYPE_DNAME:
+			if (read_name(&buffer, name) < 0)
+				break;
+			output_field_str(out, "rdata", name);
+			return;
+		case DNS_TYPE_MX:
+			if (record->rdata_length < 2)
+				break;
+			buffer_skip(&buffer, 2);
+			if (read_name(&buffer, name) < 0)
+				break;
+			output_field_uint(out, "preference", buffer_span_uint16(rdata, 0));
+			output_field_str(out, "rdata", name);
+			return;
+		case DNS_TYPE_SOA: {
+			char rname[DNS_NAME_MAXLEN + 1];
+			const uint8_t *span;
+			if (read_name(&buffer, name) < 0 || read_name(&buffer, rname) < 0
+				|| (span = buffer_read_span(&buffer, 20)) == NULL)
+				break;
+			output_field_str(out, "mname", name);
+			output_field_str(out, "rname", rname);
+			output_field_uint(out, "serial", buffer_span_uint32(span, 0));
+			return;
+		}
+		default:
+			break;
+	}
+	output_field_base64(out, "rdata", rdata, record->rdata_length);
+}
+
+void dns_pdns_print_record(const dns_pdns_record_t *record, output_t *out) {
+	output_begin_object(out, "pdns");
+	output_field_str(out, "rrname", dns_pdns_record_rrname(record));
+	output_field_str(out, "rrtype", totext(DNS_ARRAY_QTYPE, record->rrtype));
+	print_rdata(record, out);
+	output_field_uint(out, "first_seen", record->first_seen);
+	output_field_uint(out, "last_seen", record->last_seen);
+	output_field_uint(out, "count", record->count);
+	output_end_object(out);
+}
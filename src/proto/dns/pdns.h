@@ -0,0 +1,108 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Forward declarations
+typedef struct buffer buffer_t;
+typedef struct dns_hdr dns_hdr_t;
+typedef struct output output_t;
+typedef struct stats_counters stats_counters_t;
+
+//
+// Passive DNS
+//
+// Keeps every unique (rrname, rrtype, rdata) tuple seen in the answer sections of responses,
+// with the first and last time it was seen and how many times. The tuples live in a hash
+// table in memory, which is flushed every now and then to an append-only file. Each flush
+// appends a segment with the tuples that changed since the previous one, and how many times
+// they were seen since, so the counts of a tuple add up over the segments that have it.
+// Once the table is full, the tuples that didn't change since the last flush are forgotten
+// to make room, and seen anew if they come back.
+//
+// The rrname is lowercased, and so are the names in the RDATA of the types that may compress
+// them (NS, CNAME, SOA, PTR, MX and DNAME), which are also expanded, so that the RDATA no
+// longer depends on the message it came from.
+//
+#define DNS_PDNS_MAGIC				0x534e4450	// "PDNS" when written in little endian
+#define DNS_PDNS_VERSION			2			// 1 had the counts since the start instead
+#define DNS_PDNS_DEFAULT_INTERVAL	60			// seconds between flushes
+#define DNS_PDNS_MAX_TUPLES			(1 << 20)	// in memory, past which new tuples are dropped, and
+												// counted, until the next flush makes room
+
+//
+// File format
+//
+// Every field is in host byte order, which the magic tells, and the file can be mmap()'ed
+// as is. It's a sequence of segments, each made of:
+//
+//	dns_pdns_segment_t		header
+//	records					each a dns_pdns_record_t followed by its rrname, null-terminated,
+//							and its RDATA, padded to a multiple of 8 bytes
+//	uint64_t index[count]	offsets of the records from the start of the segment, sorted by
+//							rrname, rrtype and RDATA, for binary searches
+//
+// A segment cut short by a failed write is cut off, but one cut short by a crash in the
+// middle of a flush ends the file.
+//
+typedef struct dns_pdns_segment {
+	uint32_t	magic;			// DNS_PDNS_MAGIC
+	uint16_t	version;		// DNS_PDNS_VERSION
+	uint16_t	reserved;
+	uint64_t	size;			// of the whole segment, index included
+	uint64_t	count;			// of records
+	uint64_t	index_offset;	// from the start of the segment
+	uint64_t	flushed_at;		// seconds since the Epoch
+} dns_pdns_segment_t;
+
+typedef struct dns_pdns_record {
+	uint64_t	first_seen;		// seconds since the Epoch
+	uint64_t	last_seen;
+	uint64_t	count;			// since the previous segment
+	uint16_t	rrtype;
+	uint16_t	rdata_length;
+	uint8_t		rrname_length;	// without the null terminator
+	uint8_t		reserved[3];
+} dns_pdns_record_t;
+
+static inline const char *dns_pdns_record_rrname(const dns_pdns_record_t *record) {
+	return (const char *)(record + 1);
+}
+
+static inline const uint8_t *dns_pdns_record_rdata(const dns_pdns_record_t *record) {
+	return (const uint8_t *)(record + 1) + record->rrname_length + 1;
+}
+
+//
+// Writing
+//
+typedef struct dns_pdns dns_pdns_t;
+
+// Creates `path` if it doesn't exist. The segments are appended to whatever it holds.
+dns_pdns_t *dns_pdns_open(const char *path);
+// Flushes whatever is left
+void dns_pdns_close(dns_pdns_t *pdns);
+// Adds the answers of a response, given the buffer right after its header
+void dns_pdns_add_answers(dns_pdns_t *pdns, const dns_hdr_t *header, const buffer_t *buffer,
+	uint64_t now, stats_counters_t *stats);
+// Returns 1 if the tuple is new, 0 if it was seen before, or -1 if the table is full, and
+// too few of its tuples were flushed since they last changed to make room by forgetting them
+int dns_pdns_add(dns_pdns_t *pdns, const char *rrname, uint16_t rrtype,
+	const uint8_t *rdata, uint16_t rdata_length, uint64_t now);
+// Appends the tuples that changed since the last flush. Returns -1 and sets errno on failure,
+// in which case they're kept for the next one.
+int dns_pdns_flush(dns_pdns_t *pdns, uint64_t now);
+
+//
+// Reading
+//
+typedef struct dns_pdns_map dns_pdns_map_t;
+typedef void (*dns_pdns_visit_fn)(const dns_pdns_record_t *record, void *arg);
+
+dns_pdns_map_t *dns_pdns_map_open(const char *path);
+void dns_pdns_map_close(dns_pdns_map_t *map);
+// Visits every tuple of `rrname`, which is matched case-insensitively, as a record with the
+// counts of all the segments. Returns the number of tuples visited.
+size_t dns_pdns_map_lookup(const dns_pdns_map_t *map, const char *rrname, dns_pdns_visit_fn visit, void *arg);
+// Emits `record` as a `pdns` object, with the addresses and names of its RDATA as text
+void dns_pdns_print_record(const dns_pdns_record_t *record, output_t *out);
@@ -1,12 +1,9 @@
-
 #include "reader.h"
-#include "base64.h"
 #include "types/buffer.h"
-#include <stdlib.h>
-#include <string.h>
-#include <stdio.h>
+#include "types/buffer_span.h"
+#include <stdint.h>
 
-uint8_t *read_bytes(buffer_t *from_buffer, int *error, size_t size) {
+const uint8_t *read_bytes(buffer_t *from_buffer, int *error, size_t size) {
     if (from_buffer == NULL || error == NULL) {
         *error = -1; // Invalid parameters
         return NULL;
@@ -17,44 +14,19 @@ uint8_t *read_bytes(buffer_t *from_buffer, int *error, size_t size) {
         return NULL;
     }
 
-    uint8_t *data = malloc(size);
+    // No copy: the bytes stay in the message, which outlives the parsed records
+    const uint8_t *data = size <= UINT32_MAX ? buffer_read_span(from_buffer, (uint32_t)size) : NULL;
     if (data == NULL) {
-        *error = -4; // Memory allocation failed
-        return NULL;
-    }
-
-    int read = buffer_read(from_buffer, data, size);
-    if (read <= 0) {
         *error = -5; // Buffer read failed
-        free(data);
         return NULL;
     }
     return data;
 }
 
-char *read_bytes_and_base64(buffer_t *from_buffer, int *error, size_t size) {
-	uint8_t *data = read_bytes(from_buffer, error, size);
-    if (data == NULL) {
-        // error is already set by read_bytes
-        return NULL;
-    }
-
-    // encode to base64
-    size_t encoded_size = base64_encoded_size(size) + 1; // +1 for null terminator
-    char *encoded = malloc(encoded_size);
-    if (encoded == NULL) {
-        *error = -4; // Memory allocation failed
-        free(data);
-        return NULL;
-    }
-
-    int encode_ret = base64_encode(encoded, encoded_size, data, size);
-    if (encode_ret != 1) {
-        *error = -6; // Base64 encoding failed
-        free(data);
-        free(encoded);
+const uint8_t *read_string(buffer_t *from_buffer, uint8_t *length) {
+    const uint8_t *prefix = buffer_read_span(from_buffer, 1);
+    if (prefix == NULL)
         return NULL;
-    }
-    free(data);
-    return encoded;
+    *length = prefix[0];
+    return buffer_read_span(from_buffer, prefix[0]);
 }
@@ -2,5 +2,8 @@
 
 #include "types/buffer.h"
 
-uint8_t *read_bytes(buffer_t *from_buffer, int *error, size_t size);
-char *read_bytes_and_base64(buffer_t *from_buffer, int *error, size_t size);
+// Returns the next `size` bytes of the message, which remain valid as long as the message.
+const uint8_t *read_bytes(buffer_t *from_buffer, int *error, size_t size);
+// Reads a <character-string>, a length byte followed by that many bytes, which are returned
+// and counted in `length`. Returns NULL if the string overruns the buffer.
+const uint8_t *read_string(buffer_t *from_buffer, uint8_t *length);
@@ -1,13 +1,25 @@
 #include "question.h"
 #include "log.h"
+#include "output.h"
 #include "proto/dns/arrays.h"
 #include "proto/dns/dns.h"
 #include "proto/dns/name.h"
 #include "types/buffer.h"
-#include <arpa/inet.h>
+#include "types/buffer_span.h"
 #include <stdlib.h>
 #include <string.h>
 
+int decode_question_type(buffer_t *buffer, char *name, uint16_t *qtype, uint16_t *qclass) {
+	if (name != NULL ? read_name(buffer, name) < 0 : skip_name(buffer) != 0)
+		return -1;
+	const uint8_t *span = buffer_read_span(buffer, 4);
+	if (span == NULL)
+		return -1;
+	*qtype = buffer_span_uint16(span, 0);
+	*qclass = buffer_span_uint16(span, 2);
+	return 0;
+}
+
 dns_question_t *parse_question(buffer_t *buffer) {
 	dns_question_t *question = malloc(sizeof(dns_question_t));
 	if (question == NULL)
@@ -17,12 +29,11 @@ dns_question_t *parse_question(buffer_t *buffer) {
 		question->name = parse_name(buffer);
 		if (question->name == NULL)
 			goto error;
-		question->qtype = buffer_read_uint16(buffer);
-		question->qclass = buffer_read_uint16(buffer);
-		if (buffer_has_error(buffer))
+		const uint8_t *span = buffer_read_span(buffer, 4);
+		if (span == NULL)
 			goto error;
-		question->qtype = ntohs(question->qtype);
-		question->qclass = ntohs(question->qclass);
+		question->qtype = buffer_span_uint16(span, 0);
+		question->qclass = buffer_span_uint16(span, 2);
 	}
 	return question;
 error:
@@ -38,9 +49,10 @@ void free_question(dns_question_t *question) {
 	free(question);
 }
 
-void print_question(dns_question_t *question) {
-	LOG_PRINTF_INDENT(4, "%s\t\t\t%s\t%s\n",
-		question->name,
-		totext(DNS_ARRAY_QCLASS, question->qclass),
-		totext(DNS_ARRAY_QTYPE, question->qtype));
+void print_question(dns_question_t *question, output_t *out) {
+	output_begin_object(out, NULL);
+	output_field_str(out, "name", question->name);
+	output_field_str(out, "class", totext(DNS_ARRAY_QCLASS, question->qclass));
+	output_field_str(out, "type", totext(DNS_ARRAY_QTYPE, question->qtype));
+	output_end_object(out);
 }
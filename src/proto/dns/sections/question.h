@@ -1,9 +1,11 @@
 #pragma once
 
 #include "proto/dns/types.h"
+#include <stdint.h>
 
 // Forward declarations
 typedef struct buffer buffer_t;
+typedef struct output output_t;
 
 //
 // Question
@@ -14,6 +16,10 @@ typedef struct dns_question {
 	dns_qclass_e	qclass:16; // Class of the query
 } dns_question_t;
 
+// Moves past the question, and reads its type and class. The name is only decoded if `name`
+// isn't NULL, in which case it must have room for DNS_NAME_MAXLEN+1 characters.
+// Returns -1 if the question is malformed.
+int decode_question_type(buffer_t *buffer, char *name, uint16_t *qtype, uint16_t *qclass);
 dns_question_t *parse_question(buffer_t *buffer);
 void free_question(dns_question_t *question);
-void print_question(dns_question_t *question);
+void print_question(dns_question_t *question, output_t *out);
@@ -1,126 +1,94 @@
 #include "rdata.h"
 #include "log.h"
+#include "output.h"
 #include "types/buffer.h"
+#include "types/buffer_span.h"
 #include "proto/dns/sections/rr.h"
 #include "proto/dns/arrays.h"
-#include <stdlib.h>
+#include <string.h>
 
+#define RDATA_OPS(name) { parse_rdata_##name, free_rdata_##name, print_rdata_##name }
+
+// Indexed by type. CAA is the only decoded type above 255, so it's kept apart.
+static const dns_rdata_ops_t g_rdata_ops[] = {
+	[DNS_TYPE_A] =		RDATA_OPS(a),
+	[DNS_TYPE_NS] =		RDATA_OPS(ns),
+	[DNS_TYPE_CNAME] =	RDATA_OPS(cname),
+	[DNS_TYPE_SOA] =	RDATA_OPS(soa),
+	[DNS_TYPE_PTR] =	RDATA_OPS(ptr),
+	[DNS_TYPE_MX] =		RDATA_OPS(mx),
+	[DNS_TYPE_TXT] =	RDATA_OPS(txt),
+	[DNS_TYPE_AAAA] =	RDATA_OPS(aaaa),
+	[DNS_TYPE_SRV] =	RDATA_OPS(srv),
+	[DNS_TYPE_NAPTR] =	RDATA_OPS(naptr),
+	[DNS_QTYPE_OPT] =	RDATA_OPS(opt),
+	[DNS_TYPE_DS] =		RDATA_OPS(ds),
+	[DNS_TYPE_RRSIG] =	RDATA_OPS(rrsig),
+	[DNS_TYPE_NSEC] =	RDATA_OPS(nsec),
+	[DNS_TYPE_DNSKEY] =	RDATA_OPS(dnskey),
+	[DNS_TYPE_NSEC3] =	RDATA_OPS(nsec3),
+	[DNS_TYPE_SVCB] =	RDATA_OPS(svcb),
+	[DNS_TYPE_HTTPS] =	RDATA_OPS(svcb),
+	[DNS_TYPE_SPF] =	RDATA_OPS(txt),
+};
+
+static const dns_rdata_ops_t g_rdata_ops_caa = RDATA_OPS(caa);
+
+const dns_rdata_ops_t *rdata_ops(uint16_t type) {
+	if (type < sizeof(g_rdata_ops) / sizeof(g_rdata_ops[0]) && g_rdata_ops[type].parse != NULL)
+		return &g_rdata_ops[type];
+	if (type == DNS_TYPE_CAA)
+		return &g_rdata_ops_caa;
+	return NULL;
+}
+
+// The RDLENGTH is a hard bound: the parser can't read past the RDATA, and must consume
+// all of it, so the next RR starts where it should no matter what. An RDATA that fails
+// either way is kept undecoded, and doesn't fail the rest of the message.
 int parse_rdata(dns_rr_t *rr, buffer_t *buffer) {
-	switch (rr->qtype) {
-		case DNS_TYPE_A:
-			if (parse_rdata_a(&rr->rdata, buffer) != 0) return -1;
-			break;
-		case DNS_TYPE_AAAA:
-			if (parse_rdata_aaaa(&rr->rdata, buffer) != 0) return -1;
-			break;
-		case DNS_TYPE_NS:
-			if (parse_rdata_ns(&rr->rdata, buffer) != 0) return -1;
-			break;
-		case DNS_TYPE_CNAME:
-			if (parse_rdata_cname(&rr->rdata, buffer) != 0) return -1;
-			break;
-		case DNS_TYPE_SOA:
-			if (parse_rdata_soa(&rr->rdata, buffer) != 0) return -1;
-			break;
-		case DNS_TYPE_PTR:
-			if (parse_rdata_ptr(&rr->rdata, buffer) != 0) return -1;
-			break;
-		case DNS_TYPE_MX:
-			if (parse_rdata_mx(&rr->rdata, buffer) != 0) return -1;
-			break;
-		case DNS_TYPE_TXT:
-			if (parse_rdata_txt(&rr->rdata, buffer) != 0) return -1;
-			break;
-		case DNS_TYPE_RRSIG:
-			if (parse_rdata_rrsig(&rr->rdata, buffer) != 0) return -1;
-			break;
-		case DNS_TYPE_DNSKEY:
-			if (parse_rdata_dnskey(&rr->rdata, buffer) != 0) return -1;
-			break;
-		case DNS_TYPE_NSEC3:
-			break;
-		default:
-			break;
+	uint32_t start = buffer_tell(buffer);
+	rr->rdata_wire = buffer_read_span(buffer, rr->rdlen);
+	if (rr->rdata_wire == NULL) {
+		LOG_WARN("RDATA overruns the message");
+		return -1;
 	}
+	const dns_rdata_ops_t *ops = rdata_ops(rr->qtype);
+	if (ops == NULL)
+		return 0;
+
+	// Compression pointers may still point back into the rest of the message
+	buffer_t bounded = *buffer;
+	bounded.size = start + rr->rdlen;
+	bounded.current = start;
+	if (rr->qtype == DNS_QTYPE_OPT)
+		dns_opt_decode_fixed(&rr->rdata.opt, rr->qclass, rr->ttl);
+	int result = ops->parse(&rr->rdata, &bounded);
+	if (result == 0 && buffer_remaining(&bounded) != 0) {
+		LOG_WARN("RDATA of type %s has %u trailing bytes", totext(DNS_ARRAY_QTYPE, rr->qtype), buffer_remaining(&bounded));
+		result = -1;
+	}
+	if (result != 0) {
+		LOG_WARN("failed to decode RDATA of type %s", totext(DNS_ARRAY_QTYPE, rr->qtype));
+		ops->free(&rr->rdata);
+		memset(&rr->rdata, 0, sizeof(rr->rdata));
+		return 0;
+	}
+	rr->ops = ops;
 	return 0;
 }
 
 void free_rdata(dns_rr_t *rr) {
-	switch (rr->qtype) {
-		case DNS_TYPE_A:
-			free_rdata_a(&rr->rdata);
-			break;
-		case DNS_TYPE_AAAA:
-			free_rdata_aaaa(&rr->rdata);
-			break;
-		case DNS_TYPE_NS:
-			free_rdata_ns(&rr->rdata);
-			break;
-		case DNS_TYPE_CNAME:
-			free_rdata_cname(&rr->rdata);
-			break;
-		case DNS_TYPE_SOA:
-			free_rdata_soa(&rr->rdata);
-			break;
-		case DNS_TYPE_PTR:
-			free_rdata_ptr(&rr->rdata);
-			break;
-		case DNS_TYPE_MX:
-			free_rdata_mx(&rr->rdata);
-			break;
-		case DNS_TYPE_TXT:
-			free_rdata_txt(&rr->rdata);
-			break;
-		case DNS_TYPE_RRSIG:
-			free_rdata_rrsig(&rr->rdata);
-			break;
-		case DNS_TYPE_DNSKEY:
-			free_rdata_dnskey(&rr->rdata);
-			break;
-		case DNS_TYPE_NSEC3:
-			break;
-		default:
-			break;
-	}
+	if (rr->ops != NULL)
+		rr->ops->free(&rr->rdata);
 }
 
-void print_rdata(dns_rr_t *rr) {
-	switch (rr->qtype) {
-		case DNS_TYPE_A:
-			print_rdata_a(&rr->rdata);
-			break;
-		case DNS_TYPE_AAAA:
-			print_rdata_aaaa(&rr->rdata);
-			break;
-		case DNS_TYPE_NS:
-			print_rdata_ns(&rr->rdata);
-			break;
-		case DNS_TYPE_CNAME:
-			print_rdata_cname(&rr->rdata);
-			break;
-		case DNS_TYPE_SOA:
-			print_rdata_soa(&rr->rdata);
-			break;
-		case DNS_TYPE_PTR:
-			print_rdata_ptr(&rr->rdata);
-			break;
-		case DNS_TYPE_MX:
-			print_rdata_mx(&rr->rdata);
-			break;
-		case DNS_TYPE_TXT:
-			print_rdata_txt(&rr->rdata);
-			break;
-		case DNS_TYPE_RRSIG:
-			print_rdata_rrsig(&rr->rdata);
-			break;
-		case DNS_TYPE_DNSKEY:
-			print_rdata_dnskey(&rr->rdata);
-			break;
-		case DNS_TYPE_NSEC3:
-			break;
-		default:
-			//LOG_PRINTF("\n");
-			LOG_WARN("Unhandled qtype (%u -> %s)", rr->qtype, totext(DNS_ARRAY_QTYPE, rr->qtype));
-			break;
+void print_rdata(dns_rr_t *rr, output_t *out) {
+	if (rr->ops != NULL) {
+		rr->ops->print(&rr->rdata, out);
+		return;
 	}
+	// Undecoded, as in RFC 3597
+	if (rdata_ops(rr->qtype) != NULL)
+		output_field_str(out, "error", "malformed");
+	output_field_base64(out, "data", rr->rdata_wire, rr->rdlen);
 }
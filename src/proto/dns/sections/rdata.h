@@ -2,18 +2,27 @@
 
 #include "proto/dns/sections/rdata/a.h"
 #include "proto/dns/sections/rdata/aaaa.h"
+#include "proto/dns/sections/rdata/caa.h"
 #include "proto/dns/sections/rdata/cname.h"
 #include "proto/dns/sections/rdata/dnskey.h"
+#include "proto/dns/sections/rdata/ds.h"
 #include "proto/dns/sections/rdata/mx.h"
+#include "proto/dns/sections/rdata/naptr.h"
 #include "proto/dns/sections/rdata/ns.h"
+#include "proto/dns/sections/rdata/nsec.h"
+#include "proto/dns/sections/rdata/nsec3.h"
+#include "proto/dns/sections/rdata/opt.h"
 #include "proto/dns/sections/rdata/ptr.h"
 #include "proto/dns/sections/rdata/rrsig.h"
 #include "proto/dns/sections/rdata/soa.h"
+#include "proto/dns/sections/rdata/srv.h"
+#include "proto/dns/sections/rdata/svcb.h"
 #include "proto/dns/sections/rdata/txt.h"
 
 // Forward declarations
 typedef struct buffer buffer_t;
 typedef struct dns_rr dns_rr_t;
+typedef struct output output_t;
 
 //
 // RDATA
@@ -27,10 +36,29 @@ typedef union dns_rdata {
 	dns_rdata_ptr_t			ptr;
 	dns_rdata_mx_t			mx;
 	dns_rdata_txt_t			txt;
+	dns_rdata_opt_t			opt;
+	dns_rdata_srv_t			srv;
+	dns_rdata_naptr_t		naptr;
+	dns_rdata_caa_t			caa;
+	dns_rdata_svcb_t		svcb;	// also HTTPS
 	dnssec_rdata_rrsig_t	rrsig;
 	dnssec_rdata_dnskey_t	dnskey;
+	dnssec_rdata_ds_t		ds;
+	dnssec_rdata_nsec_t		nsec;
+	dnssec_rdata_nsec3_t	nsec3;
 } dns_rdata_t;
 
+// How to decode the RDATA of a given type. `parse` is handed a buffer that ends with
+// the RDATA, so types with a variable-length tail take what's left of it.
+typedef struct dns_rdata_ops {
+	int (*parse)(dns_rdata_t *rdata, buffer_t *buffer);
+	void (*free)(dns_rdata_t *rdata);
+	void (*print)(dns_rdata_t *rdata, output_t *out);
+} dns_rdata_ops_t;
+
+// Returns NULL if the type isn't decoded
+const dns_rdata_ops_t *rdata_ops(uint16_t type);
+
 int parse_rdata(dns_rr_t *rr, buffer_t *buffer);
 void free_rdata(dns_rr_t *rr);
-void print_rdata(dns_rr_t *rr);
+void print_rdata(dns_rr_t *rr, output_t *out);
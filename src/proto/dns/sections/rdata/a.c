@@ -1,16 +1,19 @@
 #include "a.h"
 #include "log.h"
+#include "output.h"
 #include "types/buffer.h"
+#include "types/buffer_span.h"
 #include "proto/dns/sections/rdata.h"
 #include "utils.h" // for utils_in_addr_to_str
 #include <arpa/inet.h> // for INET_ADDRSTRLEN
 
 int parse_rdata_a(dns_rdata_t *rdata, buffer_t *buffer) {
-	rdata->a.address[0] = buffer_read_uint32(buffer);
-	if (buffer_has_error(buffer)) {
+	const uint8_t *span = buffer_read_span(buffer, sizeof(rdata->a.address));
+	if (span == NULL) {
 		LOG_WARN("detected an error in the buffer while reading RR of type A");
 		return -1;
 	}
+	memcpy(rdata->a.address, span, sizeof(rdata->a.address)); // kept in network byte order
 	return 0;
 }
 
@@ -18,8 +21,8 @@ void free_rdata_a(dns_rdata_t *rdata) {
     // Nothing to do
 }
 
-void print_rdata_a(dns_rdata_t *rdata) {
+void print_rdata_a(dns_rdata_t *rdata, output_t *out) {
 	char ip_as_str[INET_ADDRSTRLEN];
 	const char *ip_addr = utils_in_addr_to_str(ip_as_str, sizeof(ip_as_str), (struct in_addr *)rdata->a.address);
-	LOG_PRINTF("%s\n", ip_addr);
+	output_field_str(out, "address", ip_addr);
 }
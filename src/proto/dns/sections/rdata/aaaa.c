@@ -1,18 +1,20 @@
 #include "aaaa.h"
 #include "log.h"
+#include "output.h"
 #include "types/buffer.h"
+#include "types/buffer_span.h"
 #include "proto/dns/sections/rdata.h"
 #include "utils.h" // for utils_in6_addr_to_str
 #include <arpa/inet.h> // for INET6_ADDRSTRLEN
+#include <string.h>
 
 int parse_rdata_aaaa(dns_rdata_t *rdata, buffer_t *buffer) {
-	for (size_t i=0; i<4; i++) {
-		rdata->aaaa.address[i] = buffer_read_uint32(buffer);
-		if (buffer_has_error(buffer)) {
-			LOG_WARN("detected an error in the buffer while reading RR of type AAAA");
-			return -1;
-		}
+	const uint8_t *span = buffer_read_span(buffer, sizeof(rdata->aaaa.address));
+	if (span == NULL) {
+		LOG_WARN("detected an error in the buffer while reading RR of type AAAA");
+		return -1;
 	}
+	memcpy(rdata->aaaa.address, span, sizeof(rdata->aaaa.address)); // kept in network byte order
 	return 0;
 }
 
@@ -20,8 +22,8 @@ void free_rdata_aaaa(dns_rdata_t *rdata) {
     // Nothing to do
 }
 
-void print_rdata_aaaa(dns_rdata_t *rdata) {
+void print_rdata_aaaa(dns_rdata_t *rdata, output_t *out) {
 	char ip_as_str[INET6_ADDRSTRLEN];
 	const char *ip_addr = utils_in6_addr_to_str(ip_as_str, sizeof(ip_as_str), (struct in6_addr *)rdata->aaaa.address);
-	LOG_PRINTF("%s\n", ip_addr);
+	output_field_str(out, "address", ip_addr);
 }
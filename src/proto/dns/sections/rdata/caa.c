@@ -0,0 +1,42 @@
+#include "caa.h"
+#include "log.h"
+#include "macros.h"
+#include "output.h"
+#include "types/buffer.h"
+#include "types/buffer_span.h"
+#include "proto/dns/sections/rdata.h"
+#include "reader.h"
+
+int parse_rdata_caa(dns_rdata_t *rdata, buffer_t *buffer) {
+	const uint8_t *span = buffer_read_span(buffer, 1);
+	if (span == NULL)
+		goto error;
+	rdata->caa.flags = buffer_span_uint8(span, 0);
+	rdata->caa.tag = read_string(buffer, &rdata->caa.tag_length);
+	if (rdata->caa.tag == NULL || rdata->caa.tag_length == 0)
+		goto error;
+
+	// The value takes up the rest of the RDATA
+	size_t value_size = buffer_remaining(buffer);
+	int read_error = 0;
+	rdata->caa.value = read_bytes(buffer, &read_error, value_size);
+	rdata->caa.value_length = (uint16_t)value_size;
+	if (read_error != 0)
+		goto error;
+	return 0;
+error:
+	LOG_WARN("detected an error in the buffer while reading RR of type CAA");
+	return -1;
+}
+
+void free_rdata_caa(dns_rdata_t *rdata) {
+	UNUSED(rdata); // Nothing to do
+}
+
+void print_rdata_caa(dns_rdata_t *rdata, output_t *out) {
+	output_field_uint(out, "flags", rdata->caa.flags);
+	if (rdata->caa.flags & 0x80)
+		output_field_uint(out, "critical", 1);
+	output_field_strn(out, "tag", (const char *)rdata->caa.tag, rdata->caa.tag_length);
+	output_field_strn(out, "value", (const char *)rdata->caa.value, rdata->caa.value_length);
+}
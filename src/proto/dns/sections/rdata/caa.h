@@ -0,0 +1,24 @@
+#pragma once
+
+#include <stdint.h>
+
+// Forward declarations
+typedef struct buffer buffer_t;
+typedef union dns_rdata dns_rdata_t;
+typedef struct output output_t;
+
+//
+// CAA
+//
+// REFERENCE: https://datatracker.ietf.org/doc/html/rfc8659#section-4.1
+typedef struct dns_rdata_caa {
+	uint8_t		flags;		// Bit 7 is Issuer Critical
+	uint8_t		tag_length;
+	uint16_t	value_length;
+	const uint8_t *	tag;	// e.g. "issue", points into the message
+	const uint8_t *	value;	// Points into the message
+} dns_rdata_caa_t;
+
+int parse_rdata_caa(dns_rdata_t *rdata, buffer_t *buffer);
+void free_rdata_caa(dns_rdata_t *rdata);
+void print_rdata_caa(dns_rdata_t *rdata, output_t *out);
@@ -1,5 +1,6 @@
 #include "cname.h"
 #include "log.h"
+#include "output.h"
 #include "types/buffer.h"
 #include "proto/dns/name.h"
 #include "proto/dns/sections/rdata.h"
@@ -17,6 +18,6 @@ void free_rdata_cname(dns_rdata_t *rdata) {
     free_name(rdata->cname.name);
 }
 
-void print_rdata_cname(dns_rdata_t *rdata) {
-	LOG_PRINTF("%s\n", rdata->cname.name);
+void print_rdata_cname(dns_rdata_t *rdata, output_t *out) {
+	output_field_str(out, "cname", rdata->cname.name);
 }
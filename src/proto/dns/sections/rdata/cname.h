@@ -5,6 +5,7 @@
 // Forward declarations
 typedef struct buffer buffer_t;
 typedef union dns_rdata dns_rdata_t;
+typedef struct output output_t;
 
 //
 // CNAME
@@ -15,4 +16,4 @@ typedef struct dns_rdata_cname {
 
 int parse_rdata_cname(dns_rdata_t *rdata, buffer_t *buffer);
 void free_rdata_cname(dns_rdata_t *rdata);
-void print_rdata_cname(dns_rdata_t *rdata);
+void print_rdata_cname(dns_rdata_t *rdata, output_t *out);
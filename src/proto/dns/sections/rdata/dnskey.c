@@ -1,25 +1,32 @@
 #include "dnskey.h"
 #include "log.h"
+#include "macros.h"
+#include "output.h"
 #include "types/buffer.h"
+#include "types/buffer_span.h"
 #include "proto/dns/sections/rdata.h"
 #include "proto/dns/arrays.h"
 #include "reader.h"
-#include <arpa/inet.h> // for ntohs
-#include <stdlib.h>
 
-char *read_public_key(buffer_t *from_buffer, int *error, size_t size) {
-	return read_bytes_and_base64(from_buffer, error, size);
+const uint8_t *read_public_key(buffer_t *from_buffer, int *error, size_t size) {
+	return read_bytes(from_buffer, error, size);
 }
 
 int parse_rdata_dnskey(dns_rdata_t *rdata, buffer_t *buffer) {
-	rdata->dnskey.flags = buffer_read_uint16(buffer);
-	rdata->dnskey.protocol = buffer_read_uint8(buffer);
-	rdata->dnskey.algorithm = buffer_read_uint8(buffer);
+	const uint8_t *span = buffer_read_span(buffer, 4);
+	if (span == NULL) {
+		LOG_WARN("detected an error in the buffer while reading RR of type DNSKEY");
+		return -1;
+	}
+	rdata->dnskey.flags = buffer_span_uint16(span, 0);
+	rdata->dnskey.protocol = buffer_span_uint8(span, 2);
+	rdata->dnskey.algorithm = buffer_span_uint8(span, 3);
 
-	// TODO(jweyrich): Figure out sizes depending on algorithm
-	size_t public_key_size = 64;
+	// Its size depends on the algorithm, but it takes up the rest of the RDATA anyway
+	size_t public_key_size = buffer_remaining(buffer);
 	int read_error = 0;
 	rdata->dnskey.public_key = read_public_key(buffer, &read_error, public_key_size);
+	rdata->dnskey.public_key_length = (uint16_t)public_key_size;
 	if (read_error != 0) {
 		LOG_WARN("error while reading DNSKEY public key: %d", read_error);
 		return -1;
@@ -28,26 +35,24 @@ int parse_rdata_dnskey(dns_rdata_t *rdata, buffer_t *buffer) {
 		LOG_WARN("detected an error in the buffer while reading RR of type DNSKEY");
 		return -1;
 	}
-
-	rdata->dnskey.flags = ntohs(rdata->dnskey.flags);
 	return 0;
 }
 
 void free_rdata_dnskey(dns_rdata_t *rdata) {
-    free(rdata->dnskey.public_key);
+    UNUSED(rdata); // Nothing to do
 }
 
-void print_rdata_dnskey(dns_rdata_t *rdata) {
-	LOG_PRINTF("%s %s %s %u %s\n",
-		// If bit 15 has value 1, then the DNSKEY record holds a
-		// key intended for use as a secure entry point
-		(rdata->dnskey.flags & 0x8000) ? "SEP" : "",
-		// If bit 7 has value 1, then the DNSKEY record holds a DNS zone key
-		// If bit 7 has value 0, then the DNSKEY record holds some other type of
-		// DNS public key and MUST NOT be used to verify RRSIGs that cover RRsets.
-		(rdata->dnskey.flags & 0x0100) ? "ZONE" : "",
-		totext(DNSSEC_ARRAY_ALGORITHM, rdata->dnskey.algorithm),
-		rdata->dnskey.flags,
-		rdata->dnskey.public_key
-	);
+void print_rdata_dnskey(dns_rdata_t *rdata, output_t *out) {
+	// If bit 15 has value 1, then the DNSKEY record holds a
+	// key intended for use as a secure entry point
+	if (rdata->dnskey.flags & 0x8000)
+		output_field_uint(out, "sep", 1);
+	// If bit 7 has value 1, then the DNSKEY record holds a DNS zone key
+	// If bit 7 has value 0, then the DNSKEY record holds some other type of
+	// DNS public key and MUST NOT be used to verify RRSIGs that cover RRsets.
+	if (rdata->dnskey.flags & 0x0100)
+		output_field_uint(out, "zone", 1);
+	output_field_str(out, "algorithm", totext(DNSSEC_ARRAY_ALGORITHM, rdata->dnskey.algorithm));
+	output_field_uint(out, "flags", rdata->dnskey.flags);
+	output_field_base64(out, "public_key", rdata->dnskey.public_key, rdata->dnskey.public_key_length);
 }
@@ -5,6 +5,7 @@
 // Forward declarations
 typedef struct buffer buffer_t;
 typedef union dns_rdata dns_rdata_t;
+typedef struct output output_t;
 
 //
 // DNSKEY
@@ -14,9 +15,10 @@ typedef struct dnssec_dnskey {
 	uint16_t	flags;		// Flags
 	uint8_t		protocol;	// Protocol
 	uint8_t		algorithm;	// Algorithm
-	char *		public_key;	// Public key
+	const uint8_t *	public_key;	// Public key, points into the message
+	uint16_t	public_key_length;
 } dnssec_rdata_dnskey_t;
 
 int parse_rdata_dnskey(dns_rdata_t *rdata, buffer_t *buffer);
 void free_rdata_dnskey(dns_rdata_t *rdata);
-void print_rdata_dnskey(dns_rdata_t *rdata);
+void print_rdata_dnskey(dns_rdata_t *rdata, output_t *out);
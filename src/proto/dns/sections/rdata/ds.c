@@ -0,0 +1,42 @@
+#include "ds.h"
+#include "log.h"
+#include "macros.h"
+#include "output.h"
+#include "types/buffer.h"
+#include "types/buffer_span.h"
+#include "proto/dns/sections/rdata.h"
+#include "proto/dns/arrays.h"
+#include "reader.h"
+
+int parse_rdata_ds(dns_rdata_t *rdata, buffer_t *buffer) {
+	const uint8_t *span = buffer_read_span(buffer, 4);
+	if (span == NULL) {
+		LOG_WARN("detected an error in the buffer while reading RR of type DS");
+		return -1;
+	}
+	rdata->ds.key_tag = buffer_span_uint16(span, 0);
+	rdata->ds.algorithm = buffer_span_uint8(span, 2);
+	rdata->ds.digest_type = buffer_span_uint8(span, 3);
+
+	// The digest takes up the rest of the RDATA
+	size_t digest_size = buffer_remaining(buffer);
+	int read_error = 0;
+	rdata->ds.digest = read_bytes(buffer, &read_error, digest_size);
+	rdata->ds.digest_length = (uint16_t)digest_size;
+	if (read_error != 0) {
+		LOG_WARN("error while reading DS digest: %d", read_error);
+		return -1;
+	}
+	return 0;
+}
+
+void free_rdata_ds(dns_rdata_t *rdata) {
+	UNUSED(rdata); // Nothing to do
+}
+
+void print_rdata_ds(dns_rdata_t *rdata, output_t *out) {
+	output_field_uint(out, "key_tag", rdata->ds.key_tag);
+	output_field_str(out, "algorithm", totext(DNSSEC_ARRAY_ALGORITHM, rdata->ds.algorithm));
+	output_field_uint(out, "digest_type", rdata->ds.digest_type);
+	output_field_hexstr(out, "digest", rdata->ds.digest, rdata->ds.digest_length);
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <stdint.h>
+
+// Forward declarations
+typedef struct buffer buffer_t;
+typedef union dns_rdata dns_rdata_t;
+typedef struct output output_t;
+
+//
+// DS
+//
+// REFERENCE: https://datatracker.ietf.org/doc/html/rfc4034#section-5.1
+typedef struct dnssec_ds {
+	uint16_t	key_tag;		// Of the DNSKEY it refers to
+	uint8_t		algorithm;		// Of the DNSKEY it refers to
+	uint8_t		digest_type;	// 1 = SHA-1, 2 = SHA-256, 4 = SHA-384
+	const uint8_t *	digest;		// Points into the message
+	uint16_t	digest_length;
+} dnssec_rdata_ds_t;
+
+int parse_rdata_ds(dns_rdata_t *rdata, buffer_t *buffer);
+void free_rdata_ds(dns_rdata_t *rdata);
+void print_rdata_ds(dns_rdata_t *rdata, output_t *out);
@@ -1,22 +1,23 @@
 #include "mx.h"
 #include "log.h"
+#include "output.h"
 #include "types/buffer.h"
+#include "types/buffer_span.h"
 #include "proto/dns/name.h"
 #include "proto/dns/sections/rdata.h"
-#include <netinet/in.h> // for ntohs
 
 int parse_rdata_mx(dns_rdata_t *rdata, buffer_t *buffer) {
-	rdata->mx.preference = buffer_read_uint16(buffer);
-	if (buffer_has_error(buffer)) {
+	const uint8_t *span = buffer_read_span(buffer, 2);
+	if (span == NULL) {
 		LOG_WARN("detected an error in the buffer while reading RR of type MX");
 		return -1;
 	}
+	rdata->mx.preference = buffer_span_uint16(span, 0);
 	rdata->mx.exchange = parse_name(buffer);
 	if (rdata->mx.exchange == NULL) {
 		LOG_WARN("MX exchange is NULL");
 		return -1;
 	}
-	rdata->mx.preference = ntohs(rdata->mx.preference);
 	return 0;
 }
 
@@ -24,8 +25,7 @@ void free_rdata_mx(dns_rdata_t *rdata) {
     free_name(rdata->mx.exchange);
 }
 
-void print_rdata_mx(dns_rdata_t *rdata) {
-	LOG_PRINTF("%u\t%s\n",
-		rdata->mx.preference,
-		rdata->mx.exchange);
+void print_rdata_mx(dns_rdata_t *rdata, output_t *out) {
+	output_field_uint(out, "preference", rdata->mx.preference);
+	output_field_str(out, "exchange", rdata->mx.exchange);
 }
@@ -5,6 +5,7 @@
 // Forward declarations
 typedef struct buffer buffer_t;
 typedef union dns_rdata dns_rdata_t;
+typedef struct output output_t;
 
 //
 // MX
@@ -16,4 +17,4 @@ typedef struct dns_rdata_mx {
 
 int parse_rdata_mx(dns_rdata_t *rdata, buffer_t *buffer);
 void free_rdata_mx(dns_rdata_t *rdata);
-void print_rdata_mx(dns_rdata_t *rdata);
+void print_rdata_mx(dns_rdata_t *rdata, output_t *out);
@@ -0,0 +1,49 @@
+#include "naptr.h"
+#include "log.h"
+#include "output.h"
+#include "types/buffer.h"
+#include "types/buffer_span.h"
+#include "proto/dns/name.h"
+#include "proto/dns/sections/rdata.h"
+#include "reader.h"
+
+int parse_rdata_naptr(dns_rdata_t *rdata, buffer_t *buffer) {
+	dns_rdata_naptr_t *naptr = &rdata->naptr;
+	const uint8_t *span = buffer_read_span(buffer, 4);
+	if (span == NULL)
+		goto error;
+	naptr->order = buffer_span_uint16(span, 0);
+	naptr->preference = buffer_span_uint16(span, 2);
+	naptr->flags = read_string(buffer, &naptr->flags_length);
+	if (naptr->flags == NULL)
+		goto error;
+	naptr->services = read_string(buffer, &naptr->services_length);
+	if (naptr->services == NULL)
+		goto error;
+	naptr->regexp = read_string(buffer, &naptr->regexp_length);
+	if (naptr->regexp == NULL)
+		goto error;
+	naptr->replacement = parse_name(buffer);
+	if (naptr->replacement == NULL) {
+		LOG_WARN("NAPTR replacement is NULL");
+		return -1;
+	}
+	return 0;
+error:
+	LOG_WARN("detected an error in the buffer while reading RR of type NAPTR");
+	return -1;
+}
+
+void free_rdata_naptr(dns_rdata_t *rdata) {
+	free_name(rdata->naptr.replacement);
+}
+
+void print_rdata_naptr(dns_rdata_t *rdata, output_t *out) {
+	const dns_rdata_naptr_t *naptr = &rdata->naptr;
+	output_field_uint(out, "order", naptr->order);
+	output_field_uint(out, "preference", naptr->preference);
+	output_field_strn(out, "flags", (const char *)naptr->flags, naptr->flags_length);
+	output_field_strn(out, "services", (const char *)naptr->services, naptr->services_length);
+	output_field_strn(out, "regexp", (const char *)naptr->regexp, naptr->regexp_length);
+	output_field_str(out, "replacement", naptr->replacement);
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <stdint.h>
+
+// Forward declarations
+typedef struct buffer buffer_t;
+typedef union dns_rdata dns_rdata_t;
+typedef struct output output_t;
+
+//
+// NAPTR
+//
+// REFERENCE: https://datatracker.ietf.org/doc/html/rfc3403#section-4.1
+typedef struct dns_rdata_naptr {
+	uint16_t	order;		// Lower values are processed first
+	uint16_t	preference;	// Among the records of the same order
+	// The strings point into the message, and aren't null-terminated
+	const uint8_t *	flags;
+	const uint8_t *	services;
+	const uint8_t *	regexp;
+	uint8_t		flags_length;
+	uint8_t		services_length;
+	uint8_t		regexp_length;
+	char *		replacement; // Next name to query, if there's no regexp
+} dns_rdata_naptr_t;
+
+int parse_rdata_naptr(dns_rdata_t *rdata, buffer_t *buffer);
+void free_rdata_naptr(dns_rdata_t *rdata);
+void print_rdata_naptr(dns_rdata_t *rdata, output_t *out);
@@ -1,5 +1,6 @@
 #include "ns.h"
 #include "log.h"
+#include "output.h"
 #include "types/buffer.h"
 #include "proto/dns/name.h"
 #include "proto/dns/sections/rdata.h"
@@ -17,6 +18,6 @@ void free_rdata_ns(dns_rdata_t *rdata) {
     free_name(rdata->ns.name);
 }
 
-void print_rdata_ns(dns_rdata_t *rdata) {
-	LOG_PRINTF("%s\n", rdata->ns.name);
+void print_rdata_ns(dns_rdata_t *rdata, output_t *out) {
+	output_field_str(out, "nsdname", rdata->ns.name);
 }
@@ -0,0 +1,71 @@
+#include "nsec.h"
+#include "log.h"
+#include "output.h"
+#include "types/buffer.h"
+#include "types/buffer_span.h"
+#include "proto/dns/name.h"
+#include "proto/dns/sections/rdata.h"
+#include "proto/dns/arrays.h"
+#include <stdio.h>
+#include <string.h>
+
+int read_type_bitmaps(buffer_t *buffer, const uint8_t **bitmaps, uint16_t *length) {
+	uint32_t size = buffer_remaining(buffer);
+	const uint8_t *data = buffer_read_span(buffer, size);
+	if (data == NULL || size > UINT16_MAX)
+		return -1;
+	// Each window is its number, the length of its bitmap (1 to 32), and the bitmap
+	for (uint32_t i = 0; i < size; ) {
+		if (size - i < 2 || data[i + 1] == 0 || data[i + 1] > 32 || size - i - 2 < data[i + 1])
+			return -1;
+		i += 2 + data[i + 1];
+	}
+	*bitmaps = data;
+	*length = (uint16_t)size;
+	return 0;
+}
+
+void print_type_bitmaps(output_t *out, const char *key, const uint8_t *bitmaps, size_t length) {
+	char label[16];
+	output_begin_list(out, key);
+	for (size_t i = 0; i + 2 <= length; i += 2 + bitmaps[i + 1]) {
+		unsigned window = bitmaps[i];
+		for (unsigned byte = 0; byte < bitmaps[i + 1] && i + 2 + byte < length; byte++) {
+			for (unsigned bit = 0; bit < 8; bit++) {
+				if ((bitmaps[i + 2 + byte] & (0x80 >> bit)) == 0)
+					continue;
+				int type = (int)(window * 256 + byte * 8 + bit);
+				const char *name = totext(DNS_ARRAY_QTYPE, type);
+				// RFC 3597 notation for the types without a name
+				if (strcmp(name, "UNKNOWN") == 0) {
+					snprintf(label, sizeof(label), "TYPE%d", type);
+					name = label;
+				}
+				output_field_str(out, NULL, name);
+			}
+		}
+	}
+	output_end_list(out);
+}
+
+int parse_rdata_nsec(dns_rdata_t *rdata, buffer_t *buffer) {
+	rdata->nsec.next_domain = parse_name(buffer);
+	if (rdata->nsec.next_domain == NULL) {
+		LOG_WARN("NSEC next domain is NULL");
+		return -1;
+	}
+	if (read_type_bitmaps(buffer, &rdata->nsec.type_bitmaps, &rdata->nsec.type_bitmaps_length) != 0) {
+		LOG_WARN("detected an error in the type bitmaps of RR of type NSEC");
+		return -1;
+	}
+	return 0;
+}
+
+void free_rdata_nsec(dns_rdata_t *rdata) {
+	free_name(rdata->nsec.next_domain);
+}
+
+void print_rdata_nsec(dns_rdata_t *rdata, output_t *out) {
+	output_field_str(out, "next_domain", rdata->nsec.next_domain);
+	print_type_bitmaps(out, "types", rdata->nsec.type_bitmaps, rdata->nsec.type_bitmaps_length);
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Forward declarations
+typedef struct buffer buffer_t;
+typedef union dns_rdata dns_rdata_t;
+typedef struct output output_t;
+
+//
+// NSEC
+//
+// REFERENCE: https://datatracker.ietf.org/doc/html/rfc4034#section-4.1
+typedef struct dnssec_nsec {
+	char *		next_domain;	// Next owner name in the canonical ordering of the zone
+	const uint8_t *	type_bitmaps;	// Points into the message
+	uint16_t	type_bitmaps_length;
+} dnssec_rdata_nsec_t;
+
+int parse_rdata_nsec(dns_rdata_t *rdata, buffer_t *buffer);
+void free_rdata_nsec(dns_rdata_t *rdata);
+void print_rdata_nsec(dns_rdata_t *rdata, output_t *out);
+
+//
+// Type bitmaps, shared with NSEC3
+//
+// REFERENCE: https://datatracker.ietf.org/doc/html/rfc4034#section-4.1.2
+// Reads the bitmaps that take up the rest of `buffer`. Returns -1 if they're malformed.
+int read_type_bitmaps(buffer_t *buffer, const uint8_t **bitmaps, uint16_t *length);
+// Prints the types that the bitmaps list as a list of names
+void print_type_bitmaps(output_t *out, const char *key, const uint8_t *bitmaps, size_t length);
@@ -0,0 +1,66 @@
+#include "nsec3.h"
+#include "log.h"
+#include "macros.h"
+#include "output.h"
+#include "types/buffer.h"
+#include "types/buffer_span.h"
+#include "proto/dns/sections/rdata.h"
+#include "proto/dns/sections/rdata/nsec.h"
+#include "reader.h"
+
+int parse_rdata_nsec3(dns_rdata_t *rdata, buffer_t *buffer) {
+	dnssec_rdata_nsec3_t *nsec3 = &rdata->nsec3;
+	const uint8_t *span = buffer_read_span(buffer, 4);
+	if (span == NULL)
+		goto error;
+	nsec3->hash_algorithm = buffer_span_uint8(span, 0);
+	nsec3->flags = buffer_span_uint8(span, 1);
+	nsec3->iterations = buffer_span_uint16(span, 2);
+	nsec3->salt = read_string(buffer, &nsec3->salt_length);
+	if (nsec3->salt == NULL)
+		goto error;
+	nsec3->next_hashed_owner = read_string(buffer, &nsec3->next_hashed_owner_length);
+	if (nsec3->next_hashed_owner == NULL || nsec3->next_hashed_owner_length == 0)
+		goto error;
+	if (read_type_bitmaps(buffer, &nsec3->type_bitmaps, &nsec3->type_bitmaps_length) != 0)
+		goto error;
+	return 0;
+error:
+	LOG_WARN("detected an error in the buffer while reading RR of type NSEC3");
+	return -1;
+}
+
+void free_rdata_nsec3(dns_rdata_t *rdata) {
+	UNUSED(rdata); // Nothing to do
+}
+
+// Base32 with the extended hex alphabet, unpadded, as in the owner names of NSEC3 RRs
+static size_t base32hex_encode(char *output, const uint8_t *data, size_t length) {
+	static const char digits[] = "0123456789abcdefghijklmnopqrstuv";
+	size_t count = 0;
+	uint32_t bits = 0;
+	int pending = 0;
+	for (size_t i = 0; i < length; i++) {
+		bits = (bits << 8) | data[i];
+		pending += 8;
+		while (pending >= 5) {
+			pending -= 5;
+			output[count++] = digits[(bits >> pending) & 0x1f];
+		}
+	}
+	if (pending > 0)
+		output[count++] = digits[(bits << (5 - pending)) & 0x1f];
+	return count;
+}
+
+void print_rdata_nsec3(dns_rdata_t *rdata, output_t *out) {
+	const dnssec_rdata_nsec3_t *nsec3 = &rdata->nsec3;
+	char next_hashed_owner[(255 * 8 + 4) / 5];
+	output_field_uint(out, "hash_algorithm", nsec3->hash_algorithm);
+	output_field_uint(out, "opt_out", nsec3->flags & 0x01);
+	output_field_uint(out, "iterations", nsec3->iterations);
+	output_field_hexstr(out, "salt", nsec3->salt, nsec3->salt_length);
+	output_field_strn(out, "next_hashed_owner", next_hashed_owner,
+		base32hex_encode(next_hashed_owner, nsec3->next_hashed_owner, nsec3->next_hashed_owner_length));
+	print_type_bitmaps(out, "types", nsec3->type_bitmaps, nsec3->type_bitmaps_length);
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <stdint.h>
+
+// Forward declarations
+typedef struct buffer buffer_t;
+typedef union dns_rdata dns_rdata_t;
+typedef struct output output_t;
+
+//
+// NSEC3
+//
+// REFERENCE: https://datatracker.ietf.org/doc/html/rfc5155#section-3.2
+// Everything points into the message.
+typedef struct dnssec_nsec3 {
+	uint8_t		hash_algorithm;	// 1 = SHA-1
+	uint8_t		flags;			// Bit 0 is Opt-Out
+	uint16_t	iterations;
+	uint8_t		salt_length;
+	uint8_t		next_hashed_owner_length;
+	const uint8_t *	salt;
+	const uint8_t *	next_hashed_owner;	// Unencoded hash of the next owner name
+	const uint8_t *	type_bitmaps;
+	uint16_t	type_bitmaps_length;
+} dnssec_rdata_nsec3_t;
+
+int parse_rdata_nsec3(dns_rdata_t *rdata, buffer_t *buffer);
+void free_rdata_nsec3(dns_rdata_t *rdata);
+void print_rdata_nsec3(dns_rdata_t *rdata, output_t *out);
@@ -0,0 +1,212 @@
+#include "opt.h"
+#include "log.h"
+#include "macros.h"
+#include "output.h"
+#include "types/buffer.h"
+#include "types/buffer_span.h"
+#include "proto/dns/header.h"
+#include "proto/dns/name.h"
+#include "proto/dns/sections/rdata.h"
+#include "proto/dns/types.h"
+#include "utils.h" // for utils_in_addr_to_str + utils_in6_addr_to_str
+#include <arpa/inet.h> // for INET6_ADDRSTRLEN
+#include <string.h>
+
+#define DNS_ECS_FAMILY_IPV4	1
+#define DNS_ECS_FAMILY_IPV6	2
+
+//
+// Option iterator
+//
+void dns_opt_iter_init(dns_opt_iter_t *iter, const uint8_t *options, size_t length) {
+	iter->ptr = options;
+	iter->end = options + length;
+}
+
+int dns_opt_iter_next(dns_opt_iter_t *iter, dns_opt_option_t *option) {
+	size_t left = (size_t)(iter->end - iter->ptr);
+	if (left == 0)
+		return 0;
+	if (left < 4)
+		return -1;
+	option->code = buffer_span_uint16(iter->ptr, 0);
+	option->length = buffer_span_uint16(iter->ptr, 2);
+	if (left - 4 < option->length)
+		return -1;
+	option->data = iter->ptr + 4;
+	iter->ptr += 4 + option->length;
+	return 1;
+}
+
+const char *dns_opt_code_totext(uint16_t code) {
+	switch (code) {
+		case DNS_OPT_NSID:				return "NSID";
+		case DNS_OPT_CLIENT_SUBNET:		return "ECS";
+		case DNS_OPT_EXPIRE:			return "EXPIRE";
+		case DNS_OPT_COOKIE:			return "COOKIE";
+		case DNS_OPT_TCP_KEEPALIVE:		return "TCP_KEEPALIVE";
+		case DNS_OPT_PADDING:			return "PADDING";
+		case DNS_OPT_CHAIN:				return "CHAIN";
+		case DNS_OPT_KEY_TAG:			return "KEY_TAG";
+		case DNS_OPT_EXTENDED_ERROR:	return "EDE";
+		default:						return "UNKNOWN";
+	}
+}
+
+//
+// Decoding
+//
+// REFERENCE: https://datatracker.ietf.org/doc/html/rfc7871#section-6
+static int decode_client_subnet(dns_rdata_opt_t *opt, const dns_opt_option_t *option) {
+	if (option->length < 4)
+		return -1;
+	uint16_t family = buffer_span_uint16(option->data, 0);
+	uint8_t source_prefix = buffer_span_uint8(option->data, 2);
+	size_t max_prefix = family == DNS_ECS_FAMILY_IPV4 ? 32 : family == DNS_ECS_FAMILY_IPV6 ? 128 : 0;
+	size_t address_length = option->length - 4u;
+	// The address is truncated to the bytes that the source prefix covers
+	if (max_prefix == 0 || source_prefix > max_prefix || address_length != (source_prefix + 7u) / 8)
+		return -1;
+	opt->has_client_subnet = true;
+	opt->ecs_family = family;
+	opt->ecs_source_prefix = source_prefix;
+	opt->ecs_scope_prefix = buffer_span_uint8(option->data, 3);
+	memset(opt->ecs_address, 0, sizeof(opt->ecs_address));
+	memcpy(opt->ecs_address, option->data + 4, address_length);
+	return 0;
+}
+
+void dns_opt_decode_fixed(dns_rdata_opt_t *opt, uint16_t rr_class, uint32_t rr_ttl) {
+	opt->udp_size = rr_class;
+	opt->extended_rcode = (uint8_t)(rr_ttl >> 24);
+	opt->version = (uint8_t)(rr_ttl >> 16);
+	opt->dnssec_ok = (rr_ttl & 0x8000) != 0;
+}
+
+int dns_opt_decode_options(dns_rdata_opt_t *opt, const uint8_t *options, uint16_t length) {
+	opt->options = options;
+	opt->options_length = length;
+
+	dns_opt_iter_t iter;
+	dns_opt_option_t option;
+	int ret;
+	dns_opt_iter_init(&iter, options, length);
+	while ((ret = dns_opt_iter_next(&iter, &option)) > 0) {
+		switch (option.code) {
+			case DNS_OPT_CLIENT_SUBNET:
+				if (decode_client_subnet(opt, &option) != 0)
+					return -1;
+				break;
+			case DNS_OPT_COOKIE:
+				// Either a client cookie alone, or followed by a server cookie of 8 to 32 bytes
+				if (option.length != DNS_OPT_COOKIE_CLIENT_LEN
+					&& (option.length < 16 || option.length > DNS_OPT_COOKIE_MAXLEN))
+					return -1;
+				opt->cookie = option.data;
+				opt->cookie_length = (uint8_t)option.length;
+				break;
+			case DNS_OPT_PADDING:
+				opt->has_padding = true;
+				opt->padding_length += option.length;
+				break;
+			default:
+				break;
+		}
+	}
+	return ret;
+}
+
+int dns_opt_find(dns_rdata_opt_t *opt, const dns_hdr_t *header, const buffer_t *buffer) {
+	buffer_t peek = *buffer;
+	for (uint16_t i = 0; i < header->qd_c; i++) {
+		if (skip_name(&peek) != 0 || buffer_read_span(&peek, 4) == NULL)
+			return -1;
+	}
+	// The records of the answer and authority sections are skipped with their RDLENGTH
+	uint32_t records = (uint32_t)header->an_c + header->ns_c;
+	for (uint32_t i = 0; i < records + header->ar_c; i++) {
+		if (skip_name(&peek) != 0)
+			return -1;
+		const uint8_t *span = buffer_read_span(&peek, 10);
+		if (span == NULL)
+			return -1;
+		uint16_t rdlen = buffer_span_uint16(span, 8);
+		const uint8_t *rdata = buffer_read_span(&peek, rdlen);
+		if (rdata == NULL)
+			return -1;
+		if (i >= records && buffer_span_uint16(span, 0) == DNS_QTYPE_OPT) {
+			memset(opt, 0, sizeof(*opt));
+			dns_opt_decode_fixed(opt, buffer_span_uint16(span, 2), buffer_span_uint32(span, 4));
+			return dns_opt_decode_options(opt, rdata, rdlen) == 0 ? 1 : -1;
+		}
+	}
+	return 0;
+}
+
+//
+// RDATA
+//
+// Only the options, see dns_opt_decode_fixed()
+int parse_rdata_opt(dns_rdata_t *rdata, buffer_t *buffer) {
+	uint32_t length = buffer_remaining(buffer);
+	const uint8_t *options = buffer_read_span(buffer, length);
+	if (options == NULL || length > UINT16_MAX) {
+		LOG_WARN("detected an error in the buffer while reading RR of type OPT");
+		return -1;
+	}
+	if (dns_opt_decode_options(&rdata->opt, options, (uint16_t)length) != 0) {
+		LOG_WARN("malformed EDNS0 option in RR of type OPT");
+		return -1;
+	}
+	return 0;
+}
+
+void free_rdata_opt(dns_rdata_t *rdata) {
+	UNUSED(rdata); // Nothing to do
+}
+
+void print_rdata_opt(dns_rdata_t *rdata, output_t *out) {
+	const dns_rdata_opt_t *opt = &rdata->opt;
+	output_field_uint(out, "udp_size", opt->udp_size);
+	output_field_uint(out, "extended_rcode", opt->extended_rcode);
+	output_field_uint(out, "version", opt->version);
+	output_field_uint(out, "dnssec_ok", opt->dnssec_ok);
+
+	if (opt->has_client_subnet) {
+		char address[INET6_ADDRSTRLEN];
+		output_begin_object(out, "client_subnet");
+		output_field_uint(out, "family", opt->ecs_family);
+		output_field_uint(out, "source_prefix", opt->ecs_source_prefix);
+		output_field_uint(out, "scope_prefix", opt->ecs_scope_prefix);
+		if (opt->ecs_family == DNS_ECS_FAMILY_IPV4)
+			utils_in_addr_to_str(address, sizeof(address), (const struct in_addr *)opt->ecs_address);
+		else
+			utils_in6_addr_to_str(address, sizeof(address), (const struct in6_addr *)opt->ecs_address);
+		output_field_str(out, "address", address);
+		output_end_object(out);
+	}
+	if (opt->cookie != NULL) {
+		output_begin_object(out, "cookie");
+		output_field_hexstr(out, "client", opt->cookie, DNS_OPT_COOKIE_CLIENT_LEN);
+		if (opt->cookie_length > DNS_OPT_COOKIE_CLIENT_LEN) {
+			output_field_hexstr(out, "server", opt->cookie + DNS_OPT_COOKIE_CLIENT_LEN,
+				opt->cookie_length - DNS_OPT_COOKIE_CLIENT_LEN);
+		}
+		output_end_object(out);
+	}
+	if (opt->has_padding)
+		output_field_uint(out, "padding", opt->padding_length);
+
+	dns_opt_iter_t iter;
+	dns_opt_option_t option;
+	dns_opt_iter_init(&iter, opt->options, opt->options_length);
+	output_begin_list(out, "options");
+	while (dns_opt_iter_next(&iter, &option) > 0) {
+		output_begin_object(out, NULL);
+		output_field_uint(out, "code", option.code);
+		output_field_str(out, "name", dns_opt_code_totext(option.code));
+		output_field_uint(out, "length", option.length);
+		output_end_object(out);
+	}
+	output_end_list(out);
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Forward declarations
+typedef struct buffer buffer_t;
+typedef struct dns_hdr dns_hdr_t;
+typedef union dns_rdata dns_rdata_t;
+typedef struct output output_t;
+
+//
+// EDNS0 option codes
+//
+// REFERENCE: https://www.iana.org/assignments/dns-parameters/dns-parameters.xhtml#dns-parameters-11
+typedef enum {
+	DNS_OPT_NSID			= 3,	// RFC 5001
+	DNS_OPT_CLIENT_SUBNET	= 8,	// RFC 7871
+	DNS_OPT_EXPIRE			= 9,	// RFC 7314
+	DNS_OPT_COOKIE			= 10,	// RFC 7873
+	DNS_OPT_TCP_KEEPALIVE	= 11,	// RFC 7828
+	DNS_OPT_PADDING			= 12,	// RFC 7830
+	DNS_OPT_CHAIN			= 13,	// RFC 7901
+	DNS_OPT_KEY_TAG			= 14,	// RFC 8145
+	DNS_OPT_EXTENDED_ERROR	= 15	// RFC 8914
+} dns_opt_code_e;
+
+#define DNS_OPT_COOKIE_CLIENT_LEN	8
+#define DNS_OPT_COOKIE_MAXLEN		40	// 8 bytes of client cookie + 8 to 32 of server cookie
+
+//
+// OPT
+//
+// REFERENCE: https://datatracker.ietf.org/doc/html/rfc6891#section-6.1
+// The fixed part of the pseudo-RR is spread over the CLASS and TTL fields, and the options
+// are decoded in place, so nothing here is allocated and `options` points into the message.
+typedef struct dns_rdata_opt {
+	uint16_t	udp_size;		// Requestor's UDP payload size (the CLASS field)
+	uint8_t		extended_rcode;	// Upper 8 bits of the 12-bit rcode
+	uint8_t		version;
+	bool		dnssec_ok;		// DO bit
+	const uint8_t *	options;	// Points into the message
+	uint16_t	options_length;
+	// Client Subnet (RFC 7871)
+	bool		has_client_subnet;
+	uint16_t	ecs_family;		// 1 = IPv4, 2 = IPv6
+	uint8_t		ecs_source_prefix;
+	uint8_t		ecs_scope_prefix;
+	uint8_t		ecs_address[16];	// Zero-filled past the source prefix
+	// Cookie (RFC 7873)
+	const uint8_t *	cookie;		// Points into the message, NULL if absent
+	uint8_t		cookie_length;	// Client cookie, plus the server cookie if present
+	// Padding (RFC 7830)
+	bool		has_padding;
+	uint16_t	padding_length;
+} dns_rdata_opt_t;
+
+//
+// Option iterator
+//
+//	dns_opt_iter_t iter;
+//	dns_opt_option_t option;
+//	dns_opt_iter_init(&iter, opt->options, opt->options_length);
+//	while (dns_opt_iter_next(&iter, &option) > 0)
+//		...
+//
+typedef struct dns_opt_option {
+	uint16_t		code;
+	uint16_t		length;
+	const uint8_t *	data;
+} dns_opt_option_t;
+
+typedef struct dns_opt_iter {
+	const uint8_t *ptr;
+	const uint8_t *end;
+} dns_opt_iter_t;
+
+void dns_opt_iter_init(dns_opt_iter_t *iter, const uint8_t *options, size_t length);
+// Returns 1 and fills `option`, 0 past the last option, or -1 if the option overruns the RDATA.
+int dns_opt_iter_next(dns_opt_iter_t *iter, dns_opt_option_t *option);
+const char *dns_opt_code_totext(uint16_t code);
+
+// The fixed part is spread over the CLASS and TTL fields of the RR
+void dns_opt_decode_fixed(dns_rdata_opt_t *opt, uint16_t rr_class, uint32_t rr_ttl);
+// Returns -1 if the options are malformed. Leaves the fields of absent options alone.
+int dns_opt_decode_options(dns_rdata_opt_t *opt, const uint8_t *options, uint16_t length);
+// Walks the message in `buffer`, which must be positioned right after `header`, up to the
+// first OPT RR of the additional section, without decoding anything else. The position of
+// `buffer` is left alone. Returns 1 if found, 0 if not, or -1 if the message is malformed.
+int dns_opt_find(dns_rdata_opt_t *opt, const dns_hdr_t *header, const buffer_t *buffer);
+
+// The options take up the rest of `buffer`
+int parse_rdata_opt(dns_rdata_t *rdata, buffer_t *buffer);
+void free_rdata_opt(dns_rdata_t *rdata);
+void print_rdata_opt(dns_rdata_t *rdata, output_t *out);
@@ -1,40 +1,43 @@
 #include "rrsig.h"
 #include "log.h"
+#include "output.h"
 #include "types/buffer.h"
+#include "types/buffer_span.h"
 #include "proto/dns/name.h"
 #include "proto/dns/sections/rdata.h"
 #include "proto/dns/arrays.h"
 #include "reader.h"
 #include <stdlib.h>
-#include <netinet/in.h> // for ntohs and ntohl
 #include <time.h> // for gmtime_r + strftime
 
-char *read_signature(buffer_t *from_buffer, int *error, size_t size) {
-	return read_bytes_and_base64(from_buffer, error, size);
+const uint8_t *read_signature(buffer_t *from_buffer, int *error, size_t size) {
+	return read_bytes(from_buffer, error, size);
 }
 
 int parse_rdata_rrsig(dns_rdata_t *rdata, buffer_t *buffer) {
-	rdata->rrsig.typec = buffer_read_uint16(buffer);
-	rdata->rrsig.algnum = buffer_read_uint8(buffer);
-	rdata->rrsig.labels = buffer_read_uint8(buffer);
-	rdata->rrsig.original_ttl = buffer_read_uint32(buffer);
-	rdata->rrsig.signature_expiration = buffer_read_uint32(buffer);
-	rdata->rrsig.signature_inception = buffer_read_uint32(buffer);
-	rdata->rrsig.key_tag = buffer_read_uint16(buffer);
-	if (buffer_has_error(buffer)) {
+	const uint8_t *span = buffer_read_span(buffer, 18);
+	if (span == NULL) {
 		LOG_WARN("detected an error in the buffer while reading RR of type RRSIG");
 		return -1;
 	}
+	rdata->rrsig.typec = buffer_span_uint16(span, 0);
+	rdata->rrsig.algnum = buffer_span_uint8(span, 2);
+	rdata->rrsig.labels = buffer_span_uint8(span, 3);
+	rdata->rrsig.original_ttl = buffer_span_uint32(span, 4);
+	rdata->rrsig.signature_expiration = buffer_span_uint32(span, 8);
+	rdata->rrsig.signature_inception = buffer_span_uint32(span, 12);
+	rdata->rrsig.key_tag = buffer_span_uint16(span, 16);
 	rdata->rrsig.signer_name = parse_name(buffer);
 	if (rdata->rrsig.signer_name == NULL) {
 		LOG_WARN("RRSIG signer name is NULL");
 		return -1;
 	}
 
-	// TODO(jweyrich): Figure out sizes depending on algorithm
-	size_t signature_size = 64;
+	// Its size depends on the algorithm, but it takes up the rest of the RDATA anyway
+	size_t signature_size = buffer_remaining(buffer);
 	int read_error = 0;
 	rdata->rrsig.signature = read_signature(buffer, &read_error, signature_size);
+	rdata->rrsig.signature_length = (uint16_t)signature_size;
 	if (read_error != 0) {
 		LOG_WARN("error while reading RRSIG signature: %d", read_error);
 		return -1;
@@ -43,18 +46,11 @@ int parse_rdata_rrsig(dns_rdata_t *rdata, buffer_t *buffer) {
 		LOG_WARN("detected an error in the buffer while reading RR of type RRSIG");
 		return -1;
 	}
-
-	rdata->rrsig.typec = ntohs(rdata->rrsig.typec);
-	rdata->rrsig.original_ttl = ntohl(rdata->rrsig.original_ttl);
-	rdata->rrsig.signature_expiration = ntohl(rdata->rrsig.signature_expiration);
-	rdata->rrsig.signature_inception = ntohl(rdata->rrsig.signature_inception);
-	rdata->rrsig.key_tag = ntohs(rdata->rrsig.key_tag);
 	return 0;
 }
 
 void free_rdata_rrsig(dns_rdata_t *rdata) {
     free(rdata->rrsig.signer_name);
-	free(rdata->rrsig.signature);
 }
 
 static char *parse_timestamp(char *out, size_t out_size, time_t in) {
@@ -64,18 +60,16 @@ static char *parse_timestamp(char *out, size_t out_size, time_t in) {
 	return out;
 }
 
-void print_rdata_rrsig(dns_rdata_t *rdata) {
+void print_rdata_rrsig(dns_rdata_t *rdata, output_t *out) {
 	char sig_expiration[15];
 	char sig_inception[15];
-	LOG_PRINTF("%s %s %u %u %s %s %u %s %s\n",
-		totext(DNS_ARRAY_QTYPE, rdata->rrsig.typec),
-		totext(DNSSEC_ARRAY_ALGORITHM, rdata->rrsig.algnum),
-		rdata->rrsig.labels,
-		rdata->rrsig.original_ttl,
-		parse_timestamp(sig_expiration, sizeof(sig_expiration), rdata->rrsig.signature_expiration),
-		parse_timestamp(sig_inception, sizeof(sig_inception), rdata->rrsig.signature_inception),
-		rdata->rrsig.key_tag,
-		rdata->rrsig.signer_name,
-		rdata->rrsig.signature
-	);
+	output_field_str(out, "type_covered", totext(DNS_ARRAY_QTYPE, rdata->rrsig.typec));
+	output_field_str(out, "algorithm", totext(DNSSEC_ARRAY_ALGORITHM, rdata->rrsig.algnum));
+	output_field_uint(out, "labels", rdata->rrsig.labels);
+	output_field_uint(out, "original_ttl", rdata->rrsig.original_ttl);
+	output_field_str(out, "expiration", parse_timestamp(sig_expiration, sizeof(sig_expiration), rdata->rrsig.signature_expiration));
+	output_field_str(out, "inception", parse_timestamp(sig_inception, sizeof(sig_inception), rdata->rrsig.signature_inception));
+	output_field_uint(out, "key_tag", rdata->rrsig.key_tag);
+	output_field_str(out, "signer", rdata->rrsig.signer_name);
+	output_field_base64(out, "signature", rdata->rrsig.signature, rdata->rrsig.signature_length);
 }
@@ -5,6 +5,7 @@
 // Forward declarations
 typedef struct buffer buffer_t;
 typedef union dns_rdata dns_rdata_t;
+typedef struct output output_t;
 
 //
 // RRSIG
@@ -19,9 +20,10 @@ typedef struct dnssec_rrsig {
 	uint32_t	signature_inception;
 	uint16_t	key_tag;
 	char *		signer_name;
-	char *		signature;
+	const uint8_t *	signature;	// Points into the message
+	uint16_t	signature_length;
 } dnssec_rdata_rrsig_t;
 
 int parse_rdata_rrsig(dns_rdata_t *rdata, buffer_t *buffer);
 void free_rdata_rrsig(dns_rdata_t *rdata);
-void print_rdata_rrsig(dns_rdata_t *rdata);
+void print_rdata_rrsig(dns_rdata_t *rdata, output_t *out);
@@ -1,9 +1,10 @@
 #include "soa.h"
 #include "log.h"
+#include "output.h"
 #include "types/buffer.h"
+#include "types/buffer_span.h"
 #include "proto/dns/name.h"
 #include "proto/dns/sections/rdata.h"
-#include <netinet/in.h> // for ntohs and ntohl
 
 int parse_rdata_soa(dns_rdata_t *rdata, buffer_t *buffer) {
 	rdata->soa.mname = parse_name(buffer);
@@ -16,20 +17,16 @@ int parse_rdata_soa(dns_rdata_t *rdata, buffer_t *buffer) {
 		LOG_WARN("SOA rname is NULL");
 		return -1;
 	}
-	rdata->soa.serial = buffer_read_uint32(buffer);
-	rdata->soa.refresh = buffer_read_int32(buffer);
-	rdata->soa.retry = buffer_read_int32(buffer);
-	rdata->soa.expire = buffer_read_int32(buffer);
-	rdata->soa.minimum = buffer_read_uint32(buffer);
-	if (buffer_has_error(buffer)) {
+	const uint8_t *span = buffer_read_span(buffer, 20);
+	if (span == NULL) {
 		LOG_WARN("detected an error in the buffer while reading RR of type SOA");
 		return -1;
 	}
-	rdata->soa.serial = ntohl(rdata->soa.serial);
-	rdata->soa.refresh = ntohl(rdata->soa.refresh);
-	rdata->soa.retry = ntohl(rdata->soa.retry);
-	rdata->soa.expire = ntohl(rdata->soa.expire);
-	rdata->soa.minimum = ntohl(rdata->soa.minimum);
+	rdata->soa.serial = buffer_span_uint32(span, 0);
+	rdata->soa.refresh = (int32_t)buffer_span_uint32(span, 4);
+	rdata->soa.retry = (int32_t)buffer_span_uint32(span, 8);
+	rdata->soa.expire = (int32_t)buffer_span_uint32(span, 12);
+	rdata->soa.minimum = buffer_span_uint32(span, 16);
 	return 0;
 }
 
@@ -38,13 +35,12 @@ void free_rdata_soa(dns_rdata_t *rdata) {
 	free_name(rdata->soa.rname);
 }
 
-void print_rdata_soa(dns_rdata_t *rdata) {
-	LOG_PRINTF("%s %s %u %d %d %d %u\n",
-		rdata->soa.mname,
-		rdata->soa.rname,
-		rdata->soa.serial,
-		rdata->soa.refresh,
-		rdata->soa.retry,
-		rdata->soa.expire,
-		rdata->soa.minimum);
+void print_rdata_soa(dns_rdata_t *rdata, output_t *out) {
+	output_field_str(out, "mname", rdata->soa.mname);
+	output_field_str(out, "rname", rdata->soa.rname);
+	output_field_uint(out, "serial", rdata->soa.serial);
+	output_field_int(out, "refresh", rdata->soa.refresh);
+	output_field_int(out, "retry", rdata->soa.retry);
+	output_field_int(out, "expire", rdata->soa.expire);
+	output_field_uint(out, "minimum", rdata->soa.minimum);
 }
@@ -5,6 +5,7 @@
 // Forward declarations
 typedef struct buffer buffer_t;
 typedef union dns_rdata dns_rdata_t;
+typedef struct output output_t;
 
 //
 // SOA
@@ -21,4 +22,4 @@ typedef struct dns_rdata_soa {
 
 int parse_rdata_soa(dns_rdata_t *rdata, buffer_t *buffer);
 void free_rdata_soa(dns_rdata_t *rdata);
-void print_rdata_soa(dns_rdata_t *rdata);
+void print_rdata_soa(dns_rdata_t *rdata, output_t *out);
@@ -0,0 +1,35 @@
+#include "srv.h"
+#include "log.h"
+#include "output.h"
+#include "types/buffer.h"
+#include "types/buffer_span.h"
+#include "proto/dns/name.h"
+#include "proto/dns/sections/rdata.h"
+
+int parse_rdata_srv(dns_rdata_t *rdata, buffer_t *buffer) {
+	const uint8_t *span = buffer_read_span(buffer, 6);
+	if (span == NULL) {
+		LOG_WARN("detected an error in the buffer while reading RR of type SRV");
+		return -1;
+	}
+	rdata->srv.priority = buffer_span_uint16(span, 0);
+	rdata->srv.weight = buffer_span_uint16(span, 2);
+	rdata->srv.port = buffer_span_uint16(span, 4);
+	rdata->srv.target = parse_name(buffer);
+	if (rdata->srv.target == NULL) {
+		LOG_WARN("SRV target is NULL");
+		return -1;
+	}
+	return 0;
+}
+
+void free_rdata_srv(dns_rdata_t *rdata) {
+	free_name(rdata->srv.target);
+}
+
+void print_rdata_srv(dns_rdata_t *rdata, output_t *out) {
+	output_field_uint(out, "priority", rdata->srv.priority);
+	output_field_uint(out, "weight", rdata->srv.weight);
+	output_field_uint(out, "port", rdata->srv.port);
+	output_field_str(out, "target", rdata->srv.target);
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <stdint.h>
+
+// Forward declarations
+typedef struct buffer buffer_t;
+typedef union dns_rdata dns_rdata_t;
+typedef struct output output_t;
+
+//
+// SRV
+//
+// REFERENCE: https://datatracker.ietf.org/doc/html/rfc2782
+typedef struct dns_rdata_srv {
+	uint16_t	priority;	// Lower values are tried first
+	uint16_t	weight;		// Relative weight among the targets of the same priority
+	uint16_t	port;
+	char *		target;		// Host that provides the service
+} dns_rdata_srv_t;
+
+int parse_rdata_srv(dns_rdata_t *rdata, buffer_t *buffer);
+void free_rdata_srv(dns_rdata_t *rdata);
+void print_rdata_srv(dns_rdata_t *rdata, output_t *out);
@@ -0,0 +1,147 @@
+#include "svcb.h"
+#include "log.h"
+#include "output.h"
+#include "types/buffer.h"
+#include "types/buffer_span.h"
+#include "proto/dns/name.h"
+#include "proto/dns/sections/rdata.h"
+#include "proto/dns/sections/rdata/opt.h" // SvcParams have the layout of EDNS0 options
+#include "utils.h" // for utils_in_addr_to_str + utils_in6_addr_to_str
+#include <arpa/inet.h> // for INET6_ADDRSTRLEN
+#include <stdbool.h>
+#include <stdio.h>
+
+static const char *param_totext(uint16_t key, char *buffer, size_t size) {
+	switch (key) {
+		case DNS_SVC_PARAM_MANDATORY:		return "mandatory";
+		case DNS_SVC_PARAM_ALPN:			return "alpn";
+		case DNS_SVC_PARAM_NO_DEFAULT_ALPN:	return "no-default-alpn";
+		case DNS_SVC_PARAM_PORT:			return "port";
+		case DNS_SVC_PARAM_IPV4HINT:		return "ipv4hint";
+		case DNS_SVC_PARAM_ECH:				return "ech";
+		case DNS_SVC_PARAM_IPV6HINT:		return "ipv6hint";
+		case DNS_SVC_PARAM_DOHPATH:			return "dohpath";
+		case DNS_SVC_PARAM_OHTTP:			return "ohttp";
+		default:
+			snprintf(buffer, size, "key%u", key); // RFC 9460 notation
+			return buffer;
+	}
+}
+
+// The values of the keys that babysniff prints in detail must have the expected shape
+static bool param_is_valid(const dns_opt_option_t *param) {
+	switch (param->code) {
+		case DNS_SVC_PARAM_MANDATORY:		return param->length > 0 && param->length % 2 == 0;
+		case DNS_SVC_PARAM_NO_DEFAULT_ALPN:	return param->length == 0;
+		case DNS_SVC_PARAM_PORT:			return param->length == 2;
+		case DNS_SVC_PARAM_IPV4HINT:		return param->length > 0 && param->length % 4 == 0;
+		case DNS_SVC_PARAM_IPV6HINT:		return param->length > 0 && param->length % 16 == 0;
+		case DNS_SVC_PARAM_ALPN:
+			// A list of <character-string>
+			for (size_t i = 0; i < param->length; i += 1 + param->data[i]) {
+				if (param->data[i] == 0 || param->length - i - 1 < param->data[i])
+					return false;
+			}
+			return param->length > 0;
+		default:
+			return true;
+	}
+}
+
+int parse_rdata_svcb(dns_rdata_t *rdata, buffer_t *buffer) {
+	const uint8_t *span = buffer_read_span(buffer, 2);
+	if (span == NULL)
+		goto error;
+	rdata->svcb.priority = buffer_span_uint16(span, 0);
+	rdata->svcb.target = parse_name(buffer);
+	if (rdata->svcb.target == NULL) {
+		LOG_WARN("SVCB target is NULL");
+		return -1;
+	}
+
+	// The params take up the rest of the RDATA, in strictly increasing order of their keys
+	uint32_t length = buffer_remaining(buffer);
+	const uint8_t *params = buffer_read_span(buffer, length);
+	if (params == NULL || length > UINT16_MAX)
+		goto error;
+	dns_opt_iter_t iter;
+	dns_opt_option_t param;
+	int ret, previous = -1;
+	dns_opt_iter_init(&iter, params, length);
+	while ((ret = dns_opt_iter_next(&iter, &param)) > 0) {
+		if ((int)param.code <= previous || !param_is_valid(&param))
+			goto error;
+		previous = param.code;
+	}
+	if (ret != 0)
+		goto error;
+	rdata->svcb.params = params;
+	rdata->svcb.params_length = (uint16_t)length;
+	return 0;
+error:
+	LOG_WARN("detected an error in the buffer while reading RR of type SVCB");
+	return -1;
+}
+
+void free_rdata_svcb(dns_rdata_t *rdata) {
+	free_name(rdata->svcb.target);
+}
+
+static void print_param(output_t *out, const dns_opt_option_t *param) {
+	char key[16];
+	char address[INET6_ADDRSTRLEN];
+	const char *name = param_totext(param->code, key, sizeof(key));
+	switch (param->code) {
+		case DNS_SVC_PARAM_MANDATORY:
+			output_begin_list(out, name);
+			for (size_t i = 0; i < param->length; i += 2)
+				output_field_str(out, NULL, param_totext(buffer_span_uint16(param->data, i), key, sizeof(key)));
+			output_end_list(out);
+			break;
+		case DNS_SVC_PARAM_ALPN:
+			output_begin_list(out, name);
+			for (size_t i = 0; i < param->length; i += 1 + param->data[i])
+				output_field_strn(out, NULL, (const char *)param->data + i + 1, param->data[i]);
+			output_end_list(out);
+			break;
+		case DNS_SVC_PARAM_NO_DEFAULT_ALPN:
+			output_field_uint(out, name, 1);
+			break;
+		case DNS_SVC_PARAM_PORT:
+			output_field_uint(out, name, buffer_span_uint16(param->data, 0));
+			break;
+		case DNS_SVC_PARAM_IPV4HINT:
+			output_begin_list(out, name);
+			for (size_t i = 0; i < param->length; i += 4)
+				output_field_str(out, NULL, utils_in_addr_to_str(address, sizeof(address), (const struct in_addr *)(param->data + i)));
+			output_end_list(out);
+			break;
+		case DNS_SVC_PARAM_IPV6HINT:
+			output_begin_list(out, name);
+			for (size_t i = 0; i < param->length; i += 16)
+				output_field_str(out, NULL, utils_in6_addr_to_str(address, sizeof(address), (const struct in6_addr *)(param->data + i)));
+			output_end_list(out);
+			break;
+		case DNS_SVC_PARAM_ECH:
+			output_field_base64(out, name, param->data, param->length);
+			break;
+		case DNS_SVC_PARAM_DOHPATH:
+			output_field_strn(out, name, (const char *)param->data, param->length);
+			break;
+		default:
+			output_field_hexstr(out, name, param->data, param->length);
+			break;
+	}
+}
+
+void print_rdata_svcb(dns_rdata_t *rdata, output_t *out) {
+	output_field_uint(out, "priority", rdata->svcb.priority);
+	output_field_str(out, "target", rdata->svcb.target);
+	dns_opt_iter_t iter;
+	dns_opt_option_t param;
+	dns_opt_iter_init(&iter, rdata->svcb.params, rdata->svcb.params_length);
+	output_begin_object(out, "params");
+	while (dns_opt_iter_next(&iter, &param) > 0)
+		print_param(out, &param);
+	output_end_object(out);
+}
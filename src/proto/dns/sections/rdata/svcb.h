@@ -0,0 +1,35 @@
+#pragma once
+
+#include <stdint.h>
+
+// Forward declarations
+typedef struct buffer buffer_t;
+typedef union dns_rdata dns_rdata_t;
+typedef struct output output_t;
+
+//
+// SVCB and HTTPS, which share the format
+//
+// REFERENCE: https://datatracker.ietf.org/doc/html/rfc9460#section-2.2
+typedef enum {
+	DNS_SVC_PARAM_MANDATORY			= 0,
+	DNS_SVC_PARAM_ALPN				= 1,
+	DNS_SVC_PARAM_NO_DEFAULT_ALPN	= 2,
+	DNS_SVC_PARAM_PORT				= 3,
+	DNS_SVC_PARAM_IPV4HINT			= 4,
+	DNS_SVC_PARAM_ECH				= 5,
+	DNS_SVC_PARAM_IPV6HINT			= 6,
+	DNS_SVC_PARAM_DOHPATH			= 7,	// RFC 9461
+	DNS_SVC_PARAM_OHTTP				= 8		// RFC 9540
+} dns_svc_param_e;
+
+typedef struct dns_rdata_svcb {
+	uint16_t	priority;	// 0 for AliasMode, otherwise ServiceMode
+	char *		target;
+	const uint8_t *	params;	// SvcParams, points into the message
+	uint16_t	params_length;
+} dns_rdata_svcb_t;
+
+int parse_rdata_svcb(dns_rdata_t *rdata, buffer_t *buffer);
+void free_rdata_svcb(dns_rdata_t *rdata);
+void print_rdata_svcb(dns_rdata_t *rdata, output_t *out);
@@ -1,47 +1,46 @@
 #include "txt.h"
 #include "log.h"
+#include "macros.h"
+#include "output.h"
 #include "types/buffer.h"
+#include "types/buffer_span.h"
 #include "proto/dns/sections/rdata.h"
-#include <stdlib.h>
-
-static char *parse_data(buffer_t *buffer) {
-	char *data = NULL;
-	size_t length;
-
-	length = buffer_read_uint8(buffer);
-	if (buffer_has_error(buffer))
-		goto error;
-	if (length == 0)
-		goto error;
-	data = malloc(length+1);
-	if (data == NULL)
-		return NULL;
-	buffer_strncpy(buffer, data, length);
-	if (buffer_has_error(buffer))
-		goto error;
-	data[length] = 0;
-	return data;
-error:
-	if (data != NULL) {
-		LOG_WARN("Invalid data");
-		free(data);
-	}
-	return NULL;
-}
+#include "reader.h"
 
+// The strings take up the rest of the RDATA
 int parse_rdata_txt(dns_rdata_t *rdata, buffer_t *buffer) {
-	rdata->txt.data = parse_data(buffer);
-	if (rdata->txt.data == NULL) {
-		LOG_WARN("TXT data is NULL");
+	uint32_t start = buffer_tell(buffer);
+	uint32_t count = 0;
+	uint8_t length;
+	while (buffer_remaining(buffer) > 0) {
+		if (read_string(buffer, &length) == NULL) {
+			LOG_WARN("detected an error in the buffer while reading RR of type TXT");
+			return -1;
+		}
+		count++;
+	}
+	uint32_t size = buffer_tell(buffer) - start;
+	if (count == 0 || size > UINT16_MAX) {
+		LOG_WARN("TXT has no strings");
 		return -1;
 	}
+	rdata->txt.strings = buffer_data(buffer) + start;
+	rdata->txt.length = (uint16_t)size;
+	rdata->txt.count = (uint16_t)count;
 	return 0;
 }
 
 void free_rdata_txt(dns_rdata_t *rdata) {
-	free(rdata->txt.data);
+	UNUSED(rdata); // Nothing to do
 }
 
-void print_rdata_txt(dns_rdata_t *rdata) {
-	LOG_PRINTF("\"%s\" \n", rdata->txt.data);
+void print_rdata_txt(dns_rdata_t *rdata, output_t *out) {
+	const uint8_t *ptr = rdata->txt.strings;
+	output_begin_list(out, "data");
+	// Already validated by parse_rdata_txt()
+	for (uint16_t i = 0; i < rdata->txt.count; i++) {
+		output_field_strn(out, NULL, (const char *)ptr + 1, ptr[0]);
+		ptr += 1 + ptr[0];
+	}
+	output_end_list(out);
 }
@@ -5,14 +5,20 @@
 // Forward declarations
 typedef struct buffer buffer_t;
 typedef union dns_rdata dns_rdata_t;
+typedef struct output output_t;
 
 //
-// TXT
+// TXT, also used by SPF
 //
+// REFERENCE: https://datatracker.ietf.org/doc/html/rfc1035#section-3.3.14
 typedef struct dns_rdata_txt {
-	char *	data; // Descriptive human-readable text
+	// One or more <character-string>, as they are in the message. Descriptive
+	// human-readable text, or e.g. SPF and DKIM records split into several strings.
+	const uint8_t *	strings;
+	uint16_t	length;
+	uint16_t	count;
 } dns_rdata_txt_t;
 
 int parse_rdata_txt(dns_rdata_t *rdata, buffer_t *buffer);
 void free_rdata_txt(dns_rdata_t *rdata);
-void print_rdata_txt(dns_rdata_t *rdata);
+void print_rdata_txt(dns_rdata_t *rdata, output_t *out);
@@ -1,8 +1,10 @@
 #include "rr.h"
 #include "log.h"
+#include "output.h"
 #include "proto/dns/arrays.h"
 #include "proto/dns/name.h"
 #include "types/buffer.h"
+#include "types/buffer_span.h"
 #include <arpa/inet.h> // for ntohs + struct in_addr + in6_addr
 #include <stdlib.h>  // for malloc
 #include <string.h>  // for memset
@@ -14,23 +16,18 @@ dns_rr_t *parse_rr(buffer_t *buffer) {
 	memset(rr, 0, sizeof(dns_rr_t));
 	{
 		rr->name = parse_name(buffer);
-		if (rr->name == NULL) {
-			// An empty name is acceptable in null RRs.
-			free_rr(rr);
-			return NULL;
-		}
-		rr->qtype = buffer_read_uint16(buffer);
-		rr->qclass = buffer_read_uint16(buffer);
-		rr->ttl = buffer_read_uint32(buffer);
-		rr->rdlen = buffer_read_uint16(buffer);
-		if (buffer_has_error(buffer)) {
+		if (rr->name == NULL)
+			goto error; // The root is "." instead, e.g. in OPT RRs
+		// Fixed part: type, class, ttl and rdlength
+		const uint8_t *span = buffer_read_span(buffer, 10);
+		if (span == NULL) {
 			LOG_WARN("detected an error in the buffer while reading RR");
 			goto error;
 		}
-		rr->qtype = ntohs(rr->qtype);
-		rr->qclass = ntohs(rr->qclass);
-		rr->ttl = ntohl(rr->ttl);
-		rr->rdlen = ntohs(rr->rdlen);
+		rr->qtype = buffer_span_uint16(span, 0);
+		rr->qclass = buffer_span_uint16(span, 2);
+		rr->ttl = buffer_span_uint32(span, 4);
+		rr->rdlen = buffer_span_uint16(span, 8);
 	}
 
 	if (parse_rdata(rr, buffer) != 0) {
@@ -52,10 +49,14 @@ void free_rr(dns_rr_t *rr) {
 	free(rr);
 }
 
-void print_rr(dns_rr_t *rr) {
-	LOG_PRINTF_INDENT(4, "%s\t\t%u\t%s\t%s\t",
-		rr->name, rr->ttl,
-		totext(DNS_ARRAY_QCLASS, rr->qclass),
-		totext(DNS_ARRAY_QTYPE, rr->qtype));
-	print_rdata(rr);
+void print_rr(dns_rr_t *rr, output_t *out) {
+	output_begin_object(out, NULL);
+	output_field_str(out, "name", rr->name);
+	output_field_uint(out, "ttl", rr->ttl);
+	output_field_str(out, "class", totext(DNS_ARRAY_QCLASS, rr->qclass));
+	output_field_str(out, "type", totext(DNS_ARRAY_QTYPE, rr->qtype));
+	output_begin_object(out, "rdata");
+	print_rdata(rr, out);
+	output_end_object(out);
+	output_end_object(out);
 }
@@ -3,7 +3,9 @@
 #include "proto/dns/sections/rdata.h"
 #include "proto/dns/types.h"
 
-typedef struct buffer buffer_t; // Forward declaration
+// Forward declarations
+typedef struct buffer buffer_t;
+typedef struct output output_t;
 
 //
 // RR
@@ -14,9 +16,11 @@ typedef struct dns_rr {
 	dns_qclass_e	qclass:16; // Class of the data in the RDATA field
 	uint32_t		ttl; // How long to keep it cached, in seconds (0 = do not cache)
 	uint16_t		rdlen; // Length of the RDATA field, in bytes
+	const uint8_t *	rdata_wire; // The RDATA field, points into the message
+	const dns_rdata_ops_t *ops; // How `rdata` was decoded, NULL if it wasn't
 	dns_rdata_t		rdata;
 } dns_rr_t;
 
 dns_rr_t *parse_rr(buffer_t *buffer);
 void free_rr(dns_rr_t *rr);
-void print_rr(dns_rr_t *rr);
+void print_rr(dns_rr_t *rr, output_t *out);
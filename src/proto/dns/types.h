@@ -65,7 +65,9 @@ typedef enum {
 	DNS_RC_BADNAME	= 20,
 	DNS_RC_BADALG	= 21,
 	// RFC 4635
-	DNS_RC_BADTRUNC	= 22
+	DNS_RC_BADTRUNC	= 22,
+	// RFC 7873
+	DNS_RC_BADCOOKIE	= 23
 } dns_rcode_ex_e;
 
 typedef enum {
@@ -154,6 +156,9 @@ typedef enum {
 	// Reid
 	DNS_TYPE_NINFO		= 56,
 	DNS_TYPE_RKEY		= 57,
+	// RFC 9460
+	DNS_TYPE_SVCB		= 64, // General-purpose service binding
+	DNS_TYPE_HTTPS		= 65, // SVCB for HTTPS
 	// RFC 4408
 	DNS_TYPE_SPF		= 99, // Sender Policy Framework
 	// IANA Reserved
@@ -174,6 +179,8 @@ typedef enum {
 	DNS_QTYPE_MAILB_	= 253, // Mailbox-related RRs (MB, MG or MR) (OBSOLETE: RFC 2505)
 	DNS_QTYPE_MAILA_	= 254, // Mail agent RRs (OBSOLETE: RFC 973)
 	DNS_QTYPE_ANY		= 255, // All cached records
+	// RFC 8659
+	DNS_TYPE_CAA		= 257, // Certification Authority Authorization
 	// Weiler
 	DNS_TYPE_TA			= 32768, // DNSSEC Trust Authorities
 	// RFC 4431
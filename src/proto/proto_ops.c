@@ -3,14 +3,44 @@
 #include <netinet/ip.h>
 #include <string.h>
 
-int sniff_packet_fromwire(const uint8_t *packet, size_t length, int protocol, const config_t *config) {
+const sniff_pipeline_t sniff_pipeline_count = {
+	.eth = sniff_eth_fromwire_count,
+	.arp = sniff_arp_fromwire_quiet,
+	.ip = sniff_ip_fromwire_count,
+	.icmp = sniff_icmp_fromwire_quiet,
+	.tcp = sniff_tcp_fromwire_count,
+	.udp = sniff_udp_fromwire_count,
+	.dns = sniff_dns_fromwire_quiet,
+};
+
+void sniff_pipeline_init(sniff_pipeline_t *pipeline, const config_t *config) {
+	pipeline->eth = config->display_filters_flag.eth ? sniff_eth_fromwire : sniff_eth_fromwire_quiet;
+	pipeline->arp = config->display_filters_flag.arp ? sniff_arp_fromwire : sniff_arp_fromwire_quiet;
+	pipeline->ip = config->display_filters_flag.ip ? sniff_ip_fromwire : sniff_ip_fromwire_quiet;
+	pipeline->icmp = config->display_filters_flag.icmp ? sniff_icmp_fromwire : sniff_icmp_fromwire_quiet;
+	pipeline->tcp = config->display_filters_flag.tcp || config->display_filters_flag.tcp_data
+		? sniff_tcp_fromwire : sniff_tcp_fromwire_quiet;
+	pipeline->udp = config->display_filters_flag.udp || config->display_filters_flag.udp_data
+		? sniff_udp_fromwire : sniff_udp_fromwire_quiet;
+	pipeline->dns = config->display_filters_flag.dns || config->display_filters_flag.dns_data
+		? sniff_dns_fromwire : sniff_dns_fromwire_quiet;
+
+	// Nothing displayed at all?
+	if (pipeline->eth == sniff_eth_fromwire_quiet && pipeline->arp == sniff_arp_fromwire_quiet
+		&& pipeline->ip == sniff_ip_fromwire_quiet && pipeline->icmp == sniff_icmp_fromwire_quiet
+		&& pipeline->tcp == sniff_tcp_fromwire_quiet && pipeline->udp == sniff_udp_fromwire_quiet
+		&& pipeline->dns == sniff_dns_fromwire_quiet)
+		*pipeline = sniff_pipeline_count;
+}
+
+int sniff_packet_fromwire(sniff_packet_t *desc, int protocol, const config_t *config) {
 	int result = 0;
 	switch (protocol) {
 		case 0:
-			result = sniff_eth_fromwire(packet, length, config);
+			result = config->pipeline.eth(desc->data, desc->caplen, desc, config);
 			break;
 		case ETHERTYPE_IP:
-			result = sniff_ip_fromwire(packet, length, config);
+			result = config->pipeline.ip(desc->data, desc->caplen, desc, config);
 			break;
 		default: break;
 	}
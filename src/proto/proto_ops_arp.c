@@ -11,7 +11,8 @@
 #include <netinet/if_ether.h>
 
 #include "config.h"
-#include "log.h"
+#include "macros.h"
+#include "output.h"
 #include "proto_ops.h"
 
 #include "types/pair.h"
@@ -25,43 +26,46 @@ typedef enum {
 	ARP_ARRAY_OP,
 } arp_array_e;
 
-static pair_t arp_array_hrd_data[] = {
-	{ ARPHRD_ETHER,				"Ethernet" },
+static const char *const arp_array_hrd_names[] = {
+	[ARPHRD_ETHER] =			"Ethernet",
 #ifdef ARPHRD_IEEE802
-	{ ARPHRD_IEEE802,			"IEEE802" },
+	[ARPHRD_IEEE802] =			"IEEE802",
 #endif
 #ifdef ARPHRD_FRELAY
-	{ ARPHRD_FRELAY,			"FRELAY" },
+	[ARPHRD_FRELAY] =			"FRELAY",
 #endif
 #ifdef ARPHRD_IEEE1394
-	{ ARPHRD_IEEE1394,			"IEEE1394" },
+	[ARPHRD_IEEE1394] =			"IEEE1394",
 #endif
 #ifdef ARPHRD_IEEE1394_EUI64
-	{ ARPHRD_IEEE1394_EUI64,	"IEEE1394EUI64" },
+	[ARPHRD_IEEE1394_EUI64] =	"IEEE1394EUI64",
 #endif
-	{ 0,						"Unknown" },
 };
 
-static const pair_array_t arp_array_hrd = {
-	.count = sizeof(arp_array_hrd_data) / sizeof(pair_t),
-	.data = arp_array_hrd_data
+static const pair_table_t arp_array_hrd = {
+	.names = arp_array_hrd_names,
+	.count = sizeof(arp_array_hrd_names) / sizeof(arp_array_hrd_names[0]),
+	.unknown = "Unknown"
 };
 
-static pair_t arp_array_pro_data[] = {
+// Ethertypes are too far apart for a dense table
+static const pair_t arp_array_pro_sparse[] = {
+	{ ETHERTYPE_IP,			"IP" }, // first, as it's by far the most common
+	{ ETHERTYPE_IPV6,		"IP6" },
 	{ ETHERTYPE_PUP,		"PUP" },
-	{ ETHERTYPE_IP,			"IP" },
 	{ ETHERTYPE_ARP,		"ARP" },
 	{ ETHERTYPE_REVARP,		"RARP" },
 	{ ETHERTYPE_VLAN,		"VLAN" }, // IEEE 802.1Q VLAN tagging
-	{ ETHERTYPE_IPV6,		"IP6" },
 	{ ETHERTYPE_LOOPBACK,	"LO" }, // used to test interfaces
 	{ ETHERTYPE_TRAIL,		"TRAIL" }, // trailer packet
-	{ 0,					"Unknown" },
 };
 
-static const pair_array_t arp_array_pro = {
-	.count = sizeof(arp_array_pro_data) / sizeof(pair_t),
-	.data = arp_array_pro_data
+static const pair_table_t arp_array_pro = {
+	.sparse = {
+		.count = sizeof(arp_array_pro_sparse) / sizeof(pair_t),
+		.data = arp_array_pro_sparse
+	},
+	.unknown = "Unknown"
 };
 
 #ifndef OS_LINUX
@@ -72,23 +76,23 @@ static const pair_array_t arp_array_pro = {
 #	define ARPOP_NAK		10
 #endif
 
-static pair_t arp_array_op_data[] = {
-	{ ARPOP_REQUEST,	"Request"  }, // request to resolve address
-	{ ARPOP_REPLY,		"Reply"    }, // response to previous request
-	{ ARPOP_RREQUEST,	"RRequest" }, // request protocol address given hardware
-	{ ARPOP_RREPLY,		"RReply"   }, // response giving protocol address
-	{ ARPOP_InREQUEST,	"IRequest" }, // request to identify peer
-	{ ARPOP_InREPLY,	"IReply"   }, // response identifying peer
-	{ ARPOP_NAK,		"NAK"      }, // (ATM)ARP NAK.
-	{ 0,				"Unknown"  },
+static const char *const arp_array_op_names[] = {
+	[ARPOP_REQUEST] =	"Request",  // request to resolve address
+	[ARPOP_REPLY] =		"Reply",    // response to previous request
+	[ARPOP_RREQUEST] =	"RRequest", // request protocol address given hardware
+	[ARPOP_RREPLY] =	"RReply",   // response giving protocol address
+	[ARPOP_InREQUEST] =	"IRequest", // request to identify peer
+	[ARPOP_InREPLY] =	"IReply",   // response identifying peer
+	[ARPOP_NAK] =		"NAK",      // (ATM)ARP NAK.
 };
 
-static const pair_array_t arp_array_op = {
-	.count = sizeof(arp_array_op_data) / sizeof(pair_t),
-	.data = arp_array_op_data
+static const pair_table_t arp_array_op = {
+	.names = arp_array_op_names,
+	.count = sizeof(arp_array_op_names) / sizeof(arp_array_op_names[0]),
+	.unknown = "Unknown"
 };
 
-static const pair_array_t *select_array(arp_array_e type) {
+static const pair_table_t *select_table(arp_array_e type) {
 	switch (type) {
 		case ARP_ARRAY_HRD: return &arp_array_hrd; break;
 		case ARP_ARRAY_PRO: return &arp_array_pro; break;
@@ -98,19 +102,31 @@ static const pair_array_t *select_array(arp_array_e type) {
 }
 
 static const char *totext(arp_array_e type, int key) {
-	const pair_array_t *array = select_array(type);
-	const pair_t *result = pair_array_lookup_key(array, key);
-	return result == NULL ? pair_array_last(array)->value : result->value;
+	return pair_table_lookup_key(select_table(type), key);
 }
 
 static int fromtext(arp_array_e type, const char *value) {
-	const pair_array_t *array = select_array(type);
-	const pair_t *result = pair_array_lookup_value(array, value);
-	return result == NULL ? pair_array_last(array)->key : result->key;
+	return pair_table_lookup_value(select_table(type), value);
 }
 
-int sniff_arp_fromwire(const uint8_t *packet, size_t length, const config_t *config) {
+static ALWAYS_INLINE int arp_fromwire(const uint8_t *packet, size_t length, sniff_packet_t *desc, bool display) {
+	output_t *out = desc->output;
+	sniff_packet_count(desc, STATS_PROTO_ARP, length);
 	const struct ether_arp *header = (struct ether_arp *)packet;
+
+	if (length < sizeof(struct ether_arp)) {
+		if (display) {
+			output_begin_object(out, "arp");
+			output_field_uint(out, "bytes", length);
+			output_field_str(out, "error", "invalid packet (truncated)");
+			output_end_object(out);
+		}
+		return sniff_packet_decode_error(desc, STATS_PROTO_ARP);
+	}
+
+	if (!display)
+		return 0;
+
 	uint16_t arphrd = ntohs(header->arp_hrd);
 	uint16_t arppro = ntohs(header->arp_pro);
 	uint16_t arpop = ntohs(header->arp_op);
@@ -127,18 +143,30 @@ int sniff_arp_fromwire(const uint8_t *packet, size_t length, const config_t *con
 	char arp_tpa_as_str[INET_ADDRSTRLEN];
 	utils_in_addr_to_str(arp_tpa_as_str, sizeof(arp_tpa_as_str), (struct in_addr *)&header->arp_tpa);
 
-	if (config->display_filters_flag.arp) {
-		LOG_PRINTF("-- ARP (%lu bytes)\n", length);
-		LOG_PRINTF_INDENT(2, "hrd: %u [%s]\n", arphrd, totext(ARP_ARRAY_HRD, arphrd)); // format of hardware address
-		LOG_PRINTF_INDENT(2, "pro: 0x%04x [%s]\n", arppro, totext(ARP_ARRAY_PRO, arppro)); // format of protocol address
-		LOG_PRINTF_INDENT(2, "hln: %u\n", header->arp_hln); // length of hardware address
-		LOG_PRINTF_INDENT(2, "pln: %u\n", header->arp_pln); // length of protocol address
-		LOG_PRINTF_INDENT(2, "op : %u [%s]\n", arpop, totext(ARP_ARRAY_OP, arpop));
-		LOG_PRINTF_INDENT(2, "sha: %s\n", arp_sha_as_str); // sender hardware address
-		LOG_PRINTF_INDENT(2, "spa: %s\n", arp_spa_as_str); // sender protocol address
-		LOG_PRINTF_INDENT(2, "tha: %s\n", arp_tha_as_str); // target hardware address
-		LOG_PRINTF_INDENT(2, "tpa: %s\n", arp_tpa_as_str); // target protocol address
-	}
+	output_begin_object(out, "arp");
+	output_field_uint(out, "bytes", length);
+	output_field_uint(out, "hrd", arphrd); // format of hardware address
+	output_field_str(out, "hrd_name", totext(ARP_ARRAY_HRD, arphrd));
+	output_field_hex(out, "pro", arppro); // format of protocol address
+	output_field_str(out, "pro_name", totext(ARP_ARRAY_PRO, arppro));
+	output_field_uint(out, "hln", header->arp_hln); // length of hardware address
+	output_field_uint(out, "pln", header->arp_pln); // length of protocol address
+	output_field_uint(out, "op", arpop);
+	output_field_str(out, "op_name", totext(ARP_ARRAY_OP, arpop));
+	output_field_str(out, "sha", arp_sha_as_str); // sender hardware address
+	output_field_str(out, "spa", arp_spa_as_str); // sender protocol address
+	output_field_str(out, "tha", arp_tha_as_str); // target hardware address
+	output_field_str(out, "tpa", arp_tpa_as_str); // target protocol address
+	output_end_object(out);
 
 	return 0;
 }
+
+int sniff_arp_fromwire(const uint8_t *packet, size_t length, sniff_packet_t *desc, const config_t *config) {
+	return arp_fromwire(packet, length, desc, config->display_filters_flag.arp);
+}
+
+int sniff_arp_fromwire_quiet(const uint8_t *packet, size_t length, sniff_packet_t *desc, const config_t *config) {
+	UNUSED(config);
+	return arp_fromwire(packet, length, desc, false);
+}
@@ -1,71 +1,244 @@
 #include "config.h"
-#include "dump.h"
-#include "log.h"
+#include "macros.h"
+#include "output.h"
 #include "proto_ops.h"
+#include "proto/dns/anomaly.h"
 #include "proto/dns/dns.h"
 #include "proto/dns/header.h"
+#include "proto/dns/name.h"
+#include "proto/dns/name_filter.h"
+#include "proto/dns/pdns.h"
 #include "proto/dns/sections/question.h"
+#include "proto/dns/sections/rdata/opt.h"
 #include "proto/dns/sections/rr.h"
 #include "types/buffer.h"
+#include "types/buffer_span.h"
+#include "utils.h"
+#include <arpa/inet.h> // for INET_ADDRSTRLEN
+#include <netinet/in.h> // for IPPROTO_TCP
+#include <time.h>
 
-int sniff_dns_fromwire(const uint8_t *packet, size_t length, const config_t *config) {
+static int sniff_dns_question_section(buffer_t *buffer, output_t *out, uint16_t count) {
+	output_begin_list(out, "question");
+	for (uint16_t i=0; i < count; i++) {
+		dns_question_t *section = parse_question(buffer);
+		if (section == NULL) {
+			output_end_list(out);
+			return -1;
+		}
+		print_question(section, out);
+		free_question(section);
+	}
+	output_end_list(out);
+	return 0;
+}
+
+static int sniff_dns_rr_section(buffer_t *buffer, output_t *out, const char *name, uint16_t count) {
+	output_begin_list(out, name);
+	for (uint16_t i=0; i < count; i++) {
+		dns_rr_t *section = parse_rr(buffer);
+		if (section == NULL) {
+			output_end_list(out);
+			return -1;
+		}
+		print_rr(section, out);
+		free_rr(section);
+	}
+	output_end_list(out);
+	return 0;
+}
+
+// Lets each message stand on its own, e.g. when only `dns` is displayed
+static void print_flow(const sniff_flow_t *flow, output_t *out) {
+	if (flow->family != AF_INET)
+		return;
+
+	char src_as_str[INET_ADDRSTRLEN];
+	utils_in_addr_to_str(src_as_str, sizeof(src_as_str), (const struct in_addr *)flow->src);
+
+	char dst_as_str[INET_ADDRSTRLEN];
+	utils_in_addr_to_str(dst_as_str, sizeof(dst_as_str), (const struct in_addr *)flow->dst);
+
+	output_field_str(out, "src", src_as_str);
+	output_field_uint(out, "sport", flow->sport);
+	output_field_str(out, "dst", dst_as_str);
+	output_field_uint(out, "dport", flow->dport);
+	output_field_str(out, "transport", flow->protocol == IPPROTO_TCP ? "tcp" : "udp");
+}
+
+// Counts what the OPT RR advertises. The buffer size and the client subnet are the
+// requestor's, so they're only counted in queries.
+static void count_edns(stats_counters_t *stats, const dns_rdata_opt_t *opt, bool query) {
+	stats_inc(&stats->dns_edns);
+	if (opt->dnssec_ok)
+		stats_inc(&stats->dns_edns_dnssec_ok);
+	if (opt->cookie != NULL)
+		stats_inc(&stats->dns_edns_cookies);
+	if (opt->has_padding)
+		stats_add(&stats->dns_edns_padding_bytes, opt->padding_length);
+	if (!query)
+		return;
+	stats_count_dns_udp_size(stats, opt->udp_size);
+	if (opt->has_client_subnet) {
+		// The prefix was validated against the family while decoding
+		if (opt->ecs_family == 1)
+			stats_inc(&stats->dns_ecs_ipv4_prefixes[opt->ecs_source_prefix]);
+		else
+			stats_inc(&stats->dns_ecs_ipv6_prefixes[opt->ecs_source_prefix]);
+	}
+}
+
+static void detect_anomalies(sniff_packet_t *desc, const char *qname, bool query, uint16_t rcode) {
+	const sniff_flow_t *flow = &desc->flow;
+	dns_anomaly_message_t message = {
+		.now = dns_anomaly_now(),
+		.qname = qname,
+		.response = !query,
+		.rcode = rcode,
+		.family = flow->family,
+		.client = query ? flow->src : flow->dst,
+	};
+	if (dns_anomaly_count(desc->anomaly, &message, desc->output, desc->stats))
+		desc->alerted = true;
+}
+
+// Counts responses by rcode, queries by the type of their first question, and the EDNS0
+// options of both. Then feeds the anomaly detector, if any.
+static void count_message(sniff_packet_t *desc, const dns_hdr_t *header, const buffer_t *buffer) {
+	stats_counters_t *stats = desc->stats;
+	bool query = !header->flags.expanded.qr;
+	uint16_t rcode = header->flags.expanded.rcode;
+	if (header->ar_c != 0) {
+		dns_rdata_opt_t opt;
+		if (dns_opt_find(&opt, header, buffer) > 0) {
+			if (stats != NULL)
+				count_edns(stats, &opt, query);
+			rcode |= (uint16_t)(opt.extended_rcode << 4);
+		}
+	}
+	if (!query && stats != NULL)
+		stats_count_dns_rcode(stats, rcode);
+	// Both count queries, but only the detector looks into the responses
+	if (header->qd_c == 0 || (query ? (stats == NULL && desc->anomaly == NULL) : desc->anomaly == NULL))
+		return;
+
+	// The detector is the only one that needs the name
+	buffer_t peek = *buffer; // Leave the position alone for the decoder
+	char qname[DNS_NAME_MAXLEN + 1];
+	uint16_t qtype, qclass;
+	if (decode_question_type(&peek, desc->anomaly != NULL ? qname : NULL, &qtype, &qclass) != 0)
+		return;
+	if (query && stats != NULL)
+		stats_count_dns_qtype(stats, qtype);
+	if (desc->anomaly != NULL)
+		detect_anomalies(desc, qname, query, rcode);
+}
+
+// Whether a question of the message is below one of the suffixes of `names`
+static bool match_names(const dns_name_filter_t *names, const dns_hdr_t *header, const buffer_t *buffer) {
+	buffer_t peek = *buffer; // Leave the position alone for the decoder
+	for (uint16_t i = 0; i < header->qd_c; i++) {
+		int ret = dns_name_filter_match(names, &peek);
+		if (ret != 0)
+			return ret > 0;
+		if (buffer_read_span(&peek, 4) == NULL)
+			return false;
+	}
+	return false;
+}
+
+// Nothing past the header is needed unless the message is displayed, counted or watched.
+// The passive DNS store walks the answers on its own, without allocating them.
+static dns_decode_level_e decode_level(const sniff_packet_t *desc, bool display) {
+	if (display)
+		return DNS_DECODE_FULL;
+	if (desc->stats != NULL || desc->anomaly != NULL || desc->pdns != NULL)
+		return DNS_DECODE_QUESTION;
+	return DNS_DECODE_HEADER;
+}
+
+static ALWAYS_INLINE int dns_decode(const uint8_t *packet, size_t length, sniff_packet_t *desc,
+	dns_decode_level_e level, bool display_data)
+{
 	int result = 0;
+	output_t *out = desc->output;
+	sniff_packet_count(desc, STATS_PROTO_DNS, length);
 	buffer_t buffer = BUFFER_INITIALIZER;
 	buffer_set_data(&buffer, (uint8_t *)packet, length);
 
-	if (config->display_filters_flag.dns) {
-		LOG_PRINTF("-- DNS (%u bytes)\n", buffer_size(&buffer));
+	dns_hdr_t header;
+	bool has_header = decode_header(&header, &buffer) == 0;
+	buffer_t sections = buffer; // Where the question section starts
+	bool matched = desc->names == NULL;
+	if (!matched && has_header && match_names(desc->names, &header, &sections)) {
+		matched = true;
+		desc->name_matched = true;
+	}
+
+	// Messages filtered out by name are never displayed, so they aren't decoded any further
+	if (!matched && level == DNS_DECODE_FULL)
+		level = DNS_DECODE_QUESTION;
+	if (level == DNS_DECODE_FULL) {
+		output_begin_object(out, "dns");
+		output_field_uint(out, "bytes", buffer_size(&buffer));
+		print_flow(&desc->flow, out);
 	}
 
-	dns_hdr_t *header = parse_header(&buffer);
-	if (header == NULL) {
+	if (!has_header) {
 		result = -1;
+		if (level == DNS_DECODE_FULL)
+			output_field_str(out, "error", "invalid header");
 	} else {
-		if (config->display_filters_flag.dns) {
-			print_header(header);
+		if (level == DNS_DECODE_FULL) {
+			print_header(&header, out);
+			result = sniff_dns_question_section(&buffer, out, header.qd_c);
+			if (result == 0)
+				result = sniff_dns_rr_section(&buffer, out, "answer", header.an_c);
+			if (result == 0)
+				result = sniff_dns_rr_section(&buffer, out, "authority", header.ns_c);
+			if (result == 0)
+				result = sniff_dns_rr_section(&buffer, out, "additional", header.ar_c);
+			if (result != 0)
+				output_field_str(out, "error", "invalid section");
 		}
 	}
 
-	if (config->display_filters_flag.dns) {
-		LOG_PRINTF_INDENT(2, "QUESTION SECTION:\n");
-		for (uint16_t i=0; result == 0 && i < header->qd_c; i++) {
-			dns_question_t *section = parse_question(&buffer);
-			if (section == NULL) { result = -1; }
-			else { print_question(section); free_question(section); }
-		}
-		LOG_PRINTF_INDENT(2, "ANSWER SECTION:\n");
-		for (uint16_t i=0; result == 0 && i < header->an_c; i++) {
-			dns_rr_t *section = parse_rr(&buffer);
-			if (section == NULL) { result = -1; }
-			else { print_rr(section); free_rr(section); }
-		}
-		LOG_PRINTF_INDENT(2, "AUTHORITY SECTION:\n");
-		for (uint16_t i=0; result == 0 && i < header->ns_c; i++) {
-			dns_rr_t *section = parse_rr(&buffer);
-			if (section == NULL) { result = -1; }
-			else { print_rr(section); free_rr(section); }
-		}
-		LOG_PRINTF_INDENT(2, "ADDITIONAL SECTION:\n");
-		for (uint16_t i=0; result == 0 && i < header->ar_c; i++) {
-			dns_rr_t *section = parse_rr(&buffer);
-			if (section == NULL) { result = -1; }
-			else { print_rr(section); free_rr(section); }
-		}
+	if (level == DNS_DECODE_FULL) {
+		output_end_object(out);
 	}
 
-	free_header(header);
+	// After the `dns` object, as the alerts of the anomaly detector have their own
+	if (level >= DNS_DECODE_QUESTION && has_header)
+		count_message(desc, &header, &sections);
+	if (level >= DNS_DECODE_QUESTION && desc->pdns != NULL && has_header && header.an_c != 0) {
+		uint64_t seen = desc->timestamp != 0 ? desc->timestamp / SNIFF_NSEC_PER_SEC : (uint64_t)time(NULL);
+		dns_pdns_add_answers(desc->pdns, &header, &sections, seen, desc->stats);
+	}
 
-//	packet = (uint8_t *)PTR_ADD(packet, DNS_HDR_LEN);
-//	length -= DNS_HDR_LEN;
-	if (config->display_filters_flag.dns_data) {
-		LOG_PRINTF("showing %lu bytes:\n", length);
-		dump_hex(stdout, packet, length, 0);
+	if (result != 0)
+		sniff_packet_decode_error(desc, STATS_PROTO_DNS);
+
+	if (display_data && matched) {
+		output_begin_object(out, "dns-data");
+		output_field_bytes(out, "data", packet, length);
+		output_end_object(out);
 	}
-//	if (result == 0) {
-//		packet = buffer_data_ptr(&buffer);
-//		length = buffer_left(&buffer);
-//		dump_hex(packet, length, 0);
-//	}
 
 	return result;
 }
+
+int sniff_dns_fromwire(const uint8_t *packet, size_t length, sniff_packet_t *desc, const config_t *config) {
+	bool display = config->display_filters_flag.dns;
+	return dns_decode(packet, length, desc, decode_level(desc, display), config->display_filters_flag.dns_data);
+}
+
+int sniff_dns_fromwire_quiet(const uint8_t *packet, size_t length, sniff_packet_t *desc, const config_t *config) {
+	UNUSED(config);
+	return dns_decode(packet, length, desc, decode_level(desc, false), false);
+}
+
+int sniff_dns_decode(const uint8_t *packet, size_t length, sniff_packet_t *desc,
+	dns_decode_level_e level, bool display_data)
+{
+	return dns_decode(packet, length, desc, level, display_data);
+}
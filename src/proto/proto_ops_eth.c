@@ -2,46 +2,61 @@
 #include <net/ethernet.h>
 #include <stdio.h>
 
-#include "system.h"
-#ifdef OS_LINUX
-#	include <netinet/ether.h> // for `ether_ntoa`
-#endif
-
 #include "config.h"
-#include "log.h"
 #include "macros.h"
+#include "output.h"
 #include "proto_ops.h"
+#include "utils.h"
 
 
 // TODO(jweyrich): linux uses struct ethhdr
-int sniff_eth_fromwire(const uint8_t *packet, size_t length, const config_t *config) {
+static ALWAYS_INLINE int eth_fromwire(const uint8_t *packet, size_t length, sniff_packet_t *desc, const config_t *config,
+	const sniff_pipeline_t *next, bool display)
+{
 	int result = 0;
+	output_t *out = desc->output;
+	sniff_packet_count(desc, STATS_PROTO_ETH, length);
 	const struct ether_header *header = (struct ether_header *)packet;
-	uint16_t type = ntohs(header->ether_type);
 	uint16_t header_len = ETHER_HDR_LEN;
 
-	if (config->display_filters_flag.eth) {
-		LOG_PRINTF("-- ETH (%lu bytes)\n", length);
+	if (display) {
+		output_begin_object(out, "eth");
+		output_field_uint(out, "bytes", length);
+		if (SNIFF_PACKET_IS_TRUNCATED(desc))
+			output_field_uint(out, "wirelen", desc->wirelen);
 	}
 
+	if (length < header_len) {
+		if (display) {
+			output_field_str(out, "error", "invalid packet (truncated)");
+			output_end_object(out);
+		}
+		return sniff_packet_decode_error(desc, STATS_PROTO_ETH);
+	}
+
+	uint16_t type = ntohs(header->ether_type);
+
 	if (type < ETHER_MIN_LEN) {
-		if (config->display_filters_flag.eth) {
-			LOG_PRINTF_INDENT(2, "\tinvalid packet\n");
+		if (display) {
+			output_field_str(out, "error", "invalid packet");
+			output_end_object(out);
 		}
-		return -1;
+		return sniff_packet_decode_error(desc, STATS_PROTO_ETH);
 	}
 
-	if (config->display_filters_flag.eth) {
+	if (display) {
+		char host_as_str[18];
 		if (type <= ETHERMTU)
-			LOG_PRINTF_INDENT(2, "\tframe: IEEE 802.3\n");
+			output_field_str(out, "frame", "IEEE 802.3");
 		else
-			LOG_PRINTF_INDENT(2, "\tframe: Ethernet\n");
-		LOG_PRINTF_INDENT(2, "\tdhost: %s\n", ether_ntoa((struct ether_addr *)&header->ether_dhost));
-		LOG_PRINTF_INDENT(2, "\tshost: %s\n", ether_ntoa((struct ether_addr *)&header->ether_shost));
+			output_field_str(out, "frame", "Ethernet");
+		output_field_str(out, "dhost", utils_ether_addr_to_str(host_as_str, sizeof(host_as_str), (struct ether_addr *)&header->ether_dhost));
+		output_field_str(out, "shost", utils_ether_addr_to_str(host_as_str, sizeof(host_as_str), (struct ether_addr *)&header->ether_shost));
 		if (type < ETHERMTU)
-			LOG_PRINTF_INDENT(2, "\tlen  : %u\n", type);
+			output_field_uint(out, "len", type);
 		else
-			LOG_PRINTF_INDENT(2, "\ttype : 0x%x\n", type);
+			output_field_hex(out, "type", type);
+		output_end_object(out);
 	}
 
 	packet = (uint8_t *)PTR_ADD(header, header_len);
@@ -49,10 +64,10 @@ int sniff_eth_fromwire(const uint8_t *packet, size_t length, const config_t *con
 
 	switch (type) {
 		case ETHERTYPE_IP:
-			result = sniff_ip_fromwire(packet, length, config);
+			result = next->ip(packet, length, desc, config);
 			break;
 		case ETHERTYPE_ARP:
-			result = sniff_arp_fromwire(packet, length, config);
+			result = next->arp(packet, length, desc, config);
 			break;
 		default:
 			break;
@@ -60,3 +75,15 @@ int sniff_eth_fromwire(const uint8_t *packet, size_t length, const config_t *con
 
 	return result;
 }
+
+int sniff_eth_fromwire(const uint8_t *packet, size_t length, sniff_packet_t *desc, const config_t *config) {
+	return eth_fromwire(packet, length, desc, config, &config->pipeline, config->display_filters_flag.eth);
+}
+
+int sniff_eth_fromwire_quiet(const uint8_t *packet, size_t length, sniff_packet_t *desc, const config_t *config) {
+	return eth_fromwire(packet, length, desc, config, &config->pipeline, false);
+}
+
+int sniff_eth_fromwire_count(const uint8_t *packet, size_t length, sniff_packet_t *desc, const config_t *config) {
+	return eth_fromwire(packet, length, desc, config, &sniff_pipeline_count, false);
+}
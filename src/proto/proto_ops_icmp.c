@@ -7,47 +7,59 @@
 #include <stdio.h>
 
 #include "config.h"
-#include "log.h"
+#include "macros.h"
+#include "output.h"
 #include "proto_ops.h"
 #include "utils.h"
 
-int sniff_icmp_fromwire(const uint8_t *packet, size_t length, const config_t *config) {
+static ALWAYS_INLINE int icmp_fromwire(const uint8_t *packet, size_t length, sniff_packet_t *desc, bool display) {
+	output_t *out = desc->output;
+	sniff_packet_count(desc, STATS_PROTO_ICMP, length);
 	const struct icmp *header = (struct icmp *)packet;
 
-	if (config->display_filters_flag.icmp) {
-		LOG_PRINTF("-- ICMP (%lu bytes)\n", length);
-	}
+	if (!display)
+		return length < ICMP_MINLEN || header->icmp_type > ICMP_MAXTYPE ? -1 : 0;
+
+	output_begin_object(out, "icmp");
+	output_field_uint(out, "bytes", length);
 
 	if (length < ICMP_MINLEN || header->icmp_type > ICMP_MAXTYPE) {
-		if (config->display_filters_flag.icmp) {
-			LOG_PRINTF_INDENT(2, "\tinvalid packet\n");
-		}
-		return -1;
+		output_field_str(out, "error", "invalid packet");
+		output_end_object(out);
+		return sniff_packet_decode_error(desc, STATS_PROTO_ICMP);
 	}
 
-	if (config->display_filters_flag.icmp) {
-		LOG_PRINTF_INDENT(2, "\ttype   : %u\n", header->icmp_type); // type of message
-		LOG_PRINTF_INDENT(2, "\tcode   : %u\n", header->icmp_code); // type sub code
-		LOG_PRINTF_INDENT(2, "\tcksum  : %u\n", ntohs(header->icmp_cksum)); // ones complement cksum of struct
-
-		if (header->icmp_type == ICMP_ECHOREPLY || header->icmp_type == ICMP_ECHO) {
-				LOG_PRINTF_INDENT(2, "\tid	: %u\n", ntohs(header->icmp_id));
-				LOG_PRINTF_INDENT(2, "\tseq   : %u\n", ntohs(header->icmp_seq));
-		} else if (header->icmp_type == ICMP_UNREACH) {
-			if (header->icmp_code == ICMP_UNREACH_NEEDFRAG) {
-				LOG_PRINTF_INDENT(2, "\tpmvoid : %u\n", ntohs(header->icmp_pmvoid));
-				LOG_PRINTF_INDENT(2, "\tnextmtu: %u\n", ntohs(header->icmp_nextmtu));
-			} else {
-				LOG_PRINTF_INDENT(2, "\tvoid   : %u\n", ntohl(header->icmp_void));
-			}
-		} else if (header->icmp_type == ICMP_REDIRECT) {
-			char icmp_gwaddr_as_str[INET_ADDRSTRLEN];
-			utils_in_addr_to_str(icmp_gwaddr_as_str, sizeof(icmp_gwaddr_as_str), &header->icmp_gwaddr);
-			LOG_PRINTF_INDENT(2, "\tgwaddr : %s\n", icmp_gwaddr_as_str);
-		} else if (header->icmp_type == ICMP_TIMXCEED) {
-			LOG_PRINTF_INDENT(2, "\tvoid   : %u\n", ntohl(header->icmp_void));
+	output_field_uint(out, "type", header->icmp_type); // type of message
+	output_field_uint(out, "code", header->icmp_code); // type sub code
+	output_field_uint(out, "cksum", ntohs(header->icmp_cksum)); // ones complement cksum of struct
+
+	if (header->icmp_type == ICMP_ECHOREPLY || header->icmp_type == ICMP_ECHO) {
+		output_field_uint(out, "id", ntohs(header->icmp_id));
+		output_field_uint(out, "seq", ntohs(header->icmp_seq));
+	} else if (header->icmp_type == ICMP_UNREACH) {
+		if (header->icmp_code == ICMP_UNREACH_NEEDFRAG) {
+			output_field_uint(out, "pmvoid", ntohs(header->icmp_pmvoid));
+			output_field_uint(out, "nextmtu", ntohs(header->icmp_nextmtu));
+		} else {
+			output_field_uint(out, "void", ntohl(header->icmp_void));
 		}
+	} else if (header->icmp_type == ICMP_REDIRECT) {
+		char icmp_gwaddr_as_str[INET_ADDRSTRLEN];
+		utils_in_addr_to_str(icmp_gwaddr_as_str, sizeof(icmp_gwaddr_as_str), &header->icmp_gwaddr);
+		output_field_str(out, "gwaddr", icmp_gwaddr_as_str);
+	} else if (header->icmp_type == ICMP_TIMXCEED) {
+		output_field_uint(out, "void", ntohl(header->icmp_void));
 	}
 
+	output_end_object(out);
 	return 0;
 }
+
+int sniff_icmp_fromwire(const uint8_t *packet, size_t length, sniff_packet_t *desc, const config_t *config) {
+	return icmp_fromwire(packet, length, desc, config->display_filters_flag.icmp);
+}
+
+int sniff_icmp_fromwire_quiet(const uint8_t *packet, size_t length, sniff_packet_t *desc, const config_t *config) {
+	UNUSED(config);
+	return icmp_fromwire(packet, length, desc, false);
+}
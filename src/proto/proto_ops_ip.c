@@ -6,10 +6,12 @@
 #include <netinet/ip.h>
 #include <netdb.h>
 #include <stdio.h>
+#include <string.h>
+#include <sys/socket.h> // for AF_INET
 
 #include "config.h"
-#include "log.h"
 #include "macros.h"
+#include "output.h"
 #include "proto_ops.h"
 #include "utils.h"
 
@@ -17,14 +19,18 @@
 // http://64.233.163.132/search?q=cache:IxxD7kq2CAAJ:www.w00w00.org/files/sectools/fragrouter/print.c+IP_OFFMASK&cd=1&hl=en&ct=clnk
 // TODO(jweyrich): linux uses struct iphdr
 
-int sniff_ip_fromwire(const uint8_t *packet, size_t length, const config_t *config) {
+static ALWAYS_INLINE int ip_fromwire(const uint8_t *packet, size_t length, sniff_packet_t *desc, const config_t *config,
+	const sniff_pipeline_t *next, bool display)
+{
 	int result = 0;
-	
+	output_t *out = desc->output;
+	sniff_packet_count(desc, STATS_PROTO_IP, length);
+
 	// Basic bounds check before accessing any fields
 	if (length < sizeof(struct ip)) {
-		return -1;
+		return sniff_packet_decode_error(desc, STATS_PROTO_IP);
 	}
-	
+
 	const struct ip *header = (struct ip *)packet;
 	uint16_t header_len = header->ip_hl << 2;
 	uint16_t ip_len = ntohs(header->ip_len);
@@ -32,67 +38,102 @@ int sniff_ip_fromwire(const uint8_t *packet, size_t length, const config_t *conf
 	uint16_t ip_off = ntohs(header->ip_off) & IP_OFFMASK; // fragment offset (lower 13 bits)
 	uint16_t ip_sum = ntohs(header->ip_sum);
 
-	if (config->display_filters_flag.ip) {
-		LOG_PRINTF("-- IP (%lu bytes)\n", ip_len);
+	if (display) {
+		output_begin_object(out, "ip");
+		output_field_uint(out, "bytes", ip_len);
 	}
 
-	// Basic validation: check minimum packet length, IP version, and header length
-	if (header->ip_v != 4 || header_len < sizeof(struct ip) || header_len > length) {
-		if (config->display_filters_flag.ip) {
-			LOG_PRINTF_INDENT(2, "\tinvalid packet (validation failed: length=%lu, ip_v=%u, ip_hl=%u, header_len=%u)\n",
-				length, header->ip_v, header->ip_hl, header_len);
+	// Basic validation: check minimum packet length, IP version, and header length.
+	// The total length can't be smaller than the header, or the payload length would wrap.
+	if (header->ip_v != 4 || header_len < sizeof(struct ip) || header_len > length || ip_len < header_len) {
+		if (display) {
+			output_field_str(out, "error", "invalid packet (validation failed)");
+			output_field_uint(out, "length", length);
+			output_field_uint(out, "ip_v", header->ip_v);
+			output_field_uint(out, "ip_hl", header->ip_hl);
+			output_end_object(out);
 		}
-		return -1;
+		return sniff_packet_decode_error(desc, STATS_PROTO_IP);
 	}
 
 	// Allow packets larger than IP length (common with padding),
-	// but reject truncated packets
+	// but reject truncated packets unless they were cut short by the snaplen
 	if (ip_len > length) {
-		if (config->display_filters_flag.ip) {
-			LOG_PRINTF_INDENT(2, "\tinvalid packet (truncated)\n");
+		if (!SNIFF_PACKET_IS_TRUNCATED(desc)) {
+			if (display) {
+				output_field_str(out, "error", "invalid packet (truncated)");
+				output_end_object(out);
+			}
+			return sniff_packet_decode_error(desc, STATS_PROTO_IP);
+		}
+		if (display) {
+			output_field_uint(out, "captured", length); // cut short by the snaplen
 		}
-		return -1;
 	}
 
-	char ip_src_as_str[INET_ADDRSTRLEN];
-	utils_in_addr_to_str(ip_src_as_str, sizeof(ip_src_as_str), &header->ip_src);
+	if (display) {
+		char ip_src_as_str[INET_ADDRSTRLEN];
+		utils_in_addr_to_str(ip_src_as_str, sizeof(ip_src_as_str), &header->ip_src);
 
-	char ip_dst_as_str[INET_ADDRSTRLEN];
-	utils_in_addr_to_str(ip_dst_as_str, sizeof(ip_dst_as_str), &header->ip_dst);
+		char ip_dst_as_str[INET_ADDRSTRLEN];
+		utils_in_addr_to_str(ip_dst_as_str, sizeof(ip_dst_as_str), &header->ip_dst);
 
-	if (config->display_filters_flag.ip) {
-		LOG_PRINTF_INDENT(2, "\tv  : %u\n", header->ip_v); // version
-		LOG_PRINTF_INDENT(2, "\thl : %u\n", header_len); // header length
-		LOG_PRINTF_INDENT(2, "\ttos: 0x%x\n", header->ip_tos); // type of service
-		LOG_PRINTF_INDENT(2, "\tlen: %u\n", ip_len); // total length
-		LOG_PRINTF_INDENT(2, "\tid : %u\n", ip_id); // identification
-		LOG_PRINTF_INDENT(2, "\toff: %u\n", ip_off); // fragment offset (lower 13 bits)
-		LOG_PRINTF_INDENT(2, "\tttl: %u\n", header->ip_ttl); // time to live
+		output_field_uint(out, "v", header->ip_v); // version
+		output_field_uint(out, "hl", header_len); // header length
+		output_field_hex(out, "tos", header->ip_tos); // type of service
+		output_field_uint(out, "len", ip_len); // total length
+		output_field_uint(out, "id", ip_id); // identification
+		output_field_uint(out, "off", ip_off); // fragment offset (lower 13 bits)
+		output_field_uint(out, "ttl", header->ip_ttl); // time to live
+		output_field_uint(out, "p", header->ip_p); // protocol
 		struct protoent *proto = getprotobynumber(header->ip_p);
-		LOG_PRINTF_INDENT(2, "\tp  : %u [%s]\n", header->ip_p, proto ? proto->p_name : "unknown");
-		LOG_PRINTF_INDENT(2, "\tsum: %u\n", ip_sum); // checksum
-		LOG_PRINTF_INDENT(2, "\tsrc: %s\n", ip_src_as_str); // source address
-		LOG_PRINTF_INDENT(2, "\tdst: %s\n", ip_dst_as_str); // destination address
+		output_field_str(out, "p_name", proto ? proto->p_name : "unknown");
+		output_field_uint(out, "sum", ip_sum); // checksum
+		output_field_str(out, "src", ip_src_as_str); // source address
+		output_field_str(out, "dst", ip_dst_as_str); // destination address
 	}
 
 	// fragmented? Check the More Fragments flag
 	if ((ip_off & IP_MF) != 0) {
-		if (config->display_filters_flag.ip) {
-			LOG_PRINTF_INDENT(2, "\tfragmented\n");
+		if (display) {
+			output_field_str(out, "error", "fragmented");
+			output_end_object(out);
 		}
 		return -1;
 	}
 
+	if (display) {
+		output_end_object(out);
+	}
+
+	desc->flow.family = AF_INET;
+	desc->flow.protocol = header->ip_p;
+	memcpy(desc->flow.src, &header->ip_src, sizeof(header->ip_src));
+	memcpy(desc->flow.dst, &header->ip_dst, sizeof(header->ip_dst));
+
 	packet = (uint8_t *)PTR_ADD(header, header_len);
-	// Use the IP packet's actual payload length, not the received buffer length
-	size_t payload_length = ip_len - header_len;
+	// Use the IP packet's actual payload length, not the received buffer length,
+	// but never go past what was actually captured
+	size_t payload_length = (ip_len < length ? ip_len : length) - header_len;
 
 	switch (header->ip_p) {
-		case IPPROTO_TCP: result = sniff_tcp_fromwire(packet, payload_length, config); break;
-		case IPPROTO_UDP: result = sniff_udp_fromwire(packet, payload_length, config); break;
-		case IPPROTO_ICMP: result = sniff_icmp_fromwire(packet, payload_length, config); break;
+		case IPPROTO_TCP: result = next->tcp(packet, payload_length, desc, config); break;
+		case IPPROTO_UDP: result = next->udp(packet, payload_length, desc, config); break;
+		case IPPROTO_ICMP: result = next->icmp(packet, payload_length, desc, config); break;
 		default: break;
 	}
 
 	return result;
 }
+
+int sniff_ip_fromwire(const uint8_t *packet, size_t length, sniff_packet_t *desc, const config_t *config) {
+	return ip_fromwire(packet, length, desc, config, &config->pipeline, config->display_filters_flag.ip);
+}
+
+int sniff_ip_fromwire_quiet(const uint8_t *packet, size_t length, sniff_packet_t *desc, const config_t *config) {
+	return ip_fromwire(packet, length, desc, config, &config->pipeline, false);
+}
+
+int sniff_ip_fromwire_count(const uint8_t *packet, size_t length, sniff_packet_t *desc, const config_t *config) {
+	return ip_fromwire(packet, length, desc, config, &sniff_pipeline_count, false);
+}
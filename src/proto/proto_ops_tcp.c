@@ -6,9 +6,8 @@
 #include <stdio.h>
 #include <string.h>
 
-#include "dump.h"
-#include "log.h"
 #include "macros.h"
+#include "output.h"
 #include "proto_ops.h"
 #include "system.h"
 #include "types/buffer.h"
@@ -37,36 +36,47 @@ static const char *flags_totext(uint8_t value) {
 	return text;
 }
 
-int sniff_tcp_fromwire(const uint8_t *packet, size_t length, const config_t *config) {
+static ALWAYS_INLINE int tcp_fromwire(const uint8_t *packet, size_t length, sniff_packet_t *desc, const config_t *config,
+	const sniff_pipeline_t *next, bool display, bool display_data)
+{
+	output_t *out = desc->output;
+	sniff_packet_count(desc, STATS_PROTO_TCP, length);
 	const struct tcphdr *header = (struct tcphdr *)packet;
-	uint16_t header_len = header->th_off * 4;
 
-	if (config->display_filters_flag.tcp) {
-		LOG_PRINTF("-- TCP (%lu bytes)\n", length);
+	if (display) {
+		output_begin_object(out, "tcp");
+		output_field_uint(out, "bytes", length);
 	}
 
-	if (length < header_len) {
-		if (config->display_filters_flag.tcp) {
-			LOG_PRINTF_INDENT(2, "\tinvalid packet\n");
+	uint16_t header_len = length < sizeof(struct tcphdr) ? 0 : header->th_off * 4;
+	if (header_len < sizeof(struct tcphdr) || length < header_len) {
+		if (display) {
+			output_field_str(out, "error", "invalid packet");
+			output_end_object(out);
 		}
-		return -1;
+		return sniff_packet_decode_error(desc, STATS_PROTO_TCP);
 	}
 
 	uint16_t sport = ntohs(header->th_sport);
 	uint16_t dport = ntohs(header->th_dport);
 
-	if (config->display_filters_flag.tcp) {
-		LOG_PRINTF_INDENT(2, "\tsport: %u\n", sport); // source port
-		LOG_PRINTF_INDENT(2, "\tdport: %u\n", dport); // destination port
-		LOG_PRINTF_INDENT(2, "\tseq  : %u\n", ntohl(header->th_seq)); // sequence number
-		LOG_PRINTF_INDENT(2, "\tack  : %u\n", ntohl(header->th_ack)); // acknowledgement number
-		LOG_PRINTF_INDENT(2, "\toff  : %u\n", header->th_off); // data offset
-		LOG_PRINTF_INDENT(2, "\tflags: %u [%s]\n", header->th_flags, flags_totext(header->th_flags)); // flags
-		LOG_PRINTF_INDENT(2, "\twin  : %u\n", ntohs(header->th_win)); // window
-		LOG_PRINTF_INDENT(2, "\tsum  : %u\n", ntohs(header->th_sum)); // checksum
-		LOG_PRINTF_INDENT(2, "\turp  : %u\n", ntohs(header->th_urp)); // urgent pointer
+	if (display) {
+		output_field_uint(out, "sport", sport); // source port
+		output_field_uint(out, "dport", dport); // destination port
+		output_field_uint(out, "seq", ntohl(header->th_seq)); // sequence number
+		output_field_uint(out, "ack", ntohl(header->th_ack)); // acknowledgement number
+		output_field_uint(out, "off", header->th_off); // data offset
+		output_field_uint(out, "flags", header->th_flags); // flags
+		output_field_str(out, "flags_text", flags_totext(header->th_flags));
+		output_field_uint(out, "win", ntohs(header->th_win)); // window
+		output_field_uint(out, "sum", ntohs(header->th_sum)); // checksum
+		output_field_uint(out, "urp", ntohs(header->th_urp)); // urgent pointer
+		output_end_object(out);
 	}
 
+	desc->flow.sport = sport;
+	desc->flow.dport = dport;
+
 	packet = (uint8_t *)PTR_ADD(packet, header_len);
 	length -= header_len;
 
@@ -82,13 +92,29 @@ int sniff_tcp_fromwire(const uint8_t *packet, size_t length, const config_t *con
 		dns_len = buffer_read_uint16(&buffer);
 		dns_len = ntohs(dns_len);
 		if (!buffer_has_error(&buffer)) {
-			sniff_dns_fromwire(buffer_data_ptr(&buffer), dns_len, config);
+			// The message may have been cut short by the snaplen
+			if (dns_len > buffer_remaining(&buffer))
+				dns_len = buffer_remaining(&buffer);
+			next->dns(buffer_data_ptr(&buffer), dns_len, desc, config);
 		}
 	}
 
-	if (config->display_filters_flag.tcp_data) {
-		LOG_PRINTF("showing %lu bytes:\n", length);
-		dump_hex(stdout, packet, length, 0);
+	if (display_data) {
+		output_begin_object(out, "tcp-data");
+		output_field_bytes(out, "data", packet, length);
+		output_end_object(out);
 	}
 	return 0;
 }
+
+int sniff_tcp_fromwire(const uint8_t *packet, size_t length, sniff_packet_t *desc, const config_t *config) {
+	return tcp_fromwire(packet, length, desc, config, &config->pipeline, config->display_filters_flag.tcp, config->display_filters_flag.tcp_data);
+}
+
+int sniff_tcp_fromwire_quiet(const uint8_t *packet, size_t length, sniff_packet_t *desc, const config_t *config) {
+	return tcp_fromwire(packet, length, desc, config, &config->pipeline, false, false);
+}
+
+int sniff_tcp_fromwire_count(const uint8_t *packet, size_t length, sniff_packet_t *desc, const config_t *config) {
+	return tcp_fromwire(packet, length, desc, config, &sniff_pipeline_count, false, false);
+}
@@ -3,28 +3,50 @@
 #include <stdio.h>
 
 #include "config.h"
-#include "dump.h"
-#include "log.h"
 #include "macros.h"
+#include "output.h"
 #include "proto_ops.h"
 
 #define UDP_HDR_LEN 8
 
-int sniff_udp_fromwire(const uint8_t *packet, size_t length, const config_t *config) {
+static ALWAYS_INLINE int udp_fromwire(const uint8_t *packet, size_t length, sniff_packet_t *desc, const config_t *config,
+	const sniff_pipeline_t *next, bool display, bool display_data)
+{
+	output_t *out = desc->output;
+	sniff_packet_count(desc, STATS_PROTO_UDP, length);
 	const struct udphdr *header = (struct udphdr *)packet;
+
+	if (display) {
+		output_begin_object(out, "udp");
+		output_field_uint(out, "bytes", length);
+	}
+
+	if (length < UDP_HDR_LEN || ntohs(header->uh_ulen) < UDP_HDR_LEN) {
+		if (display) {
+			output_field_str(out, "error", "invalid packet");
+			output_end_object(out);
+		}
+		return sniff_packet_decode_error(desc, STATS_PROTO_UDP);
+	}
+
 	uint16_t sport = ntohs(header->uh_sport);
 	uint16_t dport = ntohs(header->uh_dport);
+	uint16_t ulen = ntohs(header->uh_ulen);
 
-	if (config->display_filters_flag.udp) {
-		LOG_PRINTF("-- UDP (%lu bytes)\n", length);
-		LOG_PRINTF_INDENT(2,  "\tsport: %u\n", sport); // source port
-		LOG_PRINTF_INDENT(2,  "\tdport: %u\n", dport); // destination port
-		LOG_PRINTF_INDENT(2,  "\tulen : %u\n", ntohs(header->uh_ulen)); // udp length
-		LOG_PRINTF_INDENT(2,  "\tsum  : %u\n", header->uh_sum); // udp checksum
+	if (display) {
+		output_field_uint(out, "sport", sport); // source port
+		output_field_uint(out, "dport", dport); // destination port
+		output_field_uint(out, "ulen", ulen); // udp length
+		output_field_uint(out, "sum", header->uh_sum); // udp checksum
+		output_end_object(out);
 	}
 
+	desc->flow.sport = sport;
+	desc->flow.dport = dport;
+
 	packet = (uint8_t *)PTR_ADD(packet, UDP_HDR_LEN);
-	length = ntohs(header->uh_ulen) - UDP_HDR_LEN;
+	// The payload may have been cut short by the snaplen
+	length = (ulen < length ? ulen : length) - UDP_HDR_LEN;
 
 	// If there is no data, we can return now
 	if (length == 0) {
@@ -32,13 +54,26 @@ int sniff_udp_fromwire(const uint8_t *packet, size_t length, const config_t *con
 	}
 
 	if (sport == 53 || dport == 53) {
-		sniff_dns_fromwire(packet, length, config);
+		next->dns(packet, length, desc, config);
 	}
 
-	if (config->display_filters_flag.udp_data) {
-		LOG_PRINTF("showing %lu bytes:\n", length);
-		dump_hex(stdout, packet, length, 0);
+	if (display_data) {
+		output_begin_object(out, "udp-data");
+		output_field_bytes(out, "data", packet, length);
+		output_end_object(out);
 	}
 
 	return 0;
 }
+
+int sniff_udp_fromwire(const uint8_t *packet, size_t length, sniff_packet_t *desc, const config_t *config) {
+	return udp_fromwire(packet, length, desc, config, &config->pipeline, config->display_filters_flag.udp, config->display_filters_flag.udp_data);
+}
+
+int sniff_udp_fromwire_quiet(const uint8_t *packet, size_t length, sniff_packet_t *desc, const config_t *config) {
+	return udp_fromwire(packet, length, desc, config, &config->pipeline, false, false);
+}
+
+int sniff_udp_fromwire_count(const uint8_t *packet, size_t length, sniff_packet_t *desc, const config_t *config) {
+	return udp_fromwire(packet, length, desc, config, &sniff_pipeline_count, false, false);
+}
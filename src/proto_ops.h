@@ -2,17 +2,55 @@
 
 #include "channel_ops_common.h"
 #include "config.h"
+#include "packet.h"
+#include "proto/dns/dns.h"
 #include <stdint.h>
 #include <stdlib.h>
 
 //
 // Parsing
 //
-int sniff_packet_fromwire(const uint8_t *packet, size_t length, int protocol, const config_t *config);
-int sniff_eth_fromwire(const uint8_t *packet, size_t length, const config_t *config);
-int sniff_arp_fromwire(const uint8_t *packet, size_t length, const config_t *config);
-int sniff_dns_fromwire(const uint8_t *packet, size_t length, const config_t *config);
-int sniff_icmp_fromwire(const uint8_t *packet, size_t length, const config_t *config);
-int sniff_ip_fromwire(const uint8_t *packet, size_t length, const config_t *config);
-int sniff_tcp_fromwire(const uint8_t *packet, size_t length, const config_t *config);
-int sniff_udp_fromwire(const uint8_t *packet, size_t length, const config_t *config);
+// Decoders receive the captured bytes in `packet`/`length` and the frame descriptor in `desc`.
+// When the capture was truncated by the snaplen, `length` can be smaller than the lengths
+// advertised by the protocol headers themselves.
+int sniff_packet_fromwire(sniff_packet_t *desc, int protocol, const config_t *config);
+// Test the display filters of their protocol as they go
+int sniff_eth_fromwire(const uint8_t *packet, size_t length, sniff_packet_t *desc, const config_t *config);
+int sniff_arp_fromwire(const uint8_t *packet, size_t length, sniff_packet_t *desc, const config_t *config);
+int sniff_dns_fromwire(const uint8_t *packet, size_t length, sniff_packet_t *desc, const config_t *config);
+int sniff_icmp_fromwire(const uint8_t *packet, size_t length, sniff_packet_t *desc, const config_t *config);
+int sniff_ip_fromwire(const uint8_t *packet, size_t length, sniff_packet_t *desc, const config_t *config);
+int sniff_tcp_fromwire(const uint8_t *packet, size_t length, sniff_packet_t *desc, const config_t *config);
+int sniff_udp_fromwire(const uint8_t *packet, size_t length, sniff_packet_t *desc, const config_t *config);
+// Same, but for when nothing of their protocol is displayed. The bodies are shared, and
+// specialized by the compiler with every display filter off, so these only count, validate
+// and hand the payload over.
+int sniff_eth_fromwire_quiet(const uint8_t *packet, size_t length, sniff_packet_t *desc, const config_t *config);
+int sniff_arp_fromwire_quiet(const uint8_t *packet, size_t length, sniff_packet_t *desc, const config_t *config);
+int sniff_dns_fromwire_quiet(const uint8_t *packet, size_t length, sniff_packet_t *desc, const config_t *config);
+int sniff_icmp_fromwire_quiet(const uint8_t *packet, size_t length, sniff_packet_t *desc, const config_t *config);
+int sniff_ip_fromwire_quiet(const uint8_t *packet, size_t length, sniff_packet_t *desc, const config_t *config);
+int sniff_tcp_fromwire_quiet(const uint8_t *packet, size_t length, sniff_packet_t *desc, const config_t *config);
+int sniff_udp_fromwire_quiet(const uint8_t *packet, size_t length, sniff_packet_t *desc, const config_t *config);
+// Same, but for when nothing at all is displayed. These hand the payload over through
+// sniff_pipeline_count rather than the pipeline of `config`, which the compiler can see
+// through when optimizing the whole program, and turn into direct calls.
+int sniff_eth_fromwire_count(const uint8_t *packet, size_t length, sniff_packet_t *desc, const config_t *config);
+int sniff_ip_fromwire_count(const uint8_t *packet, size_t length, sniff_packet_t *desc, const config_t *config);
+int sniff_tcp_fromwire_count(const uint8_t *packet, size_t length, sniff_packet_t *desc, const config_t *config);
+int sniff_udp_fromwire_count(const uint8_t *packet, size_t length, sniff_packet_t *desc, const config_t *config);
+// Decodes a DNS message no further than `level`, whatever the display filters. From
+// DNS_DECODE_QUESTION on, it's also counted and fed to `desc->anomaly` and `desc->pdns`,
+// and at DNS_DECODE_FULL it's emitted too, unless `desc->names` filters it out.
+int sniff_dns_decode(const uint8_t *packet, size_t length, sniff_packet_t *desc,
+	dns_decode_level_e level, bool display_data);
+
+//
+// Pipeline
+//
+// The decoders of the pipeline in which nothing is displayed, e.g. when only counting
+extern const sniff_pipeline_t sniff_pipeline_count;
+
+// Picks the quiet decoder of every protocol that the display filters of `config` leave out,
+// so those cost no test of the filters at all. The filters can't change after this.
+void sniff_pipeline_init(sniff_pipeline_t *pipeline, const config_t *config);
@@ -0,0 +1,102 @@
+#include "stats.h"
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *const g_proto_names[STATS_PROTO_COUNT] = {
+	[STATS_PROTO_ETH] = "eth",
+	[STATS_PROTO_ARP] = "arp",
+	[STATS_PROTO_IP] = "ip",
+	[STATS_PROTO_ICMP] = "icmp",
+	[STATS_PROTO_TCP] = "tcp",
+	[STATS_PROTO_UDP] = "udp",
+	[STATS_PROTO_DNS] = "dns",
+};
+
+// From a packet read as soon as it arrived, to a capture that's falling behind
+const uint32_t stats_latency_bounds[STATS_LATENCY_BUCKETS - 1] = { 10, 100, 1000, 10000, 100000 };
+
+// The classic limit, the DNS Flag Day 2020 default, what fits in a typical MTU, and BIND's default
+const uint16_t stats_dns_udp_size_bounds[STATS_DNS_UDP_SIZE_BUCKETS - 1] = { 512, 1232, 1400, 4096 };
+
+stats_counters_t *stats_counters_alloc(void) {
+	// sizeof() is a multiple of the alignment, as required by aligned_alloc()
+	stats_counters_t *counters = aligned_alloc(STATS_CACHE_LINE_SIZE, sizeof(stats_counters_t));
+	if (counters == NULL)
+		return NULL;
+	memset(counters, 0, sizeof(stats_counters_t));
+	return counters;
+}
+
+void stats_counters_free(stats_counters_t *counters) {
+	free(counters);
+}
+
+void stats_counters_snapshot(const stats_counters_t *counters, stats_snapshot_t *snapshot) {
+	memset(snapshot, 0, sizeof(stats_snapshot_t));
+	if (counters == NULL)
+		return;
+	snapshot->kernel_received = atomic_load_explicit(&counters->kernel_received, memory_order_relaxed);
+	snapshot->kernel_dropped = atomic_load_explicit(&counters->kernel_dropped, memory_order_relaxed);
+	snapshot->packets = atomic_load_explicit(&counters->packets, memory_order_relaxed);
+	snapshot->bytes = atomic_load_explicit(&counters->bytes, memory_order_relaxed);
+	snapshot->filter_accepted = atomic_load_explicit(&counters->filter_accepted, memory_order_relaxed);
+	snapshot->filter_rejected = atomic_load_explicit(&counters->filter_rejected, memory_order_relaxed);
+	snapshot->truncated = atomic_load_explicit(&counters->truncated, memory_order_relaxed);
+	for (int i = 0; i < STATS_LATENCY_BUCKETS; i++)
+		snapshot->latency[i] = atomic_load_explicit(&counters->latency[i], memory_order_relaxed);
+	snapshot->latency_sum = atomic_load_explicit(&counters->latency_sum, memory_order_relaxed);
+	for (int i = 0; i < STATS_PROTO_COUNT; i++) {
+		snapshot->proto_packets[i] = atomic_load_explicit(&counters->proto_packets[i], memory_order_relaxed);
+		snapshot->proto_bytes[i] = atomic_load_explicit(&counters->proto_bytes[i], memory_order_relaxed);
+		snapshot->decode_errors[i] = atomic_load_explicit(&counters->decode_errors[i], memory_order_relaxed);
+	}
+	for (int i = 0; i < STATS_DNS_RCODE_COUNT; i++)
+		snapshot->dns_rcodes[i] = atomic_load_explicit(&counters->dns_rcodes[i], memory_order_relaxed);
+	for (int i = 0; i < STATS_DNS_QTYPE_COUNT; i++)
+		snapshot->dns_qtypes[i] = atomic_load_explicit(&counters->dns_qtypes[i], memory_order_relaxed);
+	snapshot->dns_edns = atomic_load_explicit(&counters->dns_edns, memory_order_relaxed);
+	snapshot->dns_edns_dnssec_ok = atomic_load_explicit(&counters->dns_edns_dnssec_ok, memory_order_relaxed);
+	snapshot->dns_edns_cookies = atomic_load_explicit(&counters->dns_edns_cookies, memory_order_relaxed);
+	snapshot->dns_edns_padding_bytes = atomic_load_explicit(&counters->dns_edns_padding_bytes, memory_order_relaxed);
+	for (int i = 0; i < STATS_DNS_UDP_SIZE_BUCKETS; i++)
+		snapshot->dns_edns_udp_sizes[i] = atomic_load_explicit(&counters->dns_edns_udp_sizes[i], memory_order_relaxed);
+	snapshot->dns_edns_udp_size_sum = atomic_load_explicit(&counters->dns_edns_udp_size_sum, memory_order_relaxed);
+	for (int i = 0; i < STATS_DNS_ECS_IPV4_PREFIXES; i++)
+		snapshot->dns_ecs_ipv4_prefixes[i] = atomic_load_explicit(&counters->dns_ecs_ipv4_prefixes[i], memory_order_relaxed);
+	for (int i = 0; i < STATS_DNS_ECS_IPV6_PREFIXES; i++)
+		snapshot->dns_ecs_ipv6_prefixes[i] = atomic_load_explicit(&counters->dns_ecs_ipv6_prefixes[i], memory_order_relaxed);
+	for (int i = 0; i < STATS_DNS_ALERT_COUNT; i++)
+		snapshot->dns_alerts[i] = atomic_load_explicit(&counters->dns_alerts[i], memory_order_relaxed);
+	snapshot->dns_pdns_answers = atomic_load_explicit(&counters->dns_pdns_answers, memory_order_relaxed);
+	snapshot->dns_pdns_tuples = atomic_load_explicit(&counters->dns_pdns_tuples, memory_order_relaxed);
+	snapshot->dns_pdns_dropped = atomic_load_explicit(&counters->dns_pdns_dropped, memory_order_relaxed);
+}
+
+const char *stats_proto_name(stats_proto_e proto) {
+	if ((unsigned)proto >= STATS_PROTO_COUNT)
+		return "unknown";
+	return g_proto_names[proto];
+}
+
+void stats_print(FILE *stream, const stats_snapshot_t *snapshot) {
+	fprintf(stream, "Stats: kernel received=%" PRIu64 " dropped=%" PRIu64
+		" | read packets=%" PRIu64 " bytes=%" PRIu64
+		" | filter accepted=%" PRIu64 " rejected=%" PRIu64
+		" | truncated=%" PRIu64 " | decode errors",
+		snapshot->kernel_received, snapshot->kernel_dropped,
+		snapshot->packets, snapshot->bytes,
+		snapshot->filter_accepted, snapshot->filter_rejected,
+		snapshot->truncated);
+	for (int i = 0; i < STATS_PROTO_COUNT; i++)
+		fprintf(stream, " %s=%" PRIu64, g_proto_names[i], snapshot->decode_errors[i]);
+	uint64_t timed = 0;
+	for (int i = 0; i < STATS_LATENCY_BUCKETS; i++)
+		timed += snapshot->latency[i];
+	fprintf(stream, " | latency avg=%.1fus", timed == 0 ? 0.0 : (double)snapshot->latency_sum / (double)timed / 1000.0);
+	for (int i = 0; i < STATS_LATENCY_BUCKETS - 1; i++)
+		fprintf(stream, " <=%" PRIu32 "us=%" PRIu64, stats_latency_bounds[i], snapshot->latency[i]);
+	fprintf(stream, " more=%" PRIu64, snapshot->latency[STATS_LATENCY_BUCKETS - 1]);
+	fprintf(stream, " | output written=%" PRIu64 " dropped=%" PRIu64 "\n",
+		snapshot->output_written, snapshot->output_dropped);
+}
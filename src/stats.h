@@ -0,0 +1,147 @@
+#pragma once
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#define STATS_CACHE_LINE_SIZE 64
+#define STATS_DNS_RCODE_OTHER 24	// shared by every extended rcode above BADCOOKIE
+#define STATS_DNS_RCODE_COUNT (STATS_DNS_RCODE_OTHER + 1)
+#define STATS_DNS_QTYPE_OTHER 256	// shared by every qtype above 255 (CAA, URI, TA, ...)
+#define STATS_DNS_QTYPE_COUNT (STATS_DNS_QTYPE_OTHER + 1)
+#define STATS_LATENCY_BUCKETS 6	// see stats_latency_bounds
+#define STATS_DNS_UDP_SIZE_BUCKETS 5	// see stats_dns_udp_size_bounds
+#define STATS_DNS_ECS_IPV4_PREFIXES 33	// 0 to 32 bits
+#define STATS_DNS_ECS_IPV6_PREFIXES 129	// 0 to 128 bits
+#define STATS_DNS_ALERT_COUNT 3	// see dns_alert_e
+
+//
+// Types
+//
+typedef enum {
+	STATS_PROTO_ETH,
+	STATS_PROTO_ARP,
+	STATS_PROTO_IP,
+	STATS_PROTO_ICMP,
+	STATS_PROTO_TCP,
+	STATS_PROTO_UDP,
+	STATS_PROTO_DNS,
+	STATS_PROTO_COUNT
+} stats_proto_e;
+
+// Counters owned by a single thread. Only the owner writes them, without read-modify-write
+// instructions, and any other thread may read them. The alignment keeps the counters of
+// different threads on different cache lines.
+typedef struct stats_counters {
+	_Alignas(STATS_CACHE_LINE_SIZE) atomic_uint_fast64_t kernel_received; // counted by the kernel (after the native filter on Linux)
+	atomic_uint_fast64_t kernel_dropped;	// dropped by the kernel because we didn't read fast enough
+	atomic_uint_fast64_t packets;			// read from the channel
+	atomic_uint_fast64_t bytes;				// original length of the packets read
+	atomic_uint_fast64_t filter_accepted;	// passed the filter (always equal to `packets` with native BPF)
+	atomic_uint_fast64_t filter_rejected;	// rejected by the emulated filter
+	atomic_uint_fast64_t truncated;			// cut short by the snaplen
+	atomic_uint_fast64_t latency[STATS_LATENCY_BUCKETS];	// from the timestamp of the kernel to the dispatch
+	atomic_uint_fast64_t latency_sum;		// in nanoseconds
+	atomic_uint_fast64_t proto_packets[STATS_PROTO_COUNT];
+	atomic_uint_fast64_t proto_bytes[STATS_PROTO_COUNT];
+	atomic_uint_fast64_t decode_errors[STATS_PROTO_COUNT];
+	atomic_uint_fast64_t dns_rcodes[STATS_DNS_RCODE_COUNT];	// of responses, extended by their OPT RR
+	atomic_uint_fast64_t dns_qtypes[STATS_DNS_QTYPE_COUNT];	// of the first question of queries
+	atomic_uint_fast64_t dns_edns;					// messages with an OPT RR
+	atomic_uint_fast64_t dns_edns_dnssec_ok;		// of which with the DO bit set
+	atomic_uint_fast64_t dns_edns_cookies;			// of which with a cookie
+	atomic_uint_fast64_t dns_edns_padding_bytes;	// in the padding options
+	atomic_uint_fast64_t dns_edns_udp_sizes[STATS_DNS_UDP_SIZE_BUCKETS];	// advertised by queries
+	atomic_uint_fast64_t dns_edns_udp_size_sum;
+	atomic_uint_fast64_t dns_ecs_ipv4_prefixes[STATS_DNS_ECS_IPV4_PREFIXES];	// source prefix of queries
+	atomic_uint_fast64_t dns_ecs_ipv6_prefixes[STATS_DNS_ECS_IPV6_PREFIXES];
+	atomic_uint_fast64_t dns_alerts[STATS_DNS_ALERT_COUNT];	// raised by the anomaly detector
+	atomic_uint_fast64_t dns_pdns_answers;			// added to the passive DNS store
+	atomic_uint_fast64_t dns_pdns_tuples;			// of which were new tuples
+	atomic_uint_fast64_t dns_pdns_dropped;			// of which didn't fit
+} stats_counters_t;
+
+// Plain copy of the counters, plus those kept elsewhere
+typedef struct stats_snapshot {
+	uint64_t kernel_received;
+	uint64_t kernel_dropped;
+	uint64_t packets;
+	uint64_t bytes;
+	uint64_t filter_accepted;
+	uint64_t filter_rejected;
+	uint64_t truncated;
+	uint64_t latency[STATS_LATENCY_BUCKETS];
+	uint64_t latency_sum;
+	uint64_t proto_packets[STATS_PROTO_COUNT];
+	uint64_t proto_bytes[STATS_PROTO_COUNT];
+	uint64_t decode_errors[STATS_PROTO_COUNT];
+	uint64_t dns_rcodes[STATS_DNS_RCODE_COUNT];
+	uint64_t dns_qtypes[STATS_DNS_QTYPE_COUNT];
+	uint64_t dns_edns;
+	uint64_t dns_edns_dnssec_ok;
+	uint64_t dns_edns_cookies;
+	uint64_t dns_edns_padding_bytes;
+	uint64_t dns_edns_udp_sizes[STATS_DNS_UDP_SIZE_BUCKETS];
+	uint64_t dns_edns_udp_size_sum;
+	uint64_t dns_ecs_ipv4_prefixes[STATS_DNS_ECS_IPV4_PREFIXES];
+	uint64_t dns_ecs_ipv6_prefixes[STATS_DNS_ECS_IPV6_PREFIXES];
+	uint64_t dns_alerts[STATS_DNS_ALERT_COUNT];
+	uint64_t dns_pdns_answers;
+	uint64_t dns_pdns_tuples;
+	uint64_t dns_pdns_dropped;
+	uint64_t output_written;	// records
+	uint64_t output_dropped;	// records
+} stats_snapshot_t;
+
+// Upper bounds of the buckets of latency, in microseconds, but the last, which has none
+extern const uint32_t stats_latency_bounds[STATS_LATENCY_BUCKETS - 1];
+// Upper bounds of the buckets of dns_edns_udp_sizes, but the last, which has none
+extern const uint16_t stats_dns_udp_size_bounds[STATS_DNS_UDP_SIZE_BUCKETS - 1];
+
+//
+// Allocation
+//
+stats_counters_t *stats_counters_alloc(void);
+void stats_counters_free(stats_counters_t *counters);
+
+//
+// Operations
+//
+// Only to be called by the thread that owns `counter`
+static inline void stats_add(atomic_uint_fast64_t *counter, uint64_t value) {
+	uint64_t current = atomic_load_explicit(counter, memory_order_relaxed);
+	atomic_store_explicit(counter, current + value, memory_order_relaxed);
+}
+
+static inline void stats_inc(atomic_uint_fast64_t *counter) {
+	stats_add(counter, 1);
+}
+
+static inline void stats_count_latency(stats_counters_t *counters, uint64_t nanoseconds) {
+	int i = 0;
+	while (i < STATS_LATENCY_BUCKETS - 1 && nanoseconds > (uint64_t)stats_latency_bounds[i] * 1000)
+		i++;
+	stats_inc(&counters->latency[i]);
+	stats_add(&counters->latency_sum, nanoseconds);
+}
+
+static inline void stats_count_dns_qtype(stats_counters_t *counters, uint16_t qtype) {
+	stats_inc(&counters->dns_qtypes[qtype < STATS_DNS_QTYPE_OTHER ? qtype : STATS_DNS_QTYPE_OTHER]);
+}
+
+static inline void stats_count_dns_rcode(stats_counters_t *counters, uint16_t rcode) {
+	stats_inc(&counters->dns_rcodes[rcode < STATS_DNS_RCODE_OTHER ? rcode : STATS_DNS_RCODE_OTHER]);
+}
+
+static inline void stats_count_dns_udp_size(stats_counters_t *counters, uint16_t udp_size) {
+	int i = 0;
+	while (i < STATS_DNS_UDP_SIZE_BUCKETS - 1 && udp_size > stats_dns_udp_size_bounds[i])
+		i++;
+	stats_inc(&counters->dns_edns_udp_sizes[i]);
+	stats_add(&counters->dns_edns_udp_size_sum, udp_size);
+}
+
+// Safe to call from any thread
+void stats_counters_snapshot(const stats_counters_t *counters, stats_snapshot_t *snapshot);
+const char *stats_proto_name(stats_proto_e proto);
+void stats_print(FILE *stream, const stats_snapshot_t *snapshot);
@@ -1,4 +1,5 @@
 #include "types/buffer.h"
+#include "types/buffer_span.h"
 #include "compat/string_compat.h"
 #include "log.h"
 #include <stdarg.h>
@@ -25,7 +26,8 @@ static int buffer_safe_offset(buffer_t *buffer, int offset) {
             buffer, buffer->size, offset);
         return 0;
     }
-    if ((uint32_t)offset >= cur_size) {
+    // The end is a valid position, there's just nothing left to read from it
+    if ((uint32_t)offset > cur_size) {
         buffer->error.code = BUFFER_EOVERFLOW;
         buffer->error.info.memreq = offset;
         LOG_WARN("Attempt to access an invalid offset (buffer=%p size=%u offset=%u)",
@@ -181,6 +183,10 @@ uint32_t buffer_remaining(const buffer_t *buffer) {
     return buffer->size - buffer->current;
 }
 
+void buffer_span_error(buffer_t *buffer, uint32_t size) {
+    buffer_safe_size(buffer, size);
+}
+
 int buffer_read(buffer_t *buffer, uint8_t *output, size_t size) {
     uint8_t *data = buffer_data_ptr(buffer);
     if (!buffer_safe_size(buffer, size))
@@ -208,9 +214,9 @@ int16_t buffer_read_int16(buffer_t *buffer) {
         return 0;
     uint8_t *data = buffer_data_ptr(buffer);
     buffer->current += 2;
-    int16_t output = ((int16_t)data[1]) << 8;
-    output |= ((int16_t)data[0]);
-    return output;
+    uint16_t output = (uint16_t)(data[1] << 8);
+    output |= ((uint16_t)data[0]);
+    return (int16_t)output;
 }
 
 int32_t buffer_read_int32(buffer_t *buffer) {
@@ -218,11 +224,12 @@ int32_t buffer_read_int32(buffer_t *buffer) {
         return 0;
     uint8_t *data = buffer_data_ptr(buffer);
     buffer->current += 4;
-    int32_t output = ((int32_t)data[3]) << 24;
-    output |= ((int32_t)data[2]) << 16;
-    output |= ((int32_t)data[1]) << 8;
-    output |= ((int32_t)data[0]);
-    return output;
+    // Assembled unsigned, as shifting into the sign bit of a signed integer is undefined
+    uint32_t output = ((uint32_t)data[3]) << 24;
+    output |= ((uint32_t)data[2]) << 16;
+    output |= ((uint32_t)data[1]) << 8;
+    output |= ((uint32_t)data[0]);
+    return (int32_t)output;
 }
 
 int64_t buffer_read_int64(buffer_t *buffer) {
@@ -230,15 +237,15 @@ int64_t buffer_read_int64(buffer_t *buffer) {
         return 0;
     uint8_t *data = buffer_data_ptr(buffer);
     buffer->current += 8;
-    int64_t output = ((int64_t)data[7]) << 56;
-    output |= ((int64_t)data[6]) << 48;
-    output |= ((int64_t)data[5]) << 40;
-    output |= ((int64_t)data[4]) << 32;
-    output |= ((int64_t)data[3]) << 24;
-    output |= ((int64_t)data[2]) << 16;
-    output |= ((int64_t)data[1]) << 8;
-    output |= ((int64_t)data[0]);
-    return output;
+    uint64_t output = ((uint64_t)data[7]) << 56;
+    output |= ((uint64_t)data[6]) << 48;
+    output |= ((uint64_t)data[5]) << 40;
+    output |= ((uint64_t)data[4]) << 32;
+    output |= ((uint64_t)data[3]) << 24;
+    output |= ((uint64_t)data[2]) << 16;
+    output |= ((uint64_t)data[1]) << 8;
+    output |= ((uint64_t)data[0]);
+    return (int64_t)output;
 }
 
 uint8_t buffer_read_uint8(buffer_t *buffer) {
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "types/buffer.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+//
+//  Usage:
+//
+//	const uint8_t *span = buffer_read_span(buffer, 10);
+//	if (span == NULL)
+//		goto error; // the buffer has the error, like with buffer_read_*()
+//	rr->qtype = buffer_span_uint16(span, 0);
+//	rr->ttl = buffer_span_uint32(span, 4);
+//
+// Fast path of the reader for fixed-size fields: the bounds are checked once for the whole
+// span, and then each field is loaded without any check. Unlike buffer_read_uint16() and
+// friends, the loads convert from network to host byte order.
+//
+
+#if defined(__GNUC__) && defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#   define BUFFER_SPAN_NTOH16(x)    __builtin_bswap16(x)
+#   define BUFFER_SPAN_NTOH32(x)    __builtin_bswap32(x)
+#elif defined(__GNUC__) && defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#   define BUFFER_SPAN_NTOH16(x)    (x)
+#   define BUFFER_SPAN_NTOH32(x)    (x)
+#endif
+
+// Flags the buffer as overflowed. Out of line, so that the inlined fast path stays small.
+void buffer_span_error(buffer_t *buffer, uint32_t size);
+
+// Returns the next `size` bytes and moves past them, or NULL if there aren't that many.
+static inline const uint8_t *buffer_read_span(buffer_t *buffer, uint32_t size) {
+    if (buffer->size - buffer->current < size) {
+        buffer_span_error(buffer, size);
+        return NULL;
+    }
+    const uint8_t *span = buffer->data + buffer->current;
+    buffer->current += size;
+    return span;
+}
+
+//
+// Unchecked loads, `offset` bytes into a span
+//
+static inline uint8_t buffer_span_uint8(const uint8_t *span, size_t offset) {
+    return span[offset];
+}
+
+static inline uint16_t buffer_span_uint16(const uint8_t *span, size_t offset) {
+#ifdef BUFFER_SPAN_NTOH16
+    uint16_t value;
+    memcpy(&value, span + offset, sizeof(value)); // a single unaligned load
+    return BUFFER_SPAN_NTOH16(value);
+#else
+    return (uint16_t)((span[offset] << 8) | span[offset + 1]);
+#endif
+}
+
+static inline uint32_t buffer_span_uint32(const uint8_t *span, size_t offset) {
+#ifdef BUFFER_SPAN_NTOH32
+    uint32_t value;
+    memcpy(&value, span + offset, sizeof(value));
+    return BUFFER_SPAN_NTOH32(value);
+#else
+    return ((uint32_t)span[offset] << 24) | ((uint32_t)span[offset + 1] << 16)
+        | ((uint32_t)span[offset + 2] << 8) | span[offset + 3];
+#endif
+}
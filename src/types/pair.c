@@ -1,5 +1,6 @@
 #include "types/pair.h"
 #include <string.h>
+#include <strings.h> // for strcasecmp
 
 pair_t *pair_array_first(const pair_array_t *array) {
     if (array == NULL)
@@ -32,3 +33,20 @@ pair_t *pair_array_lookup_value(const pair_array_t *array, const char *value) {
     }
     return NULL;
 }
+
+const char *pair_table_lookup_sparse(const pair_table_t *table, int key) {
+    const pair_t *pair = pair_array_lookup_key(&table->sparse, key);
+    return pair != NULL ? pair->value : table->unknown;
+}
+
+int pair_table_lookup_value(const pair_table_t *table, const char *value) {
+    for (size_t i = 0; i < table->count; i++) {
+        if (table->names[i] != NULL && strcasecmp(value, table->names[i]) == 0)
+            return (int)i;
+    }
+    for (size_t i = 0; i < table->sparse.count; i++) {
+        if (strcasecmp(value, table->sparse.data[i].value) == 0)
+            return table->sparse.data[i].key;
+    }
+    return -1;
+}
@@ -17,3 +17,27 @@ pair_t *pair_array_first(const pair_array_t *array);
 pair_t *pair_array_last(const pair_array_t *array);
 pair_t *pair_array_lookup_key(const pair_array_t *array, int key);
 pair_t *pair_array_lookup_value(const pair_array_t *array, const char *value);
+
+//
+// Names indexed by key, for lookups that are a single load. The names are written with
+// designated initializers, e.g. `[DNS_TYPE_A] = "A"`, so the compiler lays out the table.
+// Keys too big for a dense table, and aliases of keys that already have a name, go in
+// `sparse`, which is only searched when the table has no name for the key.
+//
+typedef struct pair_table {
+    const char *const	*names;		// NULL where a key has no name
+    size_t				count;
+    pair_array_t		sparse;
+    const char *		unknown;	// name of the keys that are in neither
+} pair_table_t;
+
+const char *pair_table_lookup_sparse(const pair_table_t *table, int key);
+
+static inline const char *pair_table_lookup_key(const pair_table_t *table, int key) {
+    if ((unsigned)key < table->count && table->names[key] != NULL)
+        return table->names[key];
+    return pair_table_lookup_sparse(table, key);
+}
+
+// Reverse lookup, case insensitive. Returns the key, or -1 if no name matches.
+int pair_table_lookup_value(const pair_table_t *table, const char *value);